@@ -20,13 +20,14 @@ SRC_PATH = src
 CXXFLAGS = -std=c++17 -Wall -Wextra
 CXXFLAGS += -O2 -march=native
 #CXXFLAGS += -DYYDEBUG=1
+#CXXFLAGS += -DSPECS_SIGNAL_IDS=1
 CXXFLAGS += -g
 
 # Add additional include paths (SRC_PATH and subdirectories are automatically added)
 INCLUDES = -I${SYSTEMC_PATH_INCLUDE} -isystem thirdparty/args
 
 # General linker settings
-LDFLAGS += -L${SYSTEMC_PATH_LIBS} -lsystemc -lm
+LDFLAGS += -L${SYSTEMC_PATH_LIBS} -lsystemc -lm -pthread
 LDFLAGS += -Wl,-rpath -Wl,${SYSTEMC_PATH_LIBS}
 
 # Destination directory
@@ -0,0 +1,124 @@
+// One-dimensional buffers exported to Python through the buffer protocol
+// (wrapped without a copy by numpy.frombuffer), shared by the native
+// modules of pyspecs.
+//
+// Each module must call array_type_ready() in its init function.
+
+#pragma once
+
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+
+#include <cstdlib>
+#include <vector>
+
+namespace {
+
+// Buffer of uint64 ('Q') or double ('d') values, whose memory is released
+// by release(owner)
+struct ArrayObject {
+    PyObject_HEAD
+    void *data;
+    Py_ssize_t n;
+    Py_ssize_t itemsize;
+    char format[2];
+    void *owner;
+    void (*release)(void *);
+};
+
+void Array_dealloc(ArrayObject *self)
+{
+    if (self->release)
+        self->release(self->owner);
+    Py_TYPE(self)->tp_free(reinterpret_cast<PyObject *>(self));
+}
+
+int Array_getbuffer(ArrayObject *self, Py_buffer *view, int flags)
+{
+    view->obj = reinterpret_cast<PyObject *>(self);
+    Py_INCREF(self);
+    view->buf = self->data;
+    view->len = self->n * self->itemsize;
+    view->readonly = 0;
+    view->itemsize = self->itemsize;
+    view->format = (flags & PyBUF_FORMAT) ? self->format : nullptr;
+    view->ndim = 1;
+    view->shape = (flags & PyBUF_ND) ? &self->n : nullptr;
+    view->strides = (flags & PyBUF_STRIDES) ? &self->itemsize : nullptr;
+    view->suboffsets = nullptr;
+    view->internal = nullptr;
+    return 0;
+}
+
+Py_ssize_t Array_length(ArrayObject *self)
+{
+    return self->n;
+}
+
+PyBufferProcs Array_as_buffer;
+PySequenceMethods Array_as_sequence;
+
+PyTypeObject ArrayType = {
+    PyVarObject_HEAD_INIT(nullptr, 0)
+};
+
+int array_type_ready(const char *name)
+{
+    Array_as_buffer.bf_getbuffer = reinterpret_cast<getbufferproc>(Array_getbuffer);
+    Array_as_sequence.sq_length = reinterpret_cast<lenfunc>(Array_length);
+
+    ArrayType.tp_name = name;
+    ArrayType.tp_basicsize = sizeof(ArrayObject);
+    ArrayType.tp_dealloc = reinterpret_cast<destructor>(Array_dealloc);
+    ArrayType.tp_as_buffer = &Array_as_buffer;
+    ArrayType.tp_as_sequence = &Array_as_sequence;
+    ArrayType.tp_flags = Py_TPFLAGS_DEFAULT;
+    ArrayType.tp_doc = "Buffer of trace values";
+    return PyType_Ready(&ArrayType);
+}
+
+char array_format(uint64_t) { return 'Q'; }
+char array_format(double) { return 'd'; }
+
+// New array with room for capacity values (its length is set afterwards)
+template <class T>
+ArrayObject *new_array(size_t capacity)
+{
+    auto self = PyObject_New(ArrayObject, &ArrayType);
+    if (!self)
+        return nullptr;
+    self->data = std::malloc(capacity ? capacity * sizeof(T) : 1);
+    self->n = 0;
+    self->itemsize = sizeof(T);
+    self->format[0] = array_format(T());
+    self->format[1] = '\0';
+    self->owner = self->data;
+    self->release = std::free;
+    if (!self->data)
+    {
+        Py_DECREF(self);
+        PyErr_NoMemory();
+        return nullptr;
+    }
+    return self;
+}
+
+// Array taking over the memory of a vector
+template <class T>
+ArrayObject *array_from_vector(std::vector<T> &&values)
+{
+    auto self = PyObject_New(ArrayObject, &ArrayType);
+    if (!self)
+        return nullptr;
+    auto owner = new std::vector<T>(std::move(values));
+    self->data = owner->data();
+    self->n = owner->size();
+    self->itemsize = sizeof(T);
+    self->format[0] = array_format(T());
+    self->format[1] = '\0';
+    self->owner = owner;
+    self->release = [](void *p) { delete static_cast<std::vector<T> *>(p); };
+    return self;
+}
+
+} // namespace
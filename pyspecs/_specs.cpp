@@ -0,0 +1,288 @@
+// In-process bindings to libspecs
+//
+// run() parses and simulates a netlist inside the Python process: probes,
+// photodetectors and power meters record to a MemoryTrace (src/memory_trace.h)
+// whose columns are handed to Python through the buffer protocol, without
+// writing or parsing any trace file.
+//
+// SystemC elaborates a single circuit per process, so run() can only be
+// called once; native.simulate() runs each evaluation in a forked child.
+// The OP or DC analysis of that circuit can be run again with rerun(),
+// after set_parameter(): samples are recorded in the same MemoryTrace.
+
+#include "_buffer.h"
+
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "binary_trace.h"
+#include "memory_trace.h"
+#include "specs_api.h"
+
+// libsystemc calls sc_main() from its main(), which is never used here
+int sc_main(int, char *[])
+{
+    return 0;
+}
+
+namespace {
+
+// Value of a .options keyword from a Python object
+bool option_value(PyObject *value, std::string &out)
+{
+    if (PyBool_Check(value))
+    {
+        out = value == Py_True ? "1" : "0";
+        return true;
+    }
+    if (PyUnicode_Check(value))
+    {
+        const char *s = PyUnicode_AsUTF8(value);
+        if (!s)
+            return false;
+        out = std::string("\"") + s + "\"";
+        return true;
+    }
+    PyObject *str = PyObject_Str(value);
+    if (!str)
+        return false;
+    const char *s = PyUnicode_AsUTF8(str);
+    if (s)
+        out = s;
+    Py_DECREF(str);
+    return s != nullptr;
+}
+
+// {'tick': Array, column: Array, ...} of a channel, taking over its samples
+PyObject *channel_dict(MemoryTrace::Channel &ch, const std::vector<double> &wavelengths)
+{
+    PyObject *result = PyDict_New();
+    if (!result)
+        return nullptr;
+    auto set = [result](const char *key, ArrayObject *array) {
+        if (!array)
+            return false;
+        const int res = PyDict_SetItemString(result, key, reinterpret_cast<PyObject *>(array));
+        Py_DECREF(array);
+        return res == 0;
+    };
+
+    const size_t n = ch.times.size();
+    if (!set("tick", array_from_vector(std::move(ch.times))))
+    {
+        Py_DECREF(result);
+        return nullptr;
+    }
+
+    if (!ch.field)
+    {
+        for (size_t k = 0; k < ch.columns.size(); ++k)
+        {
+            if (!set(ch.columns[k].c_str(), array_from_vector(std::move(ch.values[k]))))
+            {
+                Py_DECREF(result);
+                return nullptr;
+            }
+        }
+        return result;
+    }
+
+    // Optical fields: same derived columns as the binary traces
+    static const char *derived[] = {"power", "abs", "phase", "wavelength"};
+    std::vector<std::vector<double>> columns(4, std::vector<double>(n));
+    double *out[4];
+    for (size_t k = 0; k < 4; ++k)
+        out[k] = columns[k].data();
+    derive_optical_fields(ch.values[0].data(), ch.values[1].data(), ch.values[2].data(), n, wavelengths, out);
+    ch.values.clear();
+    for (size_t k = 0; k < 4; ++k)
+    {
+        if (!set(derived[k], array_from_vector(std::move(columns[k]))))
+        {
+            Py_DECREF(result);
+            return nullptr;
+        }
+    }
+    return result;
+}
+
+// {'time_unit', 'wavelengths', 'channels'} of a run, taking over its samples
+PyObject *result_dict(MemoryTrace &trace)
+{
+    PyObject *channels = PyDict_New();
+    if (!channels)
+        return nullptr;
+    for (size_t c = 0; c < trace.channel_count(); ++c)
+    {
+        auto &ch = trace.channel(c);
+        PyObject *data = channel_dict(ch, trace.wavelengths);
+        if (!data || PyDict_SetItemString(channels, ch.name.c_str(), data) < 0)
+        {
+            Py_XDECREF(data);
+            Py_DECREF(channels);
+            return nullptr;
+        }
+        Py_DECREF(data);
+    }
+
+    PyObject *wavelengths = PyTuple_New(trace.wavelengths.size());
+    for (size_t i = 0; wavelengths && i < trace.wavelengths.size(); ++i)
+        PyTuple_SET_ITEM(wavelengths, i, PyFloat_FromDouble(trace.wavelengths[i]));
+    return Py_BuildValue("{s:d,s:N,s:N}", "time_unit", trace.time_unit_s,
+            "wavelengths", wavelengths, "channels", channels);
+}
+
+PyObject *specs_run(PyObject *, PyObject *args, PyObject *kwargs)
+{
+    static const char *kwlist[] = {"netlist", "files", "options", "trace_files", nullptr};
+    const char *netlist = "";
+    PyObject *files = nullptr;
+    PyObject *options = nullptr;
+    int trace_files = 0;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "|sOOp", const_cast<char **>(kwlist),
+            &netlist, &files, &options, &trace_files))
+        return nullptr;
+
+    if (specs_api::has_simulated())
+    {
+        PyErr_SetString(PyExc_RuntimeError,
+                "SPECS can only simulate one circuit per process (use native.simulate)");
+        return nullptr;
+    }
+
+    std::vector<std::string> filenames;
+    if (files && files != Py_None)
+    {
+        PyObject *seq = PySequence_Fast(files, "files must be a sequence of paths");
+        if (!seq)
+            return nullptr;
+        for (Py_ssize_t i = 0; i < PySequence_Fast_GET_SIZE(seq); ++i)
+        {
+            PyObject *path;
+            if (!PyUnicode_FSConverter(PySequence_Fast_GET_ITEM(seq, i), &path))
+            {
+                Py_DECREF(seq);
+                return nullptr;
+            }
+            filenames.push_back(PyBytes_AS_STRING(path));
+            Py_DECREF(path);
+        }
+        Py_DECREF(seq);
+    }
+
+    // Options come after the netlist, as the command line overrides
+    std::stringstream text;
+    text << netlist << std::endl;
+    if (options && options != Py_None)
+    {
+        if (!PyDict_Check(options))
+        {
+            PyErr_SetString(PyExc_TypeError, "options must be a dict");
+            return nullptr;
+        }
+        PyObject *key, *value;
+        Py_ssize_t pos = 0;
+        while (PyDict_Next(options, &pos, &key, &value))
+        {
+            const char *name = PyUnicode_AsUTF8(key);
+            std::string s;
+            if (!name || !option_value(value, s))
+                return nullptr;
+            text << ".options " << name << "=" << s << std::endl;
+        }
+    }
+    text << std::endl;
+
+    shared_ptr<MemoryTrace> trace;
+    Py_BEGIN_ALLOW_THREADS
+    trace = specs_api::simulate(filenames, text.str(), trace_files);
+    Py_END_ALLOW_THREADS
+    if (!trace)
+    {
+        PyErr_SetString(PyExc_RuntimeError, "parsing the netlist failed");
+        return nullptr;
+    }
+
+    return result_dict(*trace);
+}
+
+PyObject *specs_set_parameter(PyObject *, PyObject *args)
+{
+    const char *name;
+    const char *attribute;
+    double value;
+    if (!PyArg_ParseTuple(args, "ssd", &name, &attribute, &value))
+        return nullptr;
+    if (!specs_api::set_parameter(name, attribute, value))
+    {
+        PyErr_Format(PyExc_ValueError, "can't set %s of %s", attribute, name);
+        return nullptr;
+    }
+    Py_RETURN_NONE;
+}
+
+PyObject *specs_rerun(PyObject *, PyObject *)
+{
+    shared_ptr<MemoryTrace> trace;
+    Py_BEGIN_ALLOW_THREADS
+    trace = specs_api::rerun();
+    Py_END_ALLOW_THREADS
+    if (!trace)
+    {
+        PyErr_SetString(PyExc_RuntimeError,
+                "no OP or DC analysis to run again (run() must be called first)");
+        return nullptr;
+    }
+    return result_dict(*trace);
+}
+
+PyObject *specs_has_simulated(PyObject *, PyObject *)
+{
+    return PyBool_FromLong(specs_api::has_simulated());
+}
+
+PyMethodDef specs_methods[] = {
+    {"run", reinterpret_cast<PyCFunction>(reinterpret_cast<void (*)(void)>(specs_run)),
+        METH_VARARGS | METH_KEYWORDS,
+        "run(netlist='', files=(), options={}, trace_files=False) -> dict\n\n"
+        "Simulate a netlist (text and/or files) in this process, with options\n"
+        "as .options keywords. Returns {'time_unit', 'wavelengths', 'channels'},\n"
+        "channels mapping each probe, detector and power meter to its columns.\n"
+        "Can only be called once per process."},
+    {"set_parameter", specs_set_parameter, METH_VARARGS,
+        "set_parameter(name, attribute, value)\n\n"
+        "Set a parameter of a device of the circuit built by run(), as the\n"
+        "netlist keyword (e.g. 'L' of a waveguide), or 'V' of an electrical net."},
+    {"rerun", specs_rerun, METH_NOARGS,
+        "rerun() -> dict\n\n"
+        "Run the OP or DC analysis of the circuit built by run() again, with\n"
+        "the parameters set since, and return the same dict as run()."},
+    {"has_simulated", specs_has_simulated, METH_NOARGS,
+        "has_simulated() -> bool\n\n"
+        "Whether this process already ran a simulation."},
+    {nullptr, nullptr, 0, nullptr},
+};
+
+PyModuleDef specs_module = {
+    PyModuleDef_HEAD_INIT,
+    "_specs",
+    "In-process bindings to libspecs",
+    -1,
+    specs_methods,
+};
+
+} // namespace
+
+PyMODINIT_FUNC PyInit__specs(void)
+{
+    if (array_type_ready("pyspecs._specs.Array") < 0)
+        return nullptr;
+
+    PyObject *m = PyModule_Create(&specs_module);
+    if (!m)
+        return nullptr;
+    Py_INCREF(&ArrayType);
+    PyModule_AddObject(m, "Array", reinterpret_cast<PyObject *>(&ArrayType));
+    return m;
+}
@@ -0,0 +1,217 @@
+// Native reader of the binary traces (.sptr) written by SPECS
+//
+// Wraps BinaryTraceReader (src/binary_trace.h): the trace is memory-mapped,
+// the index locates the chunks overlapping the requested time window, and
+// they are decoded straight into buffers which are handed to Python
+// through the buffer protocol (numpy.frombuffer wraps them without a copy,
+// see sptr.py).
+
+#include "_buffer.h"
+
+#include <limits>
+#include <string>
+#include <vector>
+
+#include "binary_trace.h"
+
+namespace {
+
+struct ReaderObject {
+    PyObject_HEAD
+    BinaryTraceReader *reader;
+};
+
+PyObject *Reader_new(PyTypeObject *type, PyObject *, PyObject *)
+{
+    auto self = reinterpret_cast<ReaderObject *>(type->tp_alloc(type, 0));
+    if (self)
+        self->reader = new BinaryTraceReader();
+    return reinterpret_cast<PyObject *>(self);
+}
+
+int Reader_init(ReaderObject *self, PyObject *args, PyObject *)
+{
+    PyObject *path;
+    if (!PyArg_ParseTuple(args, "O&", PyUnicode_FSConverter, &path))
+        return -1;
+    std::string error;
+    const bool ok = self->reader->open(PyBytes_AS_STRING(path), error);
+    Py_DECREF(path);
+    if (!ok)
+    {
+        PyErr_SetString(PyExc_OSError, error.c_str());
+        return -1;
+    }
+    return 0;
+}
+
+void Reader_dealloc(ReaderObject *self)
+{
+    delete self->reader;
+    Py_TYPE(self)->tp_free(reinterpret_cast<PyObject *>(self));
+}
+
+PyObject *Reader_time_unit(ReaderObject *self, void *)
+{
+    return PyFloat_FromDouble(self->reader->time_unit());
+}
+
+PyObject *Reader_wavelengths(ReaderObject *self, void *)
+{
+    const auto &wavelengths = self->reader->wavelengths();
+    PyObject *result = PyTuple_New(wavelengths.size());
+    for (size_t i = 0; result && i < wavelengths.size(); ++i)
+        PyTuple_SET_ITEM(result, i, PyFloat_FromDouble(wavelengths[i]));
+    return result;
+}
+
+// [(name, kind, columns)], with the columns as returned by read()
+PyObject *Reader_channels(ReaderObject *self, void *)
+{
+    const auto &channels = self->reader->channels();
+    PyObject *result = PyList_New(channels.size());
+    for (size_t c = 0; result && c < channels.size(); ++c)
+    {
+        const auto &columns = self->reader->export_columns(c);
+        PyObject *cols = PyTuple_New(columns.size());
+        for (size_t k = 0; cols && k < columns.size(); ++k)
+            PyTuple_SET_ITEM(cols, k, PyUnicode_FromString(columns[k].c_str()));
+        const char *kind = channels[c].kind == BinaryTrace::FIELD_CHANNEL ? "field" : "values";
+        PyList_SET_ITEM(result, c, Py_BuildValue("(ssN)", channels[c].name.c_str(), kind, cols));
+    }
+    return result;
+}
+
+bool parse_window(ReaderObject *self, PyObject *args, PyObject *kwargs,
+        Py_ssize_t &channel, unsigned long long &t_begin, unsigned long long &t_end, int *raw)
+{
+    static const char *kwlist[] = {"channel", "t_begin", "t_end", "raw", nullptr};
+    t_begin = 0;
+    t_end = std::numeric_limits<unsigned long long>::max();
+    int unused = 0;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "n|KKp", const_cast<char **>(kwlist),
+            &channel, &t_begin, &t_end, raw ? raw : &unused))
+        return false;
+    if (channel < 0 || static_cast<size_t>(channel) >= self->reader->channels().size())
+    {
+        PyErr_SetString(PyExc_IndexError, "channel index out of range");
+        return false;
+    }
+    return true;
+}
+
+PyObject *Reader_max_samples(ReaderObject *self, PyObject *args, PyObject *kwargs)
+{
+    Py_ssize_t c;
+    unsigned long long t_begin, t_end;
+    if (!parse_window(self, args, kwargs, c, t_begin, t_end, nullptr))
+        return nullptr;
+    return PyLong_FromSize_t(self->reader->max_samples(c, t_begin, t_end));
+}
+
+// (times, (column, ...)) of the samples with t_begin <= t < t_end
+PyObject *Reader_read(ReaderObject *self, PyObject *args, PyObject *kwargs)
+{
+    Py_ssize_t c;
+    unsigned long long t_begin, t_end;
+    int raw = 0;
+    if (!parse_window(self, args, kwargs, c, t_begin, t_end, &raw))
+        return nullptr;
+
+    auto &reader = *self->reader;
+    const size_t n_max = reader.max_samples(c, t_begin, t_end);
+    const size_t n_columns = raw ? reader.channels()[c].columns.size() : reader.export_columns(c).size();
+
+    ArrayObject *times = new_array<uint64_t>(n_max);
+    PyObject *columns = times ? PyTuple_New(n_columns) : nullptr;
+    if (!columns)
+    {
+        Py_XDECREF(times);
+        return nullptr;
+    }
+    double *out[BinaryTrace::max_columns];
+    for (size_t k = 0; k < n_columns; ++k)
+    {
+        ArrayObject *col = new_array<double>(n_max);
+        if (!col)
+        {
+            Py_DECREF(times);
+            Py_DECREF(columns);
+            return nullptr;
+        }
+        out[k] = static_cast<double *>(col->data);
+        PyTuple_SET_ITEM(columns, k, reinterpret_cast<PyObject *>(col));
+    }
+
+    size_t n;
+    Py_BEGIN_ALLOW_THREADS
+    n = reader.read_into(c, t_begin, t_end, static_cast<uint64_t *>(times->data), out, !raw);
+    Py_END_ALLOW_THREADS
+
+    times->n = n;
+    for (size_t k = 0; k < n_columns; ++k)
+        reinterpret_cast<ArrayObject *>(PyTuple_GET_ITEM(columns, k))->n = n;
+    return Py_BuildValue("(NN)", times, columns);
+}
+
+PyGetSetDef Reader_getset[] = {
+    {"time_unit", reinterpret_cast<getter>(Reader_time_unit), nullptr,
+        "Duration of a time step, in seconds", nullptr},
+    {"wavelengths", reinterpret_cast<getter>(Reader_wavelengths), nullptr,
+        "Wavelength of each wavelength id (m)", nullptr},
+    {"channels", reinterpret_cast<getter>(Reader_channels), nullptr,
+        "List of (name, kind, columns) of the channels", nullptr},
+    {nullptr, nullptr, nullptr, nullptr, nullptr},
+};
+
+PyMethodDef Reader_methods[] = {
+    {"read", reinterpret_cast<PyCFunction>(reinterpret_cast<void (*)(void)>(Reader_read)),
+        METH_VARARGS | METH_KEYWORDS,
+        "read(channel, t_begin=0, t_end=max, raw=False) -> (times, columns)\n\n"
+        "Samples of a channel with t_begin <= t < t_end (in time steps).\n"
+        "Field channels give power, abs, phase and wavelength unless raw."},
+    {"max_samples", reinterpret_cast<PyCFunction>(reinterpret_cast<void (*)(void)>(Reader_max_samples)),
+        METH_VARARGS | METH_KEYWORDS,
+        "max_samples(channel, t_begin=0, t_end=max) -> int\n\n"
+        "Size of the chunks of a channel overlapping the window."},
+    {nullptr, nullptr, 0, nullptr},
+};
+
+PyTypeObject ReaderType = {
+    PyVarObject_HEAD_INIT(nullptr, 0)
+};
+
+PyModuleDef sptr_module = {
+    PyModuleDef_HEAD_INIT,
+    "_sptr",
+    "Native reader of SPECS binary traces (.sptr)",
+    -1,
+    nullptr,
+};
+
+} // namespace
+
+PyMODINIT_FUNC PyInit__sptr(void)
+{
+    ReaderType.tp_name = "pyspecs._sptr.Reader";
+    ReaderType.tp_basicsize = sizeof(ReaderObject);
+    ReaderType.tp_new = Reader_new;
+    ReaderType.tp_init = reinterpret_cast<initproc>(Reader_init);
+    ReaderType.tp_dealloc = reinterpret_cast<destructor>(Reader_dealloc);
+    ReaderType.tp_getset = Reader_getset;
+    ReaderType.tp_methods = Reader_methods;
+    ReaderType.tp_flags = Py_TPFLAGS_DEFAULT;
+    ReaderType.tp_doc = "Reader(filename): memory-mapped binary trace";
+
+    if (array_type_ready("pyspecs._sptr.Array") < 0 || PyType_Ready(&ReaderType) < 0)
+        return nullptr;
+
+    PyObject *m = PyModule_Create(&sptr_module);
+    if (!m)
+        return nullptr;
+    Py_INCREF(&ArrayType);
+    PyModule_AddObject(m, "Array", reinterpret_cast<PyObject *>(&ArrayType));
+    Py_INCREF(&ReaderType);
+    PyModule_AddObject(m, "Reader", reinterpret_cast<PyObject *>(&ReaderType));
+    return m;
+}
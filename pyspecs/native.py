@@ -0,0 +1,105 @@
+import os
+import pickle
+import sys
+
+import numpy as np
+
+from . import _specs
+
+def _to_numpy(result):
+    for data in result['channels'].values():
+        for col, buf in data.items():
+            data[col] = np.frombuffer(buf, dtype=np.uint64 if col == 'tick' else np.float64)
+    return result
+
+def _to_bytes(result):
+    for data in result['channels'].values():
+        for col, buf in data.items():
+            data[col] = bytes(memoryview(buf))
+    return result
+
+def simulate(netlist='', files=(), options=None, fork=True, trace_files=False):
+    """Simulates a netlist with libspecs, without a SPECS subprocess.
+
+    Probes, photodetectors and power meters record in memory, so nothing is
+    written to or parsed from VCD files.
+
+    Args:
+        netlist (str):
+            Netlist text, parsed after the files.
+        files (list of str):
+            Netlist files.
+        options (dict):
+            Simulator options, as `.options` keywords (e.g.
+            {'abstol': 1e-8, 'seed': 3}), overriding those of the netlist.
+        fork (bool):
+            SystemC can only simulate one circuit per process, so by default
+            the simulation runs in a forked child, which can be repeated
+            (e.g. in an optimization loop) and in which an invalid netlist
+            can't terminate the caller. With fork=False it runs in this
+            process, once, and the arrays share memory with the recorded
+            samples; the circuit can then be simulated again with other
+            parameters by rerun().
+        trace_files (bool):
+            Also write the trace files of the netlist, as the command line.
+
+    Returns:
+        result (dict):
+            'time_unit' (duration of a tick, in s), 'wavelengths' (by
+            wavelength id, in m) and 'channels', mapping the name of each
+            probe, detector and power meter to a dict of numpy arrays:
+            'tick' and power/abs/phase/wavelength for probes,
+            readout/readout_no_interference for detectors, power for power
+            meters.
+    """
+    kwargs = dict(netlist=netlist, files=list(files), options=options or {}, trace_files=trace_files)
+    if not fork:
+        return _to_numpy(_specs.run(**kwargs))
+
+    sys.stdout.flush()
+    sys.stderr.flush()
+    r, w = os.pipe()
+    pid = os.fork()
+    if pid == 0:
+        os.close(r)
+        status = 1
+        try:
+            with os.fdopen(w, 'wb') as out:
+                pickle.dump(_to_bytes(_specs.run(**kwargs)), out, protocol=pickle.HIGHEST_PROTOCOL)
+            status = 0
+        finally:
+            os._exit(status)
+
+    os.close(w)
+    with os.fdopen(r, 'rb') as inp:
+        payload = inp.read()
+    _, status = os.waitpid(pid, 0)
+    if status != 0 or not payload:
+        raise RuntimeError('SPECS simulation failed (exit status {})'.format(os.waitstatus_to_exitcode(status)))
+    return _to_numpy(pickle.loads(payload))
+
+def rerun(parameters=None):
+    """Simulates again the circuit of simulate(..., fork=False), in this
+    process, with other parameters.
+
+    The circuit isn't parsed or elaborated again: parameters are set on the
+    devices and the OP or DC analysis of the netlist is run again (a TRAN
+    analysis can't be, as SystemC time can't go back). Probes record the
+    steady state (the whole sweep of a DC analysis), at ticks following
+    those of the previous run.
+
+    Args:
+        parameters (dict):
+            Values by (element, attribute), with the attributes of the
+            netlist (e.g. {('wg1', 'L'): 310e-6, ('cw1', 'WL'): 1.55e-6}),
+            or by (net, 'V') for electrical nets (e.g. driving phase
+            shifters).
+
+    Returns:
+        result (dict):
+            Same as simulate(). Arrays share memory with the new samples,
+            those of previous results are left untouched.
+    """
+    for (name, attribute), value in (parameters or {}).items():
+        _specs.set_parameter(name, attribute, float(value))
+    return _to_numpy(_specs.rerun())
@@ -0,0 +1,46 @@
+"""Builds the native extensions of pyspecs in place:
+
+    cd pyspecs && python setup.py build_ext --inplace
+
+(or `make pyspecs` from the root of the repository)
+
+The in-process bindings (_specs) are only built once libspecs.so has been
+built (`make lib`, done by `make pyspecs`).
+"""
+import os
+from setuptools import setup, Extension
+
+here = os.path.dirname(os.path.abspath(__file__))
+root = os.path.dirname(here)
+src = os.path.join(root, 'src')
+systemc_lib = os.path.join(root, 'thirdparty', 'systemc', 'sc_install', 'lib')
+
+sptr = Extension(
+    '_sptr',
+    sources=[os.path.join(here, '_sptr.cpp'),
+             os.path.join(src, 'binary_trace.cpp')],
+    include_dirs=[src],
+    extra_compile_args=['-std=c++17', '-O2'],
+    extra_link_args=['-pthread'],
+    language='c++',
+)
+
+ext_modules = [sptr]
+
+if os.path.exists(os.path.join(root, 'libspecs.so')):
+    ext_modules.append(Extension(
+        '_specs',
+        sources=[os.path.join(here, '_specs.cpp')],
+        include_dirs=[src],
+        libraries=['specs'],
+        library_dirs=[root],
+        runtime_library_dirs=[root, systemc_lib],
+        extra_compile_args=['-std=c++17', '-O2'],
+        extra_link_args=['-pthread'],
+        language='c++',
+    ))
+
+setup(
+    name='pyspecs-native',
+    ext_modules=ext_modules,
+)
@@ -0,0 +1,78 @@
+import numpy as np
+
+from ._sptr import Reader
+
+class Trace:
+    """Binary trace (.sptr) written by SPECS with `--trace-format binary`.
+
+    The file is memory-mapped: opening it only reads its index, and
+    read() only decodes the chunks overlapping the requested time window.
+    The returned NumPy arrays wrap the decoded buffers without copying.
+
+    Example:
+        trace = Trace('traces/delete_me.vcd.sptr')
+        for name in trace.channels:
+            data = trace.read(name, start=1e-9, stop=2e-9)
+            print(name, data['time'][-1], data['power'].max())
+    """
+
+    def __init__(self, filename):
+        self._reader = Reader(filename)
+        self._channels = {name: (i, kind, columns)
+                          for i, (name, kind, columns) in enumerate(self._reader.channels)}
+
+    @property
+    def time_unit(self):
+        """Duration of a time step (tick), in seconds."""
+        return self._reader.time_unit
+
+    @property
+    def wavelengths(self):
+        """Wavelength of each wavelength id, in meters."""
+        return self._reader.wavelengths
+
+    @property
+    def channels(self):
+        """Names of the channels (one per probe)."""
+        return list(self._channels)
+
+    def columns(self, name):
+        """Columns returned by read() for a channel."""
+        return list(self._channels[name][2])
+
+    def read(self, name, start=None, stop=None, raw=False):
+        """Reads the samples of a channel in a time window.
+
+        Args:
+            name (str):
+                Name of the channel (probe).
+            start, stop (float):
+                Window [start, stop) in seconds (whole trace by default).
+            raw (bool):
+                For probes, return the recorded wavelength_id, re and im
+                instead of power, abs, phase and wavelength.
+
+        Returns:
+            data (dict of numpy arrays):
+                'tick' (uint64 time steps), 'time' (s) and one entry per
+                column. All but 'time' share memory with the decoded
+                chunks.
+        """
+        index = self._channels[name][0]
+        t_begin = 0 if start is None else max(0, int(np.ceil(start / self.time_unit - 1e-6)))
+        t_end = 2**64 - 1 if stop is None else max(0, int(np.ceil(stop / self.time_unit - 1e-6)))
+        times, values = self._reader.read(index, t_begin, t_end, raw)
+
+        if raw and self._channels[name][1] == 'field':
+            columns = ['wavelength_id', 're', 'im']
+        else:
+            columns = self._channels[name][2]
+        data = {'tick': np.frombuffer(times, dtype=np.uint64)}
+        data['time'] = data['tick'] * self.time_unit
+        for col, buf in zip(columns, values):
+            data[col] = np.frombuffer(buf, dtype=np.float64)
+        return data
+
+def open_trace(filename):
+    """Opens a binary trace (see Trace)."""
+    return Trace(filename)
@@ -0,0 +1,761 @@
+#include "binary_trace.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <queue>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std;
+
+namespace {
+
+const char trace_magic[8] = {'S', 'P', 'X', 'T', 'R', 'A', 'C', 'E'};
+const char trailer_magic[8] = {'S', 'P', 'X', 'T', 'R', 'I', 'D', 'X'};
+const char chunk_tag[4] = {'C', 'H', 'N', 'K'};
+const char index_tag[4] = {'I', 'N', 'D', 'X'};
+
+// Byte buffer helpers
+
+template <class T>
+void put(vector<uint8_t> &buf, const T &x)
+{
+    const auto p = reinterpret_cast<const uint8_t *>(&x);
+    buf.insert(buf.end(), p, p + sizeof(T));
+}
+
+void put_str(vector<uint8_t> &buf, const string &s)
+{
+    put<uint32_t>(buf, s.size());
+    buf.insert(buf.end(), s.begin(), s.end());
+}
+
+void put_varint(vector<uint8_t> &buf, uint64_t x)
+{
+    while (x >= 0x80)
+    {
+        buf.push_back(static_cast<uint8_t>(x) | 0x80);
+        x >>= 7;
+    }
+    buf.push_back(static_cast<uint8_t>(x));
+}
+
+// Encode a column: XOR with the previous value, then drop the leading and
+// trailing zero bytes
+void put_column(vector<uint8_t> &buf, const vector<double> &values)
+{
+    uint64_t prev = 0;
+    for (const double &v : values)
+    {
+        uint64_t bits;
+        memcpy(&bits, &v, sizeof(bits));
+        const uint64_t x = bits ^ prev;
+        prev = bits;
+        if (x == 0)
+        {
+            buf.push_back(0xff);
+            continue;
+        }
+        unsigned lead = 0;
+        while (lead < 7 && !(x >> (56 - 8 * lead) & 0xff))
+            ++lead;
+        unsigned trail = 0;
+        while (trail < 7 - lead && !(x >> (8 * trail) & 0xff))
+            ++trail;
+        buf.push_back(static_cast<uint8_t>(lead << 4 | trail));
+        for (unsigned k = trail; k < 8 - lead; ++k)
+            buf.push_back(static_cast<uint8_t>(x >> (8 * k)));
+    }
+}
+
+// Bounds-checked reads from a memory-mapped file (ok is cleared, and zeros
+// are returned, past the end)
+class ByteReader {
+    const uint8_t *m_p;
+    const uint8_t *m_end;
+
+public:
+    bool ok = true;
+
+    ByteReader(const uint8_t *p, size_t n) : m_p(p), m_end(p + n) {}
+
+    inline bool check(size_t n)
+    {
+        if (static_cast<size_t>(m_end - m_p) < n)
+        {
+            ok = false;
+            m_p = m_end;
+        }
+        return ok;
+    }
+
+    template <class T>
+    T get()
+    {
+        T x = T();
+        if (check(sizeof(T)))
+        {
+            memcpy(&x, m_p, sizeof(T));
+            m_p += sizeof(T);
+        }
+        return x;
+    }
+
+    string str()
+    {
+        const uint32_t n = get<uint32_t>();
+        if (!check(n))
+            return string();
+        string s(reinterpret_cast<const char *>(m_p), n);
+        m_p += n;
+        return s;
+    }
+
+    bool magic(const char *magic, size_t n)
+    {
+        if (!check(n) || memcmp(m_p, magic, n) != 0)
+            return false;
+        m_p += n;
+        return true;
+    }
+
+    uint8_t byte()
+    {
+        return check(1) ? *m_p++ : 0;
+    }
+
+    uint64_t varint()
+    {
+        uint64_t x = 0;
+        for (unsigned shift = 0; shift < 64; shift += 7)
+        {
+            const uint8_t b = byte();
+            x |= static_cast<uint64_t>(b & 0x7f) << shift;
+            if (!(b & 0x80))
+                break;
+        }
+        return x;
+    }
+
+    void column(size_t n, double *values)
+    {
+        uint64_t prev = 0;
+        for (size_t i = 0; i < n; ++i)
+        {
+            const uint8_t h = byte();
+            uint64_t x = 0;
+            if (h != 0xff)
+            {
+                const unsigned lead = h >> 4;
+                const unsigned trail = h & 0xf;
+                for (unsigned k = trail; k < 8 - lead; ++k)
+                    x |= static_cast<uint64_t>(byte()) << (8 * k);
+            }
+            prev ^= x;
+            memcpy(&values[i], &prev, sizeof(prev));
+        }
+    }
+};
+
+// Size of the header of a chunk: tag, channel, n, t_first, t_last, size
+const size_t chunk_header_size = 4 + 4 + 4 + 8 + 8 + 4;
+} // namespace
+
+BinaryTrace::BinaryTrace(const string &filename, double time_unit_s,
+        size_t ring_capacity, size_t chunk_samples)
+    : m_filename(filename)
+    , m_time_unit_s(time_unit_s)
+    , m_ring_capacity(ring_capacity)
+    , m_chunk_samples(chunk_samples)
+{
+    m_file.open(m_filename, ios::out | ios::binary | ios::trunc);
+    if (!m_file)
+    {
+        cerr << "Cannot open trace file: " << m_filename << endl;
+        exit(1);
+    }
+
+    vector<uint8_t> header;
+    header.insert(header.end(), trace_magic, trace_magic + 8);
+    put<uint32_t>(header, version);
+    put<double>(header, m_time_unit_s);
+    m_file.write(reinterpret_cast<const char *>(header.data()), header.size());
+    m_n_bytes += header.size();
+}
+
+BinaryTrace::~BinaryTrace()
+{
+    close();
+}
+
+BinaryTrace::channel_id BinaryTrace::add_channel(const string &name, const vector<string> &columns,
+        ChannelKind kind)
+{
+    if (m_started)
+    {
+        cerr << "Cannot add trace channel " << name << " after the trace was started" << endl;
+        exit(1);
+    }
+    if (columns.empty() || columns.size() > max_columns)
+    {
+        cerr << "Trace channel " << name << " must have 1 to " << max_columns << " columns" << endl;
+        exit(1);
+    }
+
+    m_channels.emplace_back(new Channel());
+    auto &c = *m_channels.back();
+    c.name = name;
+    c.kind = kind;
+    c.columns = columns;
+    c.ring.reset(new SpscRing<Sample>(m_ring_capacity));
+    c.values.resize(columns.size());
+    return m_channels.size() - 1;
+}
+
+void BinaryTrace::start()
+{
+    if (m_started || m_closed)
+        return;
+    m_started = true;
+    m_writer = std::thread(&BinaryTrace::writer_loop, this);
+}
+
+size_t BinaryTrace::drain(Channel &c)
+{
+    size_t n = 0;
+    Sample s;
+    while (c.ring->try_pop(s))
+    {
+        c.times.push_back(s.t);
+        for (size_t k = 0; k < c.columns.size(); ++k)
+            c.values[k].push_back(s.v[k]);
+        ++n;
+    }
+    return n;
+}
+
+void BinaryTrace::write_chunk(channel_id id, Channel &c)
+{
+    const size_t n = c.times.size();
+    if (n == 0)
+        return;
+
+    vector<uint8_t> payload;
+    payload.reserve(n * (2 + 4 * c.columns.size()));
+    uint64_t prev = c.times.front();
+    for (const auto &t : c.times)
+    {
+        put_varint(payload, t - prev);
+        prev = t;
+    }
+    for (const auto &col : c.values)
+        put_column(payload, col);
+
+    ChunkInfo info = {id, static_cast<uint32_t>(n), c.times.front(), c.times.back(), m_n_bytes};
+    m_chunks.push_back(info);
+
+    vector<uint8_t> header;
+    header.insert(header.end(), chunk_tag, chunk_tag + 4);
+    put<uint32_t>(header, info.channel);
+    put<uint32_t>(header, info.n);
+    put<uint64_t>(header, info.t_first);
+    put<uint64_t>(header, info.t_last);
+    put<uint32_t>(header, payload.size());
+    m_file.write(reinterpret_cast<const char *>(header.data()), header.size());
+    m_file.write(reinterpret_cast<const char *>(payload.data()), payload.size());
+    m_n_bytes += header.size() + payload.size();
+    m_n_samples += n;
+
+    c.times.clear();
+    for (auto &col : c.values)
+        col.clear();
+}
+
+void BinaryTrace::writer_loop()
+{
+    while (true)
+    {
+        const bool stopping = m_stop.load(std::memory_order_acquire);
+        size_t n = 0;
+        for (channel_id id = 0; id < m_channels.size(); ++id)
+        {
+            auto &c = *m_channels[id];
+            n += drain(c);
+            if (c.times.size() >= m_chunk_samples)
+                write_chunk(id, c);
+        }
+        if (stopping && n == 0)
+            break;
+        if (n == 0)
+        {
+            unique_lock<mutex> lock(m_mutex);
+            m_cv.wait_for(lock, chrono::milliseconds(1));
+        }
+    }
+}
+
+void BinaryTrace::write_index()
+{
+    vector<uint8_t> buf;
+    buf.insert(buf.end(), index_tag, index_tag + 4);
+    put<uint32_t>(buf, m_channels.size());
+    for (const auto &c : m_channels)
+    {
+        put_str(buf, c->name);
+        put<uint8_t>(buf, c->kind);
+        put<uint32_t>(buf, c->columns.size());
+        for (const auto &col : c->columns)
+            put_str(buf, col);
+    }
+    put<uint32_t>(buf, m_wavelengths.size());
+    for (const auto &wl : m_wavelengths)
+        put<double>(buf, wl);
+    put<uint64_t>(buf, m_chunks.size());
+    for (const auto &chunk : m_chunks)
+    {
+        put<uint32_t>(buf, chunk.channel);
+        put<uint32_t>(buf, chunk.n);
+        put<uint64_t>(buf, chunk.t_first);
+        put<uint64_t>(buf, chunk.t_last);
+        put<uint64_t>(buf, chunk.offset);
+    }
+    put<uint64_t>(buf, m_n_bytes);
+    buf.insert(buf.end(), trailer_magic, trailer_magic + 8);
+    m_file.write(reinterpret_cast<const char *>(buf.data()), buf.size());
+    m_n_bytes += buf.size();
+}
+
+void BinaryTrace::close()
+{
+    if (m_closed)
+        return;
+    m_closed = true;
+
+    if (m_started)
+    {
+        m_stop.store(true, std::memory_order_release);
+        m_cv.notify_one();
+        m_writer.join();
+    }
+
+    // Partial chunks
+    for (channel_id id = 0; id < m_channels.size(); ++id)
+    {
+        drain(*m_channels[id]);
+        write_chunk(id, *m_channels[id]);
+    }
+    write_index();
+    m_file.close();
+}
+
+const vector<string> &BinaryTraceReader::derived_columns()
+{
+    static const vector<string> columns = {"power", "abs", "phase", "wavelength"};
+    return columns;
+}
+
+BinaryTraceReader::BinaryTraceReader(const string &filename)
+{
+    string error;
+    if (!open(filename, error))
+    {
+        cerr << error << endl;
+        exit(1);
+    }
+}
+
+BinaryTraceReader::~BinaryTraceReader()
+{
+    close();
+}
+
+void BinaryTraceReader::close()
+{
+    if (m_data)
+        munmap(const_cast<uint8_t *>(m_data), m_size);
+    m_data = nullptr;
+    m_size = 0;
+    m_channels.clear();
+    m_chunks.clear();
+    m_wavelengths.clear();
+}
+
+bool BinaryTraceReader::open(const string &filename, string &error)
+{
+    close();
+
+    const int fd = ::open(filename.c_str(), O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0)
+    {
+        if (fd >= 0)
+            ::close(fd);
+        error = "Cannot open binary trace: " + filename;
+        return false;
+    }
+    m_size = st.st_size;
+    void *p = m_size ? mmap(nullptr, m_size, PROT_READ, MAP_SHARED, fd, 0) : MAP_FAILED;
+    ::close(fd);
+    if (p == MAP_FAILED)
+    {
+        m_size = 0;
+        error = "Not a binary trace file: " + filename;
+        return false;
+    }
+    m_data = static_cast<const uint8_t *>(p);
+
+    ByteReader header(m_data, m_size);
+    if (!header.magic(trace_magic, 8))
+    {
+        close();
+        error = "Not a binary trace file: " + filename;
+        return false;
+    }
+    // Version 1 has no channel kinds nor wavelength table
+    const uint32_t file_version = header.get<uint32_t>();
+    if (file_version < 1 || file_version > BinaryTrace::version)
+    {
+        close();
+        error = "Unsupported binary trace version: " + to_string(file_version);
+        return false;
+    }
+    m_time_unit_s = header.get<double>();
+
+    if (m_size < 16 + 16)
+    {
+        close();
+        error = "Binary trace has no index (was it closed?): " + filename;
+        return false;
+    }
+    ByteReader trailer(m_data + m_size - 16, 16);
+    const uint64_t index_offset = trailer.get<uint64_t>();
+    if (!trailer.magic(trailer_magic, 8) || index_offset >= m_size)
+    {
+        close();
+        error = "Binary trace has no index (was it closed?): " + filename;
+        return false;
+    }
+
+    ByteReader r(m_data + index_offset, m_size - index_offset);
+    bool valid = r.magic(index_tag, 4);
+    m_channels.resize(valid ? r.get<uint32_t>() : 0);
+    for (auto &c : m_channels)
+    {
+        c.name = r.str();
+        if (file_version >= 2)
+            c.kind = static_cast<BinaryTrace::ChannelKind>(r.get<uint8_t>());
+        c.columns.resize(r.get<uint32_t>());
+        if (c.columns.size() > BinaryTrace::max_columns)
+            valid = false;
+        if (!valid || !r.ok)
+            break;
+        for (auto &col : c.columns)
+            col = r.str();
+        if (c.kind == BinaryTrace::FIELD_CHANNEL && c.columns.size() != 3)
+            valid = false;
+    }
+    if (valid && file_version >= 2)
+    {
+        m_wavelengths.resize(r.get<uint32_t>());
+        for (auto &wl : m_wavelengths)
+            wl = r.get<double>();
+    }
+    m_chunks.resize(valid && r.ok ? r.get<uint64_t>() : 0);
+    for (size_t i = 0; valid && r.ok && i < m_chunks.size(); ++i)
+    {
+        auto &chunk = m_chunks[i];
+        chunk.channel = r.get<uint32_t>();
+        chunk.n = r.get<uint32_t>();
+        chunk.t_first = r.get<uint64_t>();
+        chunk.t_last = r.get<uint64_t>();
+        chunk.offset = r.get<uint64_t>();
+        if (chunk.channel >= m_channels.size() || chunk.offset + chunk_header_size > index_offset)
+        {
+            valid = false;
+            break;
+        }
+        ByteReader h(m_data + chunk.offset + chunk_header_size - 4, 4);
+        if (chunk.offset + chunk_header_size + h.get<uint32_t>() > index_offset)
+        {
+            valid = false;
+            break;
+        }
+        m_channels[chunk.channel].chunks.push_back(i);
+    }
+    if (!valid || !r.ok)
+    {
+        close();
+        error = "Corrupted binary trace index: " + filename;
+        return false;
+    }
+    return true;
+}
+
+void BinaryTraceReader::decode_chunk(size_t i, uint64_t *times, double *const *columns) const
+{
+    const auto &chunk = m_chunks[i];
+    const size_t n_columns = m_channels[chunk.channel].columns.size();
+
+    ByteReader h(m_data + chunk.offset + chunk_header_size - 4, 4);
+    ByteReader r(m_data + chunk.offset + chunk_header_size, h.get<uint32_t>());
+    uint64_t t = chunk.t_first;
+    for (size_t k = 0; k < chunk.n; ++k)
+    {
+        t += r.varint();
+        times[k] = t;
+    }
+    for (size_t col = 0; col < n_columns; ++col)
+        r.column(chunk.n, columns[col]);
+    if (!r.ok)
+    {
+        cerr << "Truncated binary trace chunk" << endl;
+        exit(1);
+    }
+}
+
+void BinaryTraceReader::read_chunk(size_t i, Block &block)
+{
+    const auto &chunk = m_chunks[i];
+    block.times.resize(chunk.n);
+    block.values.resize(m_channels[chunk.channel].columns.size());
+    vector<double *> columns;
+    for (auto &col : block.values)
+    {
+        col.resize(chunk.n);
+        columns.push_back(col.data());
+    }
+    decode_chunk(i, block.times.data(), columns.data());
+}
+
+vector<size_t>::const_iterator BinaryTraceReader::first_chunk(size_t c, uint64_t t_begin) const
+{
+    const auto &chunks = m_channels[c].chunks;
+    return lower_bound(chunks.begin(), chunks.end(), t_begin,
+        [&](size_t i, uint64_t t) { return m_chunks[i].t_last < t; });
+}
+
+size_t BinaryTraceReader::max_samples(size_t c, uint64_t t_begin, uint64_t t_end) const
+{
+    size_t n = 0;
+    const auto &chunks = m_channels[c].chunks;
+    for (auto it = first_chunk(c, t_begin); it != chunks.end() && m_chunks[*it].t_first < t_end; ++it)
+        n += m_chunks[*it].n;
+    return n;
+}
+
+size_t BinaryTraceReader::read_into(size_t c, uint64_t t_begin, uint64_t t_end,
+        uint64_t *times, double *const *columns, bool derived)
+{
+    const bool field = derived && m_channels[c].kind == BinaryTrace::FIELD_CHANNEL;
+    const size_t n_out = export_columns(c).size();
+    const size_t n_columns = field ? n_out : m_channels[c].columns.size();
+
+    size_t n = 0;
+    const auto &chunks = m_channels[c].chunks;
+    for (auto it = first_chunk(c, t_begin); it != chunks.end() && m_chunks[*it].t_first < t_end; ++it)
+    {
+        // Decode the whole chunk at the end of the output, then keep the
+        // samples inside the window
+        uint64_t *t = times + n;
+        double *out[BinaryTrace::max_columns];
+        for (size_t col = 0; col < n_columns; ++col)
+            out[col] = columns[col] + n;
+
+        if (field)
+        {
+            read_chunk(*it, m_raw);
+            memcpy(t, m_raw.times.data(), m_raw.times.size() * sizeof(uint64_t));
+        }
+        else
+            decode_chunk(*it, t, out);
+
+        const size_t n_chunk = m_chunks[*it].n;
+        const size_t k0 = lower_bound(t, t + n_chunk, t_begin) - t;
+        const size_t k1 = lower_bound(t, t + n_chunk, t_end) - t;
+        if (field)
+        {
+            const auto &v = m_raw.values;
+            derive_optical_fields(v[0].data() + k0, v[1].data() + k0, v[2].data() + k0, k1 - k0, m_wavelengths, out);
+        }
+        if (k0 > 0)
+        {
+            memmove(t, t + k0, (k1 - k0) * sizeof(uint64_t));
+            if (!field)
+                for (size_t col = 0; col < n_columns; ++col)
+                    memmove(out[col], out[col] + k0, (k1 - k0) * sizeof(double));
+        }
+        n += k1 - k0;
+    }
+    return n;
+}
+
+BinaryTraceReader::Block BinaryTraceReader::read(size_t c, uint64_t t_begin, uint64_t t_end)
+{
+    const size_t n_max = max_samples(c, t_begin, t_end);
+    Block result;
+    result.times.resize(n_max);
+    result.values.resize(m_channels[c].columns.size());
+    vector<double *> columns;
+    for (auto &col : result.values)
+    {
+        col.resize(n_max);
+        columns.push_back(col.data());
+    }
+
+    const size_t n = read_into(c, t_begin, t_end, result.times.data(), columns.data());
+    result.times.resize(n);
+    for (auto &col : result.values)
+        col.resize(n);
+    return result;
+}
+
+const vector<string> &BinaryTraceReader::export_columns(size_t c) const
+{
+    if (m_channels[c].kind == BinaryTrace::FIELD_CHANNEL)
+        return derived_columns();
+    return m_channels[c].columns;
+}
+
+BinaryTraceReader::Block BinaryTraceReader::derive(const Block &raw) const
+{
+    const size_t n = raw.times.size();
+    Block result;
+    result.times = raw.times;
+    result.values.assign(4, vector<double>(n));
+    double *out[4] = {result.values[0].data(), result.values[1].data(),
+                      result.values[2].data(), result.values[3].data()};
+    derive_optical_fields(raw.values[0].data(), raw.values[1].data(), raw.values[2].data(), n, m_wavelengths, out);
+    return result;
+}
+
+void derive_optical_fields(const double *id, const double *re, const double *im, size_t n,
+        const vector<double> &wavelengths, double *const *out)
+{
+    for (size_t k = 0; k < n; ++k)
+    {
+        const double power = re[k] * re[k] + im[k] * im[k];
+        out[0][k] = power;
+        out[1][k] = sqrt(power);
+        out[2][k] = atan2(im[k], re[k]);
+        const size_t wlid = static_cast<size_t>(id[k]);
+        out[3][k] = wlid < wavelengths.size() ? wavelengths[wlid] : nan("");
+    }
+}
+
+namespace {
+
+// VCD identifier of variable i
+string vcd_id(size_t i)
+{
+    string id;
+    do {
+        id += static_cast<char>('!' + i % 94);
+        i /= 94;
+    } while (i);
+    return id;
+}
+
+// VCD names can't contain whitespace or scope separators
+string vcd_name(string s)
+{
+    for (auto &ch : s)
+        if (isspace(static_cast<unsigned char>(ch)) || ch == '.')
+            ch = '_';
+    return s;
+}
+
+} // namespace
+
+void binary_trace_to_vcd(const string &in_filename, const string &out_filename)
+{
+    BinaryTraceReader reader(in_filename);
+
+    ofstream out(out_filename, ios::out | ios::trunc);
+    if (!out)
+    {
+        cerr << "Cannot open VCD file: " << out_filename << endl;
+        exit(1);
+    }
+
+    // Time unit as 1, 10 or 100 of a standard unit
+    const int exponent = static_cast<int>(lround(log10(reader.time_unit())));
+    const int unit_exponent = static_cast<int>(floor(exponent / 3.0)) * 3;
+    const char *units[] = {"fs", "ps", "ns", "us", "ms", "s"};
+    if (unit_exponent < -15 || unit_exponent > 0)
+    {
+        cerr << "Unsupported time unit for VCD: " << reader.time_unit() << " s" << endl;
+        exit(1);
+    }
+    int multiplier = 1;
+    for (int k = unit_exponent; k < exponent; ++k)
+        multiplier *= 10;
+
+    const auto &channels = reader.channels();
+    vector<size_t> first_var(channels.size());
+    out << "$timescale " << multiplier << " " << units[(unit_exponent + 15) / 3] << " $end" << endl;
+    out << "$scope module SPECS $end" << endl;
+    size_t n_vars = 0;
+    for (size_t c = 0; c < channels.size(); ++c)
+    {
+        first_var[c] = n_vars;
+        out << "$scope module " << vcd_name(channels[c].name) << " $end" << endl;
+        for (const auto &col : reader.export_columns(c))
+            out << "$var real 64 " << vcd_id(n_vars++) << " " << vcd_name(col) << " $end" << endl;
+        out << "$upscope $end" << endl;
+    }
+    out << "$upscope $end" << endl;
+    out << "$enddefinitions $end" << endl;
+
+    // Merge the channels in time order, one decoded chunk per channel
+    struct Cursor {
+        size_t next_chunk = 0;
+        size_t pos = 0;
+        BinaryTraceReader::Block block;
+    };
+    vector<Cursor> cursors(channels.size());
+    typedef pair<uint64_t, size_t> entry_type; // (time, channel)
+    priority_queue<entry_type, vector<entry_type>, greater<entry_type>> order;
+
+    auto advance = [&](size_t c) {
+        auto &cur = cursors[c];
+        if (cur.pos >= cur.block.times.size())
+        {
+            if (cur.next_chunk >= channels[c].chunks.size())
+                return;
+            reader.read_chunk(channels[c].chunks[cur.next_chunk++], cur.block);
+            if (channels[c].kind == BinaryTrace::FIELD_CHANNEL)
+                cur.block = reader.derive(cur.block);
+            cur.pos = 0;
+        }
+        order.emplace(cur.block.times[cur.pos], c);
+    };
+    for (size_t c = 0; c < channels.size(); ++c)
+        advance(c);
+
+    out << setprecision(17);
+    bool first = true;
+    uint64_t now = 0;
+    while (!order.empty())
+    {
+        const auto e = order.top();
+        order.pop();
+        if (first || e.first != now)
+        {
+            now = e.first;
+            first = false;
+            out << "#" << now << "\n";
+        }
+        auto &cur = cursors[e.second];
+        for (size_t col = 0; col < cur.block.values.size(); ++col)
+            out << "r" << cur.block.values[col][cur.pos] << " " << vcd_id(first_var[e.second] + col) << "\n";
+        ++cur.pos;
+        advance(e.second);
+    }
+}
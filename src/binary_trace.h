@@ -0,0 +1,289 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <complex>
+#include <condition_variable>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "utils/spsc_ring.h"
+
+using std::array;
+using std::size_t;
+using std::string;
+using std::unique_ptr;
+using std::vector;
+
+/** Binary, chunked, columnar trace file.
+ *
+ * A trace holds channels (e.g. one per probe), each with a fixed list of
+ * double-valued columns sampled at integer timestamps (in units of the
+ * SystemC time resolution). Samples are pushed by the simulation thread
+ * into a lock-free ring per channel and a background thread moves them to
+ * per-channel chunks, compresses the chunks and writes them, so that the
+ * simulation never formats nor writes anything itself.
+ *
+ * File layout (little-endian):
+ *
+ *     "SPXTRACE" u32 version  f64 time_unit_s
+ *     chunk*:   "CHNK" u32 channel  u32 n  u64 t_first  u64 t_last
+ *               u32 payload_size  payload
+ *     index:    "INDX" u32 n_channels
+ *               per channel: str name  u8 kind  u32 n_columns  str column*
+ *               u32 n_wavelengths  f64 wavelength*
+ *               u64 n_chunks
+ *               per chunk: u32 channel  u32 n  u64 t_first  u64 t_last
+ *                          u64 offset
+ *     trailer:  u64 index_offset  "SPXTRIDX"
+ *
+ * where a `str` is a u32 length followed by the characters. The payload
+ * of a chunk stores the timestamps as varint deltas (starting from
+ * t_first), then each column in turn, each value XOR-ed with the previous
+ * value of the column and stored as one byte giving the number of leading
+ * and trailing zero bytes of the result followed by its remaining bytes
+ * (0xff alone for an unchanged value).
+ *
+ * Chunks of a channel are written in time order, so the index at the end
+ * of the file gives random access by time (see BinaryTraceReader).
+ *
+ * Optical field channels (kind FIELD_CHANNEL, see add_field_channel) store
+ * the raw samples of a net: wavelength id and complex field. The power,
+ * modulus, phase and wavelength are only derived when the trace is read
+ * (BinaryTraceReader::derive), using the wavelength table of the index.
+ */
+class BinaryTrace {
+public:
+    typedef uint32_t channel_id;
+    static constexpr size_t max_columns = 4;
+    static constexpr uint32_t version = 2;
+
+    enum ChannelKind : uint8_t {
+        VALUE_CHANNEL = 0, // columns as recorded
+        FIELD_CHANNEL = 1, // wavelength_id, re, im
+    };
+
+    /** A sample of a channel, as stored in the rings */
+    struct Sample {
+        uint64_t t;
+        array<double, max_columns> v;
+    };
+
+    // Default sizes (in samples)
+    static constexpr size_t default_ring_capacity = 512;
+    static constexpr size_t default_chunk_samples = 1024;
+
+private:
+    struct Channel {
+        string name;
+        ChannelKind kind;
+        vector<string> columns;
+        unique_ptr<SpscRing<Sample>> ring;
+
+        // Writer side: samples of the chunk being filled, by column
+        vector<uint64_t> times;
+        vector<vector<double>> values;
+    };
+
+    struct ChunkInfo {
+        channel_id channel;
+        uint32_t n;
+        uint64_t t_first;
+        uint64_t t_last;
+        uint64_t offset;
+    };
+
+    string m_filename;
+    double m_time_unit_s;
+    std::ofstream m_file;
+    vector<unique_ptr<Channel>> m_channels;
+    vector<ChunkInfo> m_chunks;
+    vector<double> m_wavelengths;
+    size_t m_ring_capacity;
+    size_t m_chunk_samples;
+
+    std::thread m_writer;
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    std::atomic<bool> m_stop{false};
+    bool m_started = false;
+    bool m_closed = false;
+
+    // Statistics (writer side)
+    uint64_t m_n_samples = 0;
+    uint64_t m_n_bytes = 0;
+
+    void writer_loop();
+    size_t drain(Channel &c);
+    void write_chunk(channel_id id, Channel &c);
+    void write_index();
+
+public:
+    BinaryTrace(const string &filename, double time_unit_s,
+            size_t ring_capacity = default_ring_capacity,
+            size_t chunk_samples = default_chunk_samples);
+
+    ~BinaryTrace();
+
+    /** Declare a channel (before the first sample is pushed) */
+    channel_id add_channel(const string &name, const vector<string> &columns,
+            ChannelKind kind = VALUE_CHANNEL);
+
+    /** Declare an optical field channel */
+    inline channel_id add_field_channel(const string &name)
+    {
+        return add_channel(name, {"wavelength_id", "re", "im"}, FIELD_CHANNEL);
+    }
+
+    /** Wavelength of each wavelength id, saved in the index on close */
+    inline void set_wavelengths(const vector<double> &wavelengths)
+    {
+        m_wavelengths = wavelengths;
+    }
+
+    /** Start the writer thread (done by the first push if needed) */
+    void start();
+
+    /** Record a sample of channel c at time t (one value per column)
+     *
+     * Only called from the simulation thread. If the ring of the channel is
+     * full, wakes the writer and waits for room.
+     */
+    inline void push(channel_id c, uint64_t t, const double *values)
+    {
+        if (!m_started)
+            start();
+        auto &ch = *m_channels[c];
+        Sample s;
+        s.t = t;
+        for (size_t k = 0; k < ch.columns.size(); ++k)
+            s.v[k] = values[k];
+        while (!ch.ring->try_push(s))
+        {
+            m_cv.notify_one();
+            std::this_thread::yield();
+        }
+    }
+
+    /** Record the field of an optical net at time t */
+    inline void push_field(channel_id c, uint64_t t, uint32_t wavelength_id, const std::complex<double> &field)
+    {
+        const double values[3] = {static_cast<double>(wavelength_id), field.real(), field.imag()};
+        push(c, t, values);
+    }
+
+    /** Write all pending samples and the index, and close the file */
+    void close();
+
+    inline const string &filename() const { return m_filename; }
+    inline size_t channel_count() const { return m_channels.size(); }
+    inline uint64_t sample_count() const { return m_n_samples; }
+    inline uint64_t byte_count() const { return m_n_bytes; }
+};
+
+/** Reader of the files written by BinaryTrace
+ *
+ * The file is memory-mapped and only the index is parsed when opening it:
+ * reading a time window of a channel decodes the chunks overlapping the
+ * window, and nothing else. read_into() decodes straight into buffers
+ * owned by the caller (e.g. the arrays handed to Python by pyspecs).
+ */
+class BinaryTraceReader {
+public:
+    struct ChannelInfo {
+        string name;
+        BinaryTrace::ChannelKind kind = BinaryTrace::VALUE_CHANNEL;
+        vector<string> columns;
+        vector<size_t> chunks; // indices in m_chunks, in time order
+    };
+
+    struct ChunkInfo {
+        uint32_t channel;
+        uint32_t n;
+        uint64_t t_first;
+        uint64_t t_last;
+        uint64_t offset;
+    };
+
+    /** Decoded samples of a chunk */
+    struct Block {
+        vector<uint64_t> times;
+        vector<vector<double>> values; // by column
+    };
+
+private:
+    const uint8_t *m_data = nullptr;
+    size_t m_size = 0;
+    double m_time_unit_s = 0;
+    vector<ChannelInfo> m_channels;
+    vector<ChunkInfo> m_chunks;
+    vector<double> m_wavelengths;
+    Block m_raw; // raw samples of a field chunk being derived
+
+    void close();
+    vector<size_t>::const_iterator first_chunk(size_t c, uint64_t t_begin) const;
+    void decode_chunk(size_t i, uint64_t *times, double *const *columns) const;
+
+public:
+    /** Columns of the blocks returned by derive() */
+    static const vector<string> &derived_columns();
+
+    /** Reader without a file (see open()) */
+    BinaryTraceReader() {}
+
+    /** Open a trace and read its index (exits on invalid files) */
+    explicit BinaryTraceReader(const string &filename);
+
+    ~BinaryTraceReader();
+
+    BinaryTraceReader(const BinaryTraceReader &) = delete;
+    BinaryTraceReader &operator=(const BinaryTraceReader &) = delete;
+
+    /** Open a trace and read its index; on failure, returns false and
+     * sets error */
+    bool open(const string &filename, string &error);
+
+    inline double time_unit() const { return m_time_unit_s; }
+    inline const vector<ChannelInfo> &channels() const { return m_channels; }
+    inline const vector<ChunkInfo> &chunks() const { return m_chunks; }
+    inline const vector<double> &wavelengths() const { return m_wavelengths; }
+
+    /** Columns exported for channel c: derived_columns() for field
+     * channels, the recorded columns otherwise */
+    const vector<string> &export_columns(size_t c) const;
+
+    /** Decode chunk i */
+    void read_chunk(size_t i, Block &block);
+
+    /** Upper bound of the number of samples of channel c in
+     * [t_begin, t_end) (the size of the chunks overlapping the window) */
+    size_t max_samples(size_t c, uint64_t t_begin, uint64_t t_end) const;
+
+    /** Decode the samples of channel c with t_begin <= t < t_end into
+     * times and columns (one pointer per column), each with room for
+     * max_samples() values; returns the number of samples.
+     *
+     * With derived set, field channels are written as export_columns(c).
+     */
+    size_t read_into(size_t c, uint64_t t_begin, uint64_t t_end,
+            uint64_t *times, double *const *columns, bool derived = false);
+
+    /** Samples of channel c with t_begin <= t < t_end */
+    Block read(size_t c, uint64_t t_begin, uint64_t t_end);
+
+    /** Power, modulus, phase and wavelength of a block of a field channel */
+    Block derive(const Block &raw) const;
+};
+
+/** Power, modulus, phase and wavelength (out[0..3]) of n raw samples of an
+ * optical field channel */
+void derive_optical_fields(const double *id, const double *re, const double *im, size_t n,
+        const vector<double> &wavelengths, double *const *out);
+
+/** Write the content of a binary trace as a VCD file */
+void binary_trace_to_vcd(const string &in_filename, const string &out_filename);
@@ -9,6 +9,7 @@
 #include "devices/splitter.h"
 #include "devices/crossing.h"
 #include "devices/pcm_device.h"
+#include "devices/touchstone_device.h"
 
 /** ******************************************* **/
 /**            Active devices                   **/
@@ -44,3 +45,4 @@
 #include "devices/octane_matrix.h"
 #include "devices/mesh_col.h"
 #include "devices/clements.h"
+#include "devices/clements_fused.h"
@@ -45,6 +45,7 @@ public:
     // Initialization functions
     void init_ports();
     void init();
+    virtual bool is_composite() const { return true; }
 
     Clements(sc_module_name name, const size_t &N,
             const double &length_cm = 1e-2,
@@ -0,0 +1,436 @@
+#include "specs.h"
+#include "devices/clements_fused.h"
+#include "scattering_solver.h"
+
+#include <algorithm>
+
+using namespace std;
+
+#define __modname(SUFFIX, IDX) \
+    ((""s + this->name() + "_" + SUFFIX + to_string(IDX)).c_str())
+
+void ClementsFused::init_ports()
+{
+    p_in.clear();
+    p_out.clear();
+    m_out_writers.clear();
+    for(size_t i = 0; i < m_N; i++)
+    {
+        p_in.push_back(make_unique<spx::oa_port_in_type>(__modname("IN_", i)));
+        p_out.push_back(make_unique<spx::oa_port_out_type>(__modname("OUT_", i)));
+        m_out_writers.push_back(make_unique<OpticalOutputPort>(__modname("OOP_", i), *p_out[i]));
+    }
+
+    p_vphi.clear();
+    p_vtheta.clear();
+
+    size_t num_of_electrical_ports = (m_N * (m_N - 1) / 2);
+    for(size_t i = 0; i < num_of_electrical_ports; i++)
+    {
+        p_vphi.push_back(make_unique<sc_in<double>>(__modname("VPHI_", i)));
+        p_vtheta.push_back(make_unique<sc_in<double>>(__modname("VTHETA_", i)));
+    }
+}
+
+void ClementsFused::init()
+{
+    // Same layout as Clements/MeshCol: in even columns MZIs start on row 0,
+    // in odd columns on row 1, and the electrical index advances top to
+    // bottom, then to the next column
+    m_num_cols = (m_N != 2) ? m_N : 1;
+    m_mzi_col.clear();
+    m_mzi_row.clear();
+    m_col_mzis.assign(m_num_cols, {});
+    m_col_pass.assign(m_num_cols, {});
+
+    for(size_t j = 0; j < m_num_cols; j++)
+    {
+        size_t ports_in_col = m_N/2;
+        if ((m_N % 2 == 0) && !(j % 2 == 0)) // if even-odd, there is one less MZI
+            ports_in_col = m_N/2 - 1;
+
+        const size_t first_row = j % 2;
+        vector<uint8_t> covered(m_N, 0);
+        for(size_t i = 0; i < ports_in_col; i++)
+        {
+            const size_t row = first_row + 2 * i;
+            m_col_mzis[j].push_back(m_mzi_col.size());
+            m_mzi_col.push_back(j);
+            m_mzi_row.push_back(row);
+            covered[row] = covered[row + 1] = 1;
+        }
+        for(size_t row = 0; row < m_N; row++)
+            if (!covered[row])
+                m_col_pass[j].push_back(row);
+    }
+    assert(m_mzi_col.size() == p_vphi.size());
+
+    m_phi.assign(m_mzi_col.size(), 0);
+    m_theta.assign(m_mzi_col.size(), 0);
+    m_channels.clear();
+}
+
+void ClementsFused::start_of_simulation()
+{
+    const double c = 299792458.0;
+
+    // Same models as DirectionalCoupler (50/50), PhaseShifter (1 rad/V)
+    // and Waveguide (no dispersion)
+    const double dc_field = sqrt(0.5) * pow(10.0, -m_attenuation_coupler_dB / 20.0);
+    m_dc_through = polar(dc_field, 0.0);
+    m_dc_cross = polar(dc_field, M_PI / 2);
+    m_ps_transmission = pow(10.0, -m_attenuation_ps_dB / 20.0);
+
+    m_col_delay = sc_time(1e9 * m_length_cm * 1e-2 / (c / m_ng), SC_NS);
+    m_mesh_delay = m_col_delay * (double)m_num_cols;
+
+    for (size_t m = 0; m < m_mzi_col.size(); ++m)
+    {
+        m_phi[m] = p_vphi[m]->read();
+        m_theta[m] = p_vtheta[m]->read();
+    }
+    m_channels.clear();
+
+    if (specsGlobalConfig.verbose_component_initialization)
+        cout << describe() << endl;
+}
+
+string ClementsFused::describe() const
+{
+    stringstream ss;
+    ss << name() << ": " << m_N << "x" << m_N << " Clements mesh, ";
+    ss << m_mzi_col.size() << " MZIs in " << m_num_cols << " columns (fused)";
+    return ss.str();
+}
+
+ClementsFused::block_type ClementsFused::mzi_block(const size_t &m, const field_type &T) const
+{
+    // PS(phi) on input 1, coupler, PS(theta) and waveguide on the upper
+    // arm, waveguide on the lower arm, coupler (see MZI::init)
+    const field_type &t = m_dc_through;
+    const field_type &c = m_dc_cross;
+    const field_type p1 = polar(m_ps_transmission, m_phi[m]);
+    const field_type a = polar(m_ps_transmission, m_theta[m]) * T;
+    const field_type &b = T;
+
+    return {
+        p1 * (a * t * t + b * c * c),
+        t * c * (a + b),
+        p1 * t * c * (a + b),
+        a * c * c + b * t * t,
+    };
+}
+
+ClementsFused::Channel &ClementsFused::channel(const uint32_t &wavelength_id)
+{
+    if (wavelength_id >= m_channels.size())
+        m_channels.resize(max<size_t>(wavelength_id + 1, OpticalSignal::wavelength_registry.size()));
+
+    auto &ch = m_channels[wavelength_id];
+    if (ch.valid)
+        return ch;
+
+    // Transmission of one waveguide, as in WaveguideBase::compute_transfer
+    const double wl = OpticalSignal::getWavelength(wavelength_id);
+    const double dneff_dlambda = (m_neff - m_ng) / 1.55e-6;
+    const double neff = m_neff + dneff_dlambda * (wl - 1.55e-6);
+    const double transmission = pow(10.0, -m_attenuation_wg_dB_cm * m_length_cm / 20.0);
+    ch.T = polar(transmission, 2.0 * M_PI * m_length_cm * 1e-2 * neff / wl);
+
+    ch.blocks.resize(m_mzi_col.size());
+    for (size_t m = 0; m < m_mzi_col.size(); ++m)
+        ch.blocks[m] = mzi_block(m, ch.T);
+
+    ch.inputs.assign(1, {SC_ZERO_TIME, vector<double>(m_N, 0), vector<double>(m_N, 0)});
+    ch.yr.assign(m_N, 0);
+    ch.yi.assign(m_N, 0);
+    rebuild(ch);
+    ch.valid = true;
+    return ch;
+}
+
+void ClementsFused::apply_column(const size_t &j, const Channel &ch, field_type *v) const
+{
+    // v <- C_j v
+    for (const auto &m : m_col_mzis[j])
+    {
+        const auto &B = ch.blocks[m];
+        const size_t a = m_mzi_row[m];
+        const field_type x0 = v[a];
+        const field_type x1 = v[a + 1];
+        v[a] = B[0] * x0 + B[1] * x1;
+        v[a + 1] = B[2] * x0 + B[3] * x1;
+    }
+    for (const auto &row : m_col_pass[j])
+        v[row] *= ch.T;
+}
+
+void ClementsFused::apply_column_transposed(const size_t &j, const Channel &ch, field_type *v) const
+{
+    // v^T <- v^T C_j
+    for (const auto &m : m_col_mzis[j])
+    {
+        const auto &B = ch.blocks[m];
+        const size_t a = m_mzi_row[m];
+        const field_type x0 = v[a];
+        const field_type x1 = v[a + 1];
+        v[a] = x0 * B[0] + x1 * B[2];
+        v[a + 1] = x0 * B[1] + x1 * B[3];
+    }
+    for (const auto &row : m_col_pass[j])
+        v[row] *= ch.T;
+}
+
+void ClementsFused::rebuild(Channel &ch)
+{
+    // U = C_{n-1} ... C_0, one column of U at a time
+    ch.Ur.resize(m_N * m_N);
+    ch.Ui.resize(m_N * m_N);
+    m_s0.resize(m_N);
+    for (size_t k = 0; k < m_N; ++k)
+    {
+        fill(m_s0.begin(), m_s0.end(), 0.0);
+        m_s0[k] = 1.0;
+        for (size_t j = 0; j < m_num_cols; ++j)
+            apply_column(j, ch, m_s0.data());
+        for (size_t i = 0; i < m_N; ++i)
+        {
+            ch.Ur[k * m_N + i] = m_s0[i].real();
+            ch.Ui[k * m_N + i] = m_s0[i].imag();
+        }
+    }
+    ch.n_updates = 0;
+}
+
+void ClementsFused::update_mzi(Channel &ch, const size_t &m)
+{
+    const block_type B = mzi_block(m, ch.T);
+    const block_type dB = {B[0] - ch.blocks[m][0], B[1] - ch.blocks[m][1],
+                           B[2] - ch.blocks[m][2], B[3] - ch.blocks[m][3]};
+    ch.blocks[m] = B;
+    if (dB[0] == 0.0 && dB[1] == 0.0 && dB[2] == 0.0 && dB[3] == 0.0)
+        return;
+
+    const size_t N = m_N;
+    const size_t j = m_mzi_col[m];
+    const size_t k = m_mzi_row[m];
+
+    // U = S C_j P with S = C_{n-1}...C_{j+1} and P = C_{j-1}...C_0, so
+    // changing the block of C_j by dB adds S[:, k:k+2] dB P[k:k+2, :]
+    m_s0.assign(N, 0.0);
+    m_s1.assign(N, 0.0);
+    m_r0.assign(N, 0.0);
+    m_r1.assign(N, 0.0);
+    m_s0[k] = m_s1[k + 1] = m_r0[k] = m_r1[k + 1] = 1.0;
+    for (size_t jj = j + 1; jj < m_num_cols; ++jj)
+    {
+        apply_column(jj, ch, m_s0.data());
+        apply_column(jj, ch, m_s1.data());
+    }
+    for (size_t jj = j; jj-- > 0;)
+    {
+        apply_column_transposed(jj, ch, m_r0.data());
+        apply_column_transposed(jj, ch, m_r1.data());
+    }
+
+    // Split S columns for the update loop
+    m_tmp_r.resize(4 * N);
+    double *s0r = &m_tmp_r[0];
+    double *s0i = &m_tmp_r[N];
+    double *s1r = &m_tmp_r[2 * N];
+    double *s1i = &m_tmp_r[3 * N];
+    for (size_t i = 0; i < N; ++i)
+    {
+        s0r[i] = m_s0[i].real();
+        s0i[i] = m_s0[i].imag();
+        s1r[i] = m_s1[i].real();
+        s1i[i] = m_s1[i].imag();
+    }
+
+    for (size_t col = 0; col < N; ++col)
+    {
+        // (dB P[k:k+2, :])[:, col]
+        const field_type m0 = dB[0] * m_r0[col] + dB[1] * m_r1[col];
+        const field_type m1 = dB[2] * m_r0[col] + dB[3] * m_r1[col];
+        if (m0 == 0.0 && m1 == 0.0)
+            continue;
+        const double m0r = m0.real(), m0i = m0.imag();
+        const double m1r = m1.real(), m1i = m1.imag();
+        double *ur = &ch.Ur[col * N];
+        double *ui = &ch.Ui[col * N];
+        for (size_t i = 0; i < N; ++i)
+        {
+            ur[i] += s0r[i] * m0r - s0i[i] * m0i + s1r[i] * m1r - s1i[i] * m1i;
+            ui[i] += s0r[i] * m0i + s0i[i] * m0r + s1r[i] * m1i + s1i[i] * m1r;
+        }
+    }
+    ++ch.n_updates;
+}
+
+void ClementsFused::retire_inputs(Channel &ch) const
+{
+    // Only the last inputs which reached the outputs are kept
+    const sc_time &now = sc_time_stamp();
+    while (ch.inputs.size() > 1 && ch.inputs[1].t <= now)
+        ch.inputs.pop_front();
+}
+
+size_t ClementsFused::inputs_at(Channel &ch, const sc_time &t) const
+{
+    // Index of the inputs reaching the outputs at t, which are those of the
+    // last entry before t if there is none at t
+    size_t k = ch.inputs.size();
+    while (ch.inputs[k - 1].t > t)
+        --k;
+    if (ch.inputs[k - 1].t == t)
+        return k - 1;
+    Inputs x = ch.inputs[k - 1];
+    x.t = t;
+    ch.inputs.insert(ch.inputs.begin() + k, move(x));
+    return k;
+}
+
+void ClementsFused::write_outputs(const uint32_t &wavelength_id, Channel &ch, const Inputs &x, bool force)
+{
+    const size_t N = m_N;
+
+    // y = U x, accumulated column by column so that the inner loop has no
+    // reduction and is vectorized
+    m_tmp_r.assign(N, 0.0);
+    m_tmp_i.assign(N, 0.0);
+    double *yr = m_tmp_r.data();
+    double *yi = m_tmp_i.data();
+    for (size_t k = 0; k < N; ++k)
+    {
+        const double xr = x.xr[k];
+        const double xi = x.xi[k];
+        if (xr == 0 && xi == 0)
+            continue;
+        const double *ur = &ch.Ur[k * N];
+        const double *ui = &ch.Ui[k * N];
+        for (size_t i = 0; i < N; ++i)
+        {
+            yr[i] += ur[i] * xr - ui[i] * xi;
+            yi[i] += ur[i] * xi + ui[i] * xr;
+        }
+    }
+
+    // Outputs are written in time order, so ch.yr holds those of the
+    // latest write, which can only be skipped by a write at the same time or
+    // later
+    const sc_time delay = x.t - sc_time_stamp();
+    for (size_t i = 0; i < N; ++i)
+    {
+        if (!force && yr[i] == ch.yr[i] && yi[i] == ch.yi[i])
+            continue;
+        ch.yr[i] = yr[i];
+        ch.yi[i] = yi[i];
+        m_out_writers[i]->delayedWrite(OpticalSignal(field_type(yr[i], yi[i]), wavelength_id), delay);
+    }
+}
+
+void ClementsFused::on_input_changed()
+{
+    // Store all the inputs which changed in this delta cycle, as the inputs
+    // reaching the outputs after the delay of the mesh
+    const sc_time t = sc_time_stamp() + m_mesh_delay;
+    m_dirty.clear();
+    for (size_t i = 0; i < m_N; ++i)
+    {
+        if (!(*p_in[i])->event())
+            continue;
+        const OpticalSignal s = (*p_in[i])->read();
+        if (isnan(OpticalSignal::getWavelengthUnchecked(s.m_wavelength_id)))
+            continue;
+
+        auto &ch = channel(s.m_wavelength_id);
+        if (find(m_dirty.begin(), m_dirty.end(), s.m_wavelength_id) == m_dirty.end())
+        {
+            retire_inputs(ch);
+            m_dirty.push_back(s.m_wavelength_id);
+        }
+        auto &x = ch.inputs[inputs_at(ch, t)];
+        x.xr[i] = s.m_field.real();
+        x.xi[i] = s.m_field.imag();
+    }
+
+    // Then compute the outputs once per wavelength
+    for (const auto &wlid : m_dirty)
+    {
+        auto &ch = m_channels[wlid];
+        write_outputs(wlid, ch, ch.inputs.back());
+    }
+}
+
+void ClementsFused::on_voltage_changed()
+{
+    vector<uint32_t> changed;
+    for (size_t m = 0; m < m_mzi_col.size(); ++m)
+    {
+        if (!p_vphi[m]->event() && !p_vtheta[m]->event())
+            continue;
+        m_phi[m] = p_vphi[m]->read();
+        m_theta[m] = p_vtheta[m]->read();
+        changed.push_back(m);
+    }
+
+    // Columns closest to the outputs first: their effect reaches the
+    // outputs before the one of earlier columns
+    stable_sort(changed.begin(), changed.end(), [this](uint32_t a, uint32_t b)
+    { return m_mzi_col[a] > m_mzi_col[b]; });
+
+    size_t first = 0;
+    while (first < changed.size())
+    {
+        const size_t j = m_mzi_col[changed[first]];
+        size_t last = first;
+        while (last < changed.size() && m_mzi_col[changed[last]] == j)
+            ++last;
+
+        const sc_time t = sc_time_stamp() + m_col_delay * (double)(m_num_cols - j);
+        for (uint32_t wlid = 0; wlid < m_channels.size(); ++wlid)
+        {
+            auto &ch = m_channels[wlid];
+            if (!ch.valid)
+                continue;
+
+            // Rebuild from time to time so that rounding errors of the
+            // updates don't accumulate
+            if (ch.n_updates + (last - first) > m_N)
+            {
+                for (size_t k = first; k < last; ++k)
+                    ch.blocks[changed[k]] = mzi_block(changed[k], ch.T);
+                rebuild(ch);
+            }
+            else
+            {
+                for (size_t k = first; k < last; ++k)
+                    update_mzi(ch, changed[k]);
+            }
+
+            // Inputs reaching the outputs from t on crossed the new MZIs
+            retire_inputs(ch);
+            for (size_t k = inputs_at(ch, t); k < ch.inputs.size(); ++k)
+                write_outputs(wlid, ch, ch.inputs[k], true);
+        }
+        first = last;
+    }
+}
+
+bool ClementsFused::stamp_scattering(ScatteringStamp &stamp, uint32_t wavelength_id)
+{
+    if (isnan(OpticalSignal::getWavelengthUnchecked(wavelength_id)))
+        return true;
+
+    const auto &ch = channel(wavelength_id);
+    for (size_t k = 0; k < m_N; ++k)
+    {
+        for (size_t i = 0; i < m_N; ++i)
+        {
+            const field_type S(ch.Ur[k * m_N + i], ch.Ui[k * m_N + i]);
+            if (S != 0.0)
+                stamp.add(*p_out[i], *p_in[k], S, m_mesh_delay);
+        }
+    }
+    return true;
+}
@@ -0,0 +1,178 @@
+#pragma once
+
+#include <systemc.h>
+#include <array>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <vector>
+
+#include "optical_output_port.h"
+#include "optical_signal.h"
+#include "specs.h"
+#include "devices/spx_module.h"
+
+using std::array;
+using std::deque;
+using std::unique_ptr;
+using std::vector;
+
+/* Clements MZI Mesh, simulated as a single N x N transfer matrix
+
+Same ports, parameters and electrical addressing as Clements (see
+devices/clements.h), but no MZI, waveguide or coupler is instantiated. The
+device keeps, for each wavelength:
+
+  - the 2x2 transfer matrix of every MZI,
+  - the product U of all the columns of the mesh,
+  - the input vectors still in flight in the mesh.
+
+An input event costs one complex matrix-vector product y = U x (stored in
+split real/imaginary arrays, column-major, so that the inner loop is
+vectorized), and outputs are written after the group delay of the mesh.
+
+When a phase changes, U is updated in O(N^2) with the difference of the
+2x2 matrix of that MZI, instead of being rebuilt. The change reaches the
+outputs after the delay of the columns which remain to be crossed, and the
+inputs which arrive from then on have crossed the new MZI: the outputs of
+all of them, already scheduled with the old U, are written again with the
+new one (a write replaces the one scheduled at the same time). This is exact
+unless a phase change is followed, less than one mesh delay later, by a
+change in a column closer to the outputs: the outputs in between then see
+the first change too early.
+*/
+
+class ClementsFused : public spx_module {
+public:
+    typedef OpticalSignal::field_type field_type;
+
+    vector<unique_ptr<spx::oa_port_in_type>> p_in;
+    vector<unique_ptr<spx::oa_port_out_type>> p_out;
+    vector<unique_ptr<sc_in<double>>> p_vphi;
+    vector<unique_ptr<sc_in<double>>> p_vtheta;
+
+    vector<unique_ptr<OpticalOutputPort>> m_out_writers;
+
+    // Member variables
+    size_t m_N; // represents the number of inputs of the mesh (rows)
+
+    // Parameters of the MZIs
+    double m_length_cm;
+    double m_attenuation_wg_dB_cm;
+    double m_attenuation_coupler_dB;
+    double m_attenuation_ps_dB;
+    double m_neff;
+    double m_ng;
+
+    // Mesh layout (see init): MZI m is in column m_mzi_col[m], on rows
+    // m_mzi_row[m] and m_mzi_row[m] + 1
+    size_t m_num_cols = 0;
+    vector<uint32_t> m_mzi_col;
+    vector<uint32_t> m_mzi_row;
+    vector<vector<uint32_t>> m_col_mzis;
+    vector<vector<uint32_t>> m_col_pass; // rows with only a waveguide
+
+    // Current phases of the MZIs (rad)
+    vector<double> m_phi;
+    vector<double> m_theta;
+
+    /** Processes
+     *
+     *   **SystemC type:** method
+     *
+     *   **Sensitivity list:** p_in (resp. p_vphi, p_vtheta)
+     * */
+    void on_input_changed();
+    void on_voltage_changed();
+
+    void init_ports();
+    virtual void init();
+    virtual void start_of_simulation();
+    virtual bool stamp_scattering(ScatteringStamp &stamp, uint32_t wavelength_id);
+    virtual string describe() const;
+
+    ClementsFused(sc_module_name name, const size_t &N,
+            const double &length_cm = 1e-2,
+            const double &attenuation_wg_dB_cm = 0, const double &attenuation_coupler_dB = 0,
+            const double &attenuation_ps_dB = 0,
+            const double &neff = 2.2111, const double &ng = 2.2637)
+        : spx_module(name)
+        , m_N(N)
+        , m_length_cm(length_cm)
+        , m_attenuation_wg_dB_cm(attenuation_wg_dB_cm)
+        , m_attenuation_coupler_dB(attenuation_coupler_dB)
+        , m_attenuation_ps_dB(attenuation_ps_dB)
+        , m_neff(neff)
+        , m_ng(ng)
+    {
+        assert(N > 1);
+
+        // Phases depend on the electrical inputs
+        flags = static_cast<ModuleFlags>(TIME_VARIANT | FREQUENCY_DEPENDENT);
+
+        init_ports();
+        init();
+
+        SC_HAS_PROCESS(ClementsFused);
+
+        SC_METHOD(on_input_changed);
+        for (auto &p : p_in)
+            sensitive << *p;
+        dont_initialize();
+
+        SC_METHOD(on_voltage_changed);
+        for (auto &p : p_vphi)
+            sensitive << *p;
+        for (auto &p : p_vtheta)
+            sensitive << *p;
+        dont_initialize();
+    }
+
+private:
+    typedef array<field_type, 4> block_type; // {B00, B01, B10, B11}, B(out, in)
+
+    /** Input vector which reaches the outputs at time t */
+    struct Inputs {
+        sc_time t;
+        vector<double> xr, xi;
+    };
+
+    /** State of the mesh at one wavelength */
+    struct Channel {
+        bool valid = false;
+        field_type T; // transmission of the waveguide of a column
+        vector<block_type> blocks; // per MZI, as used in U
+        vector<double> Ur, Ui; // U(i, j) at j * N + i
+        deque<Inputs> inputs; // at the outputs (front), then in flight
+        vector<double> yr, yi; // outputs written last (in time)
+        size_t n_updates = 0; // rank-2 updates since U was rebuilt
+    };
+    vector<Channel> m_channels;
+
+    // Transmission of the couplers (through, cross) and phase shifters
+    field_type m_dc_through;
+    field_type m_dc_cross;
+    double m_ps_transmission = 1;
+
+    // Group delay of one column and of the whole mesh
+    sc_time m_col_delay;
+    sc_time m_mesh_delay;
+
+    // Wavelengths whose inputs changed in the current delta cycle
+    vector<uint32_t> m_dirty;
+
+    // Scratch vectors
+    vector<field_type> m_s0, m_s1, m_r0, m_r1;
+    vector<double> m_tmp_r, m_tmp_i;
+
+    Channel &channel(const uint32_t &wavelength_id);
+    block_type mzi_block(const size_t &m, const field_type &T) const;
+
+    void apply_column(const size_t &j, const Channel &ch, field_type *v) const;
+    void apply_column_transposed(const size_t &j, const Channel &ch, field_type *v) const;
+    void rebuild(Channel &ch);
+    void update_mzi(Channel &ch, const size_t &m);
+    void retire_inputs(Channel &ch) const;
+    size_t inputs_at(Channel &ch, const sc_time &t) const;
+    void write_outputs(const uint32_t &wavelength_id, Channel &ch, const Inputs &x, bool force = false);
+};
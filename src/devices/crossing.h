@@ -25,6 +25,10 @@ public:
     double m_attenuation_power_dB;
     double m_crosstalk_power_dB;
 
+    // Pre-calculated S-parameters (see update_parameters)
+    OpticalSignal::field_type m_S_through;
+    OpticalSignal::field_type m_S_cross;
+
     // Constructor with crosstalk
     // Attenuation relates to out1/in1 when there's nothing in in2
     // Crosstalk relates to out2/in1 when there's nothing in in1
@@ -36,6 +40,9 @@ public:
         , m_crosstalk_power_dB(crosstalk_power_dB)
     {
     }
+
+    virtual void start_of_simulation();
+    virtual void update_parameters();
 };
 
 class CrossingUni : public CrossingBase {
@@ -53,6 +60,9 @@ public:
     // Processes
     void on_input_changed();
 
+    virtual void start_of_simulation();
+    virtual bool stamp_scattering(ScatteringStamp &stamp, uint32_t wavelength_id);
+
     // Constructor with crosstalk
     // Attenuation relates to out1/in1 when there's nothing in in2
     // Crosstalk relates to out2/in1 when there's nothing in in1
@@ -65,8 +75,9 @@ public:
     {
         SC_HAS_PROCESS(CrossingUni);
 
-        SC_THREAD(on_input_changed);
+        SC_METHOD(on_input_changed);
         sensitive << p_in1 << p_in2;
+        dont_initialize();
     }
 };
 
@@ -93,6 +104,9 @@ public:
     // Processes
     void on_input_changed();
 
+    virtual void start_of_simulation();
+    virtual bool stamp_scattering(ScatteringStamp &stamp, uint32_t wavelength_id);
+
     // Constructor with crosstalk
     // Attenuation relates to out1/in1 when there's nothing in in2
     // Crosstalk relates to out2/in1 when there's nothing in in1
@@ -107,7 +121,8 @@ public:
     {
         SC_HAS_PROCESS(CrossingBi);
 
-        SC_THREAD(on_input_changed);
+        SC_METHOD(on_input_changed);
         sensitive << p0_in << p1_in << p2_in << p3_in;
+        dont_initialize();
     }
 };
\ No newline at end of file
@@ -1,4 +1,7 @@
+#include "specs.h"
 #include "devices/crow.h"
+#include "scattering_solver.h"
+#include "utils/sysc_utils.h"
 
 using namespace std;
 
@@ -94,4 +97,185 @@ void CROW::connect_submodules()
     dc.at(N)->p_out2(p_out_d);
 
     dc.at(0)->m_out1_writer.m_converger = false;
-}
\ No newline at end of file
+}
+void CROW::start_of_simulation()
+{
+    if (specsGlobalConfig.simulation_mode == OpticalOutputPortMode::FREQUENCY_DOMAIN)
+        use_steady_state_model(true);
+}
+
+void CROW::use_steady_state_model(bool enable)
+{
+    if (m_steady_state && !enable)
+        fill_rings();
+    m_steady_state = enable;
+    for (auto &d : dc)
+    {
+        sc_set_processes_enabled(d.get(), !enable);
+        d->update_parameters();
+    }
+    for (size_t i = 0; i < N; ++i)
+    {
+        sc_set_processes_enabled(wg_top[i].get(), !enable);
+        sc_set_processes_enabled(wg_bot[i].get(), !enable);
+        wg_top[i]->update_parameters();
+        wg_bot[i]->update_parameters();
+    }
+    m_transfer_valid.clear();
+    m_memory_in = {};
+    m_memory_add = {};
+}
+
+void CROW::fill_rings()
+{
+    const size_t n_wavelengths = max(m_memory_in.size(), m_memory_add.size());
+    for (uint32_t wlid = 0; wlid < n_wavelengths; ++wlid)
+    {
+        if (!m_memory_in.contains(wlid) && !m_memory_add.contains(wlid))
+            continue;
+
+        // Walk the chain of transfer() from the input bus, with b_0 the
+        // steady-state through field, and give each coupler the fields
+        // entering its sides A (a_i) and B (c_i)
+        const auto &H = transfer(wlid);
+        field_type a = m_memory_in.get(wlid);
+        field_type b = H[0] * a + H[1] * m_memory_add.get(wlid);
+        for (size_t i = 0; i <= N; ++i)
+        {
+            const auto &r = dc[i]->m_S_through;
+            const auto &k = dc[i]->m_S_cross;
+            const field_type c = (-r * a + b) / k;
+            const field_type d = ((k * k - r * r) * a + r * b) / k;
+            dc[i]->m_memory_in1[wlid] = a;
+            dc[i]->m_memory_in2[wlid] = c;
+            if (i == N)
+                break;
+
+            const bool even = (i % 2 == 0);
+            const auto &h_fwd = (even ? wg_top[i] : wg_bot[i])->transfer(wlid).S;
+            const auto &h_bwd = (even ? wg_bot[i] : wg_top[i])->transfer(wlid).S;
+            a = h_fwd * d;
+            b = c / h_bwd;
+        }
+    }
+}
+
+vector<spx_module *> CROW::steady_state_replaced_devices() const
+{
+    if (!m_steady_state)
+        return {};
+    vector<spx_module *> devices;
+    for (auto &d : dc)
+        devices.push_back(d.get());
+    for (size_t i = 0; i < N; ++i)
+    {
+        devices.push_back(wg_top[i].get());
+        devices.push_back(wg_bot[i].get());
+    }
+    return devices;
+}
+
+const CROW::response_type &CROW::transfer(uint32_t wavelength_id)
+{
+    if (wavelength_id >= m_transfer_valid.size())
+    {
+        const size_t n = max<size_t>(wavelength_id + 1, OpticalSignal::wavelength_registry.size());
+        m_transfer.resize(n);
+        m_transfer_valid.resize(n, 0);
+    }
+    if (m_transfer_valid[wavelength_id])
+        return m_transfer[wavelength_id];
+
+    // Each coupler i has its side A (in1, out1) towards ring i-1 (or the
+    // input bus) and its side B (in2, out2) towards ring i (or the drop
+    // bus). With a, b the fields entering and leaving side A, and c, d
+    // those entering and leaving side B:
+    //
+    //   [c; d] = 1/k [-r, 1; k^2 - r^2, r] [a; b]
+    //
+    // Ring i then carries d_i to a_{i+1} and b_{i+1} back to c_i, through
+    // one half ring each:
+    //
+    //   [a_{i+1}; b_{i+1}] = [0, h_fwd; 1/h_bwd, 0] [c_i; d_i]
+    //
+    // The chain gives [c_N; d_N] = T [a_0; b_0], with a_0 = in, b_0 =
+    // through, c_N = add and d_N = drop.
+    field_type T00 = 1, T01 = 0, T10 = 0, T11 = 1;
+    auto multiply = [&](const field_type &M00, const field_type &M01,
+                        const field_type &M10, const field_type &M11)
+    {
+        const field_type t00 = M00 * T00 + M01 * T10;
+        const field_type t01 = M00 * T01 + M01 * T11;
+        const field_type t10 = M10 * T00 + M11 * T10;
+        const field_type t11 = M10 * T01 + M11 * T11;
+        T00 = t00; T01 = t01; T10 = t10; T11 = t11;
+    };
+    for (size_t i = 0; i <= N; ++i)
+    {
+        const auto &r = dc[i]->m_S_through;
+        const auto &k = dc[i]->m_S_cross;
+        multiply(-r / k, 1.0 / k, (k * k - r * r) / k, r / k);
+        if (i == N)
+            break;
+
+        // Even rings go left to right on top, odd rings at the bottom
+        const bool even = (i % 2 == 0);
+        const auto &h_fwd = (even ? wg_top[i] : wg_bot[i])->transfer(wavelength_id).S;
+        const auto &h_bwd = (even ? wg_bot[i] : wg_top[i])->transfer(wavelength_id).S;
+        multiply(0.0, h_fwd, 1.0 / h_bwd, 0.0);
+    }
+
+    // Solve c_N = add for b_0
+    auto &H = m_transfer[wavelength_id];
+    H[0] = -T00 / T01;
+    H[1] = 1.0 / T01;
+    H[2] = -(T00 * T11 - T01 * T10) / T01;
+    H[3] = T11 / T01;
+    m_transfer_valid[wavelength_id] = 1;
+    return H;
+}
+
+void CROW::on_port_in_changed()
+{
+    if (!m_steady_state)
+        return;
+
+    vector<uint32_t> changed;
+    if (p_in->event())
+    {
+        const auto &s = p_in->read();
+        m_memory_in[s.m_wavelength_id] = s.m_field;
+        changed.push_back(s.m_wavelength_id);
+    }
+    if (p_add->event())
+    {
+        const auto &s = p_add->read();
+        m_memory_add[s.m_wavelength_id] = s.m_field;
+        if (changed.empty() || changed[0] != s.m_wavelength_id)
+            changed.push_back(s.m_wavelength_id);
+    }
+
+    // The output nets are driven by the ports of the outer couplers
+    for (const auto &wlid : changed)
+    {
+        if (isnan(OpticalSignal::getWavelengthUnchecked(wlid)))
+            continue;
+        const auto &H = transfer(wlid);
+        const field_type a = m_memory_in[wlid];
+        const field_type add = m_memory_add[wlid];
+        dc[0]->m_out1_writer.delayedWrite(OpticalSignal(H[0] * a + H[1] * add, wlid), SC_ZERO_TIME);
+        dc[N]->m_out2_writer.delayedWrite(OpticalSignal(H[2] * a + H[3] * add, wlid), SC_ZERO_TIME);
+    }
+}
+
+bool CROW::stamp_scattering(ScatteringStamp &stamp, uint32_t wavelength_id)
+{
+    if (!m_steady_state)
+        return false;
+    const auto &H = transfer(wavelength_id);
+    stamp.add(p_out_t, p_in, H[0]);
+    stamp.add(p_out_t, p_add, H[1]);
+    stamp.add(p_out_d, p_in, H[2]);
+    stamp.add(p_out_d, p_add, H[3]);
+    return true;
+}
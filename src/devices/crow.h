@@ -8,11 +8,31 @@
 #include "devices/pcm_device.h"
 #include "devices/directional_coupler.h"
 #include "devices/merger.h"
+#include "devices/spx_module.h"
+#include "utils/wavelength_field_store.h"
 
+#include <array>
 #include <cassert>
 
-class CROW : public sc_module {
+/** Coupled-resonator optical waveguide (CROW) made of N rings.
+
+Couplers dc[0..N] link the input bus, the N rings and the drop bus, each
+ring being made of two half-ring waveguides (wg_top, wg_bot).
+
+In time-domain simulations light circulates in the rings as events. In OP
+and DC analyses (and in FREQUENCY_DOMAIN mode), the through and drop ports
+are computed in closed form instead, by chaining the 2x2 transfer matrices
+of the couplers and of the half rings (see transfer()). Switching back to
+the rings (before a TRAN analysis) fills them with the steady-state fields
+of the last inputs (see fill_rings()).
+*/
+class CROW : public spx_module {
 public:
+    typedef OpticalSignal::field_type field_type;
+
+    /** Steady-state response: {through/in, through/add, drop/in, drop/add} */
+    typedef std::array<field_type, 4> response_type;
+
     // Ports
     /** The optical input ports. */
     sc_port<sc_signal_in_if<OpticalSignal>> p_in;
@@ -45,6 +65,12 @@ public:
     virtual void init()
     {
         assert(N > 0);
+
+        // Submodules are only created once (init() is called again by
+        // SPECSConfig::prepareSimulation)
+        if (!dc.empty())
+            return;
+
         S_TL.clear();
         S_BL.clear();
         S_TR.clear();
@@ -78,15 +104,38 @@ public:
 
     void connect_submodules();
 
+    // Processes
+    /** Closed-form response, only active with the steady-state model.
+     *
+     *   **SystemC type:** method
+     *
+     *   **Sensitivity list:** p_in, p_add
+     * */
+    void on_port_in_changed();
+
+    virtual void start_of_simulation();
+    virtual bool is_composite() const { return true; }
+    virtual void use_steady_state_model(bool enable);
+    virtual vector<spx_module *> steady_state_replaced_devices() const;
+    virtual bool stamp_scattering(ScatteringStamp &stamp, uint32_t wavelength_id);
+
+    /** Steady-state response at a wavelength */
+    const response_type &transfer(uint32_t wavelength_id);
+
     /** Constructor for Waveguide
      *
      * @param name name of the module
      * */
     CROW(sc_module_name name, const size_t &nrings = 3, const double &ring_length = 0.0)
-        : sc_module(name)
+        : spx_module(name)
         , N(nrings)
         , m_ring_length(ring_length)
     {
+        SC_HAS_PROCESS(CROW);
+
+        SC_METHOD(on_port_in_changed);
+        sensitive << p_in << p_add;
+        dont_initialize();
     }
 
     void setRingLength(const double &ring_length)
@@ -94,4 +143,18 @@ public:
         assert(ring_length >= 0);
         m_ring_length = ring_length;
     }
+
+private:
+    bool m_steady_state = false;
+
+    /** Set the input memories of the couplers to the steady state */
+    void fill_rings();
+
+    // Closed-form response by wavelength id, filled on first use
+    vector<response_type> m_transfer;
+    vector<uint8_t> m_transfer_valid;
+
+    // Current inputs by wavelength (steady-state model only)
+    WavelengthFieldStore<field_type> m_memory_in;
+    WavelengthFieldStore<field_type> m_memory_add;
 };
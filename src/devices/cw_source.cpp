@@ -1,5 +1,6 @@
 #include "specs.h"
 #include "devices/cw_source.h"
+#include "scattering_solver.h"
 
 using std::cout;
 using std::endl;
@@ -43,3 +44,10 @@ void CWSource::runner()
         // cout << name() << " was reset" << endl;
     }
 }
+
+bool CWSource::stamp_scattering(ScatteringStamp &stamp, uint32_t wavelength_id)
+{
+    if (m_signal_on.m_wavelength_id == wavelength_id)
+        stamp.add_source(p_out, m_signal_on.m_field);
+    return true;
+}
@@ -27,6 +27,8 @@ public:
     // Processes
     void runner();
 
+    virtual bool stamp_scattering(ScatteringStamp &stamp, uint32_t wavelength_id);
+
     inline void setWavelength(const double &wl)
     {
         m_source_wavelength = wl;
@@ -61,6 +63,7 @@ public:
         , m_out_writer("out_delayed_writer", p_out)
     {
         SC_HAS_PROCESS(CWSource);
+        flags = static_cast<ModuleFlags>(TIME_VARIANT | FREQUENCY_DEPENDENT);
 
         SC_THREAD(runner);
 
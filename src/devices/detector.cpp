@@ -1,30 +1,31 @@
 #include "specs.h"
 #include "devices/detector.h"
 #include <cstdlib> // system()
-#include <random>
 #include <complex>
 
 using namespace std;
 
-void Detector::on_port_in_changed()
+void Detector::start_of_simulation()
 {
     // always initialize memory
+    m_memory_in.resize(OpticalSignal::wavelength_registry.size());
     m_memory_in[0] = 0;
 
-    // rng seed
-    init();
+    if (specsGlobalConfig.analytic_detectors)
+        m_analytic = true;
 
-    while (true) {
-        // Wait for a new input signal
-        wait();
+    // noise variances and stream
+    init();
+}
 
-        const auto &p_in_read = p_in->read();
+void Detector::on_port_in_changed()
+{
+    const auto &p_in_read = p_in->read();
 
-        auto cur_wavelength_id = p_in_read.m_wavelength_id;
-        // Updating the field memory
-        m_memory_in[cur_wavelength_id] = p_in_read.m_field;
-        m_event_manual_trigger.notify();
-    }
+    auto cur_wavelength_id = p_in_read.m_wavelength_id;
+    // Updating the field memory
+    m_memory_in[cur_wavelength_id] = p_in_read.m_field;
+    m_event_manual_trigger.notify();
 }
 
 void Detector::on_time_tick()
@@ -35,7 +36,6 @@ void Detector::on_time_tick()
 
     OpticalSignal::field_type total_field;
     OpticalSignal::field_type::value_type total_power;
-    double photocurrent;
 
     // Wait for enable signal
     if (! enable.read().to_bool())
@@ -45,6 +45,13 @@ void Detector::on_time_tick()
         cout << name() << " was enabled" << endl;
     }
 
+    if (m_analytic)
+    {
+        m_sampling_period = sampling_time;
+        on_time_tick_analytic();
+        return;
+    }
+
     while(true)
     {
         if (sc_pending_activity()) {
@@ -55,6 +62,7 @@ void Detector::on_time_tick()
             //TODO (see CWSource code)
             wait(); // effectively wait until the end of the simulation
         }
+        ++m_n_wakeups;
 
         /* Get current time tk*/
         double tk = sc_time_stamp().to_seconds();
@@ -63,52 +71,150 @@ void Detector::on_time_tick()
         /* Calculate sum of fields at current time*/
         total_field = 0;
         total_power = 0;
-        for (auto field : m_memory_in)
+        m_memory_in.for_each([&](uint32_t wlid, const OpticalSignal::field_type &field)
         {
-            double wl = specsGlobalConfig.wavelengths_vector[field.first];
+            double wl = OpticalSignal::getWavelengthUnchecked(wlid);
             double freq = 299792458 / wl;
-            total_field += field.second * exp(complex<double>(0, 2 * M_PI * freq * tk));
-            total_power += norm(field.second);
+            total_field += field * exp(complex<double>(0, 2 * M_PI * freq * tk));
+            total_power += norm(field);
+        });
+
+        update_readout(total_field, total_power, sc_time_stamp());
+    }
+}
+
+void Detector::on_time_tick_analytic()
+{
+    // Fields may have been received before the detector was enabled, but
+    // (as in the default mode) they are first sampled one period later
+    start_segment();
+    m_segment_steps = 1;
+
+    while (true)
+    {
+        // The samples of the previous fields are due until now
+        wait(m_event_manual_trigger);
+        ++m_n_wakeups;
+        sample_segment(sc_time_stamp(), false);
+        start_segment();
+        sample_segment(sc_time_stamp(), true);
+    }
+}
+
+void Detector::flush_readout()
+{
+    if (m_analytic)
+        sample_segment(sc_time_stamp(), true);
+}
+
+void Detector::start_segment()
+{
+    m_segment_open = true;
+    m_segment_start = sc_time_stamp();
+    m_segment_steps = 0;
+
+    m_fields.clear();
+    m_phasors.clear();
+    m_beat_omegas.clear();
+    m_total_power = 0;
+    double ref_freq = 0;
+    m_memory_in.for_each([&](uint32_t wlid, const field_type &field)
+    {
+        if (field == field_type(0))
+            return;
+        double freq = 299792458 / OpticalSignal::getWavelengthUnchecked(wlid);
+        if (m_fields.empty())
+            ref_freq = freq;
+        m_fields.push_back(field);
+        m_beat_omegas.push_back(2 * M_PI * (freq - ref_freq));
+        m_total_power += norm(field);
+    });
+
+    const double dt = m_sampling_period.to_seconds();
+    m_rotations.resize(m_fields.size());
+    for (size_t k = 0; k < m_fields.size(); ++k)
+        m_rotations[k] = polar(1.0, m_beat_omegas[k] * dt);
+}
+
+void Detector::sample_segment(const sc_time &until, bool inclusive)
+{
+    // Samples since the last input change are at m_segment_start + k * dt
+    while (m_segment_open)
+    {
+        const sc_time t = m_segment_start + m_sampling_period * (double)m_segment_steps;
+        if (t > until || (t == until && !inclusive))
+            return;
+
+        if (m_phasors.empty() || m_segment_steps % reanchor_steps == 0)
+        {
+            m_phasors.resize(m_fields.size());
+            for (size_t k = 0; k < m_fields.size(); ++k)
+                m_phasors[k] = m_fields[k] * polar(1.0, m_beat_omegas[k] * t.to_seconds());
         }
+        else
+        {
+            for (size_t k = 0; k < m_phasors.size(); ++k)
+                m_phasors[k] *= m_rotations[k];
+        }
+
+        field_type total_field = 0;
+        for (const auto &p : m_phasors)
+            total_field += p;
+        update_readout(total_field, m_total_power, t);
+        ++m_segment_steps;
+
+        // The readout is constant unless several wavelengths beat
+        if (m_phasors.size() < 2)
+            m_segment_open = false;
+    }
+}
+
+Detector::field_type Detector::field_at(const double &t) const
+{
+    field_type total_field = 0;
+    for (size_t k = 0; k < m_fields.size(); ++k)
+        total_field += m_fields[k] * polar(1.0, m_beat_omegas[k] * t);
+    return total_field;
+}
 
-        if (norm(total_field) == 0)
-            total_field = 1e-20*m_rngDist(m_rngGen);
+double Detector::readout_at(const sc_time &t) const
+{
+    return norm(field_at(t.to_seconds())) * m_responsivity_A_W + m_darkCurrent_A;
+}
 
-        photocurrent = norm(total_field) * m_responsivity_A_W;
-        m_cur_readout = photocurrent + (!m_noiseBypass)*noise_gen(photocurrent) + m_darkCurrent_A;
-        m_cur_readout_no_interf = total_power * m_responsivity_A_W + (!m_noiseBypass)*noise_gen(photocurrent) + m_darkCurrent_A;
+void Detector::update_readout(field_type total_field, const double &total_power, const sc_time &t)
+{
+    ++m_n_updates;
 
+    if (norm(total_field) == 0)
+        total_field = 1e-20*m_rngDist();
 
-        //m_cur_readout = total_field.real();
-        // Write to output port
-        //p_readout->write(m_cur_readout);
+    double photocurrent = norm(total_field) * m_responsivity_A_W;
+    m_cur_readout = photocurrent + (!m_noiseBypass)*noise_gen(photocurrent) + m_darkCurrent_A;
+    m_cur_readout_no_interf = total_power * m_responsivity_A_W + (!m_noiseBypass)*noise_gen(photocurrent) + m_darkCurrent_A;
+    if (m_mt)
+    {
+        const double values[2] = {m_cur_readout, m_cur_readout_no_interf};
+        m_mt->push(m_mt_channel, t.value(), values);
     }
+
+    //m_cur_readout = total_field.real();
+    // Write to output port
+    //p_readout->write(m_cur_readout);
 }
 
 /*
 Generates a current noise to be applied to the noiseless_readout,
 calculated from the responsivity.
 
-Considers: TIA input referred, shot, and thermal
+Considers: TIA input referred, shot, and thermal (variances are
+precomputed in init())
 */
 double Detector::noise_gen(const double &noiseless_readout)
 {
-    // elementary charge
-    const double q = 1.60217e-19;
-
-    // Boltzmann constant
-    const double K = 1.38064e-23;
-
-    double inoise_tia_2 = m_opFreq_Hz*pow(m_iTIA,2);
-    double inoise_shot_2 = m_opFreq_Hz*2*q*(noiseless_readout+m_darkCurrent_A);
-    double inoise_therm_2 = m_opFreq_Hz*4*K*m_temp_K/m_equivR_Ohm;
-
-    // the RMS value is also the variance of the random variable
-    double inoise_rms = inoise_tia_2 + inoise_shot_2 + inoise_therm_2;
-
     // mean = noiseless, std = sqrt(variance)
     // the second element of the product is the gaussian(0,1)
-    return sqrt(inoise_rms) * m_rngDist(m_rngGen);
+    return sqrt(m_noise_var_A2 + m_noise_var_shot_A * noiseless_readout) * m_rngDist();
 }
 
 /*
@@ -131,6 +237,19 @@ double Detector::wavelength_dependent_responsivity(const double &wavelength)
 
 void Detector::init()
 {
-    std::random_device rd;  // Will be used to obtain a seed for the random number engine
-    m_rngGen.seed(rd());
+    // elementary charge
+    const double q = 1.60217e-19;
+
+    // Boltzmann constant
+    const double K = 1.38064e-23;
+
+    double inoise_tia_2 = m_opFreq_Hz*m_iTIA*m_iTIA;
+    double inoise_dark_2 = m_opFreq_Hz*2*q*m_darkCurrent_A;
+    double inoise_therm_2 = m_opFreq_Hz*4*K*m_temp_K/m_equivR_Ohm;
+
+    // the shot noise variance is proportional to the photocurrent
+    m_noise_var_A2 = inoise_tia_2 + inoise_dark_2 + inoise_therm_2;
+    m_noise_var_shot_A = m_opFreq_Hz*2*q;
+
+    m_rngDist.seed(philox::make_key(specsGlobalConfig.noise_seed, name()));
 }
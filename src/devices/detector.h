@@ -2,13 +2,41 @@
 
 #include <systemc.h>
 #include <fstream>
-#include <random>
+#include <vector>
 
 #include "optical_output_port.h"
 #include "optical_signal.h"
 #include "specs.h"
 #include "devices/spx_module.h"
+#include "memory_trace.h"
+#include "utils/philox.h"
+#include "utils/wavelength_field_store.h"
 
+/* Photodetector
+
+The readout is computed from the sum of the fields of all wavelengths,
+which beat at their frequency differences, every `m_sampling_time` while
+the simulation has pending activity.
+
+In analytic mode (`m_analytic`, or `.options analytic_detectors=1` for all
+detectors), the detector only wakes up when an input changes. The field is
+constant between changes, so the samples of that interval are produced
+then, at the same times as in the default mode (every sampling period
+after the change), and recorded with their own time stamps:
+
+  - with a single wavelength, the readout is constant and has one sample,
+  - when several wavelengths beat, each keeps a phasor relative to the
+    first one, advanced by a rotation precomputed for one sampling period,
+    so that a sample costs one complex product per wavelength instead of
+    one complex exponential (phasors are periodically reset from
+    readout_at()).
+
+flush_readout() produces the samples up to the current time, at the end of
+an analysis. Traces which sample m_cur_readout (VCD) only see its value at
+input changes; readout_at() evaluates the noiseless readout at any time
+since the last input change. Noise is drawn once per sample, in the same
+order as in the default mode.
+*/
 // TODO: rename to photodetector
 class Detector : public spx_module {
 public:
@@ -19,7 +47,7 @@ public:
     double m_cur_readout_no_interf;
 
     // Input memory for multi-wavelength purposes
-    std::map<uint32_t,OpticalSignal::field_type> m_memory_in;
+    WavelengthFieldStore<OpticalSignal::field_type> m_memory_in;
 
     // Detector enable signal
     spx::ed_signal_type enable;
@@ -33,13 +61,27 @@ public:
     double m_iTIA; // A/sqrt(Hz)
     bool m_noiseBypass;
     double m_sampling_time;
+    bool m_analytic = false;
+
+    // Number of readout computations and of wakeups of the sampling thread
+    uint64_t m_n_updates = 0;
+    uint64_t m_n_wakeups = 0;
 
-    // if each photodiode has an independent RNG device
-    std::default_random_engine m_rngGen;
-    std::normal_distribution<double> m_rngDist;
+    // Gaussian noise, from a counter-based stream keyed by the name of the
+    // detector and specsGlobalConfig.noise_seed: sample k is the same
+    // whatever the order of events or the number of threads
+    philox::NormalStream m_rngDist;
+
+    // Noise variance (A^2) is m_noise_var_A2 + m_noise_var_shot_A * readout
+    double m_noise_var_A2 = 0;
+    double m_noise_var_shot_A = 0;
 
     sc_event m_event_manual_trigger;
 
+    // Readouts are also recorded here if set (see specs_api.h)
+    MemoryTrace *m_mt = nullptr;
+    MemoryTrace::channel_id m_mt_channel = 0;
+
     // Init all parameters
     void init();
 
@@ -47,9 +89,22 @@ public:
     double noise_gen(const double &noiseless_readout);
     double wavelength_dependent_responsivity(const double &wavelength);
 
+    // Readout (without noise) at time t, no earlier than the last input
+    // change, in analytic mode
+    double readout_at(const sc_time &t) const;
+
+    // Produce the samples up to the current time, in analytic mode
+    void flush_readout();
+
     // Processes
     void on_port_in_changed();
     void on_time_tick();
+    void on_time_tick_analytic();
+
+    virtual void start_of_simulation();
+
+    // No optical output: nothing to stamp
+    virtual bool stamp_scattering(ScatteringStamp &, uint32_t) { return true; }
 
     virtual void trace(sc_trace_file *Tf) const
     {
@@ -57,6 +112,12 @@ public:
         sc_trace(Tf, m_cur_readout_no_interf, (string(name()) + ".readout_no_interference").c_str());
     }
 
+    void setMemoryTrace(MemoryTrace *mt)
+    {
+        m_mt = mt;
+        m_mt_channel = m_mt->add_channel(name(), {"readout", "readout_no_interference"});
+    }
+
     // Constructor
     Detector(sc_module_name name,
              double responsivity_A_W = 1,
@@ -76,14 +137,37 @@ public:
         , m_iTIA(iTIA)
         , m_noiseBypass(noiseBypass)
         , m_sampling_time(sampling_time)
-        , m_rngDist(0,1)
     {
         SC_HAS_PROCESS(Detector);
+        flags = static_cast<ModuleFlags>(NON_LINEAR | TIME_VARIANT | FREQUENCY_DEPENDENT);
         enable = sc_logic(0);
 
-        SC_THREAD(on_port_in_changed);
+        SC_METHOD(on_port_in_changed);
         sensitive << p_in;
+        dont_initialize();
 
         SC_THREAD(on_time_tick);
     }
+
+private:
+    typedef OpticalSignal::field_type field_type;
+
+    // Wavelengths present since the last input change (analytic mode)
+    vector<field_type> m_fields;
+    vector<double> m_beat_omegas;       // rad/s, relative to the first one
+    vector<field_type> m_phasors;       // at the current sample
+    vector<field_type> m_rotations;     // over one sampling period
+    double m_total_power = 0;
+    sc_time m_sampling_period;
+    sc_time m_segment_start;
+    size_t m_segment_steps = 0;         // samples produced since the change
+    bool m_segment_open = false;        // more samples are due
+
+    // Phasors are recomputed exactly after this many rotations
+    static constexpr size_t reanchor_steps = 1024;
+
+    field_type field_at(const double &t) const;
+    void start_segment();
+    void sample_segment(const sc_time &until, bool inclusive);
+    void update_readout(field_type total_field, const double &total_power, const sc_time &t);
 };
@@ -1,33 +1,48 @@
 #include "specs.h"
 #include "devices/directional_coupler.h"
+#include "scattering_solver.h"
 
 using namespace std;
 
-void DirectionalCouplerUni::on_port_in1_changed()
+void DirectionalCouplerBase::start_of_simulation()
+{
+    update_parameters();
+
+    if (specsGlobalConfig.verbose_component_initialization)
+    {
+        cout << name() << ":" << endl;
+        cout << "through_power = " << norm(m_S_through) << " W/W" << endl;
+        cout << "cross_power = " << norm(m_S_cross)<< " W/W" << endl;
+        cout << "through_field = " << abs(m_S_through) << "" << endl;
+        cout << "cross_field = " << abs(m_S_cross)<< "" << endl;
+        cout << "insertion loss = " << m_dc_loss << "dB" << endl;
+    }
+}
+
+void DirectionalCouplerBase::update_parameters()
 {
     m_through_power_dB = 10*log10(m_dc_through_coupling_power) - m_dc_loss;
     m_cross_power_dB = 10*log10(1.0 - m_dc_through_coupling_power) - m_dc_loss;
 
-    m_memory_in1[0] = 0; // initializing for nan wavelength
-
     const double transmission_through = pow(10.0, m_through_power_dB / 20.0);
     const double transmission_cross = pow(10.0, m_cross_power_dB / 20.0);
 
     // Pre-calculate S-parameters
-    OpticalSignal::field_type S13, S14, S23, S24;
-    S13 = polar(transmission_through, m_through_phase_rad);
-    S24 = polar(transmission_through, m_through_phase_rad);
-    S14 = polar(transmission_cross, m_cross_phase_rad);
-    S23 = polar(transmission_cross, m_cross_phase_rad);
+    m_S_through = polar(transmission_through, m_through_phase_rad);
+    m_S_cross = polar(transmission_cross, m_cross_phase_rad);
+}
+
+void DirectionalCouplerUni::start_of_simulation()
+{
+    DirectionalCouplerBase::start_of_simulation();
+
+    m_memory_in1.resize(OpticalSignal::wavelength_registry.size());
+    m_memory_in2.resize(OpticalSignal::wavelength_registry.size());
+    m_memory_in1[0] = 0; // initializing for nan wavelength
+    m_memory_in2[0] = 0; // initializing for nan wavelength
 
     if (specsGlobalConfig.verbose_component_initialization)
     {
-        cout << name() << ":" << endl;
-        cout << "through_power = " << norm(S13) << " W/W" << endl;
-        cout << "cross_power = " << norm(S14)<< " W/W" << endl;
-        cout << "through_field = " << abs(S13) << "" << endl;
-        cout << "cross_field = " << abs(S14)<< "" << endl;
-        cout << "insertion loss = " << m_dc_loss << "dB" << endl;
         cout << (dynamic_cast<spx::oa_signal_type *>(p_in1.get_interface()))->name();
         cout << " --,__,-> ";
         cout << (dynamic_cast<spx::oa_signal_type *>(p_out1.get_interface()))->name();
@@ -40,102 +55,75 @@ void DirectionalCouplerUni::on_port_in1_changed()
 
         cout << endl;
     }
+}
 
-    OpticalSignal p_in1_read;
-
-    while (true) {
-        // Wait for a new input signal
-        wait();
+void DirectionalCouplerUni::on_port_in1_changed()
+{
+    const auto &S13 = m_S_through;
+    const auto &S14 = m_S_cross;
+    const auto &S23 = m_S_cross;
+    const auto &S24 = m_S_through;
 
-        // Read current inputs
-        p_in1_read = p_in1->read();
+    // Read current inputs
+    const OpticalSignal &p_in1_read = p_in1->read();
 
-        auto cur_wavelength_id = p_in1_read.m_wavelength_id;
-        // Updating the field memory
-        m_memory_in1[cur_wavelength_id] = p_in1_read.m_field;
+    auto cur_wavelength_id = p_in1_read.m_wavelength_id;
+    // Updating the field memory
+    m_memory_in1[cur_wavelength_id] = p_in1_read.m_field;
 
-        auto s3 = OpticalSignal(m_memory_in1[cur_wavelength_id] * S13 +
-                        m_memory_in2[cur_wavelength_id] * S23
-                        , cur_wavelength_id);
+    auto s3 = OpticalSignal(m_memory_in1[cur_wavelength_id] * S13 +
+                    m_memory_in2[cur_wavelength_id] * S23
+                    , cur_wavelength_id);
 
-        auto s4 = OpticalSignal(m_memory_in1[cur_wavelength_id] * S14 +
-                                m_memory_in2[cur_wavelength_id] * S24
-                                , cur_wavelength_id);
+    auto s4 = OpticalSignal(m_memory_in1[cur_wavelength_id] * S14 +
+                            m_memory_in2[cur_wavelength_id] * S24
+                            , cur_wavelength_id);
 
-        m_out1_writer.delayedWrite(s3, sc_time(m_delay_ns, SC_NS));
-        m_out2_writer.delayedWrite(s4, sc_time(m_delay_ns, SC_NS));
-    }
+    m_out1_writer.delayedWrite(s3, sc_time(m_delay_ns, SC_NS));
+    m_out2_writer.delayedWrite(s4, sc_time(m_delay_ns, SC_NS));
 }
 
 void DirectionalCouplerUni::on_port_in2_changed()
 {
-    m_through_power_dB = 10*log10(m_dc_through_coupling_power) - m_dc_loss;
-    m_cross_power_dB = 10*log10(1.0 - m_dc_through_coupling_power) - m_dc_loss;
-
-    m_memory_in2[0] = 0; // initializing for nan wavelength
-
-    const double transmission_through = pow(10.0, m_through_power_dB / 20.0);
-    const double transmission_cross = pow(10.0, m_cross_power_dB / 20.0);
-
-    // Pre-calculate S-parameters
-    OpticalSignal::field_type S13, S14, S23, S24;
-    S13 = polar(transmission_through, m_through_phase_rad);
-    S24 = polar(transmission_through, m_through_phase_rad);
-    S14 = polar(transmission_cross, m_cross_phase_rad);
-    S23 = polar(transmission_cross, m_cross_phase_rad);
-
-    OpticalSignal p_in2_read;
-
-    while (true) {
-        // Wait for a new input signal
-        wait();
+    const auto &S13 = m_S_through;
+    const auto &S14 = m_S_cross;
+    const auto &S23 = m_S_cross;
+    const auto &S24 = m_S_through;
 
-        // Read current inputs
-        p_in2_read = p_in2->read();
+    // Read current inputs
+    const OpticalSignal &p_in2_read = p_in2->read();
 
-        auto cur_wavelength_id = p_in2_read.m_wavelength_id;
-        // Updating the field memory
-        m_memory_in2[cur_wavelength_id] = p_in2_read.m_field;
+    auto cur_wavelength_id = p_in2_read.m_wavelength_id;
+    // Updating the field memory
+    m_memory_in2[cur_wavelength_id] = p_in2_read.m_field;
 
-        auto s3 = OpticalSignal(m_memory_in1[cur_wavelength_id] * S13 +
-                                m_memory_in2[cur_wavelength_id] * S23
-                        , cur_wavelength_id);
+    auto s3 = OpticalSignal(m_memory_in1[cur_wavelength_id] * S13 +
+                            m_memory_in2[cur_wavelength_id] * S23
+                    , cur_wavelength_id);
 
-        auto s4 = OpticalSignal(m_memory_in1[cur_wavelength_id] * S14 +
-                                m_memory_in2[cur_wavelength_id] * S24
-                                , cur_wavelength_id);
+    auto s4 = OpticalSignal(m_memory_in1[cur_wavelength_id] * S14 +
+                            m_memory_in2[cur_wavelength_id] * S24
+                            , cur_wavelength_id);
 
-        m_out1_writer.delayedWrite(s3, sc_time(m_delay_ns, SC_NS));
-        m_out2_writer.delayedWrite(s4, sc_time(m_delay_ns, SC_NS));
-    }
+    m_out1_writer.delayedWrite(s3, sc_time(m_delay_ns, SC_NS));
+    m_out2_writer.delayedWrite(s4, sc_time(m_delay_ns, SC_NS));
 }
 
-
-void DirectionalCouplerBi::on_p0_in_changed()
+void DirectionalCouplerBi::start_of_simulation()
 {
-    m_through_power_dB = 10*log10(m_dc_through_coupling_power) - m_dc_loss;
-    m_cross_power_dB = 10*log10(1.0 - m_dc_through_coupling_power) - m_dc_loss;
+    DirectionalCouplerBase::start_of_simulation();
 
+    m_memory_in0.resize(OpticalSignal::wavelength_registry.size());
+    m_memory_in1.resize(OpticalSignal::wavelength_registry.size());
+    m_memory_in2.resize(OpticalSignal::wavelength_registry.size());
+    m_memory_in3.resize(OpticalSignal::wavelength_registry.size());
     m_memory_in0[0] = 0; // initializing for nan wavelength
-
-    const double transmission_through = pow(10.0, m_through_power_dB / 20.0);
-    const double transmission_cross = pow(10.0, m_cross_power_dB / 20.0);
-
-    // Pre-calculate S-parameters
-    OpticalSignal::field_type S02, S13, S03, S12;
-    S02 = polar(transmission_through, m_through_phase_rad);
-    S13 = polar(transmission_through, m_through_phase_rad);
-    S03 = polar(transmission_cross, m_cross_phase_rad);
-    S12 = polar(transmission_cross, m_cross_phase_rad);
+    m_memory_in1[0] = 0; // initializing for nan wavelength
+    m_memory_in2[0] = 0; // initializing for nan wavelength
+    m_memory_in3[0] = 0; // initializing for nan wavelength
 
     if (specsGlobalConfig.verbose_component_initialization)
     {
-        cout << name() << ":" << endl;
-        cout << "through_power = " << norm(S02) << " W/W" << endl;
-        cout << "cross_power = " << norm(S03)<< " W/W" << endl;
-        cout << "through_field = " << abs(S02) << "" << endl;
-        cout << "cross_field = " << abs(S03)<< "" << endl;
-        cout << "insertion loss = " << m_dc_loss << "dB" << endl;
         cout << (dynamic_cast<spx::oa_signal_type *>(p0_in.get_interface()))->name();
 
         cout << " --,__,-> ";
@@ -157,162 +145,138 @@ void DirectionalCouplerBi::on_p0_in_changed()
 
         cout << endl;
     }
+}
 
-    OpticalSignal p0_in_read;
-
-    while (true) {
-        // Wait for a new input signal
-        wait();
+void DirectionalCouplerBi::on_p0_in_changed()
+{
+    const auto &S02 = m_S_through;
+    const auto &S13 = m_S_through;
+    const auto &S03 = m_S_cross;
+    const auto &S12 = m_S_cross;
 
-        // Read current inputs
-        p0_in_read = p0_in->read();
+    // Read current inputs
+    const OpticalSignal &p0_in_read = p0_in->read();
 
-        auto cur_wavelength_id = p0_in_read.m_wavelength_id;
+    auto cur_wavelength_id = p0_in_read.m_wavelength_id;
 
-        // Updating the field memory
-        m_memory_in0[cur_wavelength_id] = p0_in_read.m_field;
+    // Updating the field memory
+    m_memory_in0[cur_wavelength_id] = p0_in_read.m_field;
 
-        auto s2 = OpticalSignal(m_memory_in0[cur_wavelength_id] * S02 +
-                                m_memory_in1[cur_wavelength_id] * S12
-                                , cur_wavelength_id);
+    auto s2 = OpticalSignal(m_memory_in0[cur_wavelength_id] * S02 +
+                            m_memory_in1[cur_wavelength_id] * S12
+                            , cur_wavelength_id);
 
-        auto s3 = OpticalSignal(m_memory_in0[cur_wavelength_id] * S03 +
-                                m_memory_in1[cur_wavelength_id] * S13
-                                , cur_wavelength_id);
+    auto s3 = OpticalSignal(m_memory_in0[cur_wavelength_id] * S03 +
+                            m_memory_in1[cur_wavelength_id] * S13
+                            , cur_wavelength_id);
 
-        m_p2_out_writer.delayedWrite(s2, sc_time(m_delay_ns, SC_NS));
-        m_p3_out_writer.delayedWrite(s3, sc_time(m_delay_ns, SC_NS));
-    }
+    m_p2_out_writer.delayedWrite(s2, sc_time(m_delay_ns, SC_NS));
+    m_p3_out_writer.delayedWrite(s3, sc_time(m_delay_ns, SC_NS));
 }
 
 void DirectionalCouplerBi::on_p1_in_changed()
 {
-    m_through_power_dB = 10*log10(m_dc_through_coupling_power) - m_dc_loss;
-    m_cross_power_dB = 10*log10(1.0 - m_dc_through_coupling_power) - m_dc_loss;
-
-    m_memory_in1[0] = 0; // initializing for nan wavelength
+    const auto &S02 = m_S_through;
+    const auto &S13 = m_S_through;
+    const auto &S03 = m_S_cross;
+    const auto &S12 = m_S_cross;
 
-    const double transmission_through = pow(10.0, m_through_power_dB / 20.0);
-    const double transmission_cross = pow(10.0, m_cross_power_dB / 20.0);
-
-    // Pre-calculate S-parameters
-    OpticalSignal::field_type S02, S13, S03, S12;
-    S02 = polar(transmission_through, m_through_phase_rad);
-    S13 = polar(transmission_through, m_through_phase_rad);
-    S03 = polar(transmission_cross, m_cross_phase_rad);
-    S12 = polar(transmission_cross, m_cross_phase_rad);
-
-    OpticalSignal p1_in_read;
-
-    while (true) {
-        // Wait for a new input signal
-        wait();
+    // Read current inputs
+    const OpticalSignal &p1_in_read = p1_in->read();
 
-        // Read current inputs
-        p1_in_read = p1_in->read();
+    auto cur_wavelength_id = p1_in_read.m_wavelength_id;
 
-        auto cur_wavelength_id = p1_in_read.m_wavelength_id;
+    // Updating the field memory
+    m_memory_in1[cur_wavelength_id] = p1_in_read.m_field;
 
-        // Updating the field memory
-        m_memory_in1[cur_wavelength_id] = p1_in_read.m_field;
+    auto s2 = OpticalSignal(m_memory_in0[cur_wavelength_id] * S02 +
+                            m_memory_in1[cur_wavelength_id] * S12
+                            , cur_wavelength_id);
 
-        auto s2 = OpticalSignal(m_memory_in0[cur_wavelength_id] * S02 +
-                                m_memory_in1[cur_wavelength_id] * S12
-                                , cur_wavelength_id);
+    auto s3 = OpticalSignal(m_memory_in0[cur_wavelength_id] * S03 +
+                            m_memory_in1[cur_wavelength_id] * S13
+                            , cur_wavelength_id);
 
-        auto s3 = OpticalSignal(m_memory_in0[cur_wavelength_id] * S03 +
-                                m_memory_in1[cur_wavelength_id] * S13
-                                , cur_wavelength_id);
-
-        m_p2_out_writer.delayedWrite(s2, sc_time(m_delay_ns, SC_NS));
-        m_p3_out_writer.delayedWrite(s3, sc_time(m_delay_ns, SC_NS));
-    }
+    m_p2_out_writer.delayedWrite(s2, sc_time(m_delay_ns, SC_NS));
+    m_p3_out_writer.delayedWrite(s3, sc_time(m_delay_ns, SC_NS));
 }
 
 void DirectionalCouplerBi::on_p2_in_changed()
 {
-    m_through_power_dB = 10*log10(m_dc_through_coupling_power) - m_dc_loss;
-    m_cross_power_dB = 10*log10(1.0 - m_dc_through_coupling_power) - m_dc_loss;
+    const auto &S02 = m_S_through;
+    const auto &S13 = m_S_through;
+    const auto &S03 = m_S_cross;
+    const auto &S12 = m_S_cross;
 
-    m_memory_in2[0] = 0; // initializing for nan wavelength
+    // Read current inputs
+    const OpticalSignal &p2_in_read = p2_in->read();
 
-    const double transmission_through = pow(10.0, m_through_power_dB / 20.0);
-    const double transmission_cross = pow(10.0, m_cross_power_dB / 20.0);
-
-    // Pre-calculate S-parameters
-    OpticalSignal::field_type S02, S13, S03, S12;
-    S02 = polar(transmission_through, m_through_phase_rad);
-    S13 = polar(transmission_through, m_through_phase_rad);
-    S03 = polar(transmission_cross, m_cross_phase_rad);
-    S12 = polar(transmission_cross, m_cross_phase_rad);
-
-    OpticalSignal p2_in_read;
-
-    while (true) {
-        // Wait for a new input signal
-        wait();
-
-        // Read current inputs
-        p2_in_read = p2_in->read();
+    auto cur_wavelength_id = p2_in_read.m_wavelength_id;
 
-        auto cur_wavelength_id = p2_in_read.m_wavelength_id;
+    // Updating the field memory
+    m_memory_in2[cur_wavelength_id] = p2_in_read.m_field;
 
-        // Updating the field memory
-        m_memory_in2[cur_wavelength_id] = p2_in_read.m_field;
+    auto s0 = OpticalSignal(m_memory_in2[cur_wavelength_id] * S02 +
+                            m_memory_in3[cur_wavelength_id] * S03
+                            , cur_wavelength_id);
 
-        auto s0 = OpticalSignal(m_memory_in2[cur_wavelength_id] * S02 +
-                                m_memory_in3[cur_wavelength_id] * S03
-                                , cur_wavelength_id);
+    auto s1 = OpticalSignal(m_memory_in2[cur_wavelength_id] * S12 +
+                            m_memory_in3[cur_wavelength_id] * S13
+                            , cur_wavelength_id);
 
-        auto s1 = OpticalSignal(m_memory_in2[cur_wavelength_id] * S12 +
-                                m_memory_in3[cur_wavelength_id] * S13
-                                , cur_wavelength_id);
-
-        m_p0_out_writer.delayedWrite(s0, sc_time(m_delay_ns, SC_NS));
-        m_p1_out_writer.delayedWrite(s1, sc_time(m_delay_ns, SC_NS));
-    }
+    m_p0_out_writer.delayedWrite(s0, sc_time(m_delay_ns, SC_NS));
+    m_p1_out_writer.delayedWrite(s1, sc_time(m_delay_ns, SC_NS));
 }
 
 void DirectionalCouplerBi::on_p3_in_changed()
 {
-    m_through_power_dB = 10*log10(m_dc_through_coupling_power) - m_dc_loss;
-    m_cross_power_dB = 10*log10(1.0 - m_dc_through_coupling_power) - m_dc_loss;
+    const auto &S02 = m_S_through;
+    const auto &S13 = m_S_through;
+    const auto &S03 = m_S_cross;
+    const auto &S12 = m_S_cross;
 
-    m_memory_in3[0] = 0; // initializing for nan wavelength
+    // Read current inputs
+    const OpticalSignal &p3_in_read = p3_in->read();
 
-    const double transmission_through = pow(10.0, m_through_power_dB / 20.0);
-    const double transmission_cross = pow(10.0, m_cross_power_dB / 20.0);
-
-    // Pre-calculate S-parameters
-    OpticalSignal::field_type S02, S13, S03, S12;
-    S02 = polar(transmission_through, m_through_phase_rad);
-    S13 = polar(transmission_through, m_through_phase_rad);
-    S03 = polar(transmission_cross, m_cross_phase_rad);
-    S12 = polar(transmission_cross, m_cross_phase_rad);
+    auto cur_wavelength_id = p3_in_read.m_wavelength_id;
 
-    OpticalSignal p3_in_read;
+    // Updating the field memory
+    m_memory_in3[cur_wavelength_id] = p3_in_read.m_field;
 
-    while (true) {
-        // Wait for a new input signal
-        wait();
+    auto s0 = OpticalSignal(m_memory_in2[cur_wavelength_id] * S02 +
+                            m_memory_in3[cur_wavelength_id] * S03
+                            , cur_wavelength_id);
 
-        // Read current inputs
-        p3_in_read = p3_in->read();
+    auto s1 = OpticalSignal(m_memory_in2[cur_wavelength_id] * S12 +
+                            m_memory_in3[cur_wavelength_id] * S13
+                            , cur_wavelength_id);
 
-        auto cur_wavelength_id = p3_in_read.m_wavelength_id;
-
-        // Updating the field memory
-        m_memory_in3[cur_wavelength_id] = p3_in_read.m_field;
-
-        auto s0 = OpticalSignal(m_memory_in2[cur_wavelength_id] * S02 +
-                                m_memory_in3[cur_wavelength_id] * S03
-                                , cur_wavelength_id);
+    m_p0_out_writer.delayedWrite(s0, sc_time(m_delay_ns, SC_NS));
+    m_p1_out_writer.delayedWrite(s1, sc_time(m_delay_ns, SC_NS));
+}
 
-        auto s1 = OpticalSignal(m_memory_in2[cur_wavelength_id] * S12 +
-                                m_memory_in3[cur_wavelength_id] * S13
-                                , cur_wavelength_id);
+bool DirectionalCouplerUni::stamp_scattering(ScatteringStamp &stamp, uint32_t wavelength_id)
+{
+    (void)wavelength_id;
+    const sc_time delay(m_delay_ns, SC_NS);
+    stamp.add(p_out1, p_in1, m_S_through, delay);
+    stamp.add(p_out1, p_in2, m_S_cross, delay);
+    stamp.add(p_out2, p_in1, m_S_cross, delay);
+    stamp.add(p_out2, p_in2, m_S_through, delay);
+    return true;
+}
 
-        m_p0_out_writer.delayedWrite(s0, sc_time(m_delay_ns, SC_NS));
-        m_p1_out_writer.delayedWrite(s1, sc_time(m_delay_ns, SC_NS));
-    }
-}
\ No newline at end of file
+bool DirectionalCouplerBi::stamp_scattering(ScatteringStamp &stamp, uint32_t wavelength_id)
+{
+    (void)wavelength_id;
+    const sc_time delay(m_delay_ns, SC_NS);
+    stamp.add(p2_out, p0_in, m_S_through, delay);
+    stamp.add(p2_out, p1_in, m_S_cross, delay);
+    stamp.add(p3_out, p0_in, m_S_cross, delay);
+    stamp.add(p3_out, p1_in, m_S_through, delay);
+    stamp.add(p0_out, p2_in, m_S_through, delay);
+    stamp.add(p0_out, p3_in, m_S_cross, delay);
+    stamp.add(p1_out, p2_in, m_S_cross, delay);
+    stamp.add(p1_out, p3_in, m_S_through, delay);
+    return true;
+}
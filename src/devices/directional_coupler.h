@@ -5,6 +5,7 @@
 #include "optical_output_port.h"
 #include "optical_signal.h"
 #include "devices/spx_module.h"
+#include "utils/wavelength_field_store.h"
 
 
 class DirectionalCouplerBase : public spx_module {
@@ -19,6 +20,10 @@ public:
     double m_cross_power_dB;
     double m_dc_loss; // is in dB
 
+    // Pre-calculated S-parameters (see update_parameters)
+    OpticalSignal::field_type m_S_through;
+    OpticalSignal::field_type m_S_cross;
+
     // Constructor
     DirectionalCouplerBase(sc_module_name name,
                        double dc_through_coupling_power = 0.5,
@@ -29,6 +34,11 @@ public:
     {
         // nothing to do
     }
+
+    virtual void start_of_simulation();
+
+    /** Compute m_S_through and m_S_cross from the coupling and loss */
+    virtual void update_parameters();
 };
 
 class DirectionalCouplerUni : public DirectionalCouplerBase {
@@ -45,13 +55,16 @@ public:
 
     // Memory for multi-wavelength purposes
     // maybe with vector it has better performance
-    std::map<uint32_t,OpticalSignal::field_type> m_memory_in1;
-    std::map<uint32_t,OpticalSignal::field_type> m_memory_in2;
+    WavelengthFieldStore<OpticalSignal::field_type> m_memory_in1;
+    WavelengthFieldStore<OpticalSignal::field_type> m_memory_in2;
 
     // Processes
     void on_port_in1_changed();
     void on_port_in2_changed();
 
+    virtual void start_of_simulation();
+    virtual bool stamp_scattering(ScatteringStamp &stamp, uint32_t wavelength_id);
+
     // Constructor
     DirectionalCouplerUni(sc_module_name name,
                        double dc_through_coupling_power = 0.5,
@@ -62,11 +75,13 @@ public:
     {
         SC_HAS_PROCESS(DirectionalCouplerUni);
 
-        SC_THREAD(on_port_in1_changed);
+        SC_METHOD(on_port_in1_changed);
         sensitive << p_in1;
+        dont_initialize();
 
-        SC_THREAD(on_port_in2_changed);
+        SC_METHOD(on_port_in2_changed);
         sensitive << p_in2;
+        dont_initialize();
     }
 };
 
@@ -95,10 +110,10 @@ public:
 
     // Memory for multi-wavelength purposes
     // maybe with vector it has better performance
-    std::map<uint32_t,OpticalSignal::field_type> m_memory_in0;
-    std::map<uint32_t,OpticalSignal::field_type> m_memory_in1;
-    std::map<uint32_t,OpticalSignal::field_type> m_memory_in2;
-    std::map<uint32_t,OpticalSignal::field_type> m_memory_in3;
+    WavelengthFieldStore<OpticalSignal::field_type> m_memory_in0;
+    WavelengthFieldStore<OpticalSignal::field_type> m_memory_in1;
+    WavelengthFieldStore<OpticalSignal::field_type> m_memory_in2;
+    WavelengthFieldStore<OpticalSignal::field_type> m_memory_in3;
 
     // Processes
     void on_p0_in_changed();
@@ -106,6 +121,9 @@ public:
     void on_p2_in_changed();
     void on_p3_in_changed();
 
+    virtual void start_of_simulation();
+    virtual bool stamp_scattering(ScatteringStamp &stamp, uint32_t wavelength_id);
+
     // Constructor
     DirectionalCouplerBi(sc_module_name name,
                        double dc_through_coupling_power = 0.5,
@@ -118,16 +136,20 @@ public:
     {
         SC_HAS_PROCESS(DirectionalCouplerBi);
 
-        SC_THREAD(on_p0_in_changed);
+        SC_METHOD(on_p0_in_changed);
         sensitive << p0_in;
+        dont_initialize();
 
-        SC_THREAD(on_p1_in_changed);
+        SC_METHOD(on_p1_in_changed);
         sensitive << p1_in;
+        dont_initialize();
 
-        SC_THREAD(on_p2_in_changed);
+        SC_METHOD(on_p2_in_changed);
         sensitive << p2_in;
+        dont_initialize();
 
-        SC_THREAD(on_p3_in_changed);
+        SC_METHOD(on_p3_in_changed);
         sensitive << p3_in;
+        dont_initialize();
     }
 };
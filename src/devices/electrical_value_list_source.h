@@ -39,6 +39,7 @@ public:
         enable = sc_logic(0);
 
         SC_HAS_PROCESS(EVLSource);
+        flags = static_cast<ModuleFlags>(TIME_VARIANT | FREQUENCY_DEPENDENT);
         SC_THREAD(runner);
     }
 
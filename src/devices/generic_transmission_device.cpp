@@ -1,4 +1,5 @@
 #include "devices/generic_transmission_device.h"
+#include "scattering_solver.h"
 
 #define __modname(SUFFIX, IDX) \
     ((""s + this->name() + SUFFIX + "_" + to_string(IDX)).c_str())
@@ -62,6 +63,113 @@ TransmissionMatrix::paramset_type TransmissionMatrix::operator()(const size_t &i
     return {alpha,phi,tau};
 }
 
+void TransmissionMatrix::compile(const size_t max_order)
+{
+    // Number of orders actually used by any entry
+    m_norders = 1;
+    for (const auto *M : { &Malpha, &Mphi, &Mtau })
+        for (size_t k = 0; k < M->size(); ++k)
+            m_norders = max(m_norders, min(1 + max_order, (*M)[k].size()));
+
+    // Fill the blocks, with coefficient n divided by n!
+    const size_t NN = N * N;
+    m_coeffs.assign(3 * m_norders * NN, 0);
+    size_t param = 0;
+    for (const auto *M : { &Malpha, &Mphi, &Mtau })
+    {
+        for (size_t k = 0; k < NN; ++k)
+        {
+            if (!Mactive[k])
+                continue;
+            const auto &series = (*M)[k];
+            double fact_n = 1.0;
+            for (size_t order = 0; order < min(m_norders, series.size()); ++order)
+            {
+                if (order > 0)
+                    fact_n *= order;
+                m_coeffs[(param * m_norders + order) * NN + k] = series[order] / fact_n;
+            }
+        }
+        ++param;
+    }
+
+    m_eval.resize(3 * N);
+    m_rows.clear();
+    m_row_valid.clear();
+}
+
+void TransmissionMatrix::tabulate()
+{
+    const size_t n = OpticalSignal::wavelength_registry.size();
+    for (uint32_t wlid = 0; wlid < n; ++wlid)
+    {
+        if (isnan(OpticalSignal::getWavelengthUnchecked(wlid)))
+            continue;
+        for (size_t i = 0; i < N; ++i)
+            if (isInputActive(i))
+                row(i, wlid);
+    }
+}
+
+const TransmissionMatrix::row_type &TransmissionMatrix::evaluate_row(const size_t &i, const uint32_t &wavelength_id)
+{
+    if (m_coeffs.empty() && !row_function)
+        compile();
+
+    const size_t k = wavelength_id * N + i;
+    if (k >= m_row_valid.size())
+    {
+        m_rows.resize(k + N);
+        m_row_valid.resize(k + N, 0);
+    }
+
+    if (row_function)
+    {
+        auto &row = m_rows[k];
+        row.S.assign(N, 0);
+        row.delay.assign(N, SC_ZERO_TIME);
+        row_function(i, OpticalSignal::getWavelength(wavelength_id), row);
+        for (size_t j = 0; j < N; ++j)
+        {
+            if (!isActive(i, j))
+                row.S[j] = 0;
+        }
+        m_row_valid[k] = 1;
+        return row;
+    }
+
+    const size_t NN = N * N;
+    const wavelength_type dlambda = OpticalSignal::getWavelength(wavelength_id) - lambda0;
+
+    // Horner evaluation of alpha, phi and tau for all j at once
+    for (size_t param = 0; param < 3; ++param)
+    {
+        double *acc = &m_eval[param * N];
+        const double *c = &m_coeffs[((param * m_norders + m_norders - 1) * N + i) * N];
+        for (size_t j = 0; j < N; ++j)
+            acc[j] = c[j];
+        for (size_t order = m_norders - 1; order-- > 0;)
+        {
+            c -= NN;
+            for (size_t j = 0; j < N; ++j)
+                acc[j] = acc[j] * dlambda + c[j];
+        }
+    }
+
+    auto &row = m_rows[k];
+    row.S.assign(N, 0);
+    row.delay.assign(N, SC_ZERO_TIME);
+    for (size_t j = 0; j < N; ++j)
+    {
+        if (!isActive(i, j))
+            continue;
+        row.S[j] = polar(m_eval[j], m_eval[N + j]);
+        row.delay[j] = sc_time(m_eval[2 * N + j], SC_SEC);
+    }
+    m_row_valid[k] = 1;
+    return row;
+}
+
 void GenericTransmissionDevice::pre_init()
 {
     ports_in.clear();
@@ -81,6 +189,26 @@ void GenericTransmissionDevice::init()
 {
     prepareTM();
     assert(nports == TM.N);
+    TM.compile();
+
+    if (m_fused)
+    {
+        m_last_in.assign(nports, {});
+        m_delta_out.assign(nports, 0);
+        for (size_t i = 0; i < nports; ++i)
+        {
+            if (!TM.isInputActive(i))
+                continue;
+            sc_spawn_options opts;
+            opts.spawn_method();
+            opts.dont_initialize();
+            opts.set_sensitivity(ports_in[i].get());
+            sc_spawn(sc_bind(&GenericTransmissionDevice::on_input_i_changed, this, i),
+                (string(name()) + "process_" + to_string(i)).c_str(), &opts);
+        }
+        return;
+    }
+
     for (size_t i = 0; i < nports; ++i)
     {
         for (size_t j = 0; j < nports; ++j)
@@ -131,22 +259,57 @@ void GenericTransmissionDevice::input_on_i(size_t i)
             // cout << "(i,j):" << i << ", " << j << endl;
 
             // Get transmission parameters at this wavelength
-            auto Tij = TM(i, j, s.getWavelength());
+            const auto &row = TM.row(i, s.m_wavelength_id);
 
             // Apply parameters
-            auto deltaE_out = deltaE_in * polar(Tij.alpha, Tij.phi);
-
-            // cout << Tij.alpha << ", " << Tij.phi << ", " << Tij.tau << endl;
+            auto deltaE_out = deltaE_in * row.S[j];
 
             deltaE_out.getNewId();
 
             // Schedule writing the change in output port
-            ports_out_writers[j]->delayedWrite(deltaE_out, sc_time(Tij.tau, SC_SEC));
+            ports_out_writers[j]->delayedWrite(deltaE_out, row.delay[j]);
         }
     }
     while (true) { wait(); }
 }
 
+void GenericTransmissionDevice::on_input_i_changed(size_t i)
+{
+    // Read new input from i_in
+    const auto &s = (*ports_in[i])->read();
+    const uint32_t wlid = s.m_wavelength_id;
+
+    if (isnan(OpticalSignal::getWavelengthUnchecked(wlid)))
+        return;
+
+    // Compute delta at this wavelength and store the new input field
+    auto &last = m_last_in[i][wlid];
+    const OpticalSignal::field_type deltaE_in = s.m_field - last;
+    last = s.m_field;
+
+    // Apply the whole row of the matrix at once (the complex product is
+    // written out so that the loop vectorises: operator* checks for NaNs)
+    const auto &row = TM.row(i, wlid);
+    const auto *S = row.S.data();
+    auto *deltaE_out = m_delta_out.data();
+    const double dr = deltaE_in.real();
+    const double di = deltaE_in.imag();
+    for (size_t j = 0; j < nports; ++j)
+    {
+        const double sr = S[j].real();
+        const double si = S[j].imag();
+        deltaE_out[j] = OpticalSignal::field_type(sr * dr - si * di, sr * di + si * dr);
+    }
+
+    // Schedule writing the changes in the output ports
+    for (size_t j = 0; j < nports; ++j)
+    {
+        if (!TM.isActive(i, j))
+            continue;
+        ports_out_writers[j]->delayedWrite(OpticalSignal(deltaE_out[j], wlid), row.delay[j]);
+    }
+}
+
 void GenericTransmissionDevice::input_on_i_output_on_j(size_t i, size_t j)
 {
     auto last_signal = OpticalSignal(0);
@@ -160,7 +323,7 @@ void GenericTransmissionDevice::input_on_i_output_on_j(size_t i, size_t j)
     while (!active) { wait(); }
 
     complex<double> Sij;
-    double delay;
+    sc_time delay;
     
     // Wait for first signal to calculate Sij and delay
     volatile bool init_done = false;
@@ -178,13 +341,13 @@ void GenericTransmissionDevice::input_on_i_output_on_j(size_t i, size_t j)
             continue;
 
         // Find Sij at that wavelength
-        const auto Tij = TM(i, j, s.getWavelength());
-        Sij = polar(Tij.alpha, Tij.phi);
-        delay = Tij.tau;
-        
+        const auto &row = TM.row(i, s.m_wavelength_id);
+        Sij = row.S[j];
+        delay = row.delay[j];
+
         auto deltaE = (s - last_signal) * Sij;
         last_signal = s;
-        p_out_writer.delayedWrite(deltaE, sc_time(delay, SC_SEC));
+        p_out_writer.delayedWrite(deltaE, delay);
 
         init_done = true;
 
@@ -218,7 +381,22 @@ void GenericTransmissionDevice::input_on_i_output_on_j(size_t i, size_t j)
         //deltaE_out.getNewId();
 
         // Schedule writing the change in output port
-        p_out_writer.delayedWrite(deltaE, sc_time(delay, SC_SEC));
+        p_out_writer.delayedWrite(deltaE, delay);
         //wait(SC_ZERO_TIME);
     }
-}
\ No newline at end of file
+}
+
+bool GenericTransmissionDevice::stamp_scattering(ScatteringStamp &stamp, uint32_t wavelength_id)
+{
+    for (size_t i = 0; i < nports; ++i)
+    {
+        const auto &row = TM.row(i, wavelength_id);
+        for (size_t j = 0; j < nports; ++j)
+        {
+            if (!TM.isActive(i, j))
+                continue;
+            stamp.add(*ports_out[j], *ports_in[i], row.S[j], row.delay[j]);
+        }
+    }
+    return true;
+}
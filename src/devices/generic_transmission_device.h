@@ -5,12 +5,17 @@
 #include <systemc.h>
 #include <vector>
 #include <valarray>
+#include <complex>
+#include <cstdint>
+#include <functional>
 #include "devices/spx_module.h"
 #include "optical_signal.h"
 #include "optical_output_port.h"
+#include "utils/wavelength_field_store.h"
 
 using std::vector;
 using std::valarray;
+using std::complex;
 using std::string;
 using std::cout;
 using std::endl;
@@ -33,7 +38,62 @@ public:
     valarray<bool> Mactive;
     wavelength_type lambda0; // Wavelength at which the taylor coefficients were calculated
 
+    /** Transmission from input i to all outputs at one wavelength */
+    struct row_type {
+        vector<complex<double>> S;
+        vector<sc_time> delay;
+    };
+
+    /** Optional replacement for the Taylor expansion, for devices which
+     * know their response directly (e.g. from measured data). Fills
+     * row.S and row.delay (already of size N) for input i at a wavelength.
+     */
+    std::function<void(const size_t &i, const wavelength_type &lambda, row_type &row)> row_function;
+
+private:
+    // Compiled matrix (see compile()): Taylor coefficients divided by n!,
+    // stored as one contiguous N x N block per parameter and order,
+    // i.e. m_coeffs[((param * m_norders + order) * N + i) * N + j]
+    size_t m_norders = 0;
+    vector<param_type> m_coeffs;
+
+    // Rows already evaluated, indexed by wavelength_id * N + i
+    vector<row_type> m_rows;
+    vector<uint8_t> m_row_valid;
+
+    // Scratch space for the evaluation of one row
+    vector<param_type> m_eval;
+
+    const row_type &evaluate_row(const size_t &i, const uint32_t &wavelength_id);
+
+public:
     paramset_type operator()(const size_t &i, const size_t &j, const wavelength_type &lambda, const size_t max_order=2) const;
+
+    /** Prepare the fast evaluation of rows (see row()).
+     *
+     * Must be called once Malpha, Mphi, Mtau and Mactive are filled, and
+     * again whenever they change. Series are truncated to max_order as
+     * with operator().
+     */
+    void compile(const size_t max_order=2);
+
+    /** Evaluate the rows of all active inputs at all the wavelengths
+     * registered so far, so that row() is a lookup during the simulation.
+     */
+    void tabulate();
+
+    /** Transmission and delays from input i to all outputs at a wavelength.
+     *
+     * The row is evaluated for all outputs at once on the first call at a
+     * wavelength, then looked up. Inactive entries have S = 0.
+     */
+    inline const row_type &row(const size_t &i, const uint32_t &wavelength_id)
+    {
+        const size_t k = wavelength_id * N + i;
+        if (k < m_row_valid.size() && m_row_valid[k])
+            return m_rows[k];
+        return evaluate_row(i, wavelength_id);
+    }
     inline bool isActive(const size_t &i, const size_t &j) const
     { return Mactive[i * N + j]; }
     inline bool isInputActive(const size_t &i) const
@@ -52,6 +112,11 @@ public:
         Mphi.resize(0);
         Mtau.resize(0);
         Mactive.resize(0);
+        m_norders = 0;
+        m_coeffs.clear();
+        m_rows.clear();
+        m_row_valid.clear();
+        row_function = nullptr;
     }
 
     void resize(size_t nports)
@@ -75,14 +140,27 @@ public:
     vector<shared_ptr<OpticalOutputPort>> ports_out_writers;
     TransmissionMatrix TM;
 
+    /** Use one method process per input port applying the whole row of
+     * the matrix (default), instead of one thread per active (i,j) pair.
+     * Must be set before init().
+     */
+    bool m_fused = true;
+
+    // Fused mode: last field received on each input, by wavelength,
+    // and output deltas of the row being processed
+    vector<WavelengthFieldStore<OpticalSignal::field_type>> m_last_in;
+    vector<OpticalSignal::field_type> m_delta_out;
+
     /* ------------------------ */
     virtual void pre_init();
     virtual void init();
     virtual string describe() const;
     virtual void prepareTM() = 0;
+    virtual bool stamp_scattering(ScatteringStamp &stamp, uint32_t wavelength_id);
 
     // Process input on i
     void input_on_i(size_t i);
+    void on_input_i_changed(size_t i);
     void input_on_i_output_on_j(size_t i, size_t j);
 
     GenericTransmissionDevice(sc_module_name name, size_t N = 1)
@@ -1,69 +1,74 @@
 #include "devices/merger.h"
 #include "specs.h"
+#include "scattering_solver.h"
 
 using namespace std;
 
-void Merger::on_port_in1_changed()
+void Merger::start_of_simulation()
 {
-    const double transmission = pow(10.0, - m_attenuation_dB / 20) / sqrt(2);
+    update_parameters();
+    m_memory_in1.resize(OpticalSignal::wavelength_registry.size());
+    m_memory_in2.resize(OpticalSignal::wavelength_registry.size());
     m_memory_in1[0] = 0; // initializing for nan wavelength
+    m_memory_in2[0] = 0; // initializing for nan wavelength
 
     if (specsGlobalConfig.verbose_component_initialization)
     {
         cout << name() << ":" << endl;
-        cout << "transmission = " << pow(transmission, 2) << " W/W" << endl;
+        cout << "transmission = " << pow(m_transmission, 2) << " W/W" << endl;
         cout << (dynamic_cast<spx::oa_signal_type *>(p_in1.get_interface()))->name() << endl;
         cout << "\t --> \t" << (dynamic_cast<spx::oa_signal_type *>(p_out.get_interface()))->name() << endl;
         cout << (dynamic_cast<spx::oa_signal_type *>(p_in2.get_interface()))->name();
         cout << endl;
         cout << endl;
     }
+}
 
-    OpticalSignal p_in1_read;
+void Merger::update_parameters()
+{
+    m_transmission = pow(10.0, - m_attenuation_dB / 20) / sqrt(2);
+}
 
-    while (true) {
-        // Wait for a new input signal
-        wait();
-        // Read sum of input signals
-        p_in1_read = p_in1->read();
+void Merger::on_port_in1_changed()
+{
+    // Read sum of input signals
+    const OpticalSignal &p_in1_read = p_in1->read();
 
-        auto cur_wavelength_id = p_in1_read.m_wavelength_id;
-        // Updating the field memory
-        m_memory_in1[cur_wavelength_id] = p_in1_read.m_field;
+    auto cur_wavelength_id = p_in1_read.m_wavelength_id;
+    // Updating the field memory
+    m_memory_in1[cur_wavelength_id] = p_in1_read.m_field;
 
-        auto s = OpticalSignal(m_memory_in1[cur_wavelength_id] +
-                                m_memory_in2[cur_wavelength_id]
-                                , cur_wavelength_id);
+    auto s = OpticalSignal(m_memory_in1[cur_wavelength_id] +
+                            m_memory_in2[cur_wavelength_id]
+                            , cur_wavelength_id);
 
-        s *= transmission;
+    s *= m_transmission;
 
-        m_out_writer.delayedWrite(s,SC_ZERO_TIME);
-    }
+    m_out_writer.delayedWrite(s,SC_ZERO_TIME);
 }
 
 void Merger::on_port_in2_changed()
 {
-    const double transmission = pow(10.0, - m_attenuation_dB / 20) / sqrt(2);
-    m_memory_in2[0] = 0; // initializing for nan wavelength
+    // Read sum of input signals
+    const OpticalSignal &p_in2_read = p_in2->read();
 
-    OpticalSignal p_in2_read;
+    auto cur_wavelength_id = p_in2_read.m_wavelength_id;
+    // Updating the field memory
+    m_memory_in2[cur_wavelength_id] = p_in2_read.m_field;
 
-    while (true) {
-        // Wait for a new input signal
-        wait();
-        // Read sum of input signals
-        p_in2_read = p_in2->read();
+    auto s = OpticalSignal(m_memory_in1[cur_wavelength_id] +
+                            m_memory_in2[cur_wavelength_id]
+                            , cur_wavelength_id);
 
-        auto cur_wavelength_id = p_in2_read.m_wavelength_id;
-        // Updating the field memory
-        m_memory_in2[cur_wavelength_id] = p_in2_read.m_field;
+    s *= m_transmission;
 
-        auto s = OpticalSignal(m_memory_in1[cur_wavelength_id] +
-                                m_memory_in2[cur_wavelength_id]
-                                , cur_wavelength_id);
-
-        s *= transmission;
+    m_out_writer.delayedWrite(s,SC_ZERO_TIME);
+}
 
-        m_out_writer.delayedWrite(s,SC_ZERO_TIME);
-    }
-}
\ No newline at end of file
+bool Merger::stamp_scattering(ScatteringStamp &stamp, uint32_t wavelength_id)
+{
+    (void)wavelength_id;
+    stamp.add(p_out, p_in1, m_transmission);
+    stamp.add(p_out, p_in2, m_transmission);
+    return true;
+}
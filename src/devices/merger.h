@@ -8,6 +8,7 @@
 #include "optical_signal.h"
 
 #include "specs.h"
+#include "utils/wavelength_field_store.h"
 
 // A symmetric no-delay merger
 class Merger : public spx_module {
@@ -23,15 +24,22 @@ public:
     // Member variables
     double m_attenuation_dB;
 
+    // Pre-calculated field transmission (see update_parameters)
+    double m_transmission;
+
     // Memory for multi-wavelength purposes
     // maybe with vector it has better performance
-    std::map<uint32_t,OpticalSignal::field_type> m_memory_in1;
-    std::map<uint32_t,OpticalSignal::field_type> m_memory_in2;
+    WavelengthFieldStore<OpticalSignal::field_type> m_memory_in1;
+    WavelengthFieldStore<OpticalSignal::field_type> m_memory_in2;
 
     // Processes
     void on_port_in1_changed();
     void on_port_in2_changed();
 
+    virtual void start_of_simulation();
+    virtual void update_parameters();
+    virtual bool stamp_scattering(ScatteringStamp &stamp, uint32_t wavelength_id);
+
     // Constructor
     Merger(sc_module_name name,
            double attenuation_dB = 0)
@@ -41,10 +49,12 @@ public:
     {
         SC_HAS_PROCESS(Merger);
 
-        SC_THREAD(on_port_in1_changed);
+        SC_METHOD(on_port_in1_changed);
         sensitive << p_in1;
+        dont_initialize();
 
-        SC_THREAD(on_port_in2_changed);
+        SC_METHOD(on_port_in2_changed);
         sensitive << p_in2;
+        dont_initialize();
     }
 };
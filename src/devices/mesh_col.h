@@ -40,6 +40,7 @@ public:
     // Initialization functions
     void init_ports();
     void init();
+    virtual bool is_composite() const { return true; }
 
     void init_N_even_j_even();
     void init_N_even_j_odd();
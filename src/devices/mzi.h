@@ -44,6 +44,7 @@ public:
     unique_ptr<DirectionalCoupler> DC1,DC2;
 
     virtual void init();
+    virtual bool is_composite() const { return true; }
 
     /** Constructor for MZI
      *
@@ -26,6 +26,7 @@ public:
 
     virtual void init() = 0;
     virtual void connect_submodules() = 0;
+    virtual bool is_composite() const { return true; }
 
     // Member submodules
     shared_ptr<WaveguideBase> m_wg1, m_wg2, m_wg3;
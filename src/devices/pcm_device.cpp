@@ -7,7 +7,7 @@
 
 using namespace std;
 
-void PCMElement::on_input_changed()
+void PCMElement::start_of_simulation()
 {
     // setting the transmission for the initial state
     update_transmission_local();
@@ -28,68 +28,63 @@ void PCMElement::on_input_changed()
     }
 
     m_last_pulse_power = 0;
-    bool in_window = false;
-    vector<pulse_sample_t> vector_of_samples;
-    uint32_t cur_wavelength_id;
+    m_samples.clear();
+    m_memory_in.resize(OpticalSignal::wavelength_registry.size());
     m_memory_in[0] = 0;
-    double total_in_power = 0;
-
-    while (true) {
-        // Wait next input change
-        wait();
+}
 
-        // Read signal and store field in memory for that wavelength
-        auto s = p_in->read();
-        cur_wavelength_id = s.m_wavelength_id;
-        m_memory_in[cur_wavelength_id] = s.m_field;
+void PCMElement::on_input_changed()
+{
+    // Read signal and store field in memory for that wavelength
+    auto s = p_in->read();
+    m_memory_in[s.m_wavelength_id] = s.m_field;
 
-        // Summing powers of all wavelengths (IGNORE heterodyne effects !)
-        total_in_power = 0;
-        for (auto lambdaID_field : m_memory_in)
-        {
-            total_in_power += norm(lambdaID_field.second);
-        }
+    // Summing powers of all wavelengths (IGNORE heterodyne effects !)
+    double total_in_power = 0;
+    for (const auto &field : m_memory_in.values())
+    {
+        total_in_power += norm(field);
+    }
 
-        // Storage of optical state on the input
-        const sc_time &now = sc_time_stamp();
+    // Storage of optical state on the input
+    const sc_time &now = sc_time_stamp();
 
-        bool last_was_zero = m_last_pulse_power < ZERO_PULSE_THRESHOLD;
-        bool current_is_zero = total_in_power < ZERO_PULSE_THRESHOLD;
-        bool rising_edge = last_was_zero && !current_is_zero;
-        if (!rising_edge)
-        {
-            // Enter here when:
-            //   - a signal is received on top of another one (pulse intersect)
-            //   - a signal ends (power falls to 0)
+    bool last_was_zero = m_last_pulse_power < ZERO_PULSE_THRESHOLD;
+    bool current_is_zero = total_in_power < ZERO_PULSE_THRESHOLD;
+    bool rising_edge = last_was_zero && !current_is_zero;
+    if (!rising_edge)
+    {
+        // Enter here when:
+        //   - a signal is received on top of another one (pulse intersect)
+        //   - a signal ends (power falls to 0)
 
-            // Record the event
-            vector_of_samples.emplace_back(now.to_seconds(), total_in_power);
-        }
-        else
-        {
-            // Enter here when:
-            //   - a signal starts (power rises from 0 to non-0 value)
-            // This case is necessarily the first rise
-
-            // Will unroll events and check if there was a phase change before according to
-            // the vector and advance the state accordingly to get the transmission
-            // cout << "\t\t first rise detected" << endl;
-            in_window = phase_change(vector_of_samples, true);
-            if (!in_window)
-                vector_of_samples.clear();
-
-            // Record the current event
-            vector_of_samples.emplace_back(now.to_seconds(), total_in_power);
-        }
+        // Record the event
+        m_samples.emplace_back(now.to_seconds(), total_in_power);
+    }
+    else
+    {
+        // Enter here when:
+        //   - a signal starts (power rises from 0 to non-0 value)
+        // This case is necessarily the first rise
+
+        // Will unroll events and check if there was a phase change before according to
+        // the vector and advance the state accordingly to get the transmission
+        // cout << "\t\t first rise detected" << endl;
+        bool in_window = phase_change(m_samples, true);
+        if (!in_window)
+            m_samples.clear();
+
+        // Record the current event
+        m_samples.emplace_back(now.to_seconds(), total_in_power);
+    }
 
-        m_last_pulse_power = total_in_power;
+    m_last_pulse_power = total_in_power;
 
-        // Write attenuated signal to output
-        s *= m_Tcurrent_field;
-        s.getNewId();
+    // Write attenuated signal to output
+    s *= m_Tcurrent_field;
+    s.getNewId();
 
-        m_out_writer.delayedWrite(s, SC_ZERO_TIME);
-    }
+    m_out_writer.delayedWrite(s, SC_ZERO_TIME);
 }
 
 bool PCMElement::phase_change(const vector<pulse_sample_t> &samples, const bool &local)
@@ -9,6 +9,7 @@
 #include "optical_signal.h"
 
 #include "specs.h"
+#include "utils/wavelength_field_store.h"
 
 class PCMElement : public spx_module {
 public:
@@ -36,11 +37,16 @@ public:
 
     /** Current information about the optical input, before any attenuation and phase shift. */
     double m_last_pulse_power = 0;
-    std::map<uint32_t,OpticalSignal::field_type> m_memory_in;
+    WavelengthFieldStore<OpticalSignal::field_type> m_memory_in;
+
+    /** Input power samples recorded since the last pulse was evaluated. */
+    vector<pulse_sample_t> m_samples;
 
     // Processes
     void on_input_changed();
 
+    virtual void start_of_simulation();
+
     // Member functions
     bool phase_change(const vector<pulse_sample_t> &vec, const bool &local);
     void update_transmission_local();
@@ -65,8 +71,10 @@ public:
         , m_stateCurrent(state)
     {
         SC_HAS_PROCESS(PCMElement);
+        flags = static_cast<ModuleFlags>(NON_LINEAR | FREQUENCY_DEPENDENT);
 
-        SC_THREAD(on_input_changed);
+        SC_METHOD(on_input_changed);
         sensitive << p_in;
+        dont_initialize();
     }
 };
@@ -1,19 +1,36 @@
 #include "specs.h"
 #include "devices/phaseshifter.h"
+#include "scattering_solver.h"
 
 using namespace std;
 
-void PhaseShifterUni::on_port_in_changed()
+void PhaseShifterBase::start_of_simulation()
 {
-    auto transmission_field = pow(10.0, - m_attenuation_dB / 20);
-    m_memory_in[0] = 0; // initializing for nan wavelength
+    update_parameters();
 
     if (specsGlobalConfig.verbose_component_initialization)
     {
         cout << name() << ":" << endl;
-        cout << "transmission_power = " << pow(transmission_field,2) << " W/W" << endl;
+        cout << "transmission_power = " << pow(m_transmission_field,2) << " W/W" << endl;
         cout << "sensitivity = " << m_sensitivity << " rad/V" << endl;
         cout << "initial phase delay = " << m_phaseshift_rad << " rad @1.55)" << endl;
+    }
+}
+
+void PhaseShifterBase::update_parameters()
+{
+    m_transmission_field = pow(10.0, - m_attenuation_dB / 20);
+}
+
+void PhaseShifterUni::start_of_simulation()
+{
+    PhaseShifterBase::start_of_simulation();
+
+    m_memory_in.resize(OpticalSignal::wavelength_registry.size());
+    m_memory_in[0] = 0; // initializing for nan wavelength
+
+    if (specsGlobalConfig.verbose_component_initialization)
+    {
         cout << (dynamic_cast<spx::oa_signal_type *>(p_in.get_interface()))->name();
         cout << " --> ";
         cout << (dynamic_cast<spx::oa_signal_type *>(p_out.get_interface()))->name();
@@ -23,72 +40,59 @@ void PhaseShifterUni::on_port_in_changed()
         cout << endl;
         cout << endl;
     }
-    while (true) {
-        // Wait for a new input signal
-        wait();
-
-        // Read the input signal and apply attenuation
-        OpticalSignal s = p_in->read();
+}
 
+void PhaseShifterUni::on_port_in_changed()
+{
+    // Read the input signal and apply attenuation
+    OpticalSignal s = p_in->read();
 
-        // Store field value in memory
-        m_memory_in[s.m_wavelength_id] = s.m_field;
+    // Store field value in memory
+    m_memory_in[s.m_wavelength_id] = s.m_field;
 
-        // Get new ID for output event
-        s.getNewId();
+    // Get new ID for output event
+    s.getNewId();
 
-        // Apply transmission and phase-shift
-        s *= polar(transmission_field, m_sensitivity * p_vin->read());
+    // Apply transmission and phase-shift
+    s *= polar(m_transmission_field, m_sensitivity * p_vin->read());
 
-        // Write to ouput port after zero delay
-        m_out_writer.delayedWrite(s, SC_ZERO_TIME);
-    }
+    // Write to ouput port after zero delay
+    m_out_writer.delayedWrite(s, SC_ZERO_TIME);
 }
 
 void PhaseShifterUni::on_port_vin_changed()
 {
-    auto transmission_field = pow(10.0, - m_attenuation_dB / 20);
+    // Read the new phase-delay
+    m_phaseshift_rad = m_sensitivity * p_vin->read();
+    const auto S = polar(m_transmission_field, m_phaseshift_rad);
 
-    uint32_t cur_wavelength_id = 0;
-    OpticalSignal::field_type cur_field = (complex<double>)0;
-
-    while (true)
+    // writes the signals of all wavelengths with the new phase shift
+    m_memory_in.for_each([&](uint32_t wlid, const OpticalSignal::field_type &field)
     {
-        wait();
-        // Read the new phase-delay
-        m_phaseshift_rad = m_sensitivity * p_vin->read();
-
-        // writes the signals of all wavelengths with the new phase shift
-        for(auto id_field : m_memory_in)
-        {
-            cur_wavelength_id = id_field.first;
-            cur_field = id_field.second;
-            auto s = OpticalSignal(cur_field, cur_wavelength_id);
-
-            // Get a new ID for the signal
-            s.getNewId();
-
-            // Apply transmission and phase-shift
-            s *= polar(transmission_field, m_phaseshift_rad);
-
-            // Write to ouput port after zero delay
-            m_out_writer.delayedWrite(s, SC_ZERO_TIME);
-        }
-    }
-}
+        auto s = OpticalSignal(field, wlid);
+
+        // Get a new ID for the signal
+        s.getNewId();
 
+        // Apply transmission and phase-shift
+        s *= S;
 
-void PhaseShifterBi::on_p0_in_changed()
+        // Write to ouput port after zero delay
+        m_out_writer.delayedWrite(s, SC_ZERO_TIME);
+    });
+}
+
+void PhaseShifterBi::start_of_simulation()
 {
-    auto transmission_field = pow(10.0, - m_attenuation_dB / 20);
+    PhaseShifterBase::start_of_simulation();
+
+    m_memory_p0.resize(OpticalSignal::wavelength_registry.size());
+    m_memory_p1.resize(OpticalSignal::wavelength_registry.size());
     m_memory_p0[0] = 0; // initializing for nan wavelength
+    m_memory_p1[0] = 0; // initializing for nan wavelength
 
     if (specsGlobalConfig.verbose_component_initialization)
     {
-        cout << name() << ":" << endl;
-        cout << "transmission_power = " << pow(transmission_field,2) << " W/W" << endl;
-        cout << "sensitivity = " << m_sensitivity << " rad/V" << endl;
-        cout << "initial phase delay = " << m_phaseshift_rad << " rad @1.55)" << endl;
         cout << (dynamic_cast<spx::oa_signal_type *>(p0_in.get_interface()))->name();
         cout << " --> ";
         cout << (dynamic_cast<spx::oa_signal_type *>(p1_out.get_interface()))->name();
@@ -102,97 +106,91 @@ void PhaseShifterBi::on_p0_in_changed()
         cout << endl;
         cout << endl;
     }
-    while (true) {
-        // Wait for a new input signal
-        wait();
-
-        // Read the input signal and apply attenuation
-        OpticalSignal s = p0_in->read();
+}
 
+void PhaseShifterBi::on_p0_in_changed()
+{
+    // Read the input signal and apply attenuation
+    OpticalSignal s = p0_in->read();
 
-        // Store field value in memory
-        m_memory_p0[s.m_wavelength_id] = s.m_field;
+    // Store field value in memory
+    m_memory_p0[s.m_wavelength_id] = s.m_field;
 
-        // Get new ID for output event
-        s.getNewId();
+    // Get new ID for output event
+    s.getNewId();
 
-        // Apply transmission and phase-shift
-        s *= polar(transmission_field, m_sensitivity * p_vin->read());
+    // Apply transmission and phase-shift
+    s *= polar(m_transmission_field, m_sensitivity * p_vin->read());
 
-        // Write to ouput port after zero delay
-        m_p1_writer.delayedWrite(s, SC_ZERO_TIME);
-    }
+    // Write to ouput port after zero delay
+    m_p1_writer.delayedWrite(s, SC_ZERO_TIME);
 }
 
 void PhaseShifterBi::on_p1_in_changed()
 {
-    auto transmission_field = pow(10.0, - m_attenuation_dB / 20);
-    m_memory_p1[0] = 0; // initializing for nan wavelength
+    // Read the input signal and apply attenuation
+    OpticalSignal s = p1_in->read();
+
+    // Store field value in memory
+    m_memory_p1[s.m_wavelength_id] = s.m_field;
 
-    while (true) {
-        // Wait for a new input signal
-        wait();
+    // Get new ID for output event
+    s.getNewId();
 
-        // Read the input signal and apply attenuation
-        OpticalSignal s = p1_in->read();
+    // Apply transmission and phase-shift
+    s *= polar(m_transmission_field, m_sensitivity * p_vin->read());
 
-        // Store field value in memory
-        m_memory_p1[s.m_wavelength_id] = s.m_field;
+    // Write to ouput port after zero delay
+    m_p0_writer.delayedWrite(s, SC_ZERO_TIME);
+}
+
+void PhaseShifterBi::on_port_vin_changed()
+{
+    // Read the new phase-delay
+    m_phaseshift_rad = m_sensitivity * p_vin->read();
+    const auto S = polar(m_transmission_field, m_phaseshift_rad);
 
-        // Get new ID for output event
+    // writes the signals of all wavelengths with the new phase shift
+    m_memory_p0.for_each([&](uint32_t wlid, const OpticalSignal::field_type &field)
+    {
+        auto s = OpticalSignal(field, wlid);
+
+        // Get a new ID for the signal
         s.getNewId();
 
         // Apply transmission and phase-shift
-        s *= polar(transmission_field, m_sensitivity * p_vin->read());
+        s *= S;
+
+        // Write to ouput port after zero delay
+        m_p1_writer.delayedWrite(s, SC_ZERO_TIME);
+    });
+    m_memory_p1.for_each([&](uint32_t wlid, const OpticalSignal::field_type &field)
+    {
+        auto s = OpticalSignal(field, wlid);
+
+        // Get a new ID for the signal
+        s.getNewId();
+
+        // Apply transmission and phase-shift
+        s *= S;
 
         // Write to ouput port after zero delay
         m_p0_writer.delayedWrite(s, SC_ZERO_TIME);
-    }
+    });
 }
 
-void PhaseShifterBi::on_port_vin_changed()
+bool PhaseShifterUni::stamp_scattering(ScatteringStamp &stamp, uint32_t wavelength_id)
 {
-    auto transmission_field = pow(10.0, - m_attenuation_dB / 20);
-
-    uint32_t cur_wavelength_id = 0;
-    OpticalSignal::field_type cur_field = (complex<double>)0;
+    (void)wavelength_id;
+    stamp.add(p_out, p_in, polar(m_transmission_field, m_sensitivity * p_vin->read()));
+    return true;
+}
 
-    while (true)
-    {
-        wait();
-        // Read the new phase-delay
-        m_phaseshift_rad = m_sensitivity * p_vin->read();
-
-        // writes the signals of all wavelengths with the new phase shift
-        for(auto id_field : m_memory_p0)
-        {
-            cur_wavelength_id = id_field.first;
-            cur_field = id_field.second;
-            auto s = OpticalSignal(cur_field, cur_wavelength_id);
-
-            // Get a new ID for the signal
-            s.getNewId();
-
-            // Apply transmission and phase-shift
-            s *= polar(transmission_field, m_phaseshift_rad);
-
-            // Write to ouput port after zero delay
-            m_p1_writer.delayedWrite(s, SC_ZERO_TIME);
-        }
-        for(auto id_field : m_memory_p1)
-        {
-            cur_wavelength_id = id_field.first;
-            cur_field = id_field.second;
-            auto s = OpticalSignal(cur_field, cur_wavelength_id);
-
-            // Get a new ID for the signal
-            s.getNewId();
-
-            // Apply transmission and phase-shift
-            s *= polar(transmission_field, m_phaseshift_rad);
-
-            // Write to ouput port after zero delay
-            m_p0_writer.delayedWrite(s, SC_ZERO_TIME);
-        }
-    }
+bool PhaseShifterBi::stamp_scattering(ScatteringStamp &stamp, uint32_t wavelength_id)
+{
+    (void)wavelength_id;
+    const auto S = polar(m_transmission_field, m_sensitivity * p_vin->read());
+    stamp.add(p1_out, p0_in, S);
+    stamp.add(p0_out, p1_in, S);
+    return true;
 }
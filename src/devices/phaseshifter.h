@@ -6,6 +6,7 @@
 #include "devices/spx_module.h"
 #include "optical_output_port.h"
 #include "optical_signal.h"
+#include "utils/wavelength_field_store.h"
 
 /** An electrically-controllable phase shifter. */
 class PhaseShifterBase : public spx_module {
@@ -20,6 +21,9 @@ public:
     /** The responsivity of the phase-shifter in rad/V. */
     double m_sensitivity = 1;
 
+    /** The field transmission of the device (see update_parameters). */
+    double m_transmission_field = 1;
+
     /** Constructor for PhaseShifter
      *
      * @param name name of the module
@@ -28,7 +32,13 @@ public:
         : spx_module(name)
         , m_phaseshift_rad(0)
         , m_attenuation_dB(attenuation_dB)
-    {}
+    {
+        // Phase depends on the electrical input
+        flags = static_cast<ModuleFlags>(TIME_VARIANT | FREQUENCY_DEPENDENT);
+    }
+
+    virtual void start_of_simulation();
+    virtual void update_parameters();
 };
 
 class PhaseShifterUni : public PhaseShifterBase {
@@ -49,7 +59,7 @@ public:
     OpticalOutputPort m_out_writer;
 
     /** Memory of the current input value for all wavelengths. */
-    std::map<uint32_t,OpticalSignal::field_type> m_memory_in;
+    WavelengthFieldStore<OpticalSignal::field_type> m_memory_in;
 
     // Processes
     /** Main process of the module.
@@ -57,7 +67,7 @@ public:
      * It copies the input to the output, after attenuation and delay.
      * Will use the current m_phaseshift_rad at that moment.
      *
-     *   **SystemC type:** thread
+     *   **SystemC type:** method
      *
      *   **Sensitivity list:** p_in
      * */
@@ -69,12 +79,15 @@ public:
      * using the current optical input, sending it to the output
      * after zero time.
      *
-     *   **SystemC type:** thread
+     *   **SystemC type:** method
      *
      *   **Sensitivity list:** v_in
      * */
     void on_port_vin_changed();
 
+    virtual void start_of_simulation();
+    virtual bool stamp_scattering(ScatteringStamp &stamp, uint32_t wavelength_id);
+
     /** Constructor for PhaseShifter
      *
      * @param name name of the module
@@ -85,10 +98,12 @@ public:
     {
         SC_HAS_PROCESS(PhaseShifterUni);
 
-        SC_THREAD(on_port_in_changed);
+        SC_METHOD(on_port_in_changed);
         sensitive << p_in;
-        SC_THREAD(on_port_vin_changed);
+        dont_initialize();
+        SC_METHOD(on_port_vin_changed);
         sensitive << p_vin;
+        dont_initialize();
     }
 };
 
@@ -117,8 +132,8 @@ public:
     OpticalOutputPort m_p1_writer;
 
     /** Memory of the current input value for all wavelengths. */
-    std::map<uint32_t,OpticalSignal::field_type> m_memory_p0;
-    std::map<uint32_t,OpticalSignal::field_type> m_memory_p1;
+    WavelengthFieldStore<OpticalSignal::field_type> m_memory_p0;
+    WavelengthFieldStore<OpticalSignal::field_type> m_memory_p1;
 
     // Processes
     /** Main process of the module.
@@ -126,7 +141,7 @@ public:
      * It copies the input to the output, after attenuation and delay.
      * Will use the current m_phaseshift_rad at that moment.
      *
-     *   **SystemC type:** thread
+     *   **SystemC type:** method
      *
      *   **Sensitivity list:** p0_in
      * */
@@ -139,12 +154,15 @@ public:
      * using the current optical input, sending it to the output
      * after zero time.
      *
-     *   **SystemC type:** thread
+     *   **SystemC type:** method
      *
      *   **Sensitivity list:** v_in
      * */
     void on_port_vin_changed();
 
+    virtual void start_of_simulation();
+    virtual bool stamp_scattering(ScatteringStamp &stamp, uint32_t wavelength_id);
+
     /** Constructor for PhaseShifter
      *
      * @param name name of the module
@@ -156,11 +174,14 @@ public:
     {
         SC_HAS_PROCESS(PhaseShifterBi);
 
-        SC_THREAD(on_p0_in_changed);
+        SC_METHOD(on_p0_in_changed);
         sensitive << p0_in;
-        SC_THREAD(on_p1_in_changed);
+        dont_initialize();
+        SC_METHOD(on_p1_in_changed);
         sensitive << p1_in;
-        SC_THREAD(on_port_vin_changed);
+        dont_initialize();
+        SC_METHOD(on_port_vin_changed);
         sensitive << p_vin;
+        dont_initialize();
     }
 };
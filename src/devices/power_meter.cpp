@@ -11,26 +11,28 @@ void PowerMeter::trace(sc_trace_file *Tf) const
     sc_trace(Tf, m_cur_power, (string(name()) + ".power").c_str());
 }
 
-void PowerMeter::on_port_in_changed()
+void PowerMeter::start_of_simulation()
 {
     // always initialize memory
+    m_memory_in.resize(OpticalSignal::wavelength_registry.size());
     m_memory_in[0] = 0;
+    m_cur_power = 0;
+}
 
-    while (true) {
-        // Wait for a new input signal
-        wait();
-
-        const auto &p_in_read = p_in->read();
+void PowerMeter::on_port_in_changed()
+{
+    const auto &p_in_read = p_in->read();
 
-        auto cur_wavelength_id = p_in_read.m_wavelength_id;
-        // Updating the field memory
-        m_memory_in[cur_wavelength_id] = p_in_read.m_field;
+    auto cur_wavelength_id = p_in_read.m_wavelength_id;
+    // Updating the field memory
+    m_memory_in[cur_wavelength_id] = p_in_read.m_field;
 
-        double total_power = 0;
-        for (auto field : m_memory_in)
-        {
-            total_power += norm(field.second);
-        }
-        m_cur_power = total_power;
+    double total_power = 0;
+    for (const auto &field : m_memory_in.values())
+    {
+        total_power += norm(field);
     }
+    m_cur_power = total_power;
+    if (m_mt)
+        m_mt->push(m_mt_channel, sc_time_stamp().value(), &m_cur_power);
 }
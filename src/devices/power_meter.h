@@ -8,6 +8,8 @@
 #include "optical_signal.h"
 #include "specs.h"
 #include "spx_module.h"
+#include "memory_trace.h"
+#include "utils/wavelength_field_store.h"
 
 /* Power meter (DC component only) */
 class PowerMeter : public spx_module {
@@ -16,21 +18,37 @@ public:
     spx::oa_port_in_type p_in;
     double m_cur_power;
 
+    // Power is also recorded here if set (see specs_api.h)
+    MemoryTrace *m_mt = nullptr;
+    MemoryTrace::channel_id m_mt_channel = 0;
+
     // Input memory for multi-wavelength purposes
-    std::map<uint32_t,OpticalSignal::field_type> m_memory_in;
+    WavelengthFieldStore<OpticalSignal::field_type> m_memory_in;
 
     // Processes
     void on_port_in_changed();
 
+    virtual void start_of_simulation();
+
+    // No optical output: nothing to stamp
+    virtual bool stamp_scattering(ScatteringStamp &, uint32_t) { return true; }
+
     virtual void trace(sc_trace_file *Tf) const;
 
+    void setMemoryTrace(MemoryTrace *mt)
+    {
+        m_mt = mt;
+        m_mt_channel = m_mt->add_channel(name(), {"power"});
+    }
+
     // Constructor
     PowerMeter(sc_module_name name)
         : spx_module(name)
     {
         SC_HAS_PROCESS(PowerMeter);
 
-        SC_THREAD(on_port_in_changed);
+        SC_METHOD(on_port_in_changed);
         sensitive << p_in;
+        dont_initialize();
     }
 };
@@ -6,7 +6,7 @@
     ((""s + this->name() + "_" + SUFFIX + to_string(IDX)).c_str())
 
 
-void Probe::on_port_in_changed()
+void Probe::start_of_simulation()
 {
     if (specsGlobalConfig.verbose_component_initialization)
     {
@@ -18,32 +18,44 @@ void Probe::on_port_in_changed()
         cout << "trace wavelength: " << m_trace_wavelength << endl;
         cout << endl;
     }
+}
 
-    while (true) {
-        // Wait for a new input signal
-        wait();
+void Probe::on_port_in_changed()
+{
+    // Woken up by the rising edge of enable: go back to static sensitivity
+    if (m_wait_enable)
+    {
+        m_wait_enable = false;
+        return;
+    }
 
-        // Check if enabled first
-        if (!enable.read().to_bool())
-        {
-            wait(enable.posedge_event());
-            continue;
-        }
+    // Check if enabled first
+    if (!enable.read().to_bool())
+    {
+        m_wait_enable = true;
+        next_trigger(enable.posedge_event());
+        return;
+    }
 
-        auto &s = p_in->read();
-        // cout << name() << ": " << s << endl;
-        if (!isnan(s.getWavelength()))
-        {
-            if (m_trace_power)
-                m_trace_sig_power.write(s.power());
-            if (m_trace_modulus)
-                m_trace_sig_modulus.write(s.modulus());
-            if (m_trace_phase)
-                m_trace_sig_phase.write(s.phase());
-            if (m_trace_wavelength)
-                // m_trace_sig_wavelength.write(299792458.0 / s.m_wavelength);
-                m_trace_sig_wavelength.write(s.getWavelength());
-        }
+    auto &s = p_in->read();
+    // cout << name() << ": " << s << endl;
+    if (m_deadband.enabled() && !m_deadband.accept(s.m_wavelength_id, s.m_field))
+        return;
+    if (m_mt && !isnan(s.getWavelength()))
+        m_mt->push_field(m_mt_channel, sc_time_stamp().value(), s.m_wavelength_id, s.m_field);
+    else if (m_bt && !isnan(s.getWavelength()))
+        m_bt->push_field(m_bt_channel, sc_time_stamp().value(), s.m_wavelength_id, s.m_field);
+    else if (!isnan(s.getWavelength()))
+    {
+        if (m_trace_power)
+            m_trace_sig_power.write(s.power());
+        if (m_trace_modulus)
+            m_trace_sig_modulus.write(s.modulus());
+        if (m_trace_phase)
+            m_trace_sig_phase.write(s.phase());
+        if (m_trace_wavelength)
+            // m_trace_sig_wavelength.write(299792458.0 / s.m_wavelength);
+            m_trace_sig_wavelength.write(s.getWavelength());
     }
 }
 
@@ -51,26 +63,18 @@ void PowerProbe::on_port_in_changed()
 {
     //m_trace_sig.write(0);
 
-    while (true) {
-        // Wait for a new input signal
-        wait();
-        auto &s = p_in->read();
-        if (!isnan(s.getWavelength()))
-            m_trace_sig_power.write(s.power());
-    }
+    auto &s = p_in->read();
+    if (!isnan(s.getWavelength()))
+        m_trace_sig_power.write(s.power());
 }
 
 void PhaseProbe::on_port_in_changed()
 {
     //m_trace_sig.write(0);
 
-    while (true) {
-        // Wait for a new input signal
-        wait();
-        auto &s = p_in->read();
-        if (!isnan(s.getWavelength()))
-            m_trace_sig_phase.write(s.phase());
-    }
+    auto &s = p_in->read();
+    if (!isnan(s.getWavelength()))
+        m_trace_sig_phase.write(s.phase());
 }
 
 //__modname(SUFFIX, IDX)
@@ -119,10 +123,8 @@ void MLambdaProbe::setTraceFile(sc_trace_file *Tf)
         ++i;
     }
 }
-void MLambdaProbe::on_port_in_changed()
+void MLambdaProbe::start_of_simulation()
 {
-    // std::map< int, std::vector< unique_ptr<sc_signal<double> > > > wl_map;
-
     if (specsGlobalConfig.verbose_component_initialization)
     {
         cout << name() << " ready (";
@@ -134,31 +136,36 @@ void MLambdaProbe::on_port_in_changed()
         cout << "Signal: " << (dynamic_cast<spx::oa_signal_type *>(p_in.get_interface()))->name() << endl;
         cout << endl;
     }
-    //m_trace_sig.write(0);
+}
 
-    while (true) {
-        // Wait for a new input signal
-        wait();
+void MLambdaProbe::on_port_in_changed()
+{
+    // Woken up by the rising edge of enable: go back to static sensitivity
+    if (m_wait_enable)
+    {
+        m_wait_enable = false;
+        return;
+    }
 
-        // Check if enabled first
-        if (!enable.read().to_bool())
-        {
-            wait(enable.posedge_event());
-            continue;
-        }
+    // Check if enabled first
+    if (!enable.read().to_bool())
+    {
+        m_wait_enable = true;
+        next_trigger(enable.posedge_event());
+        return;
+    }
 
-        auto &s = p_in->read();
-        auto search = m_lambda_signals.find(s.getWavelength());
+    auto &s = p_in->read();
+    auto search = m_lambda_signals.find(s.getWavelength());
 
-        if (search != m_lambda_signals.end())
-        {
-            //cout << name() << " received supported signal (lambda = " << s.getWavelength() << "m)" << endl;
-            m_lambda_signals[s.getWavelength()][0]->write(s.power());
-            m_lambda_signals[s.getWavelength()][1]->write(s.modulus());
-            m_lambda_signals[s.getWavelength()][2]->write(s.phase());
-        }
-        else {
-            cout << name() << " received unsupported signal (lambda = " << s.getWavelength() << "m)" << endl;
-        }
+    if (search != m_lambda_signals.end())
+    {
+        //cout << name() << " received supported signal (lambda = " << s.getWavelength() << "m)" << endl;
+        search->second[0]->write(s.power());
+        search->second[1]->write(s.modulus());
+        search->second[2]->write(s.phase());
     }
-}
\ No newline at end of file
+    else {
+        cout << name() << " received unsupported signal (lambda = " << s.getWavelength() << "m)" << endl;
+    }
+}
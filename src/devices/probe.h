@@ -9,6 +9,9 @@
 #include "optical_signal.h"
 #include "specs.h"
 #include "devices/spx_module.h"
+#include "binary_trace.h"
+#include "memory_trace.h"
+#include "trace_rules.h"
 
 /*
 This class defines an ideal optical probe. It will sample the signal at its input and
@@ -23,6 +26,11 @@ public:
     // Processes
     virtual void on_port_in_changed();
 
+    virtual void start_of_simulation();
+
+    // No optical output: nothing to stamp
+    virtual bool stamp_scattering(ScatteringStamp &, uint32_t) { return true; }
+
     // Member variables
 
     // If given a valid trace file as argument
@@ -33,7 +41,22 @@ public:
     sc_signal<double> m_trace_sig_phase;
     sc_signal<double> m_trace_sig_wavelength;
 
+    // If given a binary trace, the raw field is pushed to its channel
+    // instead of being written to the signals above; power, modulus, phase
+    // and wavelength are only computed when the trace is exported
+    BinaryTrace *m_bt = nullptr;
+    BinaryTrace::channel_id m_bt_channel = 0;
+
+    // Same with an in-memory trace (when SPECS is embedded, see specs_api.h)
+    MemoryTrace *m_mt = nullptr;
+    MemoryTrace::channel_id m_mt_channel = 0;
+
+    // Samples within the deadband of the last recorded one are dropped
+    TraceDeadband m_deadband;
+
     sc_signal<sc_logic> enable;
+    // Set while the process is waiting for enable to rise again
+    bool m_wait_enable = false;
     bool m_trace_power;
     bool m_trace_modulus;
     bool m_trace_phase;
@@ -52,8 +75,9 @@ public:
     {
         SC_HAS_PROCESS(Probe);
 
-        SC_THREAD(on_port_in_changed);
+        SC_METHOD(on_port_in_changed);
         sensitive << p_in;
+        dont_initialize();
     }
 
     // Constructor overloading
@@ -77,6 +101,26 @@ public:
             if (m_trace_wavelength) sc_trace(m_Tf, m_trace_sig_wavelength, (string(this->name()) + ".wavelength").c_str());
         }
     }
+
+    void setBinaryTrace(BinaryTrace *bt)
+    {
+        if (m_bt == bt)
+            return;
+        if (!(m_trace_power || m_trace_modulus || m_trace_phase || m_trace_wavelength))
+            return;
+        m_bt = bt;
+        m_bt_channel = m_bt->add_field_channel(name());
+    }
+
+    void setMemoryTrace(MemoryTrace *mt)
+    {
+        if (m_mt == mt)
+            return;
+        if (!(m_trace_power || m_trace_modulus || m_trace_phase || m_trace_wavelength))
+            return;
+        m_mt = mt;
+        m_mt_channel = m_mt->add_field_channel(name());
+    }
 };
 
 class PowerProbe : public Probe {
@@ -97,11 +141,18 @@ public:
     // Processes
     virtual void on_port_in_changed();
 
+    virtual void start_of_simulation();
+
+    // No optical output: nothing to stamp
+    virtual bool stamp_scattering(ScatteringStamp &, uint32_t) { return true; }
+
     // Member variables
 
     // If given a valid trace file as argument
     // Will not save to txt and rather use VCD tracing
     sc_signal<sc_logic> enable;
+    // Set while the process is waiting for enable to rise again
+    bool m_wait_enable = false;
     sc_trace_file *m_Tf;
 
     sc_signal<double> m_trace_sig_power;
@@ -123,8 +174,9 @@ public:
     {
         SC_HAS_PROCESS(MLambdaProbe);
 
-        SC_THREAD(on_port_in_changed);
+        SC_METHOD(on_port_in_changed);
         sensitive << p_in;
+        dont_initialize();
     }
 
     // TODO: overload the constructor for the case of not informing lambdas, need to check all components
@@ -1,8 +1,93 @@
-#include "devices/waveguide.h"
+#include "specs.h"
+#include "devices/ring.h"
+#include "scattering_solver.h"
+#include "utils/sysc_utils.h"
 
-//void Ring::on_port_tuning_changed()
-//{
-//    // Tuning of the ring parameters...
-//    // e.g. wg.neff = ...
-//}
+using namespace std;
 
+void Ring::start_of_simulation()
+{
+    if (specsGlobalConfig.simulation_mode == OpticalOutputPortMode::FREQUENCY_DOMAIN)
+        use_steady_state_model(true);
+}
+
+void Ring::use_steady_state_model(bool enable)
+{
+    const bool leaving = m_steady_state && !enable;
+    m_steady_state = enable;
+    sc_set_processes_enabled(&dc, !enable);
+    sc_set_processes_enabled(&wg, !enable);
+
+    if (leaving)
+    {
+        // Fill the loop with its steady state: the coupler sees the input
+        // on p_in1 and the field back from the waveguide on p_in2
+        //   x = A (k in + r x)  =>  x = k A in / (1 - r A)
+        const auto &r = dc.m_S_through;
+        const auto &k = dc.m_S_cross;
+        for (uint32_t wlid = 0; wlid < m_memory_in.size(); ++wlid)
+        {
+            if (!m_memory_in.contains(wlid))
+                continue;
+            const field_type &in = m_memory_in[wlid];
+            const auto &A = wg.transfer(wlid).S;
+            dc.m_memory_in1[wlid] = in;
+            dc.m_memory_in2[wlid] = k * A * in / (1.0 - r * A);
+        }
+    }
+    m_memory_in = {};
+
+    // Parameters may have changed since the last analysis
+    dc.update_parameters();
+    wg.update_parameters();
+    m_transfer_valid.clear();
+}
+
+vector<spx_module *> Ring::steady_state_replaced_devices() const
+{
+    if (!m_steady_state)
+        return {};
+    return { const_cast<DirectionalCoupler *>(&dc), const_cast<Waveguide *>(&wg) };
+}
+
+const Ring::field_type &Ring::transfer(uint32_t wavelength_id)
+{
+    if (wavelength_id >= m_transfer_valid.size())
+    {
+        const size_t n = max<size_t>(wavelength_id + 1, OpticalSignal::wavelength_registry.size());
+        m_transfer.resize(n);
+        m_transfer_valid.resize(n, 0);
+    }
+    if (m_transfer_valid[wavelength_id])
+        return m_transfer[wavelength_id];
+
+    const auto &r = dc.m_S_through;
+    const auto &k = dc.m_S_cross;
+    const auto &A = wg.transfer(wavelength_id).S;
+    m_transfer[wavelength_id] = r + k * k * A / (1.0 - r * A);
+    m_transfer_valid[wavelength_id] = 1;
+    return m_transfer[wavelength_id];
+}
+
+void Ring::on_port_in_changed()
+{
+    if (!m_steady_state)
+        return;
+
+    const OpticalSignal &s = p_in->read();
+    if (isnan(OpticalSignal::getWavelengthUnchecked(s.m_wavelength_id)))
+        return;
+    m_memory_in[s.m_wavelength_id] = s.m_field;
+
+    // The output net is driven by the port of the coupler
+    const field_type y = transfer(s.m_wavelength_id) * s.m_field;
+    dc.m_out1_writer.delayedWrite(OpticalSignal(y, s.m_wavelength_id), SC_ZERO_TIME);
+}
+
+bool Ring::stamp_scattering(ScatteringStamp &stamp, uint32_t wavelength_id)
+{
+    if (!m_steady_state)
+        return false;
+    stamp.add(p_out, p_in, transfer(wavelength_id));
+    return true;
+}
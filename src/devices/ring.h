@@ -2,98 +2,124 @@
 
 #include <systemc.h>
 
+#include "devices/spx_module.h"
 #include "devices/waveguide.h"
 #include "devices/directional_coupler.h"
 #include "optical_output_port.h"
 #include "optical_signal.h"
+#include "utils/wavelength_field_store.h"
 
-/** A unidirectional waveguide module. */
-class Ring : public sc_module {
+/** An all-pass ring resonator.
+
+Made of a directional coupler and a waveguide closing the loop:
+
+        p_in __,__, __ p_out
+               DC
+             ,'  ',
+            (  WG  )
+             '.__.'
+
+In time-domain simulations light circulates around the loop as events. In
+OP and DC analyses (and in FREQUENCY_DOMAIN mode), where that would take
+many round trips to converge near resonance, the output is computed with
+the closed-form all-pass response instead:
+
+    H = r + k^2 A / (1 - r A)
+
+where r and k are the through and cross coefficients of the coupler and A
+the round-trip transmission of the waveguide. Switching back to the loop
+(before a TRAN analysis) fills it with the steady-state field of the last
+inputs, so that the transient starts from the operating point.
+*/
+class Ring : public spx_module {
 public:
+    typedef OpticalSignal::field_type field_type;
+
     // Ports
     /** The optical input port. */
-    sc_port<sc_signal_in_if<OpticalSignal>> p_in;
+    spx::oa_port_in_type p_in;
     /** The optical output port. */
-    sc_port<sc_signal_out_if<OpticalSignal>> p_out;
-
-    // Timed ports writers
-    /** Timed writer to the output port.
-     *
-     * @sa DelayedWriter
-     * */
-    OpticalOutputPort m_out_writer;
+    spx::oa_port_out_type p_out;
 
-    sc_signal<OpticalSignal> sig_in;
-    sc_signal<OpticalSignal> sig_internal_0;
-    sc_signal<OpticalSignal> sig_internal_1;
-    sc_signal<OpticalSignal> sig_out;
+    // Wires and submodules
+    spx::oa_signal_type sig_internal_0;
+    spx::oa_signal_type sig_internal_1;
     DirectionalCoupler dc;
     Waveguide wg;
 
     // Member variables
-    /** The attenuation inside the waveguide, in dB/cm. */
-    double m_attenuation_dB_cm = 0.2;
-    /** The effective index of the waveguide */
-    double m_neff = 2.2111;
-    /** The group index of the waveguide */
-    double m_ng = 2.2637;
-
-    /** The coupling from waveguide to ring, in dB. */
-    double m_cross_power_dB = 10*std::log10(0.5) - 0.15;
-    double m_through_power_dB = 10*std::log10(0.5) - 0.15;
-    double m_cross_phase_rad = M_PI / 2;
-    double m_through_phase_rad = M_PI / 2;
-
     /** The radius of the ring in um. */
     double m_radius_um = 0;
 
     // Processes
-    /** Main process of the module.
-     *
-     * It copies the input to the output, after attenuation and delay.
+    /** Closed-form response, only active with the steady-state model.
      *
-     *   **SystemC type:** thread
+     *   **SystemC type:** method
      *
      *   **Sensitivity list:** p_in
      * */
     void on_port_in_changed();
 
-    /** Constructor for Waveguide
+    virtual void start_of_simulation();
+    virtual void use_steady_state_model(bool enable);
+    virtual vector<spx_module *> steady_state_replaced_devices() const;
+    virtual bool stamp_scattering(ScatteringStamp &stamp, uint32_t wavelength_id);
+
+    /** Transmission from p_in to p_out in steady state */
+    const field_type &transfer(uint32_t wavelength_id);
+
+    /** Constructor for Ring
      *
      * @param name name of the module
-     * @param length_cm length of the waveguide in cm
+     * @param length_cm length of the ring in cm
+     * @param coupling_through power coupling of the through path
+     * @param dc_loss_dB insertion loss of the coupler
+     * @param attenuation_dB_cm loss of the ring waveguide
+     * @param neff effective index of the ring waveguide
+     * @param ng group index of the ring waveguide
      * */
-    Ring(sc_module_name name, double length_cm = 30e-6)
-        : sc_module(name)
-        , m_out_writer("out_delayed_writer", p_out)
-        , dc((std::string(name) + ".DC1").c_str())
-        , wg((std::string(name) + ".WG1").c_str())
+    Ring(sc_module_name name, double length_cm = 30e-6,
+            double coupling_through = 0.85, double dc_loss_dB = 0,
+            double attenuation_dB_cm = 0.2,
+            double neff = 2.2111, double ng = 2.2637)
+        : spx_module(name)
+        , dc("DC1", coupling_through, dc_loss_dB)
+        , wg("WG1", length_cm, attenuation_dB_cm, neff, ng)
     {
-        dc.p_in1(sig_in);
+        dc.p_in1(p_in);
         dc.p_in2(sig_internal_1);
-        dc.p_out1(sig_out);
+        dc.p_out1(p_out);
         dc.p_out2(sig_internal_0);
 
         wg.p_in(sig_internal_0);
         wg.p_out(sig_internal_1);
 
-        p_in(sig_in);
-        p_out(sig_out);
-
         setLength(length_cm);
-        
-        SC_HAS_PROCESS(Waveguide);
 
-        SC_THREAD(on_port_in_changed);
+        SC_HAS_PROCESS(Ring);
+
+        SC_METHOD(on_port_in_changed);
         sensitive << p_in;
+        dont_initialize();
     }
 
     void setRadius(double radius_um) {
         wg.setLength(2 * M_PI * radius_um * 1e-4);
         m_radius_um = radius_um;
+        m_transfer_valid.clear();
     }
 
     void setLength(double length_cm) {
         setRadius(length_cm * 1e4 / 2 / M_PI);
     }
+
+private:
+    bool m_steady_state = false;
+
+    // Closed-form transmission by wavelength id, filled on first use
+    vector<field_type> m_transfer;
+    vector<uint8_t> m_transfer_valid;
+
+    // Current inputs by wavelength (steady-state model only)
+    WavelengthFieldStore<field_type> m_memory_in;
 };
@@ -1,14 +1,14 @@
 #include "devices/splitter.h"
 #include "specs.h"
+#include "scattering_solver.h"
 
-void Splitter::on_port_in_changed()
+void Splitter::start_of_simulation()
 {
-    const double transmission = pow(10.0, - m_attenuation_dB / 20);
-    const double S12 = transmission * sqrt(m_split_ratio);
-    const double S13 = transmission * sqrt(1 - m_split_ratio);
+    update_parameters();
 
     if (specsGlobalConfig.verbose_component_initialization)
     {
+        const double transmission = pow(10.0, - m_attenuation_dB / 20);
         cout << name() << ":" << endl;
         cout << "transmission = " << pow(transmission, 2) << " W/W" << endl;
         cout << "splitting ratio_power = 0.5" << " W/W" << endl;
@@ -18,24 +18,37 @@ void Splitter::on_port_in_changed()
         cout << endl;
         cout << endl;
     }
+}
+
+void Splitter::update_parameters()
+{
+    const double transmission = pow(10.0, - m_attenuation_dB / 20);
+    m_S12 = transmission * sqrt(m_split_ratio);
+    m_S13 = transmission * sqrt(1 - m_split_ratio);
+}
 
-    while (true) {
-        // Wait for a new input signal
-        wait();
+void Splitter::on_port_in_changed()
+{
+    // Read input signal
+    const auto &s = p_in->read();
 
-        // Read input signal
-        const auto &s = p_in->read();
+    // Apply device's transmission
+    auto s1 = m_S12 * s;
+    auto s2 = m_S13 * s;
 
-        // Apply device's transmission
-        auto s1 = S12 * s;
-        auto s2 = S13 * s;
+    // Get new IDs
+    s1.getNewId();
+    s2.getNewId();
 
-        // Get new IDs
-        s1.getNewId();
-        s2.getNewId();
+    // Write to output ports after delay
+    m_out1_writer.delayedWrite(s1, SC_ZERO_TIME);
+    m_out2_writer.delayedWrite(s2, SC_ZERO_TIME);
+}
 
-        // Write to output ports after delay
-        m_out1_writer.delayedWrite(s1, SC_ZERO_TIME);
-        m_out2_writer.delayedWrite(s2, SC_ZERO_TIME);
-    }
+bool Splitter::stamp_scattering(ScatteringStamp &stamp, uint32_t wavelength_id)
+{
+    (void)wavelength_id;
+    stamp.add(p_out1, p_in, m_S12);
+    stamp.add(p_out2, p_in, m_S13);
+    return true;
 }
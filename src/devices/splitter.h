@@ -54,17 +54,30 @@ public:
      * difference. */
     double m_attenuation_dB;
 
+private:
+    /** Pre-calculated field transmissions to each branch.
+     *
+     * Computed in update_parameters() from the split ratio and attenuation.
+     * */
+    double m_S12;
+    double m_S13;
+
+public:
     // Processes
     /** Main process of the module.
      *
      * It copies the input to both output, after attenuation and delay.
      *
-     *   **SystemC type:** thread
+     *   **SystemC type:** method
      *
      *   **Sensitivity list:** p_in
      * */
     void on_port_in_changed();
 
+    virtual void start_of_simulation();
+    virtual void update_parameters();
+    virtual bool stamp_scattering(ScatteringStamp &stamp, uint32_t wavelength_id);
+
     // Constructor
     /** Constructor for Splitter
      *
@@ -81,7 +94,8 @@ public:
     {
         SC_HAS_PROCESS(Splitter);
 
-        SC_THREAD(on_port_in_changed);
+        SC_METHOD(on_port_in_changed);
         sensitive << p_in;
+        dont_initialize();
     }
 };
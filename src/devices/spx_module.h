@@ -4,11 +4,16 @@
 #include "specs.h"
 
 #include <systemc.h>
+#include <cstdint>
 #include <string>
+#include <vector>
 
 using std::string;
+using std::vector;
 using namespace std::string_literals;
 
+class ScatteringStamp;
+
 class spx_module : public sc_module {
 public:
     typedef spx_module this_type;
@@ -30,6 +35,57 @@ public:
     virtual void init() {}
     virtual string describe() const { return ""s; }
 
+    /** Add the steady-state scattering parameters of the device at the
+     * given wavelength to stamp (see ScatteringSolver).
+     *
+     * Returns false if the device can't be described this way, in which
+     * case its outputs are resolved by event propagation.
+     */
+    virtual bool stamp_scattering(ScatteringStamp &stamp, uint32_t wavelength_id)
+    {
+        (void)stamp;
+        (void)wavelength_id;
+        return false;
+    }
+
+    /** Pre-calculate the parameters of the model (e.g. the scattering
+     * parameters) from those of the device.
+     *
+     * Done in start_of_simulation(). Elaboration passes which stamp the
+     * device before (see NetlistCompression) call it first.
+     */
+    virtual void update_parameters() {}
+
+    /** Switch to (or back from) an analytical steady-state model.
+     *
+     * Called with true by the OP and DC analyses, and with false before a
+     * TRAN analysis. Composite devices which can only reach their steady
+     * state by circulating events (e.g. Ring, CROW) then compute their
+     * outputs in closed form instead. When switching back, they leave
+     * their internal devices in the steady state of the last inputs.
+     */
+    virtual void use_steady_state_model(bool enable) { (void)enable; }
+
+    /** Devices currently replaced by the steady-state model of this module.
+     *
+     * The module is then stamped by the steady-state solver in their place.
+     */
+    virtual vector<spx_module *> steady_state_replaced_devices() const { return {}; }
+
+    /** True if the module is made of other devices (e.g. MZI, Clements).
+     *
+     * Its ports are then only bound through to the ports of these devices.
+     * Modules which create their devices in init() (outside of their own
+     * construction, so they aren't children of the module) override this.
+     */
+    virtual bool is_composite() const
+    {
+        for (auto obj : get_child_objects())
+            if (dynamic_cast<spx_module *>(obj))
+                return true;
+        return false;
+    }
+
     spx_module(sc_module_name name)
     : sc_module(name)
     {}
@@ -0,0 +1,395 @@
+#include "specs.h"
+#include "devices/touchstone_device.h"
+
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <cmath>
+#include <map>
+#include <memory>
+#include <mutex>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std;
+
+namespace {
+
+/** Read-only memory mapping of a whole file */
+struct MappedFile {
+    const char *data = nullptr;
+    size_t size = 0;
+
+    explicit MappedFile(const string &filename)
+    {
+        int fd = open(filename.c_str(), O_RDONLY);
+        if (fd < 0)
+        {
+            cerr << "Error: could not open Touchstone file: " << filename << endl;
+            exit(1);
+        }
+        struct stat st;
+        if (fstat(fd, &st) < 0)
+        {
+            cerr << "Error: could not read Touchstone file: " << filename << endl;
+            exit(1);
+        }
+        size = st.st_size;
+        if (size > 0)
+        {
+            void *p = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (p == MAP_FAILED)
+            {
+                cerr << "Error: could not map Touchstone file: " << filename << endl;
+                exit(1);
+            }
+            madvise(p, size, MADV_SEQUENTIAL);
+            data = static_cast<const char *>(p);
+        }
+        close(fd);
+    }
+
+    ~MappedFile()
+    {
+        if (data)
+            munmap(const_cast<char *>(data), size);
+    }
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+};
+
+// Number of ports from the file extension (.sNp)
+size_t nports_from_extension(const string &filename)
+{
+    const size_t dot = filename.find_last_of('.');
+    if (dot == string::npos || filename.size() - dot < 4)
+        return 0;
+    string ext = filename.substr(dot + 1);
+    for (auto &c : ext)
+        c = tolower(c);
+    if (ext.front() != 's' || ext.back() != 'p')
+        return 0;
+    size_t n = 0;
+    for (size_t k = 1; k + 1 < ext.size(); ++k)
+    {
+        if (!isdigit(ext[k]))
+            return 0;
+        n = 10 * n + (ext[k] - '0');
+    }
+    return n;
+}
+
+} // namespace
+
+shared_ptr<const TouchstoneData> TouchstoneData::load(const string &filename)
+{
+    // Files already loaded, by path (data is freed with the last device)
+    static map<string, weak_ptr<const TouchstoneData>> cache;
+    static mutex cache_mutex;
+
+    char *resolved = realpath(filename.c_str(), nullptr);
+    const string key = resolved ? string(resolved) : filename;
+    free(resolved);
+
+    lock_guard<mutex> lock(cache_mutex);
+    if (auto data = cache[key].lock())
+        return data;
+
+    auto data = make_shared<TouchstoneData>();
+    data->filename = filename;
+    data->nports = nports_from_extension(filename);
+    if (data->nports == 0)
+    {
+        cerr << "Error: cannot deduce the number of ports of Touchstone file "
+             << filename << " (expected extension .sNp)" << endl;
+        exit(1);
+    }
+
+    {
+        MappedFile file(key);
+        data->parse(file.data, file.data + file.size);
+    }
+
+    cache[key] = data;
+    return data;
+}
+
+void TouchstoneData::parse(const char *begin, const char *end)
+{
+    const size_t N = nports;
+    const size_t record_size = 1 + 2 * N * N;
+
+    // Options (defaults from the specification)
+    double freq_unit = 1e9;
+    enum { FORMAT_MA, FORMAT_DB, FORMAT_RI } format = FORMAT_MA;
+
+    vector<complex<double>> S; // [f][i * N + j]
+    vector<double> record(record_size);
+    size_t n_in_record = 0;
+    size_t line = 1;
+
+    auto fail = [&](const string &msg) {
+        cerr << "Error: " << filename << ":" << line << ": " << msg << endl;
+        exit(1);
+    };
+
+    const char *p = begin;
+    while (p < end)
+    {
+        const char c = *p;
+        if (c == '\n')
+        {
+            ++line;
+            ++p;
+        }
+        else if (c == ' ' || c == '\t' || c == '\r' || c == ',')
+            ++p;
+        else if (c == '!')
+        {
+            // Comment until end of line
+            while (p < end && *p != '\n')
+                ++p;
+        }
+        else if (c == '#')
+        {
+            // Option line: # <freq unit> <parameter> <format> R <z0>
+            ++p;
+            const char *eol = find(p, end, '\n');
+            string tok;
+            bool expect_z0 = false;
+            for (const char *q = p; q <= eol; ++q)
+            {
+                if (q < eol && !isspace(*q))
+                {
+                    tok += toupper(*q);
+                    continue;
+                }
+                if (tok.empty())
+                    continue;
+                if (expect_z0)
+                {
+                    z0 = atof(tok.c_str());
+                    expect_z0 = false;
+                }
+                else if (tok == "HZ")
+                    freq_unit = 1;
+                else if (tok == "KHZ")
+                    freq_unit = 1e3;
+                else if (tok == "MHZ")
+                    freq_unit = 1e6;
+                else if (tok == "GHZ")
+                    freq_unit = 1e9;
+                else if (tok == "THZ")
+                    freq_unit = 1e12;
+                else if (tok == "MA")
+                    format = FORMAT_MA;
+                else if (tok == "DB")
+                    format = FORMAT_DB;
+                else if (tok == "RI")
+                    format = FORMAT_RI;
+                else if (tok == "R")
+                    expect_z0 = true;
+                else if (tok != "S")
+                    fail("unsupported option '" + tok + "' (only S-parameters are supported)");
+                tok.clear();
+            }
+            p = eol;
+        }
+        else if (c == '[')
+            fail("Touchstone 2.0 keywords are not supported");
+        else
+        {
+            double x;
+            auto res = from_chars(p, end, x);
+            if (res.ec != errc())
+                fail("invalid number");
+            p = res.ptr;
+
+            // Noise parameters of 2-ports follow the S-parameters, starting
+            // with a frequency which isn't greater than the last one
+            if (n_in_record == 0 && !freq.empty() && x * freq_unit <= freq.back())
+            {
+                if (N == 2)
+                    break;
+                fail("frequencies must be increasing");
+            }
+
+            record[n_in_record++] = x;
+            if (n_in_record < record_size)
+                continue;
+
+            // Complete record: frequency followed by N*N pairs
+            n_in_record = 0;
+            freq.push_back(record[0] * freq_unit);
+            const size_t offset = S.size();
+            S.resize(offset + N * N);
+            for (size_t k = 0; k < N * N; ++k)
+            {
+                const double a = record[1 + 2 * k];
+                const double b = record[2 + 2 * k];
+                complex<double> s;
+                if (format == FORMAT_RI)
+                    s = complex<double>(a, b);
+                else if (format == FORMAT_MA)
+                    s = polar(a, b * M_PI / 180);
+                else
+                    s = polar(pow(10.0, a / 20), b * M_PI / 180);
+
+                // S_ab is the response at port a to an excitation on port b.
+                // 2-ports list S11 S21 S12 S22, others are row by row.
+                const size_t a_port = (N == 2) ? k % N : k / N;
+                const size_t b_port = (N == 2) ? k / N : k % N;
+                S[offset + b_port * N + a_port] = conj(s);
+            }
+        }
+    }
+
+    if (n_in_record != 0)
+        fail("incomplete data for the last frequency");
+    if (freq.empty())
+        fail("no data found");
+
+    finalize(S);
+}
+
+void TouchstoneData::finalize(const vector<complex<double>> &S)
+{
+    const size_t N = nports;
+    const size_t nf = freq.size();
+
+    mag.resize(N * N * nf);
+    phase.resize(N * N * nf);
+    tau.resize(N * N * nf);
+
+    for (size_t k = 0; k < N * N; ++k)
+    {
+        double *m = &mag[k * nf];
+        double *ph = &phase[k * nf];
+        double *t = &tau[k * nf];
+
+        // Magnitude and unwrapped phase
+        for (size_t f = 0; f < nf; ++f)
+        {
+            const auto &s = S[f * N * N + k];
+            m[f] = abs(s);
+            ph[f] = arg(s);
+            if (f > 0)
+                ph[f] -= 2 * M_PI * round((ph[f] - ph[f - 1]) / (2 * M_PI));
+        }
+
+        // Group delay dphi/domega (central differences inside the range)
+        for (size_t f = 0; f < nf; ++f)
+        {
+            if (nf < 2)
+            {
+                t[f] = 0;
+                continue;
+            }
+            const size_t f0 = (f == 0) ? 0 : f - 1;
+            const size_t f1 = (f == nf - 1) ? f : f + 1;
+            t[f] = (ph[f1] - ph[f0]) / (2 * M_PI * (freq[f1] - freq[f0]));
+        }
+    }
+}
+
+bool TouchstoneData::isActive(const size_t &i, const size_t &j) const
+{
+    const size_t nf = freq.size();
+    const double *m = &mag[(i * nports + j) * nf];
+    return any_of(m, m + nf, [](double x) { return x > 0; });
+}
+
+void TouchstoneData::interpolateRow(const size_t &i, const double &f,
+    vector<complex<double>> &S, vector<sc_time> &delay) const
+{
+    const size_t nf = freq.size();
+
+    // Interval and weight, shared by all the outputs
+    size_t f0 = 0;
+    double w = 0;
+    if (nf > 1 && f > freq.front())
+    {
+        if (f >= freq.back())
+            f0 = nf - 1;
+        else
+        {
+            f0 = upper_bound(freq.begin(), freq.end(), f) - freq.begin() - 1;
+            w = (f - freq[f0]) / (freq[f0 + 1] - freq[f0]);
+        }
+    }
+    const size_t f1 = (w > 0) ? f0 + 1 : f0;
+
+    for (size_t j = 0; j < nports; ++j)
+    {
+        const size_t k = (i * nports + j) * nf;
+        const double m = (1 - w) * mag[k + f0] + w * mag[k + f1];
+        const double ph = (1 - w) * phase[k + f0] + w * phase[k + f1];
+        const double t = (1 - w) * tau[k + f0] + w * tau[k + f1];
+        S[j] = polar(m, ph);
+        // Measured data can give slightly negative delays
+        delay[j] = sc_time(max(t, 0.0), SC_SEC);
+    }
+}
+
+void TouchstoneDevice::prepareTM()
+{
+    const double c = 299792458.0;
+    const auto &data = *m_data;
+    const size_t nf = data.freq.size();
+
+    TM.clear();
+    TM.resize(nports);
+
+    // Values at the center of the frequency range (only used to describe
+    // the device; rows are interpolated from the data)
+    const size_t fc = nf / 2;
+    TM.lambda0 = c / data.freq[fc];
+    for (size_t i = 0; i < nports; ++i)
+    {
+        for (size_t j = 0; j < nports; ++j)
+        {
+            const size_t k = i * nports + j;
+            TM.Mactive[k] = data.isActive(i, j);
+            TM.Malpha[k] = {data.mag[k * nf + fc]};
+            TM.Mphi[k] = {data.phase[k * nf + fc]};
+            TM.Mtau[k] = {data.tau[k * nf + fc]};
+        }
+    }
+
+    TM.row_function = [this, c](const size_t &i, const double &lambda, TransmissionMatrix::row_type &row)
+    {
+        const double f = c / lambda;
+        if (!m_data->inRange(f) && !m_out_of_range_warned)
+        {
+            cerr << "Warning: " << name() << ": wavelength " << lambda
+                 << " m is outside the range of " << m_data->filename
+                 << " (using the closest frequency)" << endl;
+            m_out_of_range_warned = true;
+        }
+        m_data->interpolateRow(i, f, row.S, row.delay);
+    };
+}
+
+void TouchstoneDevice::init()
+{
+    GenericTransmissionDevice::init();
+
+    // Interpolate all the rows now rather than on the first events
+    TM.tabulate();
+
+    if (specsGlobalConfig.verbose_component_initialization)
+        cout << describe() << endl;
+}
+
+string TouchstoneDevice::describe() const
+{
+    stringstream ss;
+    ss << name() << ": " << nports << "-port from " << m_data->filename;
+    ss << " (" << m_data->freq.size() << " points, ";
+    ss << m_data->freq.front() << " Hz to " << m_data->freq.back() << " Hz)";
+    return ss.str();
+}
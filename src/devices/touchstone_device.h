@@ -0,0 +1,86 @@
+#pragma once
+
+#include "devices/generic_transmission_device.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+using std::shared_ptr;
+using std::string;
+using std::vector;
+
+/** S-parameters read from a Touchstone (.sNp) file.
+ *
+ * The file is memory-mapped and parsed in place. Data is shared between
+ * all the devices using the same file (see load()), and is kept as
+ * magnitude, unwrapped phase and group delay for each (input, output)
+ * pair so that it can be interpolated at any frequency.
+ *
+ * Phases are converted to the convention used in the rest of the
+ * simulator (a delay gives a positive phase), i.e. the S-parameters are
+ * conjugated with respect to the file.
+ */
+class TouchstoneData {
+public:
+    string filename;
+    size_t nports = 0;
+    double z0 = 50; // reference impedance (informative only)
+
+    vector<double> freq; // frequency points in Hz, increasing
+
+    // Data for input i and output j at frequency point f is stored at
+    // index (i * nports + j) * freq.size() + f
+    vector<double> mag;
+    vector<double> phase; // rad, unwrapped along frequency
+    vector<double> tau; // group delay in s
+
+    /** Load a file, or return the data already loaded from it */
+    static shared_ptr<const TouchstoneData> load(const string &filename);
+
+    /** Whether input i reaches output j at any frequency */
+    bool isActive(const size_t &i, const size_t &j) const;
+
+    /** Whether frequency f (in Hz) lies within the range of the file */
+    inline bool inRange(const double &f) const
+    { return !freq.empty() && f >= freq.front() && f <= freq.back(); }
+
+    /** Linear interpolation of the row of input i at frequency f (in Hz).
+     *
+     * S and delay must have nports elements. Out of range frequencies are
+     * clamped to the first or last point.
+     */
+    void interpolateRow(const size_t &i, const double &f,
+        vector<complex<double>> &S, vector<sc_time> &delay) const;
+
+private:
+    void parse(const char *begin, const char *end);
+    void finalize(const vector<complex<double>> &S);
+};
+
+/** N-port device described by a Touchstone file.
+ *
+ * Transmission and group delays are tabulated on the wavelengths of the
+ * circuit during init(), so that events only need a lookup.
+ */
+class TouchstoneDevice : public GenericTransmissionDevice {
+public:
+    shared_ptr<const TouchstoneData> m_data;
+
+    TouchstoneDevice(sc_module_name name, const string &filename)
+    : TouchstoneDevice(name, TouchstoneData::load(filename))
+    {}
+
+    TouchstoneDevice(sc_module_name name, shared_ptr<const TouchstoneData> data)
+    : GenericTransmissionDevice(name, data->nports)
+    , m_data(data)
+    {}
+
+    virtual void init();
+    virtual string describe() const;
+
+private:
+    bool m_out_of_range_warned = false;
+
+    virtual void prepareTM();
+};
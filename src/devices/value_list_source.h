@@ -42,6 +42,7 @@ public:
         enable = sc_logic(0);
 
         SC_HAS_PROCESS(VLSource);
+        flags = static_cast<ModuleFlags>(TIME_VARIANT | FREQUENCY_DEPENDENT);
         SC_THREAD(runner);
     }
 
@@ -1,9 +1,32 @@
 #include "specs.h"
 #include "devices/waveguide.h"
+#include "scattering_solver.h"
 
 using namespace std;
 
-void WaveguideUni::on_port_in_changed()
+void WaveguideBase::start_of_simulation()
+{
+    const double c = 299792458.0;
+
+    update_parameters();
+
+    if (specsGlobalConfig.verbose_component_initialization)
+    {
+        cout << name() << ":" << endl;
+        cout << "length = " << m_length_cm/100 << " m" << endl;
+        cout << "neff = " << m_neff << "" << endl;
+        cout << "ng = " << m_ng << "" << endl;
+        cout << "transmission_power = " << pow(m_transmission, 2) << " W/W" << endl;
+        cout << "group delay = " << m_group_delay_ns << " ns" << endl;
+        // cout << "dneff/dlambda = " << m_dneff_dlambda*1e-6 << " um^-1" << endl;
+        cout << "phase delay = " << 1e9 * m_length_cm * 1e-2 / (c / m_neff) << " ns";
+        cout << " ("
+                << fmod((2 * M_PI * m_neff / 1.55e-6) * m_length_cm * 1e-2, 2 * M_PI)
+                << "rad @1.55)" << endl;
+    }
+}
+
+void WaveguideBase::update_parameters()
 {
     const double c = 299792458.0;
 
@@ -11,134 +34,136 @@ void WaveguideUni::on_port_in_changed()
     m_attenuation_dB = m_attenuation_dB_cm * m_length_cm;
 
     // transmission in field: 10^(-dB/20)
-    const double transmission = pow(10.0, - m_attenuation_dB / 20.0);
+    m_transmission = pow(10.0, - m_attenuation_dB / 20.0);
 
     // vg = c/ng
     // => delay = L / vg = (L * ng) / c
-    const double group_delay_ns = 1e9 * m_length_cm * 1e-2 / (c / m_ng);
+    m_group_delay_ns = 1e9 * m_length_cm * 1e-2 / (c / m_ng);
 
     // precalculate 2 * pi * L
-    double phase_delay_factor = 2.0 * M_PI * m_length_cm * 1e-2;
+    m_phase_delay_factor = 2.0 * M_PI * m_length_cm * 1e-2;
 
     // ng = neff - lambda * dneff/dlambda
     // => dneff/dlambda = (neff - ng)/lambda
-    double dneff_dlambda = (m_neff - m_ng) / 1.55e-6;
+    m_dneff_dlambda = (m_neff - m_ng) / 1.55e-6;
 
     // Parameters relative to dispersion
-    double d2neff_dlambda2_over_2 = -1 * c * m_D / (2 * 1.55e-6);
-    double dng_dlambda = c*m_D;
+    m_d2neff_dlambda2_over_2 = -1 * c * m_D / (2 * 1.55e-6);
+    m_dng_dlambda = c*m_D;
 
-    if (specsGlobalConfig.verbose_component_initialization)
+    m_transfer_cache.clear();
+    m_transfer_cached.clear();
+}
+
+const WaveguideBase::Transfer &WaveguideBase::compute_transfer(uint32_t wavelength_id)
+{
+    const double c = 299792458.0;
+    const double wl = OpticalSignal::getWavelengthUnchecked(wavelength_id);
+
+    if (wavelength_id >= m_transfer_cached.size())
     {
-        cout << name() << ":" << endl;
-        cout << "length = " << m_length_cm/100 << " m" << endl;
-        cout << "neff = " << m_neff << "" << endl;
-        cout << "ng = " << m_ng << "" << endl;
-        cout << "transmission_power = " << pow(transmission, 2) << " W/W" << endl;
-        cout << "group delay = " << group_delay_ns << " ns" << endl;
-        // cout << "dneff/dlambda = " << dneff_dlambda*1e-6 << " um^-1" << endl;
-        cout << "phase delay = " << 1e9 * m_length_cm * 1e-2 / (c / m_neff) << " ns";
-        cout << " ("
-                << fmod((2 * M_PI * m_neff / 1.55e-6) * m_length_cm * 1e-2, 2 * M_PI)
-                << "rad @1.55)" << endl;
-        cout << (dynamic_cast<spx::oa_signal_type *>(p_in.get_interface()))->name();
-        cout << " --> ";
-        cout << (dynamic_cast<spx::oa_signal_type *>(p_out.get_interface()))->name();
-        cout << endl;
-        cout << endl;
+        const size_t n = max<size_t>(wavelength_id + 1, OpticalSignal::wavelength_registry.size());
+        m_transfer_cache.resize(n);
+        m_transfer_cached.resize(n, 0);
     }
+    auto &T = m_transfer_cache[wavelength_id];
 
     if(m_D == 0)
     {
-        while (true) {
-            // Wait for a new input signal
-            wait();
-            // Read the input signal
-            auto s = p_in->read();
-
-            // calculate phase-delay
-            const double neff = m_neff + dneff_dlambda * (s.getWavelength() - 1.55e-6);
-
-            const double phase_delay = phase_delay_factor * neff / s.getWavelength();
+        // calculate phase-delay
+        const double neff = m_neff + m_dneff_dlambda * (wl - 1.55e-6);
 
-            // Apply transmission function
-            const OpticalSignal::field_type S12 = polar(transmission, phase_delay);
-            s *= S12;
+        const double phase_delay = m_phase_delay_factor * neff / wl;
 
-            // Get new ID for output event
-            s.getNewId();
-
-            // Write to ouput port after group delay
-            m_out_writer.delayedWrite(s, sc_time(group_delay_ns, SC_NS));
-        }
+        // Transmission function
+        T.S = polar(m_transmission, phase_delay);
+        T.delay = sc_time(m_group_delay_ns, SC_NS);
     }
     else // dispersion has a defined value
     {
-        while (true) {
-            // Wait for a new input signal
-            wait();
-            // Read the input signal
-            auto s = p_in->read();
-
-            // calculate phase-delay
-            const double neff = m_neff + dneff_dlambda * (s.getWavelength() - 1.55e-6)
-                                 + d2neff_dlambda2_over_2 * pow(s.getWavelength() - 1.55e-6, 2);
-            const double ng = m_ng + dng_dlambda * (s.getWavelength() - 1.55e-6);
-
-            const double phase_delay_disp = phase_delay_factor * neff / s.getWavelength();
-            const double group_delay_ns_disp = 1e9 * m_length_cm * 1e-2 / (c / ng);
-            // Apply transmission function
-            const OpticalSignal::field_type S12 = polar(transmission, phase_delay_disp);
-            s *= S12;
-
-            // Get new ID for output event
-            s.getNewId();
-
-            // Write to ouput port after group delay
-            m_out_writer.delayedWrite(s, sc_time(group_delay_ns_disp, SC_NS));
-        }
+        // calculate phase-delay
+        const double neff = m_neff + m_dneff_dlambda * (wl - 1.55e-6)
+                             + m_d2neff_dlambda2_over_2 * pow(wl - 1.55e-6, 2);
+        const double ng = m_ng + m_dng_dlambda * (wl - 1.55e-6);
+
+        const double phase_delay_disp = m_phase_delay_factor * neff / wl;
+        const double group_delay_ns_disp = 1e9 * m_length_cm * 1e-2 / (c / ng);
+
+        // Transmission function
+        T.S = polar(m_transmission, phase_delay_disp);
+        T.delay = sc_time(group_delay_ns_disp, SC_NS);
     }
-}
 
+    m_transfer_cached[wavelength_id] = 1;
+    return T;
+}
 
-void WaveguideBi::on_p0_in_changed()
+double WaveguideBase::group_delay_ns(double wavelength) const
 {
     const double c = 299792458.0;
 
-    // attenuation in dB
-    m_attenuation_dB = m_attenuation_dB_cm * m_length_cm;
+    double ng = m_ng;
+    if (m_D != 0)
+        ng += c * m_D * (wavelength - 1.55e-6);
+    return 1e9 * m_length_cm * 1e-2 / (c / ng);
+}
 
-    // transmission in field: 10^(-dB/20)
-    const double transmission = pow(10.0, - m_attenuation_dB / 20.0);
+sc_time WaveguideBase::min_group_delay() const
+{
+    sc_time delay = sc_time(group_delay_ns(1.55e-6), SC_NS);
+    if (m_D == 0)
+        return delay;
 
-    // vg = c/ng
-    // => delay = L / vg = (L * ng) / c
-    const double group_delay_ns = 1e9 * m_length_cm * 1e-2 / (c / m_ng);
+    bool found = false;
+    const auto &registry = OpticalSignal::wavelength_registry;
+    for (size_t i = 0; i < registry.size(); ++i)
+    {
+        const double wl = registry[i];
+        if (isnan(wl))
+            continue;
+        const sc_time wl_delay = sc_time(group_delay_ns(wl), SC_NS);
+        delay = found ? min(delay, wl_delay) : wl_delay;
+        found = true;
+    }
+    return delay;
+}
 
-    // precalculate 2 * pi * L
-    double phase_delay_factor = 2.0 * M_PI * m_length_cm * 1e-2;
+void WaveguideUni::start_of_simulation()
+{
+    WaveguideBase::start_of_simulation();
 
-    // ng = neff - lambda * dneff/dlambda
-    // => dneff/dlambda = (neff - ng)/lambda
-    double dneff_dlambda = (m_neff - m_ng) / 1.55e-6;
+    if (specsGlobalConfig.verbose_component_initialization)
+    {
+        cout << (dynamic_cast<spx::oa_signal_type *>(p_in.get_interface()))->name();
+        cout << " --> ";
+        cout << (dynamic_cast<spx::oa_signal_type *>(p_out.get_interface()))->name();
+        cout << endl;
+        cout << endl;
+    }
+}
 
-    // Parameters relative to dispersion
-    double d2neff_dlambda2_over_2 = -1 * c * m_D / (2 * 1.55e-6);
-    double dng_dlambda = c*m_D;
+void WaveguideUni::on_port_in_changed()
+{
+    // Read the input signal
+    auto s = p_in->read();
+
+    // Apply transmission function
+    const auto &T = transfer(s.m_wavelength_id);
+    s *= T.S;
+
+    // Get new ID for output event
+    s.getNewId();
+
+    // Write to ouput port after group delay
+    m_out_writer.delayedWrite(s, T.delay);
+}
+
+void WaveguideBi::start_of_simulation()
+{
+    WaveguideBase::start_of_simulation();
 
     if (specsGlobalConfig.verbose_component_initialization)
     {
-        cout << name() << ":" << endl;
-        cout << "length = " << m_length_cm/100 << " m" << endl;
-        cout << "neff = " << m_neff << "" << endl;
-        cout << "ng = " << m_ng << "" << endl;
-        cout << "transmission_power = " << pow(transmission, 2) << " W/W" << endl;
-        cout << "group delay = " << group_delay_ns << " ns" << endl;
-        // cout << "dneff/dlambda = " << dneff_dlambda*1e-6 << " um^-1" << endl;
-        cout << "phase delay = " << 1e9 * m_length_cm * 1e-2 / (c / m_neff) << " ns";
-        cout << " ("
-                << fmod((2 * M_PI * m_neff / 1.55e-6) * m_length_cm * 1e-2, 2 * M_PI)
-                << "rad @1.55)" << endl;
         cout << (dynamic_cast<spx::oa_signal_type *>(p0_in.get_interface()))->name();
         cout << " --> ";
         cout << (dynamic_cast<spx::oa_signal_type *>(p1_out.get_interface()))->name();
@@ -149,132 +174,51 @@ void WaveguideBi::on_p0_in_changed()
         cout << endl;
         cout << endl;
     }
+}
 
-    if(m_D == 0)
-    {
-        while (true) {
-            // Wait for a new input signal
-            wait();
-            // Read the input signal
-            auto s = p0_in->read();
-
-            // calculate phase-delay
-            const double neff = m_neff + dneff_dlambda * (s.getWavelength() - 1.55e-6);
-
-            const double phase_delay = phase_delay_factor * neff / s.getWavelength();
+void WaveguideBi::on_p0_in_changed()
+{
+    // Read the input signal
+    auto s = p0_in->read();
 
-            // Apply transmission function
-            const OpticalSignal::field_type S12 = polar(transmission, phase_delay);
-            s *= S12;
+    // Apply transmission function
+    const auto &T = transfer(s.m_wavelength_id);
+    s *= T.S;
 
-            // Get new ID for output event
-            s.getNewId();
+    // Get new ID for output event
+    s.getNewId();
 
-            // Write to ouput port after group delay
-            m_p1_out_writer.delayedWrite(s, sc_time(group_delay_ns, SC_NS));
-        }
-    }
-    else // dispersion has a defined value
-    {
-        while (true) {
-            // Wait for a new input signal
-            wait();
-            // Read the input signal
-            auto s = p0_in->read();
-
-            // calculate phase-delay
-            const double neff = m_neff + dneff_dlambda * (s.getWavelength() - 1.55e-6)
-                                 + d2neff_dlambda2_over_2 * pow(s.getWavelength() - 1.55e-6, 2);
-            const double ng = m_ng + dng_dlambda * (s.getWavelength() - 1.55e-6);
-
-            const double phase_delay_disp = phase_delay_factor * neff / s.getWavelength();
-            const double group_delay_ns_disp = 1e9 * m_length_cm * 1e-2 / (c / ng);
-            // Apply transmission function
-            const OpticalSignal::field_type S12 = polar(transmission, phase_delay_disp);
-            s *= S12;
-
-            // Get new ID for output event
-            s.getNewId();
-
-            // Write to ouput port after group delay
-            m_p1_out_writer.delayedWrite(s, sc_time(group_delay_ns_disp, SC_NS));
-        }
-    }
+    // Write to ouput port after group delay
+    m_p1_out_writer.delayedWrite(s, T.delay);
 }
 
 void WaveguideBi::on_p1_in_changed()
 {
-    const double c = 299792458.0;
-
-    // attenuation in dB
-    m_attenuation_dB = m_attenuation_dB_cm * m_length_cm;
-
-    // transmission in field: 10^(-dB/20)
-    const double transmission = pow(10.0, - m_attenuation_dB / 20.0);
-
-    // vg = c/ng
-    // => delay = L / vg = (L * ng) / c
-    const double group_delay_ns = 1e9 * m_length_cm * 1e-2 / (c / m_ng);
+    // Read the input signal
+    auto s = p1_in->read();
 
-    // precalculate 2 * pi * L
-    double phase_delay_factor = 2.0 * M_PI * m_length_cm * 1e-2;
+    // Apply transmission function
+    const auto &T = transfer(s.m_wavelength_id);
+    s *= T.S;
 
-    // ng = neff - lambda * dneff/dlambda
-    // => dneff/dlambda = (neff - ng)/lambda
-    double dneff_dlambda = (m_neff - m_ng) / 1.55e-6;
+    // Get new ID for output event
+    s.getNewId();
 
-    // Parameters relative to dispersion
-    double d2neff_dlambda2_over_2 = -1 * c * m_D / (2 * 1.55e-6);
-    double dng_dlambda = c*m_D;
-
-    if(m_D == 0)
-    {
-        while (true) {
-            // Wait for a new input signal
-            wait();
-            // Read the input signal
-            auto s = p1_in->read();
-
-            // calculate phase-delay
-            const double neff = m_neff + dneff_dlambda * (s.getWavelength() - 1.55e-6);
-
-            const double phase_delay = phase_delay_factor * neff / s.getWavelength();
-
-            // Apply transmission function
-            const OpticalSignal::field_type S12 = polar(transmission, phase_delay);
-            s *= S12;
+    // Write to ouput port after group delay
+    m_p0_out_writer.delayedWrite(s, T.delay);
+}
 
-            // Get new ID for output event
-            s.getNewId();
+bool WaveguideUni::stamp_scattering(ScatteringStamp &stamp, uint32_t wavelength_id)
+{
+    const auto &T = transfer(wavelength_id);
+    stamp.add(p_out, p_in, T.S, T.delay);
+    return true;
+}
 
-            // Write to ouput port after group delay
-            m_p0_out_writer.delayedWrite(s, sc_time(group_delay_ns, SC_NS));
-        }
-    }
-    else // dispersion has a defined value
-    {
-        while (true) {
-            // Wait for a new input signal
-            wait();
-            // Read the input signal
-            auto s = p1_in->read();
-
-            // calculate phase-delay
-            const double neff = m_neff + dneff_dlambda * (s.getWavelength() - 1.55e-6)
-                                 + d2neff_dlambda2_over_2 * pow(s.getWavelength() - 1.55e-6, 2);
-            const double ng = m_ng + dng_dlambda * (s.getWavelength() - 1.55e-6);
-
-            const double phase_delay_disp = phase_delay_factor * neff / s.getWavelength();
-            const double group_delay_ns_disp = 1e9 * m_length_cm * 1e-2 / (c / ng);
-            // Apply transmission function
-            const OpticalSignal::field_type S12 = polar(transmission, phase_delay_disp);
-            s *= S12;
-
-            // Get new ID for output event
-            s.getNewId();
-
-            // Write to ouput port after group delay
-            m_p0_out_writer.delayedWrite(s, sc_time(group_delay_ns_disp, SC_NS));
-        }
-    }
-}
\ No newline at end of file
+bool WaveguideBi::stamp_scattering(ScatteringStamp &stamp, uint32_t wavelength_id)
+{
+    const auto &T = transfer(wavelength_id);
+    stamp.add(p1_out, p0_in, T.S, T.delay);
+    stamp.add(p0_out, p1_in, T.S, T.delay);
+    return true;
+}
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <systemc.h>
+#include <vector>
 
 #include "optical_output_port.h"
 #include "optical_signal.h"
@@ -26,6 +27,34 @@ public:
     /** The group velocity dispersion Dlambda of the waveguide in [s/m/m] */
     double m_D;
 
+    // Pre-calculated values (see update_parameters)
+    /** The transmission in field */
+    double m_transmission;
+    /** The group delay at 1.55um in ns */
+    double m_group_delay_ns;
+    /** 2 * pi * L */
+    double m_phase_delay_factor;
+    /** First and second order dispersion coefficients around 1.55um */
+    double m_dneff_dlambda;
+    double m_d2neff_dlambda2_over_2;
+    double m_dng_dlambda;
+
+    /** Transfer function at one wavelength */
+    struct Transfer {
+        /** Complex field transmission */
+        OpticalSignal::field_type S;
+        /** Group delay, rounded to the engine resolution */
+        sc_time delay;
+    };
+
+private:
+    // Transfer function by wavelength id, filled on first use
+    std::vector<Transfer> m_transfer_cache;
+    std::vector<uint8_t> m_transfer_cached;
+
+    const Transfer &compute_transfer(uint32_t wavelength_id);
+
+public:
     /** Constructor for WaveguideBase
      *
      * @param name name of the module
@@ -49,7 +78,51 @@ public:
             std::cerr << "Error: waveguide length < 0" << std::endl;
         }
         m_length_cm = length_cm;
+        update_parameters();
+    }
+    inline void setNeff(double neff) { m_neff = neff; update_parameters(); }
+    inline void setNg(double ng) { m_ng = ng; update_parameters(); }
+    inline void setD(double D) { m_D = D; update_parameters(); }
+    inline void setAttenuation(double attenuation_dB_cm) {
+        m_attenuation_dB_cm = attenuation_dB_cm;
+        update_parameters();
+    }
+
+    /** Pre-calculate the transfer function parameters and drop the
+     * per-wavelength cache.
+     *
+     * Must be called if the parameters are modified directly during the
+     * simulation (the setters do it).
+     * */
+    virtual void update_parameters();
+
+    /** Pre-calculate the transfer function parameters */
+    virtual void start_of_simulation();
+
+    /** Transfer function at a given wavelength id.
+     *
+     * Computed on the first event at that wavelength, then looked up.
+     * */
+    inline const Transfer &transfer(uint32_t wavelength_id)
+    {
+        if (wavelength_id < m_transfer_cached.size() && m_transfer_cached[wavelength_id])
+            return m_transfer_cache[wavelength_id];
+        return compute_transfer(wavelength_id);
     }
+
+    /** Group delay at a given wavelength in ns.
+     *
+     * Only depends on the constructor parameters, so it can be used before
+     * start_of_simulation (e.g. for lookahead computations).
+     * */
+    double group_delay_ns(double wavelength) const;
+
+    /** Smallest delay between an input event and its output event.
+     *
+     * The minimum is taken over all registered wavelengths (or 1.55um if
+     * none is registered yet), after rounding to the engine resolution.
+     * */
+    sc_time min_group_delay() const;
 };
 
 
@@ -74,12 +147,15 @@ public:
      *
      * It copies the input to the output, after attenuation and delay.
      *
-     *   **SystemC type:** thread
+     *   **SystemC type:** method
      *
      *   **Sensitivity list:** p_in
      * */
     void on_port_in_changed();
 
+    virtual void start_of_simulation();
+    virtual bool stamp_scattering(ScatteringStamp &stamp, uint32_t wavelength_id);
+
     /** Constructor for Waveguide
      *
      * @param name name of the module
@@ -93,8 +169,9 @@ public:
     {
         SC_HAS_PROCESS(WaveguideUni);
 
-        SC_THREAD(on_port_in_changed);
+        SC_METHOD(on_port_in_changed);
         sensitive << p_in;
+        dont_initialize();
     }
 };
 
@@ -125,13 +202,16 @@ public:
      *
      * It copies the input to the output, after attenuation and delay.
      *
-     *   **SystemC type:** thread
+     *   **SystemC type:** method
      *
      *   **Sensitivity list:** p0_in or p1_in
      * */
     void on_p0_in_changed();
     void on_p1_in_changed();
 
+    virtual void start_of_simulation();
+    virtual bool stamp_scattering(ScatteringStamp &stamp, uint32_t wavelength_id);
+
     /** Constructor for Waveguide
      *
      * @param name name of the module
@@ -146,9 +226,11 @@ public:
     {
         SC_HAS_PROCESS(WaveguideBi);
 
-        SC_THREAD(on_p0_in_changed);
+        SC_METHOD(on_p0_in_changed);
         sensitive << p0_in;
-        SC_THREAD(on_p1_in_changed);
+        dont_initialize();
+        SC_METHOD(on_p1_in_changed);
         sensitive << p1_in;
+        dont_initialize();
     }
 };
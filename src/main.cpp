@@ -15,6 +15,8 @@
 
 #include "specs.h"
 #include "optical_output_port.h"
+#include "binary_trace.h"
+#include "specs_api.h"
 #include "parser/parse_tree.h"
 #include "parser/parser_state.h"
 
@@ -59,6 +61,7 @@ int do_test(const string &testname)
     auto stop = high_resolution_clock::now();
     auto duration = duration_cast<microseconds>(stop - start);
     std::cout << "Total runtime: " << duration.count()/1000.0 << " ms" << std::endl;
+    specsGlobalConfig.printEventStats(duration.count()/1e6);
     return 0;
 }
 
@@ -142,46 +145,7 @@ int do_circuit(const string &filename, bool is_dry_run = false, const string& js
 
 int build_circuit(ParseTree &pt, const vector<string> &filenames, string footer="")
 {
-    yyscan_t scanner;
-    yylex_init_extra(new ParserState(), &scanner);
-
-    for(const auto &fname: filenames)
-        yy_add_content_from_file(fname, scanner);
-
-    // add footer
-    yy_add_content_from_string(footer, "footer autogenerated from command line arguments", scanner);
-
-    // Set up first file
-    int res = yy_load_next_buf(scanner);
-    if(res != 0)
-    {
-        cerr << "Expected yy_load_next_buf to return 0" << endl;
-        exit(1);
-    }
-
-    cout << "╔═══════════════════╗" << endl;
-    cout << "║  PARSING CIRCUIT  ║" << endl;
-    cout << "╚═══════════════════╝" << endl;
-
-    int parsing_result = yyparse(scanner, &pt);
-
-    //yy_delete_buffer(buf, scanner);
-    yylex_destroy(scanner);
-
-    // Return if unsuccessful
-    if (parsing_result != 0) {
-        return parsing_result;
-    }
-
-    pt.print();
-
-    cout << "╔══════════════════════╗" << endl;
-    cout << "║   BUILDING CIRCUIT   ║" << endl;
-    cout << "╚══════════════════════╝" << endl;
-
-    pt.build_circuit();
-
-    return 0;
+    return specs_api::build_circuit(pt, filenames, footer);
 }
 
 int raphael_main() { cout<< "Hello world" << endl; return 0; }
@@ -206,6 +170,38 @@ int sc_main(int argc, char *argv[])
                           " - sampled-time\n"
                           " - frequency-domain, fd",
                           { 'm', "mode"});
+    args::ValueFlag<string> set_event_scheduler(parser,
+                          "set_event_scheduler",
+                          "Set the optical events scheduler. Possible values:\n"
+                          " - queue, heap: one event queue per port (default)\n"
+                          " - wheel: timing wheel shared by all ports",
+                          { "scheduler" });
+    args::ValueFlag<string> set_steady_state_solver(parser,
+                          "set_steady_state_solver",
+                          "Set the steady-state solver for OP and DC analyses. Possible values:\n"
+                          " - events: event propagation only (default)\n"
+                          " - lu: sparse LU on linear devices",
+                          { "solver" });
+    args::Flag set_partition_report(parser,
+                          "set_partition_report",
+                          "Print how the netlist splits into partitions at waveguide delays",
+                          { "partition-report" });
+    args::Flag set_compress_linear(parser,
+                          "set_compress_linear",
+                          "Replace feed-forward clusters of linear devices by macro-models",
+                          { "compress" });
+    args::Flag set_loop_report(parser,
+                          "set_loop_report",
+                          "Detect optical feedback loops and report their convergence",
+                          { "loop-report" });
+    args::Flag set_loop_accel(parser,
+                          "set_loop_accel",
+                          "Extrapolate the fields of feedback loops in OP and DC analyses",
+                          { "loop-accel" });
+    args::Flag set_analytic_detectors(parser,
+                          "set_analytic_detectors",
+                          "Only recompute photodetector readouts when their inputs change or beat",
+                          { "analytic-detectors" });
     args::Flag run_manual_test(parser,
                           "run_manual_test",
                           "Run manual test function",
@@ -220,6 +216,17 @@ int sc_main(int argc, char *argv[])
                           "set_tracefile",
                           "Set the default trace file",
                           { 'o', "output" });
+    args::ValueFlag<string> set_trace_format(parser,
+                          "set_trace_format",
+                          "Set the format of probe traces. Possible values:\n"
+                          " - vcd: SystemC VCD writer (default)\n"
+                          " - binary: chunked columnar file (<tracefile>.sptr) written by a\n"
+                          "   background thread",
+                          { "trace-format" });
+    args::ValueFlag<string> convert_trace(parser,
+                          "convert_trace",
+                          "Convert a binary trace (.sptr) to VCD and exit",
+                          { "trace-to-vcd" });
     args::ValueFlag<string> export_json(parser,
                           "export_json",
                           "Export json of completed circuit to file",
@@ -241,6 +248,11 @@ int sc_main(int argc, char *argv[])
                           "Set the value of the absolute tolerance parameter for field",
                           { "abstol" });
 
+    args::ValueFlag<string> set_noise_seed(parser,
+                          "set_noise_seed",
+                          "Set the seed of the noise generators (default: 0)",
+                          { "seed" });
+
     args::ValueFlag<size_t> set_nrings_crow(parser,
                           "set_nrings_crow",
                           "temporary",
@@ -311,6 +323,52 @@ int sc_main(int argc, char *argv[])
         }
     }
 
+    if (set_event_scheduler) {
+        const string &s = set_event_scheduler.Get();
+        if (strutils::iequals(s, "queue") || strutils::iequals(s, "heap"))
+            specsGlobalConfig.event_scheduler = SPECSConfig::PORT_QUEUES;
+        else if (strutils::iequals(s, "wheel"))
+            specsGlobalConfig.event_scheduler = SPECSConfig::TIMING_WHEEL;
+        else
+        {
+            cerr << "Unknown scheduler: '" << s << "'" << endl;
+            return 1;
+        }
+        option_overrides["scheduler"] = "\"" + s + "\"";
+    }
+    if (set_steady_state_solver) {
+        const string &s = set_steady_state_solver.Get();
+        if (strutils::iequals(s, "lu") || strutils::iequals(s, "sparse_lu"))
+            specsGlobalConfig.steady_state_solver = SPECSConfig::SPARSE_LU;
+        else if (strutils::iequals(s, "events") || strutils::iequals(s, "event_propagation"))
+            specsGlobalConfig.steady_state_solver = SPECSConfig::EVENT_PROPAGATION;
+        else
+        {
+            cerr << "Unknown solver: '" << s << "'" << endl;
+            return 1;
+        }
+        option_overrides["solver"] = "\"" + s + "\"";
+    }
+    if (set_partition_report) {
+        specsGlobalConfig.partition_report = true;
+        option_overrides["partition"] = "1";
+    }
+    if (set_compress_linear) {
+        specsGlobalConfig.compress_linear = true;
+        option_overrides["compress"] = "1";
+    }
+    if (set_loop_report) {
+        specsGlobalConfig.loop_report = true;
+        option_overrides["loops"] = "1";
+    }
+    if (set_loop_accel) {
+        specsGlobalConfig.loop_accel = true;
+        option_overrides["loop_accel"] = "1";
+    }
+    if (set_analytic_detectors) {
+        specsGlobalConfig.analytic_detectors = true;
+        option_overrides["analytic_detectors"] = "1";
+    }
     if (set_reltol) {
         double reltol_val;
         stringstream ss;
@@ -335,6 +393,18 @@ int sc_main(int argc, char *argv[])
         }
         option_overrides["abstol"] = set_abstol.Get();
     }
+    if (set_noise_seed) {
+        uint64_t seed_val;
+        stringstream ss;
+        ss << set_noise_seed.Get();
+        ss >> seed_val;
+        if (!ss.eof() || ss.fail()) {
+            cerr << "Invalid seed value" << endl;
+            return 1;
+        }
+        specsGlobalConfig.noise_seed = seed_val;
+        option_overrides["seed"] = set_noise_seed.Get();
+    }
     if (set_verbose_component_initialization) {
         specsGlobalConfig.verbose_component_initialization = set_verbose_component_initialization.Get();
     }
@@ -365,6 +435,29 @@ int sc_main(int argc, char *argv[])
     if (list_tests) {
         return do_list_tests();
     }
+    if (convert_trace) {
+        string in = convert_trace.Get();
+        string out = in;
+        if (out.size() > 5 && out.compare(out.size() - 5, 5, ".sptr") == 0)
+            out.resize(out.size() - 5);
+        out += ".vcd";
+        binary_trace_to_vcd(in, out);
+        cout << "Converted " << in << " > " << out << endl;
+        return 0;
+    }
+    if (set_trace_format) {
+        const string &s = set_trace_format.Get();
+        if (strutils::iequals(s, "vcd"))
+            specsGlobalConfig.trace_format = SPECSConfig::VCD_TRACE;
+        else if (strutils::iequals(s, "binary"))
+            specsGlobalConfig.trace_format = SPECSConfig::BINARY_TRACE;
+        else
+        {
+            cerr << "Unknown trace format: '" << s << "'" << endl;
+            return 1;
+        }
+        option_overrides["trace_format"] = "\"" + s + "\"";
+    }
     if (set_tracefile) {
         cout << "Using trace file: " << set_tracefile.Get() << endl;
         // TODO: validate filename
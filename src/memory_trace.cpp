@@ -0,0 +1,39 @@
+#include "memory_trace.h"
+
+#include <iostream>
+
+using namespace std;
+
+MemoryTrace::channel_id MemoryTrace::add_channel(const string &name, const vector<string> &columns, bool field)
+{
+    if (m_index.count(name))
+    {
+        cerr << "Duplicate trace channel: " << name << endl;
+        exit(1);
+    }
+    m_index[name] = m_channels.size();
+    m_channels.emplace_back();
+    auto &c = m_channels.back();
+    c.name = name;
+    c.field = field;
+    c.columns = columns;
+    c.values.resize(columns.size());
+    return m_channels.size() - 1;
+}
+
+MemoryTrace::channel_id MemoryTrace::find(const string &name) const
+{
+    auto it = m_index.find(name);
+    return it == m_index.end() ? m_channels.size() : it->second;
+}
+
+void MemoryTrace::clear()
+{
+    for (auto &c : m_channels)
+    {
+        c.times.clear();
+        c.values.resize(c.columns.size());
+        for (auto &col : c.values)
+            col.clear();
+    }
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <complex>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+using std::map;
+using std::size_t;
+using std::string;
+using std::vector;
+
+/** In-memory trace, for embedding SPECS in another program (see
+ * specs_api.h).
+ *
+ * Same channels as BinaryTrace, but samples are appended to columnar
+ * vectors in the simulation thread, where the host program reads them once
+ * the analysis is done. Optical field channels store the raw samples
+ * (wavelength_id, re, im), to be derived with derive_optical_fields().
+ */
+class MemoryTrace {
+public:
+    typedef uint32_t channel_id;
+
+    struct Channel {
+        string name;
+        bool field = false;
+        vector<string> columns;
+        vector<uint64_t> times;
+        vector<vector<double>> values; // by column
+    };
+
+private:
+    vector<Channel> m_channels;
+    map<string, channel_id> m_index;
+
+public:
+    // Filled in once the analysis is done
+    double time_unit_s = 0;      // duration of a time step
+    vector<double> wavelengths;  // by wavelength id
+
+    /** Declare a channel */
+    channel_id add_channel(const string &name, const vector<string> &columns, bool field = false);
+
+    /** Declare an optical field channel */
+    inline channel_id add_field_channel(const string &name)
+    {
+        return add_channel(name, {"wavelength_id", "re", "im"}, true);
+    }
+
+    /** Record a sample of channel c at time t (one value per column) */
+    inline void push(channel_id c, uint64_t t, const double *values)
+    {
+        auto &ch = m_channels[c];
+        ch.times.push_back(t);
+        for (size_t k = 0; k < ch.values.size(); ++k)
+            ch.values[k].push_back(values[k]);
+    }
+
+    /** Record the field of an optical net at time t */
+    inline void push_field(channel_id c, uint64_t t, uint32_t wavelength_id, const std::complex<double> &field)
+    {
+        const double values[3] = {static_cast<double>(wavelength_id), field.real(), field.imag()};
+        push(c, t, values);
+    }
+
+    inline size_t channel_count() const { return m_channels.size(); }
+    inline const Channel &channel(channel_id c) const { return m_channels[c]; }
+    inline Channel &channel(channel_id c) { return m_channels[c]; }
+
+    /** Id of the channel called name, or channel_count() */
+    channel_id find(const string &name) const;
+
+    /** Drop all samples (the channels are kept, and columns handed over
+     * by the host program are restored) */
+    void clear();
+};
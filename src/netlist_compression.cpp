@@ -0,0 +1,475 @@
+#include "netlist_compression.h"
+#include "optical_output_port.h"
+#include "devices/spx_module.h"
+#include "utils/sysc_utils.h"
+
+#include <algorithm>
+#include <map>
+#include <numeric>
+#include <set>
+
+using namespace std;
+
+namespace {
+
+// Devices reading and writing an optical net
+struct NetInfo {
+    vector<sc_module *> readers;
+    vector<sc_module *> writers;
+    vector<sc_port_base *> writer_ports;
+};
+
+// Ports of composite devices are only bound through to the ports of their
+// elementary devices, which are the actual readers and writers
+sc_module *port_owner(sc_port_base *port)
+{
+    auto mod = dynamic_cast<sc_module *>(port->get_parent_object());
+    auto spx_mod = dynamic_cast<spx_module *>(mod);
+    if (spx_mod && spx_mod->is_composite())
+        return nullptr;
+    return mod;
+}
+
+// Scattering stamp of a device during elaboration, for the structure of the
+// clusters: parameters are otherwise only computed in start_of_simulation
+bool stamp_structure(spx_module *mod, ScatteringStamp &stamp, const uint32_t &wavelength_id)
+{
+    mod->update_parameters();
+    return mod->stamp_scattering(stamp, wavelength_id);
+}
+
+// Whether a device can be part of a cluster. Time-variant devices are when
+// all their electrical inputs are static (unbound, or nets which no port
+// writes to), e.g. the phase shifters of a mesh with fixed phases.
+bool is_candidate(spx_module *mod, const map<sc_port_base *, OpticalOutputPort *> &oop_of_port,
+        const set<const sc_interface *> &written_nets, const uint32_t &wavelength_id, bool &is_static)
+{
+    is_static = false;
+    if (mod->is_composite())
+        return false;
+    if (mod->flags & spx_module::NON_LINEAR)
+        return false;
+
+    // Only optical ports and static electrical inputs, each output having
+    // its output port writer, and processes owned by the module (so that
+    // they can be disabled)
+    size_t n_processes = 0;
+    size_t n_outputs = 0;
+    size_t n_static_inputs = 0;
+    for (auto obj : mod->get_child_objects())
+    {
+        if (sc_process_handle(obj).valid())
+        {
+            ++n_processes;
+            continue;
+        }
+        auto port = dynamic_cast<sc_port_base *>(obj);
+        if (!port)
+            continue;
+        if (dynamic_cast<sc_port_b<spx::oa_if_in_type> *>(port))
+            continue;
+        if (auto p = dynamic_cast<sc_port_b<spx::ea_if_in_type> *>(port))
+        {
+            for (int k = 0; k < p->size(); ++k)
+                if (written_nets.count(p->get_interface(k)))
+                    return false;
+            ++n_static_inputs;
+            continue;
+        }
+        if (!dynamic_cast<sc_port_b<spx::oa_if_out_type> *>(port))
+            return false;
+        if (oop_of_port.find(port) == oop_of_port.end())
+            return false;
+        ++n_outputs;
+    }
+    if (n_processes == 0 || n_outputs == 0)
+        return false;
+    if (mod->flags & spx_module::TIME_VARIANT)
+    {
+        // Only through their electrical inputs
+        if (n_static_inputs == 0)
+            return false;
+        is_static = true;
+    }
+
+    // Must describe itself as a scattering matrix, without sources
+    ScatteringStamp stamp;
+    if (!stamp_structure(mod, stamp, wavelength_id))
+        return false;
+    return !stamp.m_entries.empty() && stamp.m_sources.empty();
+}
+
+// Union-find over the candidates
+size_t find_root(vector<size_t> &parent, size_t i)
+{
+    while (parent[i] != i)
+    {
+        parent[i] = parent[parent[i]];
+        i = parent[i];
+    }
+    return i;
+}
+
+} // namespace
+
+void LinearMacroModel::compute_terms(const uint32_t &wavelength_id)
+{
+    typedef pair<field_type, sc_time> path_type;
+    const size_t n = m_nets.size();
+    const size_t n_inputs = m_inputs.size();
+
+    // Edges of the cluster at this wavelength, by source net
+    m_stamp.clear();
+    for (auto mod : m_modules)
+        mod->stamp_scattering(m_stamp, wavelength_id);
+    vector<vector<const ScatteringStamp::Entry *>> edges(n);
+    for (const auto &e : m_stamp.m_entries)
+    {
+        if (!e.from || e.s == field_type(0))
+            continue;
+        edges[m_net_index.at(e.from)].push_back(&e);
+    }
+
+    vector<int> output_of_net(n, -1);
+    for (size_t o = 0; o < m_outputs.size(); ++o)
+        output_of_net[m_outputs[o]] = o;
+
+    const size_t k0 = wavelength_id * n_inputs;
+    if (k0 + n_inputs > m_terms_valid.size())
+    {
+        m_terms.resize(k0 + n_inputs);
+        m_terms_valid.resize(k0 + n_inputs, 0);
+    }
+
+    // Propagate a unit change on each input along the nets in topological
+    // order, merging the paths which have the same delay
+    vector<vector<path_type>> paths(n);
+    for (size_t i = 0; i < n_inputs; ++i)
+    {
+        for (auto &p : paths)
+            p.clear();
+        paths[i].emplace_back(1.0, SC_ZERO_TIME);
+
+        for (size_t net = 0; net < n; ++net)
+        {
+            for (const auto e : edges[net])
+            {
+                auto &to = paths[m_net_index.at(e->to)];
+                for (const auto &p : paths[net])
+                {
+                    const sc_time delay = p.second + e->delay;
+                    auto it = find_if(to.begin(), to.end(),
+                        [&](const path_type &q) { return q.second == delay; });
+                    if (it == to.end())
+                        to.emplace_back(p.first * e->s, delay);
+                    else
+                        it->first += p.first * e->s;
+                }
+            }
+        }
+
+        auto &terms = m_terms[k0 + i];
+        terms.clear();
+        for (size_t net = 0; net < n; ++net)
+        {
+            if (output_of_net[net] < 0)
+                continue;
+            for (const auto &p : paths[net])
+                if (p.first != field_type(0))
+                    terms.push_back({static_cast<uint32_t>(output_of_net[net]), p.first, p.second});
+        }
+        m_terms_valid[k0 + i] = 1;
+    }
+}
+
+size_t LinearMacroModel::apply(const string &basename)
+{
+    // Retire the devices and the output ports of the internal nets
+    size_t n_disabled = 0;
+    for (auto mod : m_modules)
+        n_disabled += sc_set_processes_enabled(mod, false);
+    for (auto oop : m_internal_writers)
+        n_disabled += sc_set_processes_enabled(oop, false);
+
+    // The output ports now receive the sum of the contributions of all inputs
+    for (auto oop : m_writers)
+        oop->m_use_deltas = true;
+
+    m_last_in.assign(m_inputs.size(), {});
+    for (size_t i = 0; i < m_inputs.size(); ++i)
+    {
+        sc_spawn_options opts;
+        opts.spawn_method();
+        opts.dont_initialize();
+        opts.set_sensitivity(&m_inputs[i]->value_changed_event());
+        sc_spawn(sc_bind(&LinearMacroModel::on_input_changed, this, i),
+            (basename + "_in_" + to_string(i)).c_str(), &opts);
+    }
+    return n_disabled;
+}
+
+void LinearMacroModel::reset()
+{
+    for (auto &last : m_last_in)
+        last = {};
+}
+
+void LinearMacroModel::on_input_changed(size_t i)
+{
+    const auto &s = m_inputs[i]->read();
+    const uint32_t wlid = s.m_wavelength_id;
+
+    if (isnan(OpticalSignal::getWavelengthUnchecked(wlid)))
+        return;
+
+    // Compute delta at this wavelength and store the new input field
+    auto &last = m_last_in[i][wlid];
+    const field_type deltaE_in = s.m_field - last;
+    last = s.m_field;
+
+    for (const auto &term : terms(i, wlid))
+        m_writers[term.output]->delayedWrite(OpticalSignal(deltaE_in * term.S, wlid), term.delay);
+}
+
+void NetlistCompression::build()
+{
+    m_models.clear();
+    m_n_candidates = 0;
+    m_n_modules = 0;
+    m_n_internal_nets = 0;
+    m_n_rejected_loops = 0;
+    m_n_static = 0;
+    m_largest = 0;
+
+    // The structure of the clusters is taken from the stamps at a registered
+    // wavelength (as the sources register theirs when they are created)
+    const auto &registry = OpticalSignal::wavelength_registry;
+    uint32_t wavelength_id = 0;
+    while (wavelength_id < registry.size() && isnan(registry[wavelength_id]))
+        ++wavelength_id;
+    if (wavelength_id == registry.size())
+    {
+        cerr << "Netlist compression: no wavelength registered, nothing to compress" << endl;
+        return;
+    }
+
+    // Output port writers, by the port they write to
+    map<sc_port_base *, OpticalOutputPort *> oop_of_port;
+    for (auto oop : sc_get_all_module_by_type<OpticalOutputPort>())
+        oop_of_port[&oop->m_port] = oop;
+
+    // Readers and writers of all optical nets, and electrical nets which
+    // are written
+    map<const sc_interface *, NetInfo> nets;
+    set<const sc_interface *> written_nets;
+    for (auto port : sc_get_all_object_by_type<sc_port_base>())
+    {
+        if (auto p = dynamic_cast<sc_port_b<spx::ea_if_out_type> *>(port))
+        {
+            for (int k = 0; k < p->size(); ++k)
+                written_nets.insert(p->get_interface(k));
+            continue;
+        }
+        if (auto p = dynamic_cast<sc_port_b<spx::ea_if_inout_type> *>(port))
+        {
+            for (int k = 0; k < p->size(); ++k)
+                written_nets.insert(p->get_interface(k));
+            continue;
+        }
+        auto owner = port_owner(port);
+        if (!owner)
+            continue;
+        if (auto p = dynamic_cast<sc_port_b<spx::oa_if_in_type> *>(port))
+        {
+            for (int k = 0; k < p->size(); ++k)
+                if (auto itf = p->get_interface(k))
+                    nets[itf].readers.push_back(owner);
+        }
+        else if (auto p = dynamic_cast<sc_port_b<spx::oa_if_out_type> *>(port))
+        {
+            for (int k = 0; k < p->size(); ++k)
+            {
+                if (auto itf = p->get_interface(k))
+                {
+                    nets[itf].writers.push_back(owner);
+                    nets[itf].writer_ports.push_back(port);
+                }
+            }
+        }
+    }
+
+    // Candidate devices (sorted by name, for reproducible reports)
+    vector<spx_module *> candidates;
+    set<const sc_module *> static_candidates;
+    for (auto mod : sc_get_all_module_by_type<spx_module>())
+    {
+        bool is_static;
+        if (!is_candidate(mod, oop_of_port, written_nets, wavelength_id, is_static))
+            continue;
+        candidates.push_back(mod);
+        if (is_static)
+            static_candidates.insert(mod);
+    }
+    sort(candidates.begin(), candidates.end(),
+        [](const spx_module *a, const spx_module *b) { return string(a->name()) < string(b->name()); });
+
+    map<const sc_module *, size_t> candidate_index;
+    for (size_t c = 0; c < candidates.size(); ++c)
+        candidate_index[candidates[c]] = c;
+
+    // Devices sharing a net with another writer can't be replaced
+    for (const auto &net : nets)
+    {
+        if (net.second.writers.size() < 2)
+            continue;
+        for (auto w : net.second.writers)
+            candidate_index.erase(w);
+    }
+    m_n_candidates = candidate_index.size();
+
+    // Group candidates connected through a net
+    vector<size_t> parent(candidates.size());
+    iota(parent.begin(), parent.end(), 0);
+    for (const auto &net : nets)
+    {
+        if (net.second.writers.size() != 1)
+            continue;
+        auto w = candidate_index.find(net.second.writers[0]);
+        if (w == candidate_index.end())
+            continue;
+        for (auto r : net.second.readers)
+        {
+            auto it = candidate_index.find(r);
+            if (it == candidate_index.end())
+                continue;
+            size_t a = find_root(parent, w->second);
+            size_t b = find_root(parent, it->second);
+            if (a != b)
+                parent[max(a, b)] = min(a, b);
+        }
+    }
+
+    map<size_t, vector<spx_module *>> clusters;
+    for (const auto &c : candidate_index)
+        clusters[find_root(parent, c.second)].push_back(candidates[c.second]);
+
+    for (auto &cluster : clusters)
+    {
+        auto &modules = cluster.second;
+        if (modules.size() < 2)
+            continue;
+        sort(modules.begin(), modules.end(),
+            [&](const spx_module *a, const spx_module *b) { return candidate_index[a] < candidate_index[b]; });
+        const set<const sc_module *> in_cluster(modules.begin(), modules.end());
+
+        // Structure of the cluster (doesn't depend on the wavelength)
+        ScatteringStamp stamp;
+        for (auto mod : modules)
+            stamp_structure(mod, stamp, wavelength_id);
+
+        vector<const sc_interface *> cluster_nets;
+        map<const sc_interface *, size_t> index;
+        auto add_net = [&](const sc_interface *itf) {
+            if (itf && index.emplace(itf, cluster_nets.size()).second)
+                cluster_nets.push_back(itf);
+        };
+        for (const auto &e : stamp.m_entries)
+        {
+            add_net(e.from);
+            add_net(e.to);
+        }
+
+        // Topological order of the nets (Kahn's algorithm)
+        const size_t n = cluster_nets.size();
+        vector<vector<size_t>> succ(n);
+        vector<size_t> in_degree(n, 0);
+        for (const auto &e : stamp.m_entries)
+        {
+            if (!e.from)
+                continue;
+            succ[index[e.from]].push_back(index[e.to]);
+            ++in_degree[index[e.to]];
+        }
+        vector<size_t> order;
+        for (size_t k = 0; k < n; ++k)
+            if (in_degree[k] == 0)
+                order.push_back(k);
+        for (size_t head = 0; head < order.size(); ++head)
+            for (auto k : succ[order[head]])
+                if (--in_degree[k] == 0)
+                    order.push_back(k);
+        if (order.size() != n)
+        {
+            ++m_n_rejected_loops;
+            continue;
+        }
+
+        // Inputs are not written by the cluster, outputs are read outside
+        auto model = make_unique<LinearMacroModel>();
+        model->m_modules = modules;
+        vector<size_t> inputs, others;
+        for (auto k : order)
+        {
+            const auto &info = nets[cluster_nets[k]];
+            const bool written_inside = !info.writers.empty() && in_cluster.count(info.writers[0]);
+            (written_inside ? others : inputs).push_back(k);
+        }
+        size_t n_internal = 0;
+        for (auto k : inputs)
+        {
+            model->m_net_index[cluster_nets[k]] = model->m_nets.size();
+            model->m_nets.push_back(cluster_nets[k]);
+            model->m_inputs.push_back(dynamic_cast<const spx::oa_if_in_type *>(cluster_nets[k]));
+        }
+        for (auto k : others)
+        {
+            const auto &info = nets[cluster_nets[k]];
+            model->m_net_index[cluster_nets[k]] = model->m_nets.size();
+            bool read_outside = any_of(info.readers.begin(), info.readers.end(),
+                [&](const sc_module *r) { return !in_cluster.count(r); });
+            if (read_outside)
+            {
+                model->m_outputs.push_back(model->m_nets.size());
+                model->m_writers.push_back(oop_of_port.at(info.writer_ports[0]));
+            }
+            else
+            {
+                model->m_internal_writers.push_back(oop_of_port.at(info.writer_ports[0]));
+                ++n_internal;
+            }
+            model->m_nets.push_back(cluster_nets[k]);
+        }
+
+        m_n_modules += modules.size();
+        for (auto mod : modules)
+            m_n_static += static_candidates.count(mod);
+        m_n_internal_nets += n_internal;
+        m_largest = max(m_largest, modules.size());
+        m_models.push_back(move(model));
+    }
+}
+
+void NetlistCompression::apply()
+{
+    m_n_disabled_processes = 0;
+    m_n_macro_processes = 0;
+    for (size_t k = 0; k < m_models.size(); ++k)
+    {
+        m_n_disabled_processes += m_models[k]->apply("linear_macro_" + to_string(k));
+        m_n_macro_processes += m_models[k]->m_inputs.size();
+    }
+}
+
+void NetlistCompression::print(std::ostream &os) const
+{
+    os << "Netlist compression (feed-forward linear clusters):" << endl;
+    os << "- candidate devices: " << m_n_candidates << endl;
+    os << "- clusters: " << m_models.size();
+    os << " (largest: " << m_largest << " devices)" << endl;
+    os << "- devices replaced: " << m_n_modules;
+    os << " (" << m_n_static << " with static electrical inputs)" << endl;
+    os << "- signals eliminated: " << m_n_internal_nets << endl;
+    os << "- processes: " << m_n_disabled_processes << " disabled, ";
+    os << m_n_macro_processes << " macro-model processes" << endl;
+    os << "- clusters rejected (feedback loop): " << m_n_rejected_loops << endl;
+}
@@ -0,0 +1,151 @@
+#pragma once
+
+#define SC_INCLUDE_DYNAMIC_PROCESSES
+
+#include <systemc.h>
+
+#include <complex>
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <unordered_map>
+#include <vector>
+
+#include "optical_signal.h"
+#include "scattering_solver.h"
+#include "specs.h"
+#include "utils/wavelength_field_store.h"
+
+using std::vector;
+using std::size_t;
+using std::unique_ptr;
+
+class spx_module;
+class OpticalOutputPort;
+
+/** Macro-model replacing a feed-forward cluster of linear devices.
+ *
+ * The response of the cluster from each of its input nets to each of its
+ * output nets is a sum of terms `S * a_in(t - delay)`, one per distinct
+ * path delay through the cluster. Terms are computed from the scattering
+ * stamps of the devices (see spx_module::stamp_scattering) the first time
+ * a wavelength is seen on an input, then looked up.
+ *
+ * Changes on an input are multiplied by each term and written, as deltas,
+ * to the output ports which used to drive the output nets.
+ */
+class LinearMacroModel {
+public:
+    typedef OpticalSignal::field_type field_type;
+
+    /** Contribution of one input to one output net */
+    struct Term {
+        uint32_t output; // index in m_outputs
+        field_type S;
+        sc_time delay;
+    };
+
+    // Devices replaced by the model
+    vector<spx_module *> m_modules;
+
+    // Nets of the cluster in topological order (inputs come first)
+    vector<const sc_interface *> m_nets;
+    std::unordered_map<const sc_interface *, size_t> m_net_index;
+
+    vector<const spx::oa_if_in_type *> m_inputs; // nets m_nets[0..n_inputs)
+    vector<size_t> m_outputs; // indices in m_nets of the output nets
+    vector<OpticalOutputPort *> m_writers; // writer of each output net
+    vector<OpticalOutputPort *> m_internal_writers; // of the internal nets
+
+private:
+    // Terms for input i at a wavelength, indexed by wavelength_id * n_inputs + i
+    vector<vector<Term>> m_terms;
+    vector<uint8_t> m_terms_valid;
+
+    // Last field received on each input, by wavelength
+    vector<WavelengthFieldStore<field_type>> m_last_in;
+
+    ScatteringStamp m_stamp;
+
+    void compute_terms(const uint32_t &wavelength_id);
+
+public:
+    LinearMacroModel() {}
+
+    /** Terms from input i at a wavelength */
+    inline const vector<Term> &terms(const size_t &i, const uint32_t &wavelength_id)
+    {
+        const size_t k = wavelength_id * m_inputs.size() + i;
+        if (k >= m_terms_valid.size() || !m_terms_valid[k])
+            compute_terms(wavelength_id);
+        return m_terms[k];
+    }
+
+    /** Disable the processes of the devices and of the output ports of
+     * internal nets, and start the model.
+     *
+     * Returns the number of disabled processes.
+     */
+    size_t apply(const string &basename);
+
+    /** Forget the last inputs, e.g. once the output ports were reset:
+     * outputs are written as deltas from them */
+    void reset();
+
+    void on_input_changed(size_t i);
+};
+
+/** Elaboration pass collapsing feed-forward linear clusters.
+ *
+ * Composite devices (MZI, mesh columns, Clements meshes) expand into many
+ * elementary devices, each adding an output port queue and an event per
+ * hop. This pass finds connected groups of devices which are linear and
+ * time-invariant (no NON_LINEAR flag, and no TIME_VARIANT flag unless all
+ * their electrical inputs are static, see spx_module::ModuleFlags),
+ * describe themselves through stamp_scattering() and have no feedback
+ * loop, and replaces each group by one LinearMacroModel.
+ *
+ * An electrical input is static when no port writes to its net, e.g. the
+ * phase shifters of an MZI or of a Clements mesh whose phases are set once:
+ * the model then uses their values at the start of the simulation.
+ *
+ * SystemC can't remove modules once elaborated, so replaced devices are
+ * retired instead: their processes, and those of the output ports of the
+ * internal nets, are disabled and never scheduled again.
+ *
+ * A net is internal to a cluster when it is written by one of its devices
+ * and only read by devices of the cluster: it doesn't carry events anymore.
+ * Nets read from outside are still written, by the same output ports as
+ * before, so probes and other devices see the same values (up to the
+ * tolerances of the output ports, which are applied once instead of at
+ * every hop).
+ *
+ * Must be run once elaboration is complete (e.g. in end_of_elaboration),
+ * before the simulation starts.
+ */
+class NetlistCompression {
+private:
+    vector<unique_ptr<LinearMacroModel>> m_models;
+
+    size_t m_n_candidates = 0;
+    size_t m_n_modules = 0;
+    size_t m_n_internal_nets = 0;
+    size_t m_n_disabled_processes = 0;
+    size_t m_n_macro_processes = 0;
+    size_t m_n_rejected_loops = 0;
+    size_t m_n_static = 0;
+    size_t m_largest = 0;
+
+public:
+    NetlistCompression() {}
+
+    /** Find the clusters among all the modules registered with the kernel */
+    void build();
+
+    /** Replace the clusters found by build() with their macro-models */
+    void apply();
+
+    inline const vector<unique_ptr<LinearMacroModel>> &models() const { return m_models; }
+
+    void print(std::ostream &os) const;
+};
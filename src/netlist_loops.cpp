@@ -0,0 +1,373 @@
+#include "netlist_loops.h"
+#include "optical_output_port.h"
+#include "devices/spx_module.h"
+
+#include <algorithm>
+#include <limits>
+#include <map>
+#include <set>
+
+using namespace std;
+
+namespace {
+
+// Ports of composite devices are only bound through to the ports of their
+// elementary devices, which are the actual readers and writers
+sc_module *port_owner(sc_port_base *port)
+{
+    auto mod = dynamic_cast<sc_module *>(port->get_parent_object());
+    auto spx_mod = dynamic_cast<spx_module *>(mod);
+    if (spx_mod && spx_mod->is_composite())
+        return nullptr;
+    return mod;
+}
+
+// Strongly-connected components of the subgraph of the alive nodes
+// (Tarjan's algorithm, without recursion)
+vector<vector<size_t>> find_sccs(const vector<vector<size_t>> &succ, const vector<uint8_t> &alive)
+{
+    const size_t n = succ.size();
+    const size_t unvisited = numeric_limits<size_t>::max();
+    vector<size_t> index(n, unvisited);
+    vector<size_t> lowlink(n, 0);
+    vector<uint8_t> on_stack(n, 0);
+    vector<size_t> stack;
+    vector<pair<size_t, size_t>> call_stack; // (node, next successor)
+    vector<vector<size_t>> sccs;
+    size_t next_index = 0;
+
+    for (size_t root = 0; root < n; ++root)
+    {
+        if (!alive[root] || index[root] != unvisited)
+            continue;
+        call_stack.emplace_back(root, 0);
+        while (!call_stack.empty())
+        {
+            const size_t v = call_stack.back().first;
+            size_t &k = call_stack.back().second;
+            if (k == 0)
+            {
+                index[v] = lowlink[v] = next_index++;
+                stack.push_back(v);
+                on_stack[v] = 1;
+            }
+            bool descended = false;
+            while (k < succ[v].size())
+            {
+                const size_t w = succ[v][k++];
+                if (!alive[w])
+                    continue;
+                if (index[w] == unvisited)
+                {
+                    call_stack.emplace_back(w, 0);
+                    descended = true;
+                    break;
+                }
+                if (on_stack[w])
+                    lowlink[v] = min(lowlink[v], index[w]);
+            }
+            if (descended)
+                continue;
+
+            if (lowlink[v] == index[v])
+            {
+                sccs.emplace_back();
+                size_t w;
+                do {
+                    w = stack.back();
+                    stack.pop_back();
+                    on_stack[w] = 0;
+                    sccs.back().push_back(w);
+                } while (w != v);
+            }
+            call_stack.pop_back();
+            if (!call_stack.empty())
+            {
+                const size_t u = call_stack.back().first;
+                lowlink[u] = min(lowlink[u], lowlink[v]);
+            }
+        }
+    }
+    return sccs;
+}
+
+bool has_self_loop(const vector<vector<size_t>> &succ, size_t v)
+{
+    return find(succ[v].begin(), succ[v].end(), v) != succ[v].end();
+}
+
+} // namespace
+
+bool FeedbackLoop::on_emit(OpticalOutputPort *oop, int cut, const uint32_t &wavelength_id, field_type &desired)
+{
+    if (cut < 0)
+        return false;
+    ++m_iterations;
+
+    // Only steady-state iterations form a series (in time-domain, the
+    // fields follow the actual transient), and ports receiving deltas
+    // don't own the value they emit
+    if (oop->m_mode != OpticalOutputPortMode::NO_DELAY || oop->m_use_deltas)
+        return false;
+
+    auto &c = m_cuts[cut];
+    if (wavelength_id >= c.history.size())
+        c.history.resize(wavelength_id + 1);
+    auto &h = c.history[wavelength_id];
+
+    if (h.n == 3)
+    {
+        h.x[0] = h.x[1];
+        h.x[1] = h.x[2];
+        h.n = 2;
+    }
+    h.x[h.n++] = desired;
+    if (h.n < 3)
+        return false;
+
+    const field_type d1 = h.x[1] - h.x[0];
+    const field_type d2 = h.x[2] - h.x[1];
+    m_last_residual = abs(d2) / max(abs(desired), oop->m_abstol);
+
+    // Converged (or stalled): nothing to extrapolate
+    if (abs(d2) <= oop->m_abstol || d1 == field_type(0))
+    {
+        h.q_valid = false;
+        return false;
+    }
+
+    // Wait for two successive ratios to agree before trusting the series
+    const field_type q = d2 / d1;
+    const bool stable = h.q_valid && abs(q - h.q) <= ratio_tolerance * abs(q);
+    h.q = q;
+    h.q_valid = true;
+    if (!stable)
+        return false;
+
+    m_max_gain = max(m_max_gain, abs(q));
+    if (!m_accelerate || abs(q) >= 1.0)
+        return false;
+
+    desired = h.x[2] + d2 * q / (1.0 - q);
+    ++m_extrapolations;
+
+    // Start a new series from the extrapolated field
+    h.x[0] = desired;
+    h.n = 1;
+    h.q_valid = false;
+    return true;
+}
+
+void FeedbackLoop::reset(int cut)
+{
+    if (cut < 0)
+        return;
+    m_cuts[cut].history.clear();
+}
+
+void NetlistLoops::build()
+{
+    m_loops.clear();
+
+    // Optical nets and the nets read and written by each elementary device
+    map<const sc_interface *, size_t> net_index;
+    vector<const sc_interface *> nets;
+    auto net = [&](const sc_interface *itf) {
+        auto res = net_index.emplace(itf, nets.size());
+        if (res.second)
+            nets.push_back(itf);
+        return res.first->second;
+    };
+
+    map<sc_module *, pair<vector<size_t>, vector<size_t>>> device_nets;
+    for (auto port : sc_get_all_object_by_type<sc_port_base>())
+    {
+        auto owner = port_owner(port);
+        if (!owner)
+            continue;
+        if (auto p = dynamic_cast<sc_port_b<spx::oa_if_in_type> *>(port))
+        {
+            for (int k = 0; k < p->size(); ++k)
+                if (auto itf = p->get_interface(k))
+                    device_nets[owner].first.push_back(net(itf));
+        }
+        else if (auto p = dynamic_cast<sc_port_b<spx::oa_if_out_type> *>(port))
+        {
+            for (int k = 0; k < p->size(); ++k)
+                if (auto itf = p->get_interface(k))
+                    device_nets[owner].second.push_back(net(itf));
+        }
+    }
+    m_n_nets = nets.size();
+
+    // Net graph
+    const size_t n = nets.size();
+    vector<vector<size_t>> succ(n);
+    vector<vector<sc_module *>> devices_of_net(n);
+    for (const auto &d : device_nets)
+    {
+        for (auto from : d.second.first)
+        {
+            devices_of_net[from].push_back(d.first);
+            for (auto to : d.second.second)
+                succ[from].push_back(to);
+        }
+        for (auto to : d.second.second)
+            devices_of_net[to].push_back(d.first);
+    }
+    for (auto &s : succ)
+    {
+        sort(s.begin(), s.end());
+        s.erase(unique(s.begin(), s.end()), s.end());
+    }
+
+    auto net_name = [&](size_t i) {
+        auto obj = dynamic_cast<const sc_object *>(nets[i]);
+        return obj ? string(obj->name()) : string("?");
+    };
+
+    vector<uint8_t> alive(n, 1);
+    vector<vector<size_t>> loops;
+    for (auto &scc : find_sccs(succ, alive))
+        if (scc.size() > 1 || has_self_loop(succ, scc[0]))
+            loops.push_back(scc);
+
+    // Sort by first net name, for reproducible reports
+    for (auto &scc : loops)
+        sort(scc.begin(), scc.end(), [&](size_t a, size_t b) { return net_name(a) < net_name(b); });
+    sort(loops.begin(), loops.end(),
+        [&](const vector<size_t> &a, const vector<size_t> &b) { return net_name(a[0]) < net_name(b[0]); });
+
+    m_n_loop_nets = 0;
+    for (const auto &scc : loops)
+    {
+        m_loops.emplace_back(new FeedbackLoop());
+        auto &loop = *m_loops.back();
+        loop.m_index = m_loops.size() - 1;
+
+        set<sc_module *> devices;
+        vector<uint8_t> in_loop(n, 0);
+        for (auto i : scc)
+        {
+            in_loop[i] = 1;
+            loop.m_net_names.push_back(net_name(i));
+            devices.insert(devices_of_net[i].begin(), devices_of_net[i].end());
+        }
+        loop.m_n_devices = devices.size();
+        m_n_loop_nets += scc.size();
+
+        // Greedy cut: remove the most connected net of each remaining
+        // cycle until the loop is acyclic
+        vector<uint8_t> remaining = in_loop;
+        vector<size_t> pending = scc;
+        while (!pending.empty())
+        {
+            vector<size_t> in_degree(n, 0);
+            for (auto i : pending)
+                for (auto j : succ[i])
+                    if (remaining[j])
+                        ++in_degree[j];
+
+            size_t best = pending[0];
+            size_t best_score = 0;
+            for (auto i : pending)
+            {
+                size_t out_degree = 0;
+                for (auto j : succ[i])
+                    out_degree += remaining[j];
+                const size_t score = in_degree[i] * out_degree;
+                if (score > best_score)
+                {
+                    best = i;
+                    best_score = score;
+                }
+            }
+            loop.m_cuts.push_back({net_name(best), nullptr, {}});
+            remaining[best] = 0;
+
+            pending.clear();
+            for (auto &sub : find_sccs(succ, remaining))
+                if (sub.size() > 1 || has_self_loop(succ, sub[0]))
+                    pending.insert(pending.end(), sub.begin(), sub.end());
+            sort(pending.begin(), pending.end(), [&](size_t a, size_t b) { return net_name(a) < net_name(b); });
+        }
+    }
+}
+
+void NetlistLoops::apply(bool accelerate)
+{
+    map<string, pair<FeedbackLoop *, int>> loop_of_net;
+    for (auto &loop : m_loops)
+    {
+        loop->m_accelerate = accelerate;
+        for (const auto &name : loop->m_net_names)
+            loop_of_net[name] = {loop.get(), -1};
+        for (size_t c = 0; c < loop->m_cuts.size(); ++c)
+            loop_of_net[loop->m_cuts[c].net_name].second = c;
+    }
+
+    for (auto oop : sc_get_all_module_by_type<OpticalOutputPort>())
+    {
+        auto obj = dynamic_cast<const sc_object *>(oop->m_port.get_interface());
+        if (!obj)
+            continue;
+        auto it = loop_of_net.find(obj->name());
+        if (it == loop_of_net.end())
+            continue;
+
+        auto loop = it->second.first;
+        int cut = it->second.second;
+        if (cut >= 0 && loop->m_cuts[cut].writer)
+        {
+            // Several writers on a cut net: each one gets its own series
+            loop->m_cuts.push_back({loop->m_cuts[cut].net_name, nullptr, {}});
+            cut = loop->m_cuts.size() - 1;
+        }
+        if (cut >= 0)
+            loop->m_cuts[cut].writer = oop;
+        oop->m_loop = loop;
+        oop->m_loop_cut = cut;
+    }
+}
+
+void NetlistLoops::print(std::ostream &os) const
+{
+    size_t n_cuts = 0;
+    size_t largest = 0;
+    for (const auto &loop : m_loops)
+    {
+        n_cuts += loop->m_cuts.size();
+        largest = max(largest, loop->m_net_names.size());
+    }
+
+    os << "Feedback loops:" << endl;
+    os << "- optical nets: " << m_n_nets << endl;
+    os << "- loops: " << m_loops.size() << endl;
+    os << "- nets in a loop: " << m_n_loop_nets << endl;
+    os << "- largest loop: " << largest << " nets" << endl;
+    os << "- cut nets: " << n_cuts << endl;
+}
+
+void NetlistLoops::print_report(std::ostream &os) const
+{
+    if (m_loops.empty())
+        return;
+
+    os << "Feedback loop convergence:" << endl;
+    for (const auto &loop : m_loops)
+    {
+        os << "- loop " << loop->m_index << " (" << loop->m_net_names.size() << " nets, ";
+        os << loop->m_n_devices << " devices, cut at";
+        for (const auto &c : loop->m_cuts)
+            os << " " << c.net_name;
+        os << "):" << endl;
+        os << "    iterations: " << loop->m_iterations;
+        os << ", writes: " << loop->m_writes;
+        os << ", extrapolations: " << loop->m_extrapolations << endl;
+        os << "    loop gain: " << loop->m_max_gain;
+        os << ", last residual: " << loop->m_last_residual;
+        if (loop->runaway())
+            os << " [RUNAWAY: loop gain >= 1]";
+        os << endl;
+    }
+}
@@ -0,0 +1,127 @@
+#pragma once
+
+#include <systemc.h>
+
+#include <complex>
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "optical_signal.h"
+
+using std::vector;
+using std::size_t;
+using std::string;
+using std::unique_ptr;
+
+class OpticalOutputPort;
+
+/** A feedback loop of the optical netlist (a strongly-connected component
+ * of the net graph) and its convergence statistics.
+ *
+ * In steady-state (NO_DELAY) mode, the field on a net of a linear loop
+ * approaches its fixed point geometrically, by a factor q (the loop gain)
+ * per round trip, and near a resonance |q| is close to 1. The output ports
+ * writing the cut nets of the loop (see NetlistLoops) keep the last fields
+ * they emitted at each wavelength, and once the ratio q between successive
+ * changes is stable, jump to the limit of the series (Aitken's
+ * delta-squared):
+ *
+ *     x* = x2 - (x2 - x1)^2 / ((x2 - x1) - (x1 - x0))
+ *
+ * The extrapolated field is only a better initial guess: the loop keeps
+ * iterating from it until the output ports stop emitting, so the converged
+ * values are the same as without extrapolation (up to the tolerances).
+ */
+class FeedbackLoop {
+public:
+    typedef OpticalSignal::field_type field_type;
+
+    /** A net where the loop is cut, and the sequence of its fields */
+    struct Cut {
+        string net_name;
+        OpticalOutputPort *writer;
+
+        struct History {
+            field_type x[3];
+            field_type q;
+            uint8_t n = 0;
+            bool q_valid = false;
+        };
+        vector<History> history; // by wavelength id
+    };
+
+    size_t m_index = 0;
+    vector<string> m_net_names;
+    size_t m_n_devices = 0;
+    vector<Cut> m_cuts;
+    bool m_accelerate = false;
+
+    // Statistics
+    uint64_t m_writes = 0;          // fields written to the nets of the loop
+    uint64_t m_iterations = 0;      // fields written to the cut nets
+    uint64_t m_extrapolations = 0;
+    double m_max_gain = 0;          // largest stable |q| observed
+    double m_last_residual = 0;     // last relative change on a cut net
+
+    /** Ratio between successive changes at which the sequence is
+     * considered geometric */
+    static constexpr double ratio_tolerance = 1e-2;
+
+    FeedbackLoop() {}
+
+    /** Called by the output ports of the loop before each emission
+     *
+     * May replace `desired` with an extrapolated field if the port writes a
+     * cut net. Returns true if it did.
+     */
+    bool on_emit(OpticalOutputPort *oop, int cut, const uint32_t &wavelength_id, field_type &desired);
+
+    /** Forget the fields seen by a cut (e.g. when its port is reset) */
+    void reset(int cut);
+
+    /** Whether the loop amplifies instead of converging */
+    inline bool runaway() const { return m_max_gain >= 1.0; }
+};
+
+/** Detection of the feedback loops of the optical netlist.
+ *
+ * The net graph has one node per optical net, and an edge from each net
+ * read by an elementary device to each net it writes. Its strongly-connected
+ * components (Tarjan's algorithm) with more than one net, or with a device
+ * writing back to its own input net, are the feedback loops.
+ *
+ * In each loop, a small set of cut nets is chosen so that every cycle of the
+ * loop goes through at least one of them (greedily, taking the net with the
+ * most predecessors and successors in the loop, until what remains is
+ * acyclic). The output ports writing these nets apply the extrapolation
+ * described in FeedbackLoop, and all the output ports of the loop count
+ * their writes for the report.
+ *
+ * Must be run once elaboration is complete (e.g. in end_of_elaboration).
+ */
+class NetlistLoops {
+private:
+    vector<unique_ptr<FeedbackLoop>> m_loops;
+    size_t m_n_nets = 0;
+    size_t m_n_loop_nets = 0;
+
+public:
+    NetlistLoops() {}
+
+    /** Find the loops among all the modules registered with the kernel */
+    void build();
+
+    /** Attach the loops to the output ports writing their nets */
+    void apply(bool accelerate);
+
+    inline const vector<unique_ptr<FeedbackLoop>> &loops() const { return m_loops; }
+
+    /** Summary of the structure of the loops */
+    void print(std::ostream &os) const;
+
+    /** Iterations and convergence of each loop */
+    void print_report(std::ostream &os) const;
+};
@@ -0,0 +1,224 @@
+#include "netlist_partition.h"
+#include "specs.h"
+#include "devices/spx_module.h"
+#include "devices/waveguide.h"
+
+#include <algorithm>
+#include <numeric>
+
+using namespace std;
+
+namespace {
+
+// Append the channels bound to port (if it uses interface IF) to itfs
+template <class IF>
+bool collect_port_interfaces(sc_object *obj, vector<const sc_interface *> &itfs)
+{
+    auto port = dynamic_cast<sc_port_b<IF> *>(obj);
+    if (!port)
+        return false;
+    for (int i = 0; i < port->size(); ++i)
+    {
+        auto itf = port->get_interface(i);
+        if (itf)
+            itfs.push_back(itf);
+    }
+    return true;
+}
+
+// Return all the channels bound to the ports of a module
+vector<const sc_interface *> module_interfaces(const sc_module *mod)
+{
+    vector<const sc_interface *> itfs;
+    for (auto obj : mod->get_child_objects())
+    {
+        auto port = dynamic_cast<sc_port_base *>(obj);
+        if (!port)
+            continue;
+        if (collect_port_interfaces<spx::oa_if_in_type>(obj, itfs)
+            || collect_port_interfaces<spx::oa_if_out_type>(obj, itfs)
+            || collect_port_interfaces<spx::ea_if_in_type>(obj, itfs)
+            || collect_port_interfaces<spx::ea_if_out_type>(obj, itfs)
+            || collect_port_interfaces<sc_signal_in_if<spx::ed_value_type>>(obj, itfs)
+            || collect_port_interfaces<sc_signal_inout_if<spx::ed_value_type>>(obj, itfs))
+            continue;
+        // Other port types: only consider the first binding
+        auto itf = port->get_interface();
+        if (itf)
+            itfs.push_back(itf);
+    }
+    return itfs;
+}
+
+// Composite modules (made of other devices) are not analysed themselves,
+// nor modules which aren't devices
+bool is_leaf_module(const sc_module *mod)
+{
+    auto spx_mod = dynamic_cast<const spx_module *>(mod);
+    return spx_mod && !spx_mod->is_composite();
+}
+
+} // namespace
+
+size_t NetlistPartition::net(const sc_interface *itf)
+{
+    auto it = m_net_index.find(itf);
+    if (it != m_net_index.end())
+        return it->second;
+    size_t i = m_parent.size();
+    m_parent.push_back(i);
+    m_net_index.emplace(itf, i);
+    return i;
+}
+
+size_t NetlistPartition::find(size_t i)
+{
+    while (m_parent[i] != i)
+    {
+        m_parent[i] = m_parent[m_parent[i]];
+        i = m_parent[i];
+    }
+    return i;
+}
+
+void NetlistPartition::unite(size_t a, size_t b)
+{
+    a = find(a);
+    b = find(b);
+    if (a != b)
+        m_parent[max(a, b)] = min(a, b);
+}
+
+void NetlistPartition::build()
+{
+    m_net_index.clear();
+    m_parent.clear();
+    m_partitions.clear();
+    m_partition_of_net.clear();
+    m_cuts.clear();
+    m_n_internal_waveguides = 0;
+
+    struct WaveguideSides {
+        const WaveguideBase *wg;
+        size_t a;
+        size_t b;
+        sc_time lookahead;
+    };
+    vector<pair<const sc_module *, size_t>> devices;
+    vector<WaveguideSides> waveguides;
+
+    for (auto mod : sc_get_all_module())
+    {
+        if (!is_leaf_module(mod))
+            continue;
+
+        // Waveguides with non-zero delay are not merged across their sides
+        auto wg = dynamic_cast<WaveguideBase *>(mod);
+        sc_time lookahead = wg ? wg->min_group_delay() : SC_ZERO_TIME;
+        if (lookahead > SC_ZERO_TIME)
+        {
+            vector<const sc_interface *> side_a, side_b;
+            if (auto wg_uni = dynamic_cast<WaveguideUni *>(wg))
+            {
+                side_a = module_interfaces(wg_uni);
+                side_b.push_back(wg_uni->p_out.get_interface());
+                side_a.erase(remove(side_a.begin(), side_a.end(), side_b[0]), side_a.end());
+            }
+            else if (auto wg_bi = dynamic_cast<WaveguideBi *>(wg))
+            {
+                side_a = { wg_bi->p0_in.get_interface(), wg_bi->p0_out.get_interface() };
+                side_b = { wg_bi->p1_in.get_interface(), wg_bi->p1_out.get_interface() };
+            }
+            side_a.erase(remove(side_a.begin(), side_a.end(), nullptr), side_a.end());
+            side_b.erase(remove(side_b.begin(), side_b.end(), nullptr), side_b.end());
+
+            if (!side_a.empty() && !side_b.empty())
+            {
+                size_t a = net(side_a[0]);
+                for (const auto &itf : side_a)
+                    unite(a, net(itf));
+                size_t b = net(side_b[0]);
+                for (const auto &itf : side_b)
+                    unite(b, net(itf));
+                waveguides.push_back({wg, a, b, lookahead});
+                devices.emplace_back(mod, a);
+                continue;
+            }
+        }
+
+        // Any other device glues all its nets together
+        auto itfs = module_interfaces(mod);
+        if (itfs.empty())
+            continue;
+        size_t first = net(itfs[0]);
+        for (const auto &itf : itfs)
+            unite(first, net(itf));
+        devices.emplace_back(mod, first);
+    }
+
+    // Number partitions by order of their root net
+    vector<size_t> partition_of(m_parent.size(), SIZE_MAX);
+    m_partition_of_net.resize(m_parent.size());
+    for (size_t i = 0; i < m_parent.size(); ++i)
+    {
+        size_t root = find(i);
+        if (partition_of[root] == SIZE_MAX)
+        {
+            partition_of[root] = m_partitions.size();
+            m_partitions.emplace_back();
+        }
+        ++m_partitions[partition_of[root]].n_nets;
+        m_partition_of_net[i] = partition_of[root];
+    }
+    for (const auto &dev : devices)
+        m_partitions[partition_of[find(dev.second)]].modules.push_back(dev.first);
+
+    for (const auto &wg : waveguides)
+    {
+        size_t from = partition_of[find(wg.a)];
+        size_t to = partition_of[find(wg.b)];
+        if (from == to)
+            ++m_n_internal_waveguides; // part of a loop inside a partition
+        else
+            m_cuts.push_back({wg.wg, from, to, wg.lookahead});
+    }
+}
+
+size_t NetlistPartition::partition_of(const sc_interface *net) const
+{
+    auto it = m_net_index.find(net);
+    if (it == m_net_index.end())
+        return SIZE_MAX;
+    return m_partition_of_net[it->second];
+}
+
+sc_time NetlistPartition::lookahead() const
+{
+    if (m_cuts.empty())
+        return SC_ZERO_TIME;
+    sc_time ret = m_cuts[0].lookahead;
+    for (const auto &cut : m_cuts)
+        ret = min(ret, cut.lookahead);
+    return ret;
+}
+
+void NetlistPartition::print(std::ostream &os) const
+{
+    size_t n_modules = 0;
+    size_t largest = 0;
+    for (const auto &p : m_partitions)
+    {
+        n_modules += p.modules.size();
+        largest = max(largest, p.modules.size());
+    }
+
+    os << "Netlist partitioning (cut at waveguides):" << endl;
+    os << "- devices: " << n_modules << endl;
+    os << "- partitions: " << m_partitions.size() << endl;
+    os << "- largest partition: " << largest << " devices" << endl;
+    os << "- cut waveguides: " << m_cuts.size();
+    os << " (" << m_n_internal_waveguides << " inside a partition)" << endl;
+    os << "- lookahead: " << lookahead() << endl;
+    if (largest > 0)
+        os << "- parallelism bound: " << (double)n_modules / largest << endl;
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <systemc.h>
+
+#include <cstdint>
+#include <ostream>
+#include <unordered_map>
+#include <vector>
+
+using std::vector;
+using std::size_t;
+
+class WaveguideBase;
+
+/** Partitioning of the elaborated netlist at waveguide boundaries.
+ *
+ * Every waveguide with a strictly positive group delay cuts the netlist in
+ * two: an event entering one side cannot produce an event on the other side
+ * earlier than the group delay (the lookahead). All the other devices are
+ * treated as zero-lookahead and glue their nets together.
+ *
+ * The result is the set of partitions that a conservative parallel engine
+ * could advance independently within windows of `lookahead()`, along with
+ * the cut waveguides which carry the messages between partitions.
+ *
+ * Only SPECS devices (spx_module) are considered: other modules (e.g. the
+ * stimuli of a testbench) don't glue the nets they are bound to.
+ *
+ * The analysis only needs resolved port bindings, so it must be run after
+ * elaboration is complete (e.g. in end_of_elaboration).
+ */
+class NetlistPartition {
+public:
+    /** A waveguide carrying events from one partition to another */
+    struct Cut {
+        const WaveguideBase *waveguide;
+        size_t from;
+        size_t to;
+        sc_time lookahead;
+    };
+
+    /** A set of devices connected through zero-lookahead paths */
+    struct Partition {
+        vector<const sc_module *> modules;
+        size_t n_nets = 0;
+    };
+
+private:
+    // Union-find over the nets (channels)
+    std::unordered_map<const sc_interface *, size_t> m_net_index;
+    vector<size_t> m_parent;
+
+    vector<Partition> m_partitions;
+    vector<size_t> m_partition_of_net; // by net index
+    vector<Cut> m_cuts;
+    size_t m_n_internal_waveguides = 0;
+
+    size_t net(const sc_interface *itf);
+    size_t find(size_t i);
+    void unite(size_t a, size_t b);
+
+public:
+    NetlistPartition() {}
+
+    /** Analyse all the modules registered with the kernel */
+    void build();
+
+    inline const vector<Partition> &partitions() const { return m_partitions; }
+    inline const vector<Cut> &cuts() const { return m_cuts; }
+
+    /** Partition of the devices reading or writing a net, or SIZE_MAX */
+    size_t partition_of(const sc_interface *net) const;
+
+    /** Largest window in which partitions can be simulated independently */
+    sc_time lookahead() const;
+
+    void print(std::ostream &os) const;
+};
@@ -0,0 +1,147 @@
+#include "optical_event_scheduler.h"
+#include "optical_output_port.h"
+#include "specs.h"
+
+
+OpticalEventScheduler::OpticalEventScheduler(sc_module_name name)
+    : sc_module(name)
+    , m_next_wakeup(numeric_limits<sc_time::value_type>::max())
+{
+    SC_HAS_PROCESS(OpticalEventScheduler);
+
+    SC_METHOD(on_wakeup);
+    sensitive << m_wakeup;
+    dont_initialize();
+    ++specsGlobalConfig.port_process_count;
+}
+
+void OpticalEventScheduler::wakeup_at(sc_time::value_type t)
+{
+    // An earlier notification overrides a later one, so we only need to
+    // notify when the new time is before the scheduled wake-up
+    if (t >= m_next_wakeup)
+        return;
+    m_next_wakeup = t;
+    m_wakeup.notify(sc_time::from_value(t - sc_time_stamp().value()));
+}
+
+OpticalEventScheduler::event_id OpticalEventScheduler::new_event(OpticalOutputPort *port, sc_time::value_type t, const OpticalSignal &value)
+{
+    event_id id;
+    if (m_free_events.empty())
+    {
+        id = m_events.size();
+        m_events.push_back(Event{port, t, value, 0});
+    }
+    else
+    {
+        id = m_free_events.back();
+        m_free_events.pop_back();
+        m_events[id] = Event{port, t, value, 0};
+    }
+
+    // Track it in the pending events of the port
+    m_events[id].port_slot = port->m_scheduled_events.size();
+    port->m_scheduled_events.push_back(id);
+    return id;
+}
+
+void OpticalEventScheduler::release_event(event_id id)
+{
+    auto &ev = m_events[id];
+    if (ev.port)
+    {
+        // Remove it from the pending events of the port (swap with last)
+        auto &pending = ev.port->m_scheduled_events;
+        const event_id last = pending.back();
+        pending[ev.port_slot] = last;
+        m_events[last].port_slot = ev.port_slot;
+        pending.pop_back();
+        ev.port = nullptr;
+    }
+    m_free_events.push_back(id);
+}
+
+void OpticalEventScheduler::schedule(OpticalOutputPort *port, const sc_time &t, const OpticalSignal &value)
+{
+    Key key{port, t.value(), value.m_wavelength_id};
+
+    // check if an event was already scheduled for the same timestamp
+    auto it = m_index.find(key);
+    if (it != m_index.end()) {
+        // if yes, just replace or sum with the old one
+        auto &pending = m_events[it->second].value;
+        if (port->m_use_deltas)
+            pending += value;
+        else
+            pending = value;
+        return;
+    }
+
+    // if not, schedule the new event
+    const event_id id = new_event(port, t.value(), value);
+    m_wheel.push(t.value(), id);
+    m_index.emplace(key, id);
+    wakeup_at(t.value());
+}
+
+void OpticalEventScheduler::drop(OpticalOutputPort *port)
+{
+    // Events stay in the wheel or ready lists but are marked as dropped,
+    // they are released when they are reached
+    for (const auto &id : port->m_scheduled_events)
+    {
+        auto &ev = m_events[id];
+        m_index.erase(Key{port, ev.t, ev.value.m_wavelength_id});
+        ev.port = nullptr;
+    }
+    port->m_scheduled_events.clear();
+}
+
+void OpticalEventScheduler::on_wakeup()
+{
+    const sc_time::value_type now = sc_time_stamp().value();
+    const auto delta = sc_delta_count();
+    m_next_wakeup = numeric_limits<sc_time::value_type>::max();
+    ++specsGlobalConfig.port_process_activations;
+
+    // Collect all events due now (deferred ones come first)
+    size_t n_due = m_wheel.pop_due(now, m_ready);
+    for (size_t i = m_ready.size() - n_due; i < m_ready.size(); ++i)
+    {
+        const auto &ev = m_events[m_ready[i]];
+        if (ev.port)
+            m_index.erase(Key{ev.port, ev.t, ev.value.m_wavelength_id});
+    }
+
+    for (const auto &id : m_ready)
+    {
+        OpticalOutputPort *port = m_events[id].port;
+        if (!port)
+        {
+            release_event(id);
+            continue;
+        }
+
+        // Only one write per port and per delta cycle
+        if (port->m_last_emit_delta == delta)
+        {
+            m_deferred.push_back(id);
+            continue;
+        }
+        port->m_last_emit_delta = delta;
+
+        // emit() may schedule new events (and grow m_events)
+        const OpticalSignal value = m_events[id].value;
+        release_event(id);
+        port->emit(value);
+    }
+    m_ready.clear();
+    m_ready.swap(m_deferred);
+
+    // Schedule next activation
+    if (!m_ready.empty())
+        wakeup_at(now);
+    else if (!m_wheel.empty())
+        wakeup_at(m_wheel.next_time());
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <systemc.h>
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "optical_signal.h"
+#include "utils/timing_wheel.h"
+
+class OpticalOutputPort;
+
+/** Shared scheduler and dispatcher for the events of all optical output ports.
+ *
+ * Instead of each port keeping its own heap of pending events, its own
+ * sc_event_queue and its own thread, ports push their events to this
+ * scheduler, which stores them in a single hierarchical timing wheel (O(1)
+ * insert, O(1) amortised advance). A single method process wakes up once per
+ * timestamp, drains all the due events and writes them directly to the port
+ * signals, so no per-port coroutine (stack, context switch) is needed.
+ *
+ * Events scheduled for the same port, timestamp and wavelength are
+ * coalesced, as in the per-port queues. A port is never written twice in the
+ * same delta cycle: extra events are deferred to the next delta cycle, as an
+ * sc_event_queue would do.
+ */
+class OpticalEventScheduler : public sc_module {
+public:
+    typedef uint32_t event_id;
+
+    struct Event {
+        OpticalOutputPort *port; // null once dropped
+        sc_time::value_type t;
+        OpticalSignal value;
+        uint32_t port_slot;      // position in port->m_scheduled_events
+    };
+
+    typedef TimingWheel<event_id> wheel_type;
+
+private:
+    struct Key {
+        const OpticalOutputPort *port;
+        sc_time::value_type t;
+        uint32_t wavelength_id;
+
+        bool operator==(const Key &rhs) const
+        {
+            return port == rhs.port && t == rhs.t && wavelength_id == rhs.wavelength_id;
+        }
+    };
+
+    struct KeyHash {
+        size_t operator()(const Key &k) const
+        {
+            uint64_t x = k.t ^ reinterpret_cast<uintptr_t>(k.port)
+                       ^ (static_cast<uint64_t>(k.wavelength_id) * 0x9e3779b97f4a7c15ULL);
+            x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+            x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+            return static_cast<size_t>(x ^ (x >> 31));
+        }
+    };
+
+    // Pending events, referenced by the wheel, the ready lists, the index
+    // and the list of pending events of their port
+    vector<Event> m_events;
+    vector<event_id> m_free_events;
+
+    wheel_type m_wheel;
+    std::unordered_map<Key, event_id, KeyHash> m_index;
+
+    // Events due now, which are being dispatched or were deferred
+    vector<event_id> m_ready;
+    vector<event_id> m_deferred;
+
+    sc_event m_wakeup;
+    sc_time::value_type m_next_wakeup;
+
+    void on_wakeup();
+    void wakeup_at(sc_time::value_type t);
+
+    event_id new_event(OpticalOutputPort *port, sc_time::value_type t, const OpticalSignal &value);
+    void release_event(event_id id);
+
+public:
+    OpticalEventScheduler(sc_module_name name);
+
+    /** Schedule value on port at absolute time t */
+    void schedule(OpticalOutputPort *port, const sc_time &t, const OpticalSignal &value);
+
+    /** Drop all events pending on port (linear in the number of such events) */
+    void drop(OpticalOutputPort *port);
+
+    inline size_t size() const
+    {
+        return m_wheel.size() + m_ready.size();
+    }
+};
@@ -1,6 +1,7 @@
 #include "optical_output_port.h"
 #include "optical_signal.h"
 #include "specs.h"
+#include "netlist_loops.h"
 
 string oopPortMode2str(OpticalOutputPortMode mode)
 {
@@ -21,13 +22,8 @@ OpticalOutputPort::OpticalOutputPort(sc_module_name name, port_type &p)
     , m_port(p)
     , m_config(nullptr)
 {
-    SC_HAS_PROCESS(OpticalOutputPort);
-
-    // SC_THREAD(on_data_ready);
-    // sensitive << m_event_queue;
-
-    SC_THREAD(on_data_ready);
-    sensitive << m_event_queue;
+    // The on_data_ready process is only created in before_end_of_elaboration,
+    // once we know whether this port is handled by a shared scheduler
 
     // SC_THREAD(on_data_ready_fd);
     // sensitive << m_event_queue_fd;
@@ -36,6 +32,20 @@ OpticalOutputPort::OpticalOutputPort(sc_module_name name, port_type &p)
     // sensitive << specsGlobalConfig.drop_all_events;
 }
 
+void OpticalOutputPort::before_end_of_elaboration()
+{
+    // Ports handled by a shared scheduler are written directly by its
+    // dispatcher process and don't need a thread (nor its stack)
+    if (m_config && m_config->m_scheduler)
+        return;
+
+    SC_HAS_PROCESS(OpticalOutputPort);
+
+    SC_THREAD(on_data_ready);
+    sensitive << m_event_queue;
+    ++specsGlobalConfig.port_process_count;
+}
+
 // void OpticalOutputPort::drop_all_events() {
 //     while(true)
 //     {
@@ -86,22 +96,26 @@ void OpticalOutputPort::applyConfig() {
     m_mode = m_config->m_mode;
     m_reltol = m_config->m_reltol;
     m_abstol = m_config->m_abstol;
+    m_scheduler = m_config->m_scheduler.get();
 }
 
 void OpticalOutputPort::start_of_simulation() {
     applyConfig();
+
+    // Make room for all wavelengths known so far
+    m_desired_fields.resize(OpticalSignal::wavelength_registry.size());
+    m_emitted_fields.resize(OpticalSignal::wavelength_registry.size());
 }
 
 void OpticalOutputPort::on_data_ready()
 {
     // Initialize output queue
-    m_queue = queue_type();
-
-    spx::oa_value_type::field_type desired;
+    m_queue.clear();
 
     while (true) {
         // Wait for data ready notification
         wait();
+        ++specsGlobalConfig.port_process_activations;
 
         // Check if output queue is empty (would be a bug)
         if (m_queue.size() == 0) {
@@ -116,8 +130,7 @@ void OpticalOutputPort::on_data_ready()
         sc_time now = sc_time_stamp();
 
         // Get the next queue item and pop it from the queue
-        auto tuple = m_queue.top();
-        m_queue.pop();
+        auto tuple = m_queue.pop();
 
         // If next event is also now, notify event queue
         // if (m_queue.top().first == now)
@@ -138,55 +151,78 @@ void OpticalOutputPort::on_data_ready()
             else      continue;
         }
 
-        // Check signal error to decice whether to emit signal
-        bool emit_signal = false;
-        bool pass_abstol = false;
-        bool pass_reltol = false;
+        // Apply tolerances and write the signal to the port
+        emit(s);
+    }
+}
 
-        uint32_t wlid = s.m_wavelength_id;
+void OpticalOutputPort::emit(const OpticalSignal &s)
+{
+    spx::oa_value_type::field_type desired;
 
-        //auto &desired = m_desired_fields[wlid];
-        auto &emitted = m_emitted_fields[wlid];
+    ++specsGlobalConfig.port_event_count;
 
-        // Store the desired output value which we know is valid
-        if (m_use_deltas)
-        {
-            desired = m_desired_fields[wlid] + s.m_field;
-            m_desired_fields[wlid] = desired;
-        }
-        else
-            desired = s.m_field;
+    // Check signal error to decice whether to emit signal
+    bool emit_signal = false;
+    bool pass_abstol = false;
+    bool pass_reltol = false;
 
-        // Decide whether to emit signal or not
-        pass_abstol = check_emit_by_abstol(desired, emitted);
-        pass_reltol = check_emit_by_reltol(desired, emitted);
+    uint32_t wlid = s.m_wavelength_id;
 
-        // Only emits when passes both tests
-        emit_signal = pass_abstol && pass_reltol;
+    //auto &desired = m_desired_fields[wlid];
+    auto &emitted = m_emitted_fields[wlid];
 
-        // Emit zeros instead of signals smaller than a 10 abstol
-        // TODO: check this !!
-        if (emit_signal && (abs(desired) < 10*m_abstol))
-            desired = complex<double>(0,0);
+    // Store the desired output value which we know is valid
+    if (m_use_deltas)
+    {
+        desired = m_desired_fields[wlid] + s.m_field;
+        m_desired_fields[wlid] = desired;
+    }
+    else
+        desired = s.m_field;
 
+    // On a cut net of a feedback loop, the field may be extrapolated
+    if (m_loop)
+        m_loop->on_emit(this, m_loop_cut, wlid, desired);
 
-        // cout << "emit: " << emit_signal << endl;
-        // Emit the desired output value if its stars are aligned
-        if (emit_signal || m_skip_next_convergence_check || m_skip_convergence_check)
-        {
-            // cout << dynamic_cast<spx::oa_signal_type *>(m_port.get_interface())->name();
-            // cout << " emitting " << m_desired_fields[wlid] << endl;
-            m_skip_next_convergence_check = false;
+    // Decide whether to emit signal or not
+    pass_abstol = check_emit_by_abstol(desired, emitted);
+    pass_reltol = check_emit_by_reltol(desired, emitted);
 
-            // Replace the stored emitted output value at that wavelength
-            emitted = desired;
+    // Only emits when passes both tests
+    emit_signal = pass_abstol && pass_reltol;
 
-            // Write the value to the port
-            m_port->write(spx::oa_value_type(desired, wlid));
-        }
+    // Emit zeros instead of signals smaller than a 10 abstol
+    // TODO: check this !!
+    if (emit_signal && (abs(desired) < 10*m_abstol))
+        desired = complex<double>(0,0);
+
+
+    // cout << "emit: " << emit_signal << endl;
+    // Emit the desired output value if its stars are aligned
+    if (emit_signal || m_skip_next_convergence_check || m_skip_convergence_check)
+    {
+        // cout << dynamic_cast<spx::oa_signal_type *>(m_port.get_interface())->name();
+        // cout << " emitting " << m_desired_fields[wlid] << endl;
+        m_skip_next_convergence_check = false;
+
+        // Replace the stored emitted output value at that wavelength
+        emitted = desired;
+
+        // Write the value to the port
+        m_port->write(spx::oa_value_type(desired, wlid));
+
+        if (m_loop)
+            ++m_loop->m_writes;
     }
 }
 
+void OpticalOutputPort::reset_loop_history()
+{
+    if (m_loop)
+        m_loop->reset(m_loop_cut);
+}
+
 // Should be removed
 void OpticalOutputPort::on_data_ready_fd()
 {
@@ -337,23 +373,26 @@ void OpticalOutputPort::delayedWriteEventDriven(const OpticalSignal &value, cons
     }
 
 
-    // find first scheduled signal with this timestamp and this lambda
-    auto it = std::find_if(m_queue.begin(), m_queue.end(), [&value,&t](const auto &x) {
-            return t == x.first && value.m_wavelength_id == x.second.m_wavelength_id;
-            });
+    // with a shared scheduler, coalescing is done by the scheduler
+    if (m_scheduler) {
+        m_scheduler->schedule(this, t, value);
+        return;
+    }
+
+    // try to schedule the signal at this timestamp and this lambda
+    auto res = m_queue.emplace(t, value.m_wavelength_id, value);
 
     // check if an event was already scheduled for the same timestamp
-    if (it == m_queue.cend()) {
-        // if not, just schedule the new event
-        m_queue.push(std::make_pair(t, value));
+    if (res.second) {
+        // if not, the new event was just scheduled
         m_event_queue.notify(t - sc_time_stamp());
     }
     else {
         // if yes, just replace or sum with the old one
         if (m_use_deltas)
-            it->second += value;
+            *res.first += value;
         else
-            it->second = value;
+            *res.first = value;
     }
 }
 
@@ -377,27 +416,24 @@ void OpticalOutputPort::immediateWriteFrequencyDomain(const OpticalSignal &value
     //    return;
 
     const sc_time &now = sc_time_stamp();
-    if (m_queue.empty() || m_queue.cbegin()->first != now) {
-        // if the queue is empty, or contains no event for current time,
-        // push the signal directly
-        m_queue.push(make_pair(now, value));
+    if (m_scheduler) {
+        m_scheduler->schedule(this, now, value);
+        return;
+    }
+
+    auto res = m_queue.emplace(now, value.m_wavelength_id, value);
+    if (res.second) {
+        // if the queue contains no event for current time at this
+        // wavelength, the signal was pushed directly
         m_event_queue.notify(SC_ZERO_TIME);
     }
     else {
-        // if the queue is contains an event for current time
-        if (m_queue.cbegin()->second.m_wavelength_id == value.m_wavelength_id) {
-            // if wavelengths are equal, just replace or sum with the old one
-            if (m_use_deltas)
-                m_queue.begin()->second += value;
-            else
-                m_queue.begin()->second = value;
-            //m_event_queue_fd.cancel_all();
-            //m_event_queue_fd.notify(SC_ZERO_TIME);
-        } else {
-            // otherwise just schedule event separately
-            m_queue.push(make_pair(now, value));
-            m_event_queue.notify(SC_ZERO_TIME);
-        }
+        // if the queue contains an event for current time and wavelength,
+        // just replace or sum with the old one
+        if (m_use_deltas)
+            *res.first += value;
+        else
+            *res.first = value;
     }
 #else
     cerr << "Using implemented function: " << __FUNCTION__ << endl;
@@ -9,7 +9,9 @@
 #include <map>
 
 #include "optical_signal.h"
-#include "utils/pqueue.h"
+#include "optical_event_scheduler.h"
+#include "utils/pending_event_queue.h"
+#include "utils/wavelength_field_store.h"
 
 using std::cout;
 using std::endl;
@@ -34,12 +36,16 @@ enum OpticalOutputPortMode {
 
 string oopPortMode2str(OpticalOutputPortMode mode);
 
+class FeedbackLoop;
+
 class OpticalOutputPortConfig {
 public:
     OpticalOutputPortMode m_mode = OpticalOutputPortMode::DEFAULT;
     double m_abstol = 1e-8;
     double m_reltol = 1e-4;
     sc_time::value_type m_timestep_value = 1; // relative to systemc timestep
+    // shared scheduler (if null, each port uses its own event queue)
+    shared_ptr<OpticalEventScheduler> m_scheduler;
 
     OpticalOutputPortConfig() {}
 };
@@ -49,7 +55,7 @@ public:
     typedef OpticalOutputPort this_type;
 	typedef sc_port<sc_signal_out_if<OpticalSignal>> port_type;
 	typedef pair<sc_time, OpticalSignal> pair_type;
-    typedef PQueue<pair_type> queue_type;
+    typedef PendingEventQueue<OpticalSignal> queue_type;
 
 
 // private:
@@ -67,8 +73,8 @@ public:
     // OpticalSignal m_emitted_val;
     // OpticalSignal m_emitted_val_fd;
 
-    std::map<uint32_t,OpticalSignal::field_type> m_desired_fields;
-    std::map<uint32_t,OpticalSignal::field_type> m_emitted_fields;
+    WavelengthFieldStore<OpticalSignal::field_type> m_desired_fields;
+    WavelengthFieldStore<OpticalSignal::field_type> m_emitted_fields;
 
     sc_time m_temporal_resolution;
     OpticalOutputPortMode m_mode;
@@ -79,15 +85,29 @@ public:
     bool m_skip_next_convergence_check = false;
     bool m_skip_convergence_check = false;
 
+    // Shared scheduler mode (see OpticalEventScheduler)
+    OpticalEventScheduler *m_scheduler = nullptr;
+    vector<OpticalEventScheduler::event_id> m_scheduled_events; // pending in m_scheduler
+    uint64_t m_last_emit_delta = numeric_limits<uint64_t>::max();
+
+    // Feedback loop of the net written by this port (see NetlistLoops), and
+    // index of the cut of the loop it writes (or -1)
+    FeedbackLoop *m_loop = nullptr;
+    int m_loop_cut = -1;
+
     std::shared_ptr<const OpticalOutputPortConfig> m_config;
 
     // void drop_all_events();
     void on_data_ready();
     void on_data_ready_fd();
+    // Write s to the port now, unless it is within tolerances of the
+    // last emitted value at that wavelength
+    void emit(const OpticalSignal &s);
     bool check_emit_by_abstol(const OpticalSignal::field_type &desired, const OpticalSignal::field_type &last);
     bool check_emit_by_reltol(const OpticalSignal::field_type &desired, const OpticalSignal::field_type &last);
 
     void applyConfig();
+    virtual void before_end_of_elaboration();
     virtual void start_of_simulation();
     sc_time snap_to_next_valid_time(const sc_time &t, const unsigned int resolution_multiplier=1);
     void delayedWriteEventDriven(const OpticalSignal &value, const sc_time &delay, const unsigned int resolution_multiplier=1);
@@ -117,7 +137,9 @@ public:
             exit(1);
         }
         m_event_queue.cancel_all();
-        m_queue = queue_type();
+        m_queue.clear();
+        if (m_scheduler)
+            m_scheduler->drop(this);
     }
 
     void reset()
@@ -125,8 +147,11 @@ public:
         drop_queue();
         m_desired_fields.clear();
         m_emitted_fields.clear();
+        reset_loop_history();
     }
 
+    void reset_loop_history();
+
     void swap_wavelengths(uint32_t wl1, uint32_t wl2)
     {
         drop_queue();
@@ -138,8 +163,8 @@ public:
         m_emitted_fields.emplace(wl2, 0);
 
         // Swap wl1 and wl2 entries
-        swap(m_desired_fields.at(wl1), m_desired_fields.at(wl2));
-        swap(m_emitted_fields.at(wl1), m_emitted_fields.at(wl2));
+        m_desired_fields.swap(wl1, wl2);
+        m_emitted_fields.swap(wl1, wl2);
     }
 
     void delete_wavelength(uint32_t wl)
@@ -171,7 +196,7 @@ public:
 
     inline bool isempty() const
     {
-        return m_queue.empty();
+        return m_queue.empty() && m_scheduled_events.empty();
     }
 
     void delayedWrite(const OpticalSignal &value, const sc_time &delay, const unsigned int resolution_multiplier=1);
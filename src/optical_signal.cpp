@@ -3,7 +3,10 @@
 
 using namespace std::complex_literals;
 
+#if SPECS_SIGNAL_IDS
 unsigned int OpticalSignal::nextId = 0;
+#endif
+WavelengthRegistry OpticalSignal::wavelength_registry;
 
 OpticalSignal &OpticalSignal::operator+=(const OpticalSignal &rhs)
 {
@@ -110,48 +113,15 @@ OpticalSignal OpticalSignal::sumSignals(OpticalSignal s0, OpticalSignal s1)
 
 uint32_t OpticalSignal::getIDFromWavelength(const double &wavelength)
 {
-    auto it = find (specsGlobalConfig.wavelengths_vector.cbegin(),
-                    specsGlobalConfig.wavelengths_vector.cend(),
-                    wavelength);
-
-    uint32_t index;
-
-    if (it != specsGlobalConfig.wavelengths_vector.cend())
-    { // Found
-        index = it - specsGlobalConfig.wavelengths_vector.cbegin();
-    }
-    else
-    { // Didn't find, has to add it to the vector
-        specsGlobalConfig.wavelengths_vector.push_back(wavelength);
-        index = specsGlobalConfig.wavelengths_vector.size() - 1;
-        // -1 because of zero indexing
-    }
-
-    if (index == (uint32_t)(-1))
-    {
-        cerr << "Error: too many wavelengths being used ." << endl;
-        exit(1);
-    }
-
-    return index;
+    return wavelength_registry.id(wavelength);
 }
 
 double OpticalSignal::getWavelength() const
 {
-    if (m_wavelength_id >= specsGlobalConfig.wavelengths_vector.size())
-    {
-        cerr << "Wavelength not found in global vector." << endl;
-        exit(1);
-    }
-    return specsGlobalConfig.wavelengths_vector[m_wavelength_id];
+    return wavelength_registry.at(m_wavelength_id);
 }
 
 double OpticalSignal::getWavelength(const uint32_t &wavelength_id)
 {
-    if (wavelength_id >= specsGlobalConfig.wavelengths_vector.size())
-    {
-        cerr << "Wavelength not found in global vector." << endl;
-        exit(1);
-    }
-    return specsGlobalConfig.wavelengths_vector[wavelength_id];
-}
\ No newline at end of file
+    return wavelength_registry.at(wavelength_id);
+}
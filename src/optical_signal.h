@@ -9,23 +9,40 @@
 #include <cmath>
 #include <complex>
 #include <stdlib.h>
+#include <type_traits>
 
 #include <systemc.h>
 
+#include "wavelength_registry.h"
+
 using namespace std;
 
+// Give each signal a unique id (useful to follow individual events when
+// debugging). Ids make OpticalSignal larger and not trivially copyable, so
+// they are disabled unless SPECS_SIGNAL_IDS is defined to 1.
+#ifndef SPECS_SIGNAL_IDS
+#define SPECS_SIGNAL_IDS 0
+#endif
+
 class OpticalSignal {
 public:
     typedef complex<double> field_type;
 
+#if SPECS_SIGNAL_IDS
 private:
     // class variable for holding next id to attribute
     static unsigned int nextId;
+#endif
 
 public:
+    // wavelengths of all signals, indexed by wavelength id
+    static WavelengthRegistry wavelength_registry;
+
     field_type m_field; // complex field of the signal (V/m)
     uint32_t m_wavelength_id; // accesses the global vector of wavelengths
+#if SPECS_SIGNAL_IDS
     unsigned int m_id;
+#endif
 
     // Constructor from values
     OpticalSignal(const field_type &field = 0.0,
@@ -48,6 +65,7 @@ public:
         getNewId();
     }
 
+#if SPECS_SIGNAL_IDS
     // Copy constructor
     OpticalSignal(const OpticalSignal &s)
         : m_field(s.m_field)
@@ -55,12 +73,24 @@ public:
         , m_id(s.m_id)
     { getNewId(); }
 
-    virtual ~OpticalSignal() {}
+    OpticalSignal &operator=(const OpticalSignal &rhs)
+    {
+        m_field = rhs.m_field;
+        m_wavelength_id = rhs.m_wavelength_id;
+        getNewId();
+        return *this;
+    }
 
     inline void getNewId()
     {
         m_id = nextId++;
     }
+#else
+    OpticalSignal(const OpticalSignal &s) = default;
+    OpticalSignal &operator=(const OpticalSignal &rhs) = default;
+
+    inline void getNewId() {}
+#endif
 
     void setWavelength(const double &wavelength)
     {
@@ -74,6 +104,17 @@ public:
 
     static double getWavelength(const uint32_t &wavelength_id);
 
+    // Same as getWavelength() without checking that the id is registered
+    inline double getWavelengthUnchecked() const
+    {
+        return wavelength_registry[m_wavelength_id];
+    }
+
+    static inline double getWavelengthUnchecked(const uint32_t &wavelength_id)
+    {
+        return wavelength_registry[wavelength_id];
+    }
+
     uint32_t getIDFromWavelength(const double &wavelength);
 
     inline static complex<double> amplitudePhaseToField(double amplitude, double phase)
@@ -144,14 +185,6 @@ public:
         return m_field;
     }
 
-    OpticalSignal operator=(const OpticalSignal &rhs)
-    {
-        m_field = rhs.m_field;
-        m_wavelength_id = rhs.m_wavelength_id;
-        getNewId();
-        return *this;
-    }
-
     OpticalSignal &operator+=(const OpticalSignal &rhs);
     OpticalSignal &operator-=(const OpticalSignal &rhs);
 
@@ -190,6 +223,11 @@ public:
     sc_trace(sc_trace_file *tf, const OpticalSignal &s, const std::string &NAME);
 };
 
+#if !SPECS_SIGNAL_IDS
+static_assert(std::is_trivially_copyable<OpticalSignal>::value,
+              "OpticalSignal should be trivially copyable");
+#endif
+
 OpticalSignal operator+(OpticalSignal lhs, const OpticalSignal &rhs)
 {
     return lhs += rhs;
@@ -228,7 +266,9 @@ inline std::ostream &operator<<(std::ostream &os, const OpticalSignal &s)
 
     std::ostringstream oss;
 
+#if SPECS_SIGNAL_IDS
     oss << "[" << setw(4) << setfill('0') << s.m_id << setfill(' ') << "] ";
+#endif
     oss << " @ " << setw(4) << setprecision(8) << s.getWavelength() * 1e9 << setw(2)
         << (isnan(s.getWavelength()) ? "" : " nm");
     oss << " (" << setprecision(6) << fixed << s.modulus() << " V.m⁻¹";
@@ -246,6 +286,8 @@ inline void sc_trace(sc_trace_file *tf, const OpticalSignal &s, const std::strin
 
     // Note: C++ complex doesn't provide access to real and imaginary part
     // Therefore we cannot have references or pointers to it...
+#if SPECS_SIGNAL_IDS
     sc_trace(tf, s.m_id, NAME + ".id");
+#endif
     sc_trace(tf, s.m_wavelength_id, NAME + ".wavelengthid");
 }
@@ -0,0 +1,347 @@
+#include "parallel_engine.h"
+#include "scattering_solver.h"
+#include "devices/spx_module.h"
+#include "utils/sysc_utils.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstring>
+#include <mutex>
+#include <numeric>
+#include <thread>
+
+using namespace std;
+
+namespace {
+
+// Barrier whose last thread to arrive runs a completion step before the
+// others are released
+class Barrier {
+private:
+    mutex m_mutex;
+    condition_variable m_cv;
+    size_t m_n_threads;
+    size_t m_n_waiting = 0;
+    uint64_t m_generation = 0;
+
+public:
+    explicit Barrier(size_t n_threads) : m_n_threads(n_threads) {}
+
+    template <class F>
+    void wait(F completion)
+    {
+        unique_lock<mutex> lock(m_mutex);
+        const uint64_t generation = m_generation;
+        if (++m_n_waiting == m_n_threads)
+        {
+            completion();
+            m_n_waiting = 0;
+            ++m_generation;
+            m_cv.notify_all();
+            return;
+        }
+        m_cv.wait(lock, [&] { return m_generation != generation; });
+    }
+};
+
+} // namespace
+
+uint32_t ParallelEngine::net(const sc_interface *itf)
+{
+    auto it = m_net_index.find(itf);
+    if (it != m_net_index.end())
+        return it->second;
+    const uint32_t i = m_nets.size();
+    m_nets.push_back(itf);
+    m_net_index.emplace(itf, i);
+    return i;
+}
+
+bool ParallelEngine::build(const vector<uint32_t> &wavelength_ids)
+{
+    m_net_index.clear();
+    m_nets.clear();
+    m_edges.clear();
+    m_partitions.clear();
+    m_wavelength_ids = wavelength_ids;
+    m_wavelength_index.clear();
+    for (size_t w = 0; w < wavelength_ids.size(); ++w)
+        m_wavelength_index[wavelength_ids[w]] = w;
+    m_n_windows = 0;
+
+    m_netlist_partition.build();
+
+    // Devices by name, so that the order of the edges (and of the sums of
+    // the fields) doesn't depend on where modules are allocated
+    vector<spx_module *> devices;
+    for (auto mod : sc_get_all_module())
+    {
+        auto spx_mod = dynamic_cast<spx_module *>(mod);
+        if (spx_mod && !spx_mod->is_composite())
+            devices.push_back(spx_mod);
+    }
+    sort(devices.begin(), devices.end(), [](spx_module *a, spx_module *b) {
+        return strcmp(a->name(), b->name()) < 0;
+    });
+
+    struct StampedEdge {
+        uint32_t wavelength;
+        uint32_t from;
+        Edge edge;
+    };
+    vector<StampedEdge> stamped;
+    ScatteringStamp stamp;
+    for (auto mod : devices)
+    {
+        mod->update_parameters();
+        for (uint32_t w = 0; w < wavelength_ids.size(); ++w)
+        {
+            stamp.clear();
+            if (!mod->stamp_scattering(stamp, wavelength_ids[w]))
+            {
+                cerr << "Error: " << mod->name() << " has no scattering model, ";
+                cerr << "it can't be simulated by the parallel engine" << endl;
+                return false;
+            }
+            if (!stamp.m_sources.empty())
+            {
+                cerr << "Error: " << mod->name() << " is a source: ";
+                cerr << "its fields must be injected in the parallel engine" << endl;
+                return false;
+            }
+            if (!stamp.m_entries.empty() && (mod->flags & spx_module::NON_LINEAR))
+            {
+                cerr << "Error: " << mod->name() << " is non-linear, ";
+                cerr << "it can't be simulated by the parallel engine" << endl;
+                return false;
+            }
+            for (const auto &e : stamp.m_entries)
+            {
+                if (!e.from || e.s == field_type(0))
+                    continue;
+                stamped.push_back({w, net(e.from), {net(e.to), e.delay.value(), e.s}});
+            }
+        }
+    }
+
+    const size_t n_nets = m_nets.size();
+    const size_t n_wavelengths = wavelength_ids.size();
+
+    m_partitions.resize(m_netlist_partition.partitions().size());
+    m_partition_of_net.resize(n_nets);
+    for (size_t n = 0; n < n_nets; ++n)
+    {
+        const size_t p = m_netlist_partition.partition_of(m_nets[n]);
+        if (p >= m_partitions.size())
+        {
+            cerr << "Error: a net of the parallel engine belongs to no partition" << endl;
+            return false;
+        }
+        m_partition_of_net[n] = p;
+    }
+
+    // Lookahead: smallest delay from one partition to another
+    m_lookahead = UINT64_MAX;
+    m_edges.resize(n_wavelengths * n_nets);
+    for (const auto &s : stamped)
+    {
+        m_edges[s.wavelength * n_nets + s.from].push_back(s.edge);
+        const uint32_t p = m_partition_of_net[s.from];
+        ++m_partitions[p].n_edges;
+        if (m_partition_of_net[s.edge.to] != p)
+            m_lookahead = min(m_lookahead, s.edge.delay);
+    }
+    if (m_lookahead == 0)
+    {
+        cerr << "Error: zero-delay path between two partitions of the parallel engine" << endl;
+        return false;
+    }
+
+    m_fields.assign(n_nets * n_wavelengths, 0);
+    m_injected.assign(n_nets * n_wavelengths, 0);
+    m_observed.assign(n_nets, false);
+    m_samples.assign(n_nets, {});
+    return true;
+}
+
+void ParallelEngine::inject(const sc_interface *itf, const sc_time &t, const uint32_t &wavelength_id,
+        const field_type &field)
+{
+    auto it = m_net_index.find(itf);
+    auto wit = m_wavelength_index.find(wavelength_id);
+    if (it == m_net_index.end() || wit == m_wavelength_index.end())
+    {
+        cerr << "Error: injecting a field on a net or at a wavelength ";
+        cerr << "unknown to the parallel engine" << endl;
+        exit(1);
+    }
+    const uint32_t n = it->second;
+    const uint32_t w = wit->second;
+    auto &last = m_injected[n * m_wavelength_ids.size() + w];
+    m_partitions[m_partition_of_net[n]].queue[{t.value(), n, w}] += field - last;
+    last = field;
+}
+
+void ParallelEngine::observe(const sc_interface *itf)
+{
+    auto it = m_net_index.find(itf);
+    if (it == m_net_index.end())
+    {
+        cerr << "Error: observing a net unknown to the parallel engine" << endl;
+        exit(1);
+    }
+    m_observed[it->second] = true;
+}
+
+void ParallelEngine::advance(Partition &p, const uint32_t &index)
+{
+    const size_t n_nets = m_nets.size();
+    const size_t n_wavelengths = m_wavelength_ids.size();
+
+    // Changes received from the other partitions
+    for (const auto &m : p.inbox)
+        p.queue[{m.t, m.net, m.wavelength}] += m.delta;
+    p.inbox.clear();
+
+    while (!p.queue.empty())
+    {
+        auto it = p.queue.begin();
+        const auto [t, n, w] = it->first;
+        if (t >= m_window_end)
+            break;
+        const field_type delta = it->second;
+        p.queue.erase(it);
+        ++p.n_events;
+
+        auto &field = m_fields[n * n_wavelengths + w];
+        field += delta;
+        if (m_observed[n])
+            m_samples[n].push_back({t, m_wavelength_ids[w], field});
+        if (delta == field_type(0))
+            continue;
+
+        for (const auto &e : m_edges[w * n_nets + n])
+        {
+            const field_type d = e.S * delta;
+            if (m_partition_of_net[e.to] == index)
+                p.queue[{t + e.delay, e.to, w}] += d;
+            else
+            {
+                p.outbox.push_back({t + e.delay, e.to, w, d, index});
+                ++p.n_messages;
+            }
+        }
+    }
+}
+
+void ParallelEngine::next_window()
+{
+    // Deliver the changes sent during the window, by source partition
+    uint64_t t = UINT64_MAX;
+    for (auto &p : m_partitions)
+    {
+        for (const auto &m : p.outbox)
+        {
+            m_partitions[m_partition_of_net[m.net]].inbox.push_back(m);
+            t = min(t, m.t);
+        }
+        p.outbox.clear();
+        if (!p.queue.empty())
+            t = min(t, get<0>(p.queue.begin()->first));
+    }
+
+    if (t == UINT64_MAX || t > m_until)
+    {
+        m_done = true;
+        return;
+    }
+    ++m_n_windows;
+    m_window_start = t;
+    m_window_end = (m_until - t < m_lookahead) ? m_until + 1 : t + m_lookahead;
+}
+
+void ParallelEngine::run(const sc_time &until, size_t n_threads)
+{
+    m_until = until.value();
+    m_n_threads = max<size_t>(1, min(n_threads, m_partitions.size()));
+
+    // Partitions are assigned to threads once, largest first, to the thread
+    // with the fewest edges
+    vector<uint32_t> order(m_partitions.size());
+    iota(order.begin(), order.end(), 0);
+    stable_sort(order.begin(), order.end(), [this](uint32_t a, uint32_t b) {
+        return m_partitions[a].n_edges > m_partitions[b].n_edges;
+    });
+    vector<vector<uint32_t>> assigned(m_n_threads);
+    vector<size_t> load(m_n_threads, 0);
+    for (auto i : order)
+    {
+        const size_t k = min_element(load.begin(), load.end()) - load.begin();
+        assigned[k].push_back(i);
+        load[k] += m_partitions[i].n_edges + 1;
+    }
+
+    m_done = false;
+    next_window();
+
+    Barrier barrier(m_n_threads);
+    auto worker = [&](size_t k) {
+        while (!m_done)
+        {
+            for (auto i : assigned[k])
+                advance(m_partitions[i], i);
+            barrier.wait([this] { next_window(); });
+        }
+    };
+
+    vector<thread> threads;
+    for (size_t k = 1; k < m_n_threads; ++k)
+        threads.emplace_back(worker, k);
+    worker(0);
+    for (auto &th : threads)
+        th.join();
+}
+
+const vector<ParallelEngine::Sample> &ParallelEngine::samples(const sc_interface *itf) const
+{
+    static const vector<Sample> none;
+    auto it = m_net_index.find(itf);
+    if (it == m_net_index.end())
+        return none;
+    return m_samples[it->second];
+}
+
+ParallelEngine::field_type ParallelEngine::field(const sc_interface *itf, const uint32_t &wavelength_id) const
+{
+    auto it = m_net_index.find(itf);
+    auto wit = m_wavelength_index.find(wavelength_id);
+    if (it == m_net_index.end() || wit == m_wavelength_index.end())
+        return 0;
+    return m_fields[it->second * m_wavelength_ids.size() + wit->second];
+}
+
+uint64_t ParallelEngine::event_count() const
+{
+    uint64_t n = 0;
+    for (const auto &p : m_partitions)
+        n += p.n_events;
+    return n;
+}
+
+void ParallelEngine::print(std::ostream &os) const
+{
+    uint64_t n_messages = 0;
+    for (const auto &p : m_partitions)
+        n_messages += p.n_messages;
+
+    os << "Parallel engine (windows of the lookahead):" << endl;
+    os << "- nets: " << m_nets.size() << ", wavelengths: " << m_wavelength_ids.size() << endl;
+    os << "- partitions: " << m_partitions.size() << endl;
+    os << "- threads: " << m_n_threads << endl;
+    if (m_lookahead == UINT64_MAX)
+        os << "- lookahead: none (no cut waveguide)" << endl;
+    else
+        os << "- lookahead: " << lookahead() << endl;
+    os << "- windows: " << m_n_windows << endl;
+    os << "- events: " << event_count() << " (" << n_messages << " between partitions)" << endl;
+}
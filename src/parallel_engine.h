@@ -0,0 +1,153 @@
+#pragma once
+
+#include <systemc.h>
+
+#include <complex>
+#include <cstdint>
+#include <map>
+#include <ostream>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+
+#include "netlist_partition.h"
+#include "optical_signal.h"
+
+using std::vector;
+using std::size_t;
+
+/** Conservative parallel time-domain engine for linear optical netlists.
+ *
+ * The netlist is cut into partitions at waveguide delays (see
+ * NetlistPartition). Each partition has its own event queue and is advanced
+ * by one of the worker threads. All partitions are synchronised at the end
+ * of windows as long as the lookahead (the smallest delay from one
+ * partition to another): an event sent to another partition during a
+ * window can't be due before the next one. Events are exchanged between
+ * windows, in the order of their source partition and of their emission,
+ * so that results are bit-identical whatever the number of threads.
+ *
+ * Devices are described by their scattering stamps, which carry the delay
+ * of each path (see ScatteringStamp). An event is a change of the field of
+ * a net at one wavelength, and propagates as `S * delta` to the nets it
+ * drives, after the delay of the entry. The engine is therefore restricted
+ * to linear devices: time-variant ones (e.g. phase shifters) are stamped in
+ * their current state, and sources are replaced by the fields set with
+ * inject(). Devices with no optical output (probes, detectors, power
+ * meters) are ignored: observe() records the fields of nets instead.
+ *
+ * The engine doesn't use the SystemC kernel, only the elaborated netlist:
+ * build() must be called once elaboration is complete.
+ */
+class ParallelEngine {
+public:
+    typedef OpticalSignal::field_type field_type;
+
+    /** New field of an observed net at one wavelength */
+    struct Sample {
+        uint64_t t; // in units of the time resolution of the kernel
+        uint32_t wavelength_id;
+        field_type field;
+    };
+
+private:
+    struct Edge {
+        uint32_t to;
+        uint64_t delay;
+        field_type S;
+    };
+
+    // Change of the field of a net, sent by partition `from`
+    struct Message {
+        uint64_t t;
+        uint32_t net;
+        uint32_t wavelength;
+        field_type delta;
+        uint32_t from;
+    };
+
+    // Pending changes, by (time, net, wavelength index)
+    typedef std::map<std::tuple<uint64_t, uint32_t, uint32_t>, field_type> queue_type;
+
+    struct Partition {
+        queue_type queue;
+        vector<Message> outbox; // sent during the current window
+        vector<Message> inbox; // received for the next windows
+        uint64_t n_events = 0;
+        uint64_t n_messages = 0;
+        size_t n_edges = 0;
+    };
+
+    NetlistPartition m_netlist_partition;
+
+    // Nets and wavelengths of the engine
+    std::unordered_map<const sc_interface *, uint32_t> m_net_index;
+    vector<const sc_interface *> m_nets;
+    vector<uint32_t> m_wavelength_ids;
+    std::unordered_map<uint32_t, uint32_t> m_wavelength_index;
+
+    // Edges from net n at wavelength w, at index w * m_nets.size() + n
+    vector<vector<Edge>> m_edges;
+
+    vector<uint32_t> m_partition_of_net;
+    vector<Partition> m_partitions;
+    uint64_t m_lookahead = 0;
+
+    // Current field of each net, at index net * m_wavelength_ids.size() + w
+    vector<field_type> m_fields;
+    vector<field_type> m_injected;
+
+    vector<uint8_t> m_observed;
+    vector<vector<Sample>> m_samples; // by net
+
+    // Current window [m_window_start, m_window_end)
+    uint64_t m_window_start = 0;
+    uint64_t m_window_end = 0;
+    uint64_t m_until = 0;
+    bool m_done = false;
+    uint64_t m_n_windows = 0;
+    size_t m_n_threads = 0;
+
+    uint32_t net(const sc_interface *itf);
+    void advance(Partition &p, const uint32_t &index);
+    void next_window();
+
+public:
+    ParallelEngine() {}
+
+    /** Collect the stamps of all the devices at the given wavelengths.
+     *
+     * Returns false (after printing why) if a device can't be simulated by
+     * the engine, or if no window can be found.
+     */
+    bool build(const vector<uint32_t> &wavelength_ids);
+
+    /** Set the field of a net which no device writes to, from time t on.
+     *
+     * Fields must be injected in chronological order for each net.
+     */
+    void inject(const sc_interface *net, const sc_time &t, const uint32_t &wavelength_id,
+            const field_type &field);
+
+    /** Record the changes of the field of a net */
+    void observe(const sc_interface *net);
+
+    /** Process all the events up to time until (included), with n_threads
+     * worker threads.
+     */
+    void run(const sc_time &until, size_t n_threads);
+
+    /** Changes of an observed net, in chronological order */
+    const vector<Sample> &samples(const sc_interface *net) const;
+
+    /** Current field of a net at one wavelength */
+    field_type field(const sc_interface *net, const uint32_t &wavelength_id) const;
+
+    inline size_t partition_count() const { return m_partitions.size(); }
+    inline sc_time lookahead() const { return sc_time::from_value(m_lookahead); }
+
+    /** Events processed so far */
+    uint64_t event_count() const;
+
+    void print(std::ostream &os) const;
+};
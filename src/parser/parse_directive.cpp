@@ -37,6 +37,77 @@ void OPTIONSDirective::create() const
             specsGlobalConfig.default_resolution_multiplier = p.second.as_double();
         else if (kw == "TRACEALL")
             specsGlobalConfig.trace_all_optical_nets = p.second.as_double();
+        else if (kw == "SCHEDULER")
+        {
+            string val = p.second.as_string();
+            strutils::toupper(val);
+            if (val == "WHEEL" || val == "TIMING_WHEEL")
+                specsGlobalConfig.event_scheduler = SPECSConfig::TIMING_WHEEL;
+            else if (val == "QUEUE" || val == "PORT_QUEUES" || val == "HEAP")
+                specsGlobalConfig.event_scheduler = SPECSConfig::PORT_QUEUES;
+            else {
+                cerr << "Unknown scheduler: " << p.second.get_str() << endl;
+                exit(1);
+            }
+        }
+        else if (kw == "WLTOL" || kw == "WAVELENGTH_TOLERANCE")
+            OpticalSignal::wavelength_registry.set_tolerance(p.second.as_double());
+        else if (kw == "SOLVER")
+        {
+            string val = p.second.as_string();
+            strutils::toupper(val);
+            if (val == "LU" || val == "SPARSE_LU")
+                specsGlobalConfig.steady_state_solver = SPECSConfig::SPARSE_LU;
+            else if (val == "EVENTS" || val == "EVENT_PROPAGATION")
+                specsGlobalConfig.steady_state_solver = SPECSConfig::EVENT_PROPAGATION;
+            else {
+                cerr << "Unknown solver: " << p.second.get_str() << endl;
+                exit(1);
+            }
+        }
+        else if (kw == "PARTITION" || kw == "PARTITION_REPORT")
+            specsGlobalConfig.partition_report = p.second.as_boolean();
+        else if (kw == "COMPRESS" || kw == "COMPRESS_LINEAR")
+            specsGlobalConfig.compress_linear = p.second.as_boolean();
+        else if (kw == "LOOPS" || kw == "LOOP_REPORT")
+            specsGlobalConfig.loop_report = p.second.as_boolean();
+        else if (kw == "LOOP_ACCEL")
+            specsGlobalConfig.loop_accel = p.second.as_boolean();
+        else if (kw == "ANALYTIC_DETECTORS")
+            specsGlobalConfig.analytic_detectors = p.second.as_boolean();
+        else if (kw == "TRACE_FORMAT")
+        {
+            string val = p.second.as_string();
+            strutils::toupper(val);
+            if (val == "VCD")
+                specsGlobalConfig.trace_format = SPECSConfig::VCD_TRACE;
+            else if (val == "BINARY" || val == "SPTR")
+                specsGlobalConfig.trace_format = SPECSConfig::BINARY_TRACE;
+            else {
+                cerr << "Unknown trace format: " << p.second.get_str() << endl;
+                exit(1);
+            }
+        }
+        else if (kw == "TRACE_BUFFER")
+        {
+            int n = p.second.as_integer();
+            if (n <= 0)
+            {
+                cerr << "Invalid trace buffer size: " << p.second.get_str() << endl;
+                exit(1);
+            }
+            specsGlobalConfig.trace_buffer = n;
+        }
+        else if (kw == "SEED" || kw == "NOISE_SEED")
+        {
+            int seed = p.second.as_integer();
+            if (seed < 0)
+            {
+                cerr << "Invalid seed: " << p.second.get_str() << endl;
+                exit(1);
+            }
+            specsGlobalConfig.noise_seed = seed;
+        }
         else if (kw == "TEST_VARIABLE")
             cout << kw << "(" << p.second.kind() << "): " << p.second.get_str() << endl;
         else {
@@ -62,6 +133,39 @@ void NODESETDirective::print() const
     cout << "}" << endl;
 }
 
+void SAVEDirective::create() const
+{
+    if (args.empty())
+    {
+        cerr << ".SAVE expects at least one pattern" << endl;
+        exit(1);
+    }
+
+    TraceDeadband deadband;
+    for (auto &p: kwargs)
+    {
+        string kw = p.first;
+        strutils::toupper(kw);
+        if (kw == "DPOWER" || kw == "DPOWER_ABS")
+            deadband.abs_power = p.second.as_double();
+        else if (kw == "DPOWER_REL" || kw == "DREL")
+            deadband.rel_power = p.second.as_double();
+        else if (kw == "DPHASE")
+            deadband.phase = p.second.as_double();
+        else {
+            cerr << "Unknown keyword: " << p.first;
+            cerr << " (value: " << p.second.get_str() << " (" << p.second.kind() << "))" <<endl;
+            exit(1);
+        }
+    }
+
+    for (const auto &arg: args)
+    {
+        specsGlobalConfig.save_rules.emplace_back(arg.as_string());
+        specsGlobalConfig.save_rules.back().deadband = deadband;
+    }
+}
+
 void NODESETDirective::create() const
 {
     cerr << "NODESET is disabled pending bugfixes" << endl;
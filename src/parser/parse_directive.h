@@ -33,6 +33,18 @@ struct OPTIONSDirective : public ParseDirective {
     { return "OPTIONS"; }
 };
 
+/* SAVE: only trace the nets matching patterns (globs, or regex with re:) */
+struct SAVEDirective : public ParseDirective {
+    /* Import constructor from ParseDirective */
+    using ParseDirective::ParseDirective;
+
+    virtual ParseDirective* clone() const
+    { return new SAVEDirective(*this); }
+    virtual void create() const;
+    virtual string kind() const
+    { return "SAVE"; }
+};
+
 /* NODESET: specify initial guesses  */
 struct NODESETDirective : public ParseDirective {
     typedef string net_name;
@@ -1176,6 +1176,76 @@ sc_module *PowerMeterElement::create(ParseTreeCreationHelper &pt_helper) const
 }
 
 
+/** ******************************************* **/
+/**        Touchstone S-parameters              **/
+/** ******************************************* **/
+string TouchstoneElement::filename() const
+{
+    for (auto &p: kwargs)
+    {
+        string kw = p.first;
+        strutils::toupper(kw);
+        if (kw == "FILE")
+            return p.second.as_string();
+    }
+    cerr << name << ": missing keyword FILE" << endl;
+    exit(1);
+}
+
+INSTANTIATE_AND_CONNECT_UNI(TouchstoneElement, pt_helper)
+{
+    // S-parameters include reflections, so all ports read and write
+    return instantiate_and_connect_bi(pt_helper);
+}
+
+INSTANTIATE_AND_CONNECT_BI(TouchstoneElement, pt_helper)
+{
+    element_type_base *obj = new element_type_base(name.c_str(), filename());
+
+    if (obj->nports != nets.size())
+    {
+        cerr << name << ": " << filename() << " describes " << obj->nports
+             << " ports but " << nets.size() << " nets were given" << endl;
+        exit(1);
+    }
+
+    // All nets are bidirectional
+    for (const auto &net : nets)
+        pt_helper.upgrade_signal(net);
+
+    // connect ports
+    for (size_t i = 0; i < nets.size(); ++i)
+        pt_helper.connect_bi<spx::oa_signal_type>(*obj->ports_in[i], *obj->ports_out[i], nets[i]);
+
+    return obj;
+}
+
+sc_module *TouchstoneElement::create(ParseTreeCreationHelper &pt_helper) const
+{
+    element_type_base *obj = nullptr;
+
+    // Create signals if they don't exist
+    pt_helper.create_signals(this);
+
+    // Create the object and connect ports to signals
+    obj = instantiate_and_connect_bi(pt_helper);
+
+    // Parse keyword arguments
+    for (auto &p: kwargs)
+    {
+        string kw = p.first;
+        strutils::toupper(kw);
+        if (kw == "FILE")
+            continue;
+        else {
+            cerr << name << ": unknown keyword: " << p.first << endl;
+            exit(1);
+        }
+    }
+
+    return obj;
+}
+
 /** ******************************************* **/
 /**              Phase-change cell              **/
 /** ******************************************* **/
@@ -1299,6 +1369,8 @@ sc_module *PhotodetectorElement::create(ParseTreeCreationHelper &pt_helper) cons
             obj->m_noiseBypass = p.second.as_boolean();
         else if (kw == "FREQUENCY" || kw == "FOP")
             obj->m_opFreq_Hz = p.second.as_double();            
+        else if (kw == "ANALYTIC")
+            obj->m_analytic = p.second.as_boolean();
         else {
             cerr << "Unknown keyword: " << p.first << endl;
             exit(1);
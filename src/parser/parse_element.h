@@ -96,6 +96,26 @@ DECLARE_UNIDIR_ELEMENT(ProbeElement, "PROBE", Probe, 1);
 DECLARE_UNIDIR_ELEMENT(MLProbeElement, "MULTIWAVELENGTH PROBE", MLambdaProbe, 1);
 DECLARE_UNIDIR_ELEMENT(PowerMeterElement, "POWER METER", PowerMeter, 1);
 
+// Number of nets depends on the file, so it doesn't use the macros
+struct TouchstoneElement : public ParseElement {
+    typedef TouchstoneDevice element_type_base;
+
+    using ParseElement::ParseElement;
+
+    virtual ParseElement *clone() const
+    { return new TouchstoneElement(*this); }
+    virtual sc_module *create(ParseTreeCreationHelper &pt_helper) const;
+    virtual element_type_base *
+    instantiate_and_connect_uni(ParseTreeCreationHelper &pt_helper) const;
+    virtual element_type_base *
+    instantiate_and_connect_bi(ParseTreeCreationHelper &pt_helper) const;
+
+    virtual string kind() const { return "TOUCHSTONE S-PARAMETERS (bidir)"; }
+    virtual bool bidir_capable() const { return true; }
+
+    string filename() const;
+};
+
 // TODO: take care of subcircuit instance...
 DECLARE_UNIDIR_ELEMENT(XElement, "SUBCIRCUIT", SubcircuitInstance, 1);
 
@@ -61,30 +61,58 @@ string ParseNet::name_from_id(int id)
     return ss.str();
 }
 
+void ParseTreeCreationHelper::resetParseTree(ParseTree *parse_tree)
+{
+    pt = parse_tree;
+    nets = &parse_tree->nets;
+    elements_backlog.clear();
+    circuit_signals.clear();
+    circuit_modules.clear();
+
+    // Index the elements connected to each net
+    net_elements.clear();
+    element_index.clear();
+    element_done.assign(pt->elements.size(), false);
+    for (size_t i = 0; i < pt->elements.size(); ++i)
+    {
+        const auto elem = pt->elements[i];
+        element_index.emplace(elem, i);
+        for (const auto &net : elem->nets)
+        {
+            auto &adjacent = net_elements[net].elements;
+            // an element may be connected several times to the same net
+            if (adjacent.empty() || adjacent.back() != i)
+                adjacent.push_back(i);
+        }
+    }
+
+    bidir_net_cursor = pt->nets.begin();
+    net_cursor = pt->nets.begin();
+}
+
 // return next bidir net which doesn't have a corresponding signal in circuit_signals
 map<string, ParseNet>::iterator ParseTreeCreationHelper::next_fresh_bidir_net()
 {
-    for (auto it = pt->nets.begin(); it != pt->nets.end(); ++it)
+    // Nets skipped here never come back: a net only becomes bidirectional
+    // when an element connected to it is created, which creates its signal
+    for (; bidir_net_cursor != pt->nets.end(); ++bidir_net_cursor)
     {
-        const auto &net = *it;
+        const auto &net = *bidir_net_cursor;
 
         // check if net is bidirectional
         if (!net.second.bidirectional())
             continue;
 
         // check if net has a corresponding signal instanciated
-        auto it_sig = find_if(circuit_signals.cbegin(), circuit_signals.cend(), [&it](const auto &p)
-        { return p.first == it->first; }
-        );
-        if (it_sig != circuit_signals.cend())
+        if (circuit_signals.count(net.first))
             continue;
 
         // check if net is unbound
-        auto it_elem = next_fresh_element_bound_to(it->first);
-        if (it_elem == pt->elements.cend())
+        auto it_elem = next_fresh_element_bound_to(net.first);
+        if (it_elem == pt->elements.end())
             continue;
 
-        return it;
+        return bidir_net_cursor;
     }
     return pt->nets.end();
 }
@@ -92,54 +120,43 @@ map<string, ParseNet>::iterator ParseTreeCreationHelper::next_fresh_bidir_net()
 // return next bidir net which doesn't have a corresponding signal in circuit_signals
 map<string, ParseNet>::iterator ParseTreeCreationHelper::next_fresh_net()
 {
-    for (auto it = pt->nets.begin(); it != pt->nets.end(); ++it)
+    for (; net_cursor != pt->nets.end(); ++net_cursor)
     {
         // check if net has a corresponding signal
-        auto it_sig = find_if(circuit_signals.cbegin(), circuit_signals.cend(), [&it](const auto &p)
-        { return p.first == it->first; }
-        );
-        if (it_sig != circuit_signals.cend())
+        if (circuit_signals.count(net_cursor->first))
             continue;
 
         // check if net is unbound
-        auto it_elem = next_fresh_element_bound_to(it->first);
-        if (it_elem == pt->elements.cend())
+        auto it_elem = next_fresh_element_bound_to(net_cursor->first);
+        if (it_elem == pt->elements.end())
             continue;
 
-        return it;
+        return net_cursor;
     }
     return pt->nets.end();
 }
 
 // return next element which is connected to "net_name" and doesnt have a corresponding
 // module in circuit_modules and isn't already in the backlog
-vector<ParseElement *>::iterator ParseTreeCreationHelper::next_fresh_element_bound_to(const string &net_name, const set<const ParseElement *> &excludes)
+vector<ParseElement *>::iterator ParseTreeCreationHelper::next_fresh_element_bound_to(const string &net_name, const ParseElement *exclude)
 {
-    // Loop over elements
-    for (auto it = pt->elements.begin(); it != pt->elements.end(); ++it)
-    {
-        const auto &elem = *it;
+    auto it_adj = net_elements.find(net_name);
+    if (it_adj == net_elements.end())
+        return pt->elements.end();
+    auto &adjacent = it_adj->second;
 
-        // Check if element is part of exlude set
-        if (excludes.find(elem) != excludes.cend())
-            continue;
-
-        // Check if element is part of backlog set
-        if (elements_backlog.find(elem) != elements_backlog.cend())
-            continue;
+    // Skip the elements which were created or added to the backlog since
+    // the last search
+    while (adjacent.first_fresh < adjacent.elements.size()
+            && element_done[adjacent.elements[adjacent.first_fresh]])
+        ++adjacent.first_fresh;
 
-        // Check if net_name is in element nets
-        if (find(elem->nets.cbegin(), elem->nets.cend(), net_name) == elem->nets.cend())
+    for (size_t k = adjacent.first_fresh; k < adjacent.elements.size(); ++k)
+    {
+        const size_t i = adjacent.elements[k];
+        if (element_done[i] || pt->elements[i] == exclude)
             continue;
-
-        // Check if element has a corresponding module instantiated
-        auto it_mod = find_if(circuit_modules.cbegin(), circuit_modules.cend(), [&it](const auto &p)
-        { return p.first == (*it)->name; }
-        );
-
-        // if not, return current iterator `it`
-        if (it_mod == circuit_modules.cend())
-            return it;
+        return pt->elements.begin() + i;
     }
     return pt->elements.end();
 }
@@ -147,7 +164,7 @@ vector<ParseElement *>::iterator ParseTreeCreationHelper::next_fresh_element_bou
 void ParseTreeCreationHelper::create_signals(const ParseElement *elem)
 {
     // element should be in the parsetree
-    assert(find(pt->elements.begin(), pt->elements.end(), elem) != pt->elements.end());
+    assert(element_index.count(elem));
 
     // for all nets connected to elements
     for (const auto &net : elem->nets)
@@ -164,16 +181,61 @@ void ParseTreeCreationHelper::create_signals(const ParseElement *elem)
 
             // find all elements connected to net and add them to the elements backlog
             // FIXME: potential bug here if an element can have both bidir and unidir nets
-            auto it = next_fresh_element_bound_to(net, {elem});
+            auto it = next_fresh_element_bound_to(net, elem);
             while (it != pt->elements.end())
             {
-                elements_backlog.insert(*it);
-                it = next_fresh_element_bound_to(net, {elem});
+                const size_t i = it - pt->elements.begin();
+                elements_backlog.insert(i);
+                element_done[i] = true;
+                it = next_fresh_element_bound_to(net, elem);
             }
         }
     }
 }
 
+void ParseTreeCreationHelper::create_module(size_t i_elem, const char *reason)
+{
+    const auto elem = pt->elements[i_elem];
+    element_done[i_elem] = true;
+
+    if (specsGlobalConfig.verbose_component_initialization)
+        cout << "Creating " << elem->name << " (reason: " << reason << ")" << endl;
+    auto mod = elem->create(*this);
+    if (specsGlobalConfig.verbose_component_initialization)
+        cout << "Done creating " << elem->name << endl;
+
+    if (mod->name() != elem->name)
+    {
+        cerr << "Error: a module with name '" << elem->name << "' already exists or";
+        cerr << " it was renamed due to a bad naming." << endl;
+        cerr << "Make sure there is no naming conflict in the netlist" << endl;
+        exit(1);
+    }
+    circuit_modules.emplace(mod->name(), mod);
+}
+
+void ParseTreeCreationHelper::create_modules_bound_to(const string &net_name, const string &direction)
+{
+    const string reason = "connection to " + direction + " net";
+    const string backlog_reason = direction + " backlog";
+
+    // Find elements which are connected
+    auto elem = next_fresh_element_bound_to(net_name);
+    while (elem != pt->elements.end())
+    {
+        create_module(elem - pt->elements.begin(), reason.c_str());
+
+        // Process backlog elements (elements that were connected to the nets)
+        while ( !elements_backlog.empty() )
+        {
+            const size_t i = *elements_backlog.begin();
+            create_module(i, backlog_reason.c_str());
+            elements_backlog.erase(i);
+        }
+        elem = next_fresh_element_bound_to(net_name);
+    }
+}
+
 void ParseTreeCreationHelper::upgrade_signal(const string &net_name)
 {
     // Upgrade even if: net.bidirectional() is false
@@ -242,7 +304,8 @@ void ParseTreeCreationHelper::upgrade_signal(const string &net_name)
             circuit_signals[net_name].clear(); // will delete the net through the destructor
             circuit_signals[net_name] = pt->nets.at(net_name).create(net_name);
         }
-        cout << "\t" << circuit_signals[net_name][0]->name() << "," << circuit_signals[net_name][1]->name() << endl;
+        if (specsGlobalConfig.verbose_component_initialization)
+            cout << "\t" << circuit_signals[net_name][0]->name() << "," << circuit_signals[net_name][1]->name() << endl;
     }
 }
 
@@ -694,56 +757,21 @@ void ParseTree::build_circuit()
 
     auto pt_helper = ParseTreeCreationHelper(this);
 
-    auto &elements_backlog = pt_helper.elements_backlog;
     auto &circuit_signals = pt_helper.circuit_signals;
     auto &circuit_modules = pt_helper.circuit_modules;
+    const bool verbose = specsGlobalConfig.verbose_component_initialization;
 
     // Find first bidirectional net in nets that is not in circuit_nets
     auto next_net = pt_helper.next_fresh_bidir_net();
     while(next_net != nets.end())
     {
-        cout << "Elaborating network of " << next_net->first << "..." << endl;
-
-        // Find elements which are connected
-        auto elem = pt_helper.next_fresh_element_bound_to(next_net->first);
-        while (elem != elements.end())
-        {
-            cout << "Creating " << (*elem)->name << " (reason: connection to bidir net)" << endl;
-            auto mod = (*elem)->create(pt_helper);
-            cout << "Done creating " << (*elem)->name << endl;
-            if (mod->name() != (*elem)->name)
-            {
-                cerr << "Error: a module with name '" << (*elem)->name << "' already exists or";
-                cerr << " it was renamed due to a bad naming." << endl;
-                cerr << "Make sure there is no naming conflict in the netlist" << endl;
-                exit(1);
-            }
-            circuit_modules.emplace(mod->name(), mod);
+        if (verbose)
+            cout << "Elaborating network of " << next_net->first << "..." << endl;
 
-            // Process backlog elements (elements that were connected to the nets)
-            while ( !elements_backlog.empty() )
-            {
-                auto it = elements_backlog.begin();
-                auto &backlog_elem = *it;
-                cout << "Creating - " << backlog_elem->name << " (reason: bidir backlog)" << endl;
-                auto mod = backlog_elem->create(pt_helper);
-                cout << "Done creating " << backlog_elem->name << endl;
-
-                if (mod->name() != (*it)->name)
-                {
-                    cerr << "Error: a module with name '" << (*it)->name << "' already exists or";
-                    cerr << " it was renamed due to a bad naming." << endl;
-                    cerr << "Make sure there is no naming conflict in the netlist" << endl;
-                    exit(1);
-                }
-
-                circuit_modules.emplace(mod->name(), mod);
-                elements_backlog.erase(*it);
-            }
-            elem = pt_helper.next_fresh_element_bound_to(next_net->first);
-        }
+        pt_helper.create_modules_bound_to(next_net->first, "bidir");
 
-        cout << "Done (elaborating network of " << next_net->first << ")" << endl;
+        if (verbose)
+            cout << "Done (elaborating network of " << next_net->first << ")" << endl;
 
         // At this point all elements connected to the bidirectional net have been created
         // move on to the next one
@@ -755,53 +783,21 @@ void ParseTree::build_circuit()
     next_net = pt_helper.next_fresh_net();
     while(next_net != nets.end())
     {
-        cout << "Elaborating network of " << next_net->first << "..." << endl;
+        if (verbose)
+            cout << "Elaborating network of " << next_net->first << "..." << endl;
 
-        // Find elements which are connected
-        auto elem = pt_helper.next_fresh_element_bound_to(next_net->first);
-        while (elem != elements.end())
-        {
-            cout << "Creating " << (*elem)->name << " (reason: connection to unidir net)" << endl;
-            auto mod = (*elem)->create(pt_helper);
-            cout << "Done creating " << (*elem)->name << endl;
-            if (mod->name() != (*elem)->name)
-            {
-                cerr << "Error: a module with name '" << (*elem)->name << "' already exists or";
-                cerr << " it was renamed due to a bad naming." << endl;
-                cerr << "Make sure there is no naming conflict in the netlist" << endl;
-                exit(1);
-            }
-            circuit_modules.emplace(mod->name(), mod);
-
-            // Process backlog elements (elements that were connected to the nets)
-            while ( !elements_backlog.empty() )
-            {
-                auto it = elements_backlog.begin();
-                auto &backlog_elem = *it;
-                cout << "Creating " << backlog_elem->name << " (reason: unidir backlog)" << endl;
-                auto mod = backlog_elem->create(pt_helper);
-                cout << "Done creating " << backlog_elem->name << endl;
-
-                if (mod->name() != (*it)->name)
-                {
-                    cerr << "Error: a module with name '" << (*it)->name << "' already exists or";
-                    cerr << " it was renamed due to a bad naming." << endl;
-                    cerr << "Make sure there is no naming conflict in the netlist" << endl;
-                    exit(1);
-                }
+        pt_helper.create_modules_bound_to(next_net->first, "unidir");
 
-                circuit_modules.emplace(mod->name(), mod);
-                elements_backlog.erase(*it);
-            }
-            elem = pt_helper.next_fresh_element_bound_to(next_net->first);
-        }
-
-        cout << "Done (elaborating network of " << next_net->first << ")" << endl;
+        if (verbose)
+            cout << "Done (elaborating network of " << next_net->first << ")" << endl;
 
         // At this point all elements connected to the bidirectional net have been created
         // move on to the next one
         next_net = pt_helper.next_fresh_net();
     }
+    cout << "Created " << circuit_modules.size() << " devices and "
+         << circuit_signals.size() << " nets" << endl;
+
     for (const auto &x : directives)
         x->create();
 
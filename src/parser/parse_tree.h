@@ -9,6 +9,8 @@
 #include <string>
 #include <vector>
 #include <map>
+#include <set>
+#include <unordered_map>
 #include <iostream>
 
 using std::pair;
@@ -16,6 +18,8 @@ using std::make_pair;
 using std::string;
 using std::vector;
 using std::map;
+using std::set;
+using std::unordered_map;
 using std::cout;
 using std::cerr;
 using std::endl;
@@ -745,13 +749,31 @@ struct ParseTreeCreationHelper {
     // backlog: elements to be created in priority
     map<string, ParseNet> *nets;
 
-    // backlog: elements to be created in priority
-    set<const ParseElement *> elements_backlog;
+    // backlog: elements to be created in priority (by index in pt->elements)
+    set<size_t> elements_backlog;
 
     // Circuit elements generated by build
     map<string, vector<shared_ptr<sc_object>>> circuit_signals;
     map<string, shared_ptr<sc_module>> circuit_modules;
 
+    // Adjacency index of the parse tree, built by resetParseTree(): the
+    // elements connected to each net (by index in pt->elements, in netlist
+    // order), and the position of the first one which may still be fresh.
+    // Elements never become fresh again, so the searches below resume
+    // where the previous ones stopped and elaboration is linear in the
+    // size of the netlist.
+    struct NetAdjacency {
+        vector<size_t> elements;
+        size_t first_fresh = 0;
+    };
+    unordered_map<string, NetAdjacency> net_elements;
+    unordered_map<const ParseElement *, size_t> element_index;
+    vector<bool> element_done; // created or in the backlog
+
+    // Position of next_fresh_bidir_net() and next_fresh_net() in pt->nets
+    map<string, ParseNet>::iterator bidir_net_cursor;
+    map<string, ParseNet>::iterator net_cursor;
+
     ParseTreeCreationHelper()
     : pt(nullptr)
     {}
@@ -761,14 +783,7 @@ struct ParseTreeCreationHelper {
         resetParseTree(parse_tree);
     }
 
-    void resetParseTree(ParseTree *parse_tree)
-    {
-        pt = parse_tree;
-        nets = &parse_tree->nets;
-        elements_backlog.clear();
-        circuit_signals.clear();
-        circuit_modules.clear();
-    }
+    void resetParseTree(ParseTree *parse_tree);
 
     // return next bidir net which doesn't have a corresponding signal in circuit_signals
     map<string, ParseNet>::iterator next_fresh_bidir_net();
@@ -777,7 +792,14 @@ struct ParseTreeCreationHelper {
     map<string, ParseNet>::iterator next_fresh_net();
 
     // return next element which is connected to "net_name" and doesnt have a corresponding module in circuit_modules
-    vector<ParseElement *>::iterator next_fresh_element_bound_to(const string &net_name, const set<const ParseElement *> &excludes = {});
+    vector<ParseElement *>::iterator next_fresh_element_bound_to(const string &net_name, const ParseElement *exclude = nullptr);
+
+    // Create the module of an element and add it to circuit_modules
+    void create_module(size_t i_elem, const char *reason);
+
+    // Create the modules of the elements connected to a net, and those of
+    // the backlog (direction: "bidir" or "unidir", for messages)
+    void create_modules_bound_to(const string &net_name, const string &direction);
 
     // upgrade a signal to bidirectional
     void upgrade_signal(const string &name);
@@ -74,12 +74,12 @@ int yyerror(yyscan_t scanner, ParseTree *pt, const char *err);
 %token <s_ptr> T_ELEM_WG T_ELEM_COUPLER T_ELEM_MERGER T_ELEM_SPLITTER
 %token <s_ptr> T_ELEM_PSHIFT T_ELEM_MZI T_ELEM_CROSSING T_ELEM_PCMCELL
 %token <s_ptr> T_ELEM_PROBE T_ELEM_MLPROBE T_ELEM_PDET T_ELEM_PWR_METER
+%token <s_ptr> T_ELEM_SNP
 %token <s_ptr> T_ELEM_X
 %token <i_val> T_ANALYSIS_OP T_ANALYSIS_DC T_ANALYSIS_TRAN
-%token <i_val> T_DIRECTIVE_OPTIONS T_DIRECTIVE_NODESET
+%token <i_val> T_DIRECTIVE_OPTIONS T_DIRECTIVE_NODESET T_DIRECTIVE_SAVE
 %token <i_val> T_DIRECTIVE_SUBCKT
 %token <s_ptr> T_DIRECTIVE_ENDS
-%token <s_ptr> T_DIRECTIVE_SAVE
 %token <i_val> T_LOCAL_ASSIGNMENT
 %type <c_val> '='
 
@@ -100,6 +100,7 @@ int yyerror(yyscan_t scanner, ParseTree *pt, const char *err);
 %type <i_val> element.mlprobe
 %type <i_val> element.power_meter
 %type <i_val> element.pdet
+%type <i_val> element.snp
 %type <i_val> element.x
 
 // Available analysis
@@ -111,6 +112,7 @@ int yyerror(yyscan_t scanner, ParseTree *pt, const char *err);
 // Available directives
 %type <i_val> directive.options
 %type <i_val> directive.nodeset
+%type <i_val> directive.save
 
 // Rules for circuit nets (value is index in PT elements)
 %type <s_ptr> net_name.base.str
@@ -134,6 +136,7 @@ int yyerror(yyscan_t scanner, ParseTree *pt, const char *err);
 %type <i_val> atomelement element
 %type <i_val> element.with_args element.with_kwargs
 %type <i_val> element.x.with_args element.x.with_kwargs
+%type <i_val> element.snp.with_kwargs
 
 // Rules for circuit analysis (value is ptr to ParseAnalysis)
 %type <i_val> atomanalysis analysis
@@ -198,6 +201,9 @@ local_assignment: T_LOCAL_ASSIGNMENT assignment
 directive.options: T_DIRECTIVE_OPTIONS { $$ = cur_pt->register_directive(new OPTIONSDirective); }
 ;
 
+directive.save: T_DIRECTIVE_SAVE { $$ = cur_pt->register_directive(new SAVEDirective); }
+;
+
 directive.nodeset: T_DIRECTIVE_NODESET { $$ = cur_pt->register_directive(new NODESETDirective); }
                  | directive.nodeset netval_assignment
                     {
@@ -384,6 +390,21 @@ element.power_meter: T_ELEM_PWR_METER net.oa.in
             }
 ;
 
+element.snp: T_ELEM_SNP net.oa.bidir
+            {
+                $$ = cur_pt->register_element(new TouchstoneElement(*$1, {*$2}));
+                delete $1;
+                delete $2;
+            }
+           | element.snp net.oa.bidir
+            {
+                // The number of ports is only known from the file
+                cur_pt->elements[$1]->nets.push_back(*$2);
+                $$ = $1;
+                delete $2;
+            }
+;
+
 element.x: T_ELEM_X
             {
                 $$ = cur_pt->register_element(new XElement(*$1));
@@ -421,6 +442,7 @@ analysis.tran: T_ANALYSIS_TRAN
 
 atomdirective: directive.options { $$ = $1; }
              | directive.nodeset { $$ = $1; }
+             | directive.save { $$ = $1; }
 ;
 
 directive.with_args:
@@ -551,9 +573,20 @@ element.x.with_kwargs:
 | element.x.with_args
 ;
 
+element.snp.with_kwargs:
+  element.snp.with_kwargs assignment
+            {
+                cur_pt->elements[$1]->kwargs[$2->first] = $2->second;
+                $$ = $1;
+                delete $2;
+            }
+| element.snp { $$ = $1; }
+;
+
 element:
   element.with_kwargs
 | element.x.with_kwargs
+| element.snp.with_kwargs
 ;
 
 /* ---------- Analysis arguments parsing ----------- */
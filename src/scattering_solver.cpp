@@ -0,0 +1,168 @@
+#include "scattering_solver.h"
+#include "optical_output_port.h"
+#include "specs.h"
+#include "devices/spx_module.h"
+
+#include <algorithm>
+#include <set>
+
+using namespace std;
+
+size_t ScatteringSolver::net(const sc_interface *itf)
+{
+    auto it = m_net_index.find(itf);
+    if (it != m_net_index.end())
+        return it->second;
+    size_t i = m_nets.size();
+    m_nets.push_back(itf);
+    m_net_index.emplace(itf, i);
+    return i;
+}
+
+void ScatteringSolver::clear()
+{
+    m_net_index.clear();
+    m_nets.clear();
+    m_solutions.clear();
+    m_stamp.clear();
+    m_n_linear = 0;
+    m_n_fallback = 0;
+    m_nnz_factors = 0;
+}
+
+bool ScatteringSolver::solve(const vector<uint32_t> &wavelength_ids)
+{
+    clear();
+
+    // Composite modules with a steady-state model are stamped instead of
+    // the devices they are made of
+    const auto all_modules = sc_get_all_module_by_type<spx_module>();
+    vector<spx_module *> devices;
+    set<spx_module *> replaced;
+    for (auto mod : all_modules)
+    {
+        if (!mod->is_composite())
+            continue;
+        const auto subs = mod->steady_state_replaced_devices();
+        if (subs.empty())
+            continue;
+        devices.push_back(mod);
+        replaced.insert(subs.begin(), subs.end());
+    }
+    for (auto mod : all_modules)
+        if (!mod->is_composite() && !replaced.count(mod))
+            devices.push_back(mod);
+
+    bool first = true;
+    for (const auto &wlid : wavelength_ids)
+    {
+        // Collect the scattering parameters of all linear devices
+        m_stamp.clear();
+        for (auto mod : devices)
+        {
+            bool linear = !(mod->flags & spx_module::NON_LINEAR)
+                          && mod->stamp_scattering(m_stamp, wlid);
+            if (first)
+                ++(linear ? m_n_linear : m_n_fallback);
+        }
+        first = false;
+
+        // Unknowns are the nets driven by linear devices
+        for (const auto &e : m_stamp.m_entries)
+            net(e.to);
+        for (const auto &src : m_stamp.m_sources)
+            net(src.to);
+        const size_t n = m_nets.size();
+
+        // Assemble (I - S) in compressed sparse column form. Nets which are
+        // not solved (driven by other devices) are taken as zero.
+        vector<SparseLU<value_type>::index_type> colptr(n + 1, 0);
+        for (size_t j = 0; j < n; ++j)
+            ++colptr[j + 1]; // diagonal
+        for (const auto &e : m_stamp.m_entries)
+        {
+            if (!e.from || e.s == value_type(0))
+                continue;
+            auto it = m_net_index.find(e.from);
+            if (it != m_net_index.end())
+                ++colptr[it->second + 1];
+        }
+        for (size_t j = 0; j < n; ++j)
+            colptr[j + 1] += colptr[j];
+
+        vector<SparseLU<value_type>::index_type> rowind(colptr[n]);
+        vector<value_type> values(colptr[n]);
+        vector<SparseLU<value_type>::index_type> fill(colptr.begin(), colptr.end() - 1);
+        for (size_t j = 0; j < n; ++j)
+        {
+            rowind[fill[j]] = j;
+            values[fill[j]++] = 1.0;
+        }
+        for (const auto &e : m_stamp.m_entries)
+        {
+            if (!e.from || e.s == value_type(0))
+                continue;
+            auto it = m_net_index.find(e.from);
+            if (it == m_net_index.end())
+                continue;
+            const size_t j = it->second;
+            rowind[fill[j]] = m_net_index[e.to];
+            values[fill[j]++] = -e.s;
+        }
+
+        vector<value_type> b(n, 0);
+        for (const auto &src : m_stamp.m_sources)
+            b[m_net_index[src.to]] += src.b;
+
+        // Factorize and solve
+        m_lu.set_matrix(n, move(colptr), move(rowind), move(values));
+        if (!m_lu.factorize())
+        {
+            cerr << "Warning: singular scattering matrix at ";
+            cerr << OpticalSignal::getWavelength(wlid) << " m" << endl;
+            return false;
+        }
+        m_nnz_factors = max(m_nnz_factors, m_lu.nnz_factors());
+        m_lu.solve(b);
+        m_solutions[wlid] = move(b);
+    }
+    return true;
+}
+
+size_t ScatteringSolver::seed() const
+{
+    size_t n_seeded = 0;
+    vector<bool> done(m_nets.size(), false);
+
+    for (auto oop : sc_get_all_module_by_type<OpticalOutputPort>())
+    {
+        // Ports working with deltas (GenericTransmissionDevice) derive their
+        // output from the changes of their inputs and can't be seeded
+        if (oop->m_use_deltas)
+            continue;
+
+        auto it = m_net_index.find(oop->m_port.get_interface());
+        if (it == m_net_index.end() || done[it->second])
+            continue;
+        done[it->second] = true;
+
+        for (const auto &sol : m_solutions)
+        {
+            if (it->second >= sol.second.size())
+                continue;
+            uint32_t wlid = sol.first;
+            oop->delayedWrite(OpticalSignal(sol.second[it->second], wlid), SC_ZERO_TIME);
+        }
+        ++n_seeded;
+    }
+    return n_seeded;
+}
+
+void ScatteringSolver::print(std::ostream &os) const
+{
+    os << "Linear solver: " << m_nets.size() << " nets, ";
+    os << m_solutions.size() << " wavelength(s), ";
+    os << m_nnz_factors << " nonzeros in LU" << endl;
+    os << "- linear devices: " << m_n_linear << endl;
+    os << "- devices left to event propagation: " << m_n_fallback << endl;
+}
@@ -0,0 +1,135 @@
+#pragma once
+
+#include <systemc.h>
+
+#include <complex>
+#include <cstdint>
+#include <ostream>
+#include <unordered_map>
+#include <vector>
+
+#include "utils/sparse_lu.h"
+
+using std::vector;
+using std::complex;
+
+class OpticalOutputPort;
+
+/** Collects the scattering parameters of the devices at one wavelength.
+ *
+ * Devices describe their steady-state behaviour as a set of entries
+ * `a_to += S * a_from`, where `a_x` is the complex field on the optical net
+ * bound to port `x`, and sources as `a_to += b`. Entries also carry the
+ * delay after which a change of `a_from` reaches `a_to` (ignored by the
+ * steady-state solver, used to build macro-models, see NetlistCompression).
+ *
+ * @sa spx_module::stamp_scattering
+ */
+class ScatteringStamp {
+public:
+    typedef complex<double> value_type;
+
+    struct Entry {
+        const sc_interface *to;
+        const sc_interface *from;
+        value_type s;
+        sc_time delay;
+    };
+
+    struct Source {
+        const sc_interface *to;
+        value_type b;
+    };
+
+    vector<Entry> m_entries;
+    vector<Source> m_sources;
+
+    /** Add S from the net of input port `from` to the net of output port `to`
+     *
+     * The net of `to` is solved even if `from` is unbound or S is zero.
+     */
+    inline void add(sc_port_base &to, sc_port_base &from, const value_type &s,
+                    const sc_time &delay = SC_ZERO_TIME)
+    {
+        const sc_interface *to_itf = to.get_interface();
+        if (to_itf)
+            m_entries.push_back({to_itf, from.get_interface(), s, delay});
+    }
+
+    /** Add a constant field b to the net of output port `to` */
+    inline void add_source(sc_port_base &to, const value_type &b)
+    {
+        const sc_interface *to_itf = to.get_interface();
+        if (to_itf)
+            m_sources.push_back({to_itf, b});
+    }
+
+    inline void clear()
+    {
+        m_entries.clear();
+        m_sources.clear();
+    }
+};
+
+/** Direct steady-state solver for the OP and DC analyses.
+ *
+ * For each wavelength, the scattering parameters of all linear devices are
+ * assembled in a global sparse matrix S over the optical nets, and the
+ * steady-state fields are obtained by solving `(I - S) a = b` with a sparse
+ * LU factorization, where b holds the CW sources.
+ *
+ * Composite devices with an analytical steady-state model (see
+ * spx_module::use_steady_state_model) are stamped as a whole, in place of
+ * the devices they are made of.
+ *
+ * Time-variant devices (sources, phase shifters) are stamped in their
+ * current state, which is constant during an operating point. Devices
+ * which are flagged NON_LINEAR, or which don't implement
+ * stamp_scattering(), are left out of the system: the nets they
+ * drive are not solved and are taken as zero. The solution is then used to
+ * seed the output ports (see seed()), and the usual event propagation takes
+ * it from there: when every device is linear, the seeded values are already
+ * converged and propagation stops after one pass; otherwise, it only has to
+ * resolve the effect of the remaining devices.
+ */
+class ScatteringSolver {
+public:
+    typedef complex<double> value_type;
+
+private:
+    // Solved nets and their field at each solved wavelength
+    std::unordered_map<const sc_interface *, size_t> m_net_index;
+    vector<const sc_interface *> m_nets;
+    std::unordered_map<uint32_t, vector<value_type>> m_solutions;
+
+    SparseLU<value_type> m_lu;
+    ScatteringStamp m_stamp;
+
+    size_t m_n_linear = 0;
+    size_t m_n_fallback = 0;
+    size_t m_nnz_factors = 0;
+
+    size_t net(const sc_interface *itf);
+
+public:
+    ScatteringSolver() {}
+
+    /** Assemble and solve the system at all given wavelengths.
+     *
+     * Returns false if the system is singular at any wavelength (e.g. a
+     * lossless resonator exactly at resonance), in which case nothing
+     * should be seeded.
+     */
+    bool solve(const vector<uint32_t> &wavelength_ids);
+
+    /** Write the solution to the output ports driving the solved nets.
+     *
+     * Must be called with ports in NO_DELAY mode, before the simulation is
+     * resumed. Returns the number of seeded ports.
+     */
+    size_t seed() const;
+
+    void clear();
+
+    void print(std::ostream &os) const;
+};
@@ -13,6 +13,20 @@
 #include "devices/detector.h"
 #include "devices/power_meter.h"
 #include "devices/generic_transmission_device.h"
+#include "devices/waveguide.h"
+#include "devices/directional_coupler.h"
+#include "devices/phaseshifter.h"
+#include "optical_event_scheduler.h"
+#include "netlist_partition.h"
+#include "netlist_compression.h"
+#include "netlist_loops.h"
+#include "binary_trace.h"
+#include "memory_trace.h"
+#include "scattering_solver.h"
+#include "utils/strutils.h"
+
+#include <algorithm>
+#include <chrono>
 
 using std::string;
 
@@ -43,6 +57,8 @@ void SPECSConfig::runAnalysis()
     applyEngineResolution();
     prepareSimulation();
 
+    auto start = std::chrono::high_resolution_clock::now();
+
     switch (analysis_type) {
         case CW_OPERATING_POINT:
             runOPAnalysis();
@@ -57,6 +73,16 @@ void SPECSConfig::runAnalysis()
             cerr << "Undefined Analysis type";
             sc_stop();
     }
+
+    auto stop = std::chrono::high_resolution_clock::now();
+    printEventStats(std::chrono::duration<double>(stop - start).count());
+    if (netlist_loops)
+        netlist_loops->print_report(cout);
+
+    // Samples of analytic photodetectors since their last input change
+    for (auto pdet : sc_get_all_module_by_type<Detector>())
+        pdet->flush_readout();
+    closeTraceFiles();
 }
 
 void SPECSConfig::runOPAnalysis()
@@ -96,10 +122,18 @@ void SPECSConfig::runOPAnalysis()
         oop->m_mode = OpticalOutputPortMode::NO_DELAY;
     }
 
+    // Use closed-form models where devices have one (e.g. rings)
+    for (auto mod: sc_get_all_module_by_type<spx_module>()) {
+        mod->use_steady_state_model(true);
+    }
+
     // Activate all CW sources
     for (auto cws: all_cws)
         cws->enable = sc_logic(1);
 
+    // Solve linear devices directly
+    seedSteadyState();
+
     // Run operating point simulation
     sc_start();
 
@@ -141,13 +175,17 @@ void SPECSConfig::runDCAnalysis()
         oop->m_mode = OpticalOutputPortMode::NO_DELAY;
     }
 
+    // Use closed-form models where devices have one (e.g. rings)
+    for (auto mod: sc_get_all_module_by_type<spx_module>()) {
+        mod->use_steady_state_model(true);
+    }
+
     // Activate CW sources
     for (auto cws: all_cws) {
         cws->enable = sc_logic(1);
     }
 
     const auto &order = *cw_sweep_orders.begin();
-    wavelengths_vector.reserve(order.second.second.size());
     cout << "Starting sweep on " << order.first;
     cout << " (" << order.second.second.size() << " points)" << endl;
     for (const auto &val : order.second.second)
@@ -157,34 +195,270 @@ void SPECSConfig::runDCAnalysis()
 
         //cout << order.first << " = " << val << endl;
 
-        // Reset OOP and set internal signals to new wavelength
-        for (auto oop: all_oop) {
-            #if 1 // reset OOP
-            oop->reset();
-            // TODO: also reset photodetectors?
-            #elif 0 // remove previous wavelengths from OOP but keep value
-            if (wavelengths_vector.size() >= 2)
+        solveSteadyStatePoint(all_oop, all_cws);
+
+        //printOPAnalysisResult();
+    }
+}
+
+void SPECSConfig::solveSteadyStatePoint(const set<OpticalOutputPort *> &all_oop, const set<CWSource *> &all_cws)
+{
+    // Reset OOP and set internal signals to new wavelength
+    for (auto oop: all_oop) {
+        #if 1 // reset OOP
+        oop->reset();
+        // TODO: also reset photodetectors?
+        #elif 0 // remove previous wavelengths from OOP but keep value
+        const auto n_wavelengths = OpticalSignal::wavelength_registry.size();
+        if (n_wavelengths >= 2)
+        {
+            oop->swap_wavelengths(n_wavelengths-1, n_wavelengths-2);
+            oop->delete_wavelength(n_wavelengths-2);
+            oop->m_skip_next_convergence_check = true;
+        }
+        #else
+        // do nothing
+        #endif
+    }
+
+    // Macro-models write deltas to the ports which were just reset
+    if (netlist_compression)
+        for (const auto &model : netlist_compression->models())
+            model->reset();
+
+    // Solve linear devices directly
+    seedSteadyState();
+
+    // run simulation and advance one tick
+    sc_start(sc_time::from_value(1));
+
+    // Reset CW sources
+    for (auto cws: all_cws)
+    {
+        cws->reset.write(sc_logic(1));
+    }
+}
+
+bool SPECSConfig::setParameter(const string &name, const string &attribute, double value)
+{
+    string target = name;
+    string attr = attribute;
+    strutils::toupper(target);
+    strutils::toupper(attr);
+
+    // Devices replaced by a macro-model keep the parameters they were
+    // stamped with
+    auto retired = [this](const spx_module *mod) {
+        if (!netlist_compression)
+            return false;
+        for (const auto &model : netlist_compression->models())
+        {
+            const auto &mods = model->m_modules;
+            if (find(mods.begin(), mods.end(), mod) != mods.end())
+                return true;
+        }
+        return false;
+    };
+
+    // Value of an electrical net (e.g. driving phase shifters)
+    for (auto sig: sc_get_all_object_by_type<spx::ea_signal_type>())
+    {
+        if (sig->name() != name && sig->name() != target)
+            continue;
+        if (attr != "V")
+        {
+            cerr << "Unknown attribute for net " << name << ": " << attribute << endl;
+            return false;
+        }
+        for (auto mod: sc_get_all_module_by_type<spx_module>())
+        {
+            auto ps_uni = dynamic_cast<PhaseShifterUni *>(mod);
+            auto ps_bi = dynamic_cast<PhaseShifterBi *>(mod);
+            const sc_interface *itf = ps_uni ? ps_uni->p_vin.get_interface()
+                : ps_bi ? ps_bi->p_vin.get_interface() : nullptr;
+            if (itf == sig && retired(mod))
             {
-                oop->swap_wavelengths(wavelengths_vector.size()-1, wavelengths_vector.size()-2);
-                oop->delete_wavelength(wavelengths_vector.size()-2);
-                oop->m_skip_next_convergence_check = true;
+                cerr << "Net " << name << " drives " << mod->name();
+                cerr << ", which was compressed into a macro-model" << endl;
+                return false;
             }
-            #else
-            // do nothing
-            #endif
         }
+        sig->write(value);
+        return true;
+    }
 
-        // run simulation and advance one tick
-        sc_start(sc_time::from_value(1));
+    spx_module *elem = nullptr;
+    for (auto mod: sc_get_all_module_by_type<spx_module>())
+    {
+        if (mod->name() == name || mod->name() == target)
+        {
+            elem = mod;
+            break;
+        }
+    }
+    if (!elem)
+    {
+        cerr << "Element not found: " << name << endl;
+        return false;
+    }
+    if (retired(elem))
+    {
+        cerr << "Element " << name << " was compressed into a macro-model, ";
+        cerr << "its parameters can't be changed" << endl;
+        return false;
+    }
+
+    bool known = true;
+    if (auto cws = dynamic_cast<CWSource *>(elem))
+    {
+        if (attr == "WL" || attr == "WAVELENGTH" || attr == "LAMBDA")
+            cws->setWavelength(value);
+        else if (attr == "P" || attr == "POW" || attr == "POWER")
+            cws->setPower(value);
+        else if (attr == "F" || attr == "FREQ" || attr == "FREQUENCY")
+            cws->setFrequency(value);
+        else if (attr == "PHI")
+            cws->setPhase(value);
+        else
+            known = false;
+    }
+    else if (auto wg = dynamic_cast<WaveguideBase *>(elem))
+    {
+        if (attr == "L" || attr == "LENGTH")
+            wg->setLength(value * 100);
+        else if (attr == "NEFF")
+            wg->setNeff(value);
+        else if (attr == "NG")
+            wg->setNg(value);
+        else if (attr == "ATT")
+            wg->setAttenuation(value);
+        else if (attr == "D")
+            wg->setD(value);
+        else
+            known = false;
+    }
+    else if (auto dc = dynamic_cast<DirectionalCouplerBase *>(elem))
+    {
+        // Same conventions as the netlist
+        if (attr == "K" || attr == "KF" || attr == "KFIELD")
+            dc->m_dc_through_coupling_power = 1 - pow(value, 2);
+        else if (attr == "KP" || attr == "KPOW" || attr == "KPOWER")
+            dc->m_dc_through_coupling_power = 1 - value;
+        else if (attr == "T")
+            dc->m_dc_through_coupling_power = pow(value, 2);
+        else if (attr == "LOSS")
+            dc->m_dc_loss = value;
+        else
+            known = false;
+        dc->update_parameters();
+    }
+    else if (auto ps = dynamic_cast<PhaseShifterBase *>(elem))
+    {
+        if (attr == "ATTENUATION" || attr == "ATT")
+            ps->m_attenuation_dB = value;
+        else if (attr == "SENSITIVITY" || attr == "GAIN" || attr == "G")
+            ps->m_sensitivity = value;
+        else
+            known = false;
+        ps->update_parameters();
+    }
+    else
+        known = false;
+
+    if (!known)
+    {
+        cerr << "Unknown attribute for " << name << ": " << attribute << endl;
+        return false;
+    }
+    return true;
+}
+
+bool SPECSConfig::rerunSteadyState()
+{
+    if (analysis_type != CW_OPERATING_POINT && analysis_type != CW_SWEEP)
+    {
+        cerr << "Only OP and DC analyses can be run again" << endl;
+        return false;
+    }
+
+    auto all_probes = sc_get_all_module_by_type<Probe>();
+    auto all_mlprobes = sc_get_all_module_by_type<MLambdaProbe>();
+    auto all_photodetectors = sc_get_all_module_by_type<Detector>();
+    auto all_oop = sc_get_all_module_by_type<OpticalOutputPort>();
+    auto all_cws = sc_get_all_module_by_type<CWSource>();
+
+    // Same configuration as a DC analysis
+    for (auto probe: all_probes)
+        probe->enable = sc_logic(1);
+    for (auto mlprobe: all_mlprobes)
+        mlprobe->enable = sc_logic(0);
+    for (auto pdet: all_photodetectors)
+        pdet->enable = sc_logic(0);
+    for (auto oop: all_oop)
+        oop->m_mode = OpticalOutputPortMode::NO_DELAY;
+
+    // Also drops what closed-form models computed from the old parameters
+    for (auto mod: sc_get_all_module_by_type<spx_module>())
+        mod->use_steady_state_model(true);
+
+    // CW sources emit again at the next point (after an OP analysis, they
+    // still wait for their reset)
+    for (auto cws: all_cws)
+    {
+        cws->enable = sc_logic(1);
+        cws->reset.write(sc_logic(1));
+    }
 
-        // Reset CW sources
-        for (auto cws: all_cws)
+    // Nets start again from no value (as at the start of the simulation),
+    // so that probes record all the steady state, changed or not
+    auto all_sig = sc_get_all_object_by_type<sc_signal<OpticalSignal, SC_MANY_WRITERS>>();
+    auto solve = [&]() {
+        for (auto sig: all_sig)
+            sig->write(OpticalSignal());
+        solveSteadyStatePoint(all_oop, all_cws);
+    };
+
+    if (analysis_type == CW_SWEEP)
+    {
+        const auto &order = *cw_sweep_orders.begin();
+        for (const auto &val : order.second.second)
         {
-            cws->reset.write(sc_logic(1));
+            order.second.first(val);
+            solve();
         }
+    }
+    else
+        solve();
+    return true;
+}
 
-        //printOPAnalysisResult();
+void SPECSConfig::seedSteadyState()
+{
+    if (steady_state_solver != SPARSE_LU)
+        return;
+
+    // Wavelengths emitted by the CW sources
+    vector<uint32_t> wavelength_ids;
+    for (auto cws: sc_get_all_module_by_type<CWSource>())
+    {
+        const auto &s = cws->m_signal_on;
+        if (isnan(s.getWavelength()))
+            continue;
+        if (find(wavelength_ids.begin(), wavelength_ids.end(), s.m_wavelength_id) == wavelength_ids.end())
+            wavelength_ids.push_back(s.m_wavelength_id);
     }
+    if (wavelength_ids.empty())
+        return;
+
+    ScatteringSolver solver;
+    if (!solver.solve(wavelength_ids))
+    {
+        cerr << "Falling back to event propagation" << endl;
+        return;
+    }
+    solver.seed();
+    if (verbose_component_initialization)
+        solver.print(cout);
 }
 
 void SPECSConfig::runTRANAnalysis()
@@ -199,6 +473,12 @@ void SPECSConfig::runTRANAnalysis()
     // Run OP analysis
     runOPAnalysis();
 
+    // Back to the time-domain models of devices (the OP analysis switched
+    // them to their steady-state model)
+    const bool steady_state = simulation_mode == OpticalOutputPortMode::FREQUENCY_DOMAIN;
+    for (auto mod: sc_get_all_module_by_type<spx_module>())
+        mod->use_steady_state_model(steady_state);
+
     // Set values of signals according to IC directive
     for (auto &ic_order : ic_orders)
     {
@@ -247,6 +527,12 @@ void SPECSConfig::applyDefaultOpticalOutputPortConfig() {
     oop_default_config->m_abstol = default_abstol;
     oop_default_config->m_reltol = default_reltol;
     oop_default_config->m_timestep_value = default_resolution_multiplier; // relative to systemc timestep
+    if (event_scheduler == TIMING_WHEEL)
+    {
+        if (!shared_scheduler)
+            shared_scheduler = make_shared<OpticalEventScheduler>("SCHEDULER");
+        oop_default_config->m_scheduler = shared_scheduler;
+    }
 
     // apply default config to all optical output ports which don't have one
     auto all_oop = sc_get_all_module_by_type<OpticalOutputPort>();
@@ -258,12 +544,32 @@ void SPECSConfig::applyDefaultOpticalOutputPortConfig() {
 }
 
 void SPECSConfig::applyDefaultTraceFileToAllSignals() {
-    if (!default_trace_file)
+    if (!default_trace_file && !memory_trace)
         return;
 
+    // Probes write to the memory or binary trace if there is one
+    auto attach = [this](Probe *p) {
+        if (memory_trace)
+            p->setMemoryTrace(memory_trace.get());
+        else if (binary_trace)
+            p->setBinaryTrace(binary_trace.get());
+        else
+            p->setTraceFile(default_trace_file);
+    };
+
+    // First .SAVE rule matching a name (nullptr if none)
+    auto find_rule = [this](const string &name) -> const TraceRule * {
+        for (const auto &rule: save_rules)
+            if (rule.matches(name))
+                return &rule;
+        return nullptr;
+    };
+
     auto all_probes = sc_get_all_object_by_type<Probe>();
     for (auto p: all_probes) {
-        p->setTraceFile(default_trace_file);
+        if (auto rule = find_rule(p->name()))
+            p->m_deadband = rule->deadband;
+        attach(p);
     }
 
     // auto all_mlprobes = sc_get_all_object_by_type<MLambdaProbe>();
@@ -274,10 +580,63 @@ void SPECSConfig::applyDefaultTraceFileToAllSignals() {
 
     auto all_mlambda_probes = sc_get_all_object_by_type<MLambdaProbe>();
     for (auto p: all_mlambda_probes) {
-        p->setTraceFile(default_trace_file);
+        if (default_trace_file)
+            p->setTraceFile(default_trace_file);
     }
 
-    if (trace_all_optical_nets)
+    if (!save_rules.empty())
+    {
+        // Nets of the devices matching a rule (ports of composite devices
+        // are bound through to the nets of their elementary devices)
+        map<const sc_interface *, const TraceRule *> device_nets;
+        for (auto port: sc_get_all_object_by_type<sc_port_base>()) {
+            auto mod = dynamic_cast<sc_module *>(port->get_parent_object());
+            if (!mod || dynamic_cast<Probe *>(mod))
+                continue;
+            auto rule = find_rule(mod->name());
+            if (!rule)
+                continue;
+            if (auto pin = dynamic_cast<sc_port_b<spx::oa_if_in_type> *>(port)) {
+                for (int k = 0; k < pin->size(); ++k)
+                    device_nets.emplace(pin->get_interface(k), rule);
+            } else if (auto pout = dynamic_cast<sc_port_b<spx::oa_if_out_type> *>(port)) {
+                for (int k = 0; k < pout->size(); ++k)
+                    device_nets.emplace(pout->get_interface(k), rule);
+            }
+        }
+
+        size_t n_saved = 0;
+        auto all_optical_sigs = sc_get_all_object_by_type<spx::oa_signal_type>();
+        for (auto &sig: all_optical_sigs) {
+            string signame = sig->name();
+
+            // Bidirectional nets are made of two signals, net:0 and net:1
+            string netname = signame;
+            const auto colon = netname.rfind(':');
+            if (colon != string::npos && netname.find('/', colon) == string::npos)
+                netname.resize(colon);
+
+            const TraceRule *rule = find_rule(netname);
+            if (!rule && netname != signame)
+                rule = find_rule(signame);
+            if (!rule) {
+                auto it = device_nets.find(sig);
+                if (it != device_nets.end())
+                    rule = it->second;
+            }
+            if (!rule)
+                continue;
+
+            auto p = make_shared<Probe>(("PROBE{" + signame + "}").c_str(), true, true, true, true);
+            p->m_deadband = rule->deadband;
+            attach(p.get());
+            p->p_in(*sig);
+            additional_objects.push_back(p);
+            ++n_saved;
+        }
+        cout << "Saved " << n_saved << " of " << all_optical_sigs.size() << " optical nets" << endl;
+    }
+    else if (trace_all_optical_nets)
     {
         auto all_optical_sigs = sc_get_all_object_by_type<sc_signal<OpticalSignal, SC_MANY_WRITERS>>();
         for (auto &sig: all_optical_sigs) {
@@ -292,7 +651,7 @@ void SPECSConfig::applyDefaultTraceFileToAllSignals() {
             //cout << signame << endl;
 
             auto p = make_shared<Probe>(("PROBE{" + signame + "}").c_str(), true, true, true, true);
-            p->setTraceFile(default_trace_file);
+            attach(p.get());
             p->p_in(*sig);
             additional_objects.push_back(p);
         }
@@ -302,14 +661,20 @@ void SPECSConfig::applyDefaultTraceFileToAllSignals() {
     for (auto &pdet: all_pdets) {
         string detname = pdet->name();
         cout << detname << endl;
-        pdet->trace(default_trace_file);
+        if (memory_trace)
+            pdet->setMemoryTrace(memory_trace.get());
+        else
+            pdet->trace(default_trace_file);
     }
 
     auto all_pwr_meters = sc_get_all_object_by_type<PowerMeter>();
     for (auto &pwr_meter: all_pwr_meters) {
         string pwr_meter_name = pwr_meter->name();
         cout << pwr_meter_name << endl;
-        pwr_meter->trace(default_trace_file);
+        if (memory_trace)
+            pwr_meter->setMemoryTrace(memory_trace.get());
+        else
+            pwr_meter->trace(default_trace_file);
     }
 }
 
@@ -327,6 +692,42 @@ string SPECSConfig::analysisTypeDesc() const
     }
 }
 
+string SPECSConfig::eventSchedulerDesc() const
+{
+    switch (event_scheduler) {
+        case PORT_QUEUES:
+            return "per-port event queues";
+        case TIMING_WHEEL:
+            return "shared timing wheel";
+        default:
+            return "UNDEFINED";
+    }
+}
+
+string SPECSConfig::steadyStateSolverDesc() const
+{
+    switch (steady_state_solver) {
+        case EVENT_PROPAGATION:
+            return "event propagation";
+        case SPARSE_LU:
+            return "sparse LU";
+        default:
+            return "UNDEFINED";
+    }
+}
+
+string SPECSConfig::traceFormatDesc() const
+{
+    switch (trace_format) {
+        case VCD_TRACE:
+            return "VCD";
+        case BINARY_TRACE:
+            return "binary (probes), VCD (other traces)";
+        default:
+            return "UNDEFINED";
+    }
+}
+
 void SPECSConfig::printConfig() const
 {
     cout << "Current SPECS config: " << endl;
@@ -337,6 +738,62 @@ void SPECSConfig::printConfig() const
     cout << "- default reltol: " << default_reltol << endl;
     cout << "- resolution multiplier: " << default_resolution_multiplier << endl;
     cout << "- trace all optical nets: " << trace_all_optical_nets << endl;
+    if (!save_rules.empty())
+    {
+        cout << "- saved nets:";
+        for (const auto &rule: save_rules)
+            cout << " " << rule.pattern();
+        cout << endl;
+    }
+    cout << "- trace format: " << traceFormatDesc() << endl;
+    if (trace_format == BINARY_TRACE)
+        cout << "- trace buffer: " << trace_buffer << " samples" << endl;
+    cout << "- event scheduler: " << eventSchedulerDesc() << endl;
+    cout << "- partition report: " << partition_report << endl;
+    cout << "- linear cluster compression: " << compress_linear << endl;
+    cout << "- feedback loop report: " << loop_report << endl;
+    cout << "- feedback loop acceleration: " << loop_accel << endl;
+    cout << "- analytic photodetectors: " << analytic_detectors << endl;
+    cout << "- noise seed: " << noise_seed << endl;
+    cout << "- steady-state solver: " << steadyStateSolverDesc() << endl;
+    cout << "- wavelength tolerance: " << OpticalSignal::wavelength_registry.tolerance() << endl;
+}
+
+void SPECSConfig::end_of_elaboration()
+{
+    if (partition_report)
+    {
+        NetlistPartition partition;
+        partition.build();
+        partition.print(cout);
+    }
+
+    if (compress_linear)
+    {
+        netlist_compression = make_shared<NetlistCompression>();
+        netlist_compression->build();
+        netlist_compression->apply();
+        netlist_compression->print(cout);
+    }
+
+    if (loop_report || loop_accel)
+    {
+        netlist_loops = make_shared<NetlistLoops>();
+        netlist_loops->build();
+        netlist_loops->apply(loop_accel);
+        netlist_loops->print(cout);
+    }
+}
+
+void SPECSConfig::printEventStats(double runtime_s) const
+{
+    cout << "Processed " << port_event_count << " port events in ";
+    cout << runtime_s << " s (";
+    if (runtime_s > 0)
+        cout << port_event_count / runtime_s << " events/s, ";
+    cout << eventSchedulerDesc() << ")" << endl;
+    cout << "Port event processes: " << port_process_count;
+    cout << " (" << port_process_activations << " activations)" << endl;
 }
 
 void SPECSConfig::printOPAnalysisResult() const
@@ -366,7 +823,12 @@ void SPECSConfig::prepareSimulation() {
         if (!default_trace_file && trace_filename.size())
             default_trace_file = sc_create_vcd_trace_file(trace_filename.c_str());
 
-        default_trace_file->set_time_unit(std::pow(10, 15 + engine_timescale), SC_FS);
+        if (default_trace_file)
+            default_trace_file->set_time_unit(std::pow(10, 15 + engine_timescale), SC_FS);
+
+        if (trace_format == BINARY_TRACE && !binary_trace && trace_filename.size())
+            binary_trace = make_shared<BinaryTrace>(trace_filename + ".sptr",
+                sc_get_time_resolution().to_seconds(), trace_buffer);
     }
 
     applyDefaultOpticalOutputPortConfig();
@@ -375,6 +837,22 @@ void SPECSConfig::prepareSimulation() {
         sc_trace(default_trace_file, *this, "");
 }
 
+void SPECSConfig::closeTraceFiles()
+{
+    if (binary_trace)
+    {
+        const auto &registry = OpticalSignal::wavelength_registry;
+        vector<double> wavelengths(registry.size());
+        for (size_t i = 0; i < wavelengths.size(); ++i)
+            wavelengths[i] = registry[i];
+        binary_trace->set_wavelengths(wavelengths);
+        binary_trace->close();
+        cout << "Binary trace: " << binary_trace->sample_count() << " samples from ";
+        cout << binary_trace->channel_count() << " probes, " << binary_trace->byte_count();
+        cout << " bytes > " << binary_trace->filename() << endl;
+    }
+}
+
 inline void sc_trace(sc_trace_file *tf, const SPECSConfig &s, string parent_tree)
 {
     parent_tree += (parent_tree.size() ? "." : "");
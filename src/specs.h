@@ -3,6 +3,7 @@
 #include "utils/sysc_utils.h"
 #include "optical_signal.h"
 #include "optical_output_port.h"
+#include "trace_rules.h"
 
 #include <systemc.h>
 #include <vector>
@@ -51,6 +52,12 @@ namespace spx {
     typedef sc_port<ea_if_inout_type> ea_port_inout_type;
 };
 
+class CWSource;
+class NetlistCompression;
+class NetlistLoops;
+class BinaryTrace;
+class MemoryTrace;
+
 class SPECSConfig : public sc_module {
 public:
     enum EngineTimescale {
@@ -87,6 +94,27 @@ public:
         UNDEFINED = ANALYSIS_TYPE_MAXVAL,
     };
 
+    enum EventScheduler {
+        EVENT_SCHEDULER_MINVAL = -1,
+        PORT_QUEUES = 0,  // one event queue per optical output port
+        TIMING_WHEEL = 1, // one timing wheel shared by all ports
+        EVENT_SCHEDULER_MAXVAL,
+    };
+
+    enum SteadyStateSolver {
+        STEADY_STATE_SOLVER_MINVAL = -1,
+        EVENT_PROPAGATION = 0, // propagate events until ports stop emitting
+        SPARSE_LU = 1,         // solve linear devices directly (OP and DC)
+        STEADY_STATE_SOLVER_MAXVAL,
+    };
+
+    enum TraceFormat {
+        TRACE_FORMAT_MINVAL = -1,
+        VCD_TRACE = 0,    // SystemC VCD writer
+        BINARY_TRACE = 1, // probes go to a BinaryTrace (see binary_trace.h)
+        TRACE_FORMAT_MAXVAL,
+    };
+
     // Hold simulation objects
     vector<shared_ptr<sc_object>> additional_objects;
     map<string, pair<sc_signal<OpticalSignal, SC_MANY_WRITERS> *, OpticalSignal>> ic_orders;
@@ -103,18 +131,36 @@ public:
     double default_abstol = 1e-8;
     double default_reltol = 1e-4;
     sc_time::value_type default_resolution_multiplier = 1;
-
-    // For multi-wavelength support
-    vector<double> wavelengths_vector;
+    EventScheduler event_scheduler = PORT_QUEUES;
+    SteadyStateSolver steady_state_solver = EVENT_PROPAGATION;
+    shared_ptr<OpticalEventScheduler> shared_scheduler;
 
     // Trace options
     string trace_filename = "";
     sc_trace_file *default_trace_file = nullptr;
     bool trace_all_optical_nets = 1;
+    vector<TraceRule> save_rules; // from .SAVE; when set, only matching nets are traced
+    TraceFormat trace_format = VCD_TRACE;
+    shared_ptr<BinaryTrace> binary_trace;
+    shared_ptr<MemoryTrace> memory_trace; // set by specs_api.h to record in memory
+    size_t trace_buffer = 512; // samples per probe buffered for the binary trace writer
 
     // other
     sc_signal<bool, SC_MANY_WRITERS> drop_all_events;
     bool verbose_component_initialization = false;
+    bool partition_report = false;
+    bool compress_linear = false;
+    shared_ptr<NetlistCompression> netlist_compression;
+    bool loop_report = false;
+    bool loop_accel = false;
+    shared_ptr<NetlistLoops> netlist_loops;
+    bool analytic_detectors = false;
+    uint64_t noise_seed = 0;
+
+    // Statistics
+    uint64_t port_event_count = 0;
+    uint64_t port_process_count = 0;
+    uint64_t port_process_activations = 0;
 
     SPECSConfig(sc_module_name name);
 
@@ -122,11 +168,30 @@ public:
 
     virtual void before_end_of_elaboration()
     {}
+    virtual void end_of_elaboration();
 
     void runAnalysis();
     void runOPAnalysis();
     void runDCAnalysis();
     void runTRANAnalysis();
+    void solveSteadyStatePoint(const set<OpticalOutputPort *> &all_oop, const set<CWSource *> &all_cws);
+    void seedSteadyState();
+
+    /** Set a parameter of an elaborated device (e.g. "L" of a waveguide, in
+     * m, or "P" of a CW source), as the netlist keyword, or the value "V"
+     * of an electrical net. Returns false (after printing why) if there is
+     * no such device, net or parameter.
+     */
+    bool setParameter(const string &name, const string &attribute, double value);
+
+    /** Run the OP or DC analysis again on the elaborated circuit, e.g.
+     * after setParameter(), without parsing or elaborating it again.
+     *
+     * Probes record the steady state (the whole sweep of a DC analysis),
+     * at times following those of the previous run. SystemC time can't go
+     * back, so a TRAN analysis can't be run again: returns false.
+     */
+    bool rerunSteadyState();
 
     void applyEngineResolution() {
         // set engine time resolution
@@ -143,11 +208,19 @@ public:
         assert(ONE_FS <= engine_timescale && engine_timescale <= ONE_SEC);
         assert(PORT_MODE_MINVAL < simulation_mode && simulation_mode < PORT_MODE_MAXVAL);
         assert(ANALYSIS_TYPE_MINVAL < analysis_type && analysis_type < ANALYSIS_TYPE_MAXVAL);
+        assert(EVENT_SCHEDULER_MINVAL < event_scheduler && event_scheduler < EVENT_SCHEDULER_MAXVAL);
+        assert(STEADY_STATE_SOLVER_MINVAL < steady_state_solver && steady_state_solver < STEADY_STATE_SOLVER_MAXVAL);
+        assert(TRACE_FORMAT_MINVAL < trace_format && trace_format < TRACE_FORMAT_MAXVAL);
     }
     string analysisTypeDesc() const;
+    string eventSchedulerDesc() const;
+    string steadyStateSolverDesc() const;
+    string traceFormatDesc() const;
     void printConfig() const;
     void printOPAnalysisResult() const;
+    void printEventStats(double runtime_s) const;
     void prepareSimulation();
+    void closeTraceFiles();
     inline void register_object(shared_ptr<sc_object> object) {
         additional_objects.push_back(object);
     }
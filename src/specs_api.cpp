@@ -0,0 +1,135 @@
+#include "specs_api.h"
+#include "specs.h"
+#include "optical_signal.h"
+#include "parser/parse_tree.h"
+#include "parser/parser_state.h"
+
+#include <iostream>
+
+#include "parser.h"
+#include "scanner.h"
+extern int yy_load_next_buf(yyscan_t scanner);
+extern void yy_add_content_from_string(const string &str, const string &desc, yyscan_t &scanner);
+extern void yy_add_content_from_file(const string &filename, yyscan_t &scanner);
+
+using namespace std;
+
+namespace {
+
+bool simulated = false;
+bool built = false;
+
+// Information needed to interpret the samples
+void finish_trace(MemoryTrace &trace)
+{
+    const auto &registry = OpticalSignal::wavelength_registry;
+    trace.wavelengths.resize(registry.size());
+    for (size_t i = 0; i < trace.wavelengths.size(); ++i)
+        trace.wavelengths[i] = registry[i];
+    trace.time_unit_s = sc_get_time_resolution().to_seconds();
+}
+
+} // namespace
+
+int specs_api::build_circuit(ParseTree &pt, const vector<string> &filenames, const string &text)
+{
+    yyscan_t scanner;
+    yylex_init_extra(new ParserState(), &scanner);
+
+    for (const auto &fname: filenames)
+        yy_add_content_from_file(fname, scanner);
+    yy_add_content_from_string(text, "netlist text", scanner);
+
+    // Set up first file
+    int res = yy_load_next_buf(scanner);
+    if (res != 0)
+    {
+        cerr << "Expected yy_load_next_buf to return 0" << endl;
+        exit(1);
+    }
+
+    cout << "╔═══════════════════╗" << endl;
+    cout << "║  PARSING CIRCUIT  ║" << endl;
+    cout << "╚═══════════════════╝" << endl;
+
+    int parsing_result = yyparse(scanner, &pt);
+    yylex_destroy(scanner);
+    if (parsing_result != 0)
+        return parsing_result;
+
+    pt.print();
+
+    cout << "╔══════════════════════╗" << endl;
+    cout << "║   BUILDING CIRCUIT   ║" << endl;
+    cout << "╚══════════════════════╝" << endl;
+
+    pt.build_circuit();
+    return 0;
+}
+
+bool specs_api::has_simulated()
+{
+    return simulated;
+}
+
+shared_ptr<MemoryTrace> specs_api::simulate(const vector<string> &filenames, const string &text, bool trace_files)
+{
+    if (simulated)
+    {
+        cerr << "SPECS can only simulate one circuit per process" << endl;
+        return nullptr;
+    }
+    simulated = true;
+
+    if (!trace_files)
+        specsGlobalConfig.trace_filename = "";
+    auto trace = make_shared<MemoryTrace>();
+    specsGlobalConfig.memory_trace = trace;
+
+    // The parse tree owns the devices and signals, which must outlive the
+    // simulation context
+    static ParseTree pt("ROOT");
+    if (build_circuit(pt, filenames, text) != 0)
+        return nullptr;
+    built = true;
+
+    cout << "╔══════════════════════╗" << endl;
+    cout << "║      SIMULATION      ║" << endl;
+    cout << "╚══════════════════════╝" << endl;
+
+    specsGlobalConfig.runAnalysis();
+
+    finish_trace(*trace);
+    return trace;
+}
+
+bool specs_api::set_parameter(const string &name, const string &attribute, double value)
+{
+    if (!built)
+    {
+        cerr << "No circuit was built in this process" << endl;
+        return false;
+    }
+    return specsGlobalConfig.setParameter(name, attribute, value);
+}
+
+shared_ptr<MemoryTrace> specs_api::rerun()
+{
+    auto trace = specsGlobalConfig.memory_trace;
+    if (!built || !trace)
+    {
+        cerr << "No circuit was built in this process" << endl;
+        return nullptr;
+    }
+    trace->clear();
+
+    cout << "╔══════════════════════╗" << endl;
+    cout << "║      SIMULATION      ║" << endl;
+    cout << "╚══════════════════════╝" << endl;
+
+    if (!specsGlobalConfig.rerunSteadyState())
+        return nullptr;
+
+    finish_trace(*trace);
+    return trace;
+}
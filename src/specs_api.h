@@ -0,0 +1,53 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "memory_trace.h"
+
+using std::shared_ptr;
+using std::string;
+using std::vector;
+
+class ParseTree;
+
+/** Running SPECS from another program (e.g. the Python bindings of
+ * pyspecs/_specs.cpp) instead of the command line.
+ *
+ * Probes, photodetectors and power meters record to a MemoryTrace instead
+ * of trace files. SystemC elaborates a single circuit per process, so a
+ * process can only build one circuit. Its OP or DC analysis can then be
+ * run again in the same process with other parameters (set_parameter()
+ * and rerun()); other circuits run in child processes (see
+ * pyspecs/native.py).
+ */
+namespace specs_api {
+
+/** Parse netlist files, then text (e.g. overriding options), and build the
+ * circuit in pt. Returns the parser status (0 on success). */
+int build_circuit(ParseTree &pt, const vector<string> &filenames, const string &text);
+
+/** Whether this process already simulated a circuit */
+bool has_simulated();
+
+/** Build a circuit from files and text, run its analysis and return what
+ * was recorded (nullptr if the netlist can't be parsed or the process
+ * already simulated). With trace_files, VCD/binary trace files are written
+ * as by the command line too. */
+shared_ptr<MemoryTrace> simulate(const vector<string> &filenames, const string &text, bool trace_files = false);
+
+/** Set a parameter of a device, or the value of an electrical net, of the
+ * circuit built by simulate() (see SPECSConfig::setParameter). Returns
+ * false if it can't be set. */
+bool set_parameter(const string &name, const string &attribute, double value);
+
+/** Run the OP or DC analysis of the circuit built by simulate() again,
+ * with the parameters set since (see SPECSConfig::rerunSteadyState).
+ *
+ * The samples are recorded in the same MemoryTrace, which is cleared
+ * first: columns handed over after the previous run are not copied.
+ * Returns nullptr if no circuit was built or the analysis is a TRAN. */
+shared_ptr<MemoryTrace> rerun();
+
+} // namespace specs_api
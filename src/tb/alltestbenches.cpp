@@ -22,6 +22,19 @@ std::map<std::string, tb_func_t> tb_map = {
     { "phaseshifter", ps_tb_run },
     { "ps", ps_tb_run },
     { "mesh", mesh_tb_run },
+    { "oop_queue", oop_queue_tb_run },
+    { "clements_bench", clements_bench_tb_run },
+    { "clements_fused_bench", clements_fused_bench_tb_run },
+    { "wdm_bench", wdm_bench_tb_run },
+    { "ring_sweep_bench", ring_sweep_bench_tb_run },
+    { "ring_tran", ring_tran_tb_run },
+    { "detector_array_bench", detector_array_bench_tb_run },
+    { "detector_array_analytic_bench", detector_array_analytic_bench_tb_run },
+    { "detector_analytic", detector_analytic_tb_run },
+    { "steady_state_rerun", steady_state_rerun_tb_run },
+    { "touchstone", touchstone_tb_run },
+    { "parallel_engine", parallel_engine_tb_run },
+    { "elaboration_bench", elaboration_bench_tb_run },
 };
 #else
 std::map<std::string, tb_func_t> tb_map = {};
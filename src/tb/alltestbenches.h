@@ -14,6 +14,17 @@
 #include "tb/lambda_tb.h"
 #include "tb/phase_shifter_tb.h"
 #include "tb/mesh_tb.h"
+#include "tb/oop_queue_tb.h"
+#include "tb/clements_bench_tb.h"
+#include "tb/wdm_bench_tb.h"
+#include "tb/ring_sweep_bench_tb.h"
+#include "tb/ring_tran_tb.h"
+#include "tb/detector_array_bench_tb.h"
+#include "tb/detector_analytic_tb.h"
+#include "tb/steady_state_rerun_tb.h"
+#include "tb/touchstone_tb.h"
+#include "tb/parallel_engine_tb.h"
+#include "tb/elaboration_bench_tb.h"
 #endif
 
 #include <map>
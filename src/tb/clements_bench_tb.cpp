@@ -0,0 +1,203 @@
+#include <chrono>
+#include <random>
+#include <type_traits>
+#include "tb/clements_bench_tb.h"
+
+#include "utils/sysc_utils.h"
+
+using namespace std::chrono;
+
+void clements_bench_tb::run()
+{
+    std::mt19937 gen(1234);
+    std::uniform_real_distribution<double> amplitude(0, 1);
+    std::uniform_real_distribution<double> phase(0, 2 * M_PI);
+    std::uniform_int_distribution<size_t> mzi(0, VPHI.size() - 1);
+
+    for (size_t k = 0; k < m_n_vectors; ++k)
+    {
+        for (size_t i = 0; i < m_N; ++i)
+            (*IN[i])->write(OpticalSignal(polar(amplitude(gen), phase(gen)), 1550e-9));
+
+        // While the vector crosses the mesh, change a few phases...
+        wait(10, SC_PS);
+        for (size_t n = 0; n < 3; ++n)
+        {
+            const size_t m = mzi(gen);
+            VPHI[m]->write(phase(gen));
+            VTHETA[m]->write(phase(gen));
+        }
+
+        // ... then half of the inputs
+        wait(20, SC_PS);
+        for (size_t i = 0; i < m_N; i += 2)
+            (*IN[i])->write(OpticalSignal(polar(amplitude(gen), phase(gen)), 1550e-9));
+        wait(970, SC_PS);
+    }
+}
+
+void clements_bench_tb::compare()
+{
+    // Outputs are sampled between events, with a tolerance for the
+    // filtering of small changes by the output ports of each device
+    const double tolerance = 1e-3;
+    const sc_time end(m_n_vectors, SC_NS);
+    double max_error = 0;
+    sc_time max_error_time;
+    size_t max_error_output = 0;
+    while (sc_time_stamp() < end)
+    {
+        wait(1, SC_PS);
+        for (size_t i = 0; i < m_N; ++i)
+        {
+            const double error = abs((*OUT[i])->read().m_field - (*OUT_REF[i])->read().m_field);
+            if (error > max_error)
+            {
+                max_error = error;
+                max_error_time = sc_time_stamp();
+                max_error_output = i;
+            }
+        }
+    }
+
+    if (max_error > tolerance)
+    {
+        cerr << "Outputs differ from the Clements mesh: error " << max_error;
+        cerr << " on output " << max_error_output << " at " << max_error_time << endl;
+        exit(1);
+    }
+    cout << "Outputs match the Clements mesh (max error " << max_error << ")" << endl;
+}
+
+// Mesh is Clements or ClementsFused, compared to Clements with check
+template <class Mesh>
+static void run_clements_bench(bool check = false)
+{
+    const size_t N = 64;
+    const size_t n_vectors = 16;
+
+    // Apply SPECS resolution before creating any device
+    specsGlobalConfig.applyEngineResolution();
+
+    // Optical nets
+    vector<unique_ptr<spx::oa_signal_type>> sig_in, sig_out;
+    for (size_t i = 0; i < N; ++i)
+    {
+        sig_in.push_back(make_unique<spx::oa_signal_type>(("IN_" + to_string(i)).c_str()));
+        sig_out.push_back(make_unique<spx::oa_signal_type>(("OUT_" + to_string(i)).c_str()));
+    }
+
+    // Electrical nets (random phases)
+    std::mt19937 gen(5678);
+    std::uniform_real_distribution<double> phase(0, 2 * M_PI);
+    const size_t n_mzi = N * (N - 1) / 2;
+    vector<unique_ptr<sc_signal<double>>> vphi, vtheta;
+    for (size_t i = 0; i < n_mzi; ++i)
+    {
+        vphi.push_back(make_unique<sc_signal<double>>(("VPHI_" + to_string(i)).c_str(), phase(gen)));
+        vtheta.push_back(make_unique<sc_signal<double>>(("VTHETA_" + to_string(i)).c_str(), phase(gen)));
+    }
+
+    auto t_elab_start = high_resolution_clock::now();
+
+    Mesh mesh("mesh", N);
+    for (size_t i = 0; i < N; ++i)
+    {
+        mesh.p_in[i]->bind(*sig_in[i]);
+        mesh.p_out[i]->bind(*sig_out[i]);
+    }
+    for (size_t i = 0; i < n_mzi; ++i)
+    {
+        mesh.p_vphi[i]->bind(*vphi[i]);
+        mesh.p_vtheta[i]->bind(*vtheta[i]);
+    }
+    // (the MZIs of Clements are instantiated by prepareSimulation, which
+    // calls init() once: they must not exist before)
+
+    // Reference mesh on the same nets
+    unique_ptr<Clements> reference;
+    vector<unique_ptr<spx::oa_signal_type>> sig_ref;
+    if (check)
+    {
+        reference = make_unique<Clements>("reference", N);
+        for (size_t i = 0; i < N; ++i)
+        {
+            sig_ref.push_back(make_unique<spx::oa_signal_type>(("OUT_REF_" + to_string(i)).c_str()));
+            reference->p_in[i]->bind(*sig_in[i]);
+            reference->p_out[i]->bind(*sig_ref[i]);
+        }
+        for (size_t i = 0; i < n_mzi; ++i)
+        {
+            reference->p_vphi[i]->bind(*vphi[i]);
+            reference->p_vtheta[i]->bind(*vtheta[i]);
+        }
+    }
+
+    clements_bench_tb tb("tb", N, n_vectors, check);
+    for (size_t i = 0; i < N; ++i)
+    {
+        tb.IN[i]->bind(*sig_in[i]);
+        if (check)
+        {
+            tb.OUT[i]->bind(*sig_out[i]);
+            tb.OUT_REF[i]->bind(*sig_ref[i]);
+        }
+    }
+    for (size_t i = 0; i < n_mzi; ++i)
+    {
+        tb.VPHI[i]->bind(*vphi[i]);
+        tb.VTHETA[i]->bind(*vtheta[i]);
+    }
+
+    // Apply SPECS options specific to the testbench
+    specsGlobalConfig.simulation_mode = OpticalOutputPortMode::EVENT_DRIVEN;
+    specsGlobalConfig.trace_all_optical_nets = 0;
+
+    // Run SPECS pre-simulation code
+    specsGlobalConfig.prepareSimulation();
+
+    // Elaborate and run
+    sc_start(SC_ZERO_TIME);
+    auto t_sim_start = high_resolution_clock::now();
+    sc_start();
+    auto t_sim_stop = high_resolution_clock::now();
+
+    // Count processes by kind
+    size_t n_threads = 0;
+    size_t n_methods = 0;
+    for (const auto &obj : sc_get_all_object())
+    {
+        const string kind = obj->kind();
+        if (kind == "sc_thread_process" || kind == "sc_cthread_process")
+            ++n_threads;
+        else if (kind == "sc_method_process")
+            ++n_methods;
+    }
+
+    const double t_elab = duration<double>(t_sim_start - t_elab_start).count();
+    const double t_sim = duration<double>(t_sim_stop - t_sim_start).count();
+
+    cout << endl;
+    cout << (is_same<Mesh, ClementsFused>::value ? "Fused Clements " : "Clements ");
+    cout << N << "x" << N << " (" << n_mzi << " MZIs), ";
+    cout << n_vectors << " input vectors" << endl;
+    cout << "SystemC processes: " << n_threads << " threads, ";
+    cout << n_methods << " methods" << endl;
+    cout << "Elaboration: " << t_elab << " s" << endl;
+    cout << "Simulation: " << t_sim << " s" << endl;
+    cout << "OpticalSignal: " << sizeof(OpticalSignal) << " bytes";
+    cout << (SPECS_SIGNAL_IDS ? " (with ids)" : "") << endl;
+    specsGlobalConfig.printEventStats(t_sim);
+
+    sc_close_vcd_trace_file(specsGlobalConfig.default_trace_file);
+}
+
+void clements_bench_tb_run()
+{
+    run_clements_bench<Clements>();
+}
+
+void clements_fused_bench_tb_run()
+{
+    run_clements_bench<ClementsFused>(true);
+}
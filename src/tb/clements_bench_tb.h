@@ -0,0 +1,68 @@
+#pragma once
+
+#include "optical_signal.h"
+#include <systemc.h>
+#include "specs.h"
+#include "devices/clements.h"
+#include "devices/clements_fused.h"
+
+/* Benchmark of a large Clements mesh (64x64 by default).
+ *
+ * All inputs are driven with a sequence of random input vectors, the phases
+ * of the MZIs are set to random values and a few of them change while each
+ * vector crosses the mesh. The wall-clock time of the simulation is reported
+ * along with the number of SystemC thread and method processes, so that the
+ * cost of device processes can be compared between versions of the
+ * simulator.
+ *
+ * clements_fused_bench runs the same circuit with ClementsFused, along with
+ * a Clements mesh on the same nets, and fails if their outputs differ (its
+ * timings include both meshes).
+ */
+class clements_bench_tb : public sc_module {
+public:
+    vector<unique_ptr<spx::oa_port_out_type>> IN;
+    vector<unique_ptr<sc_out<double>>> VPHI, VTHETA;
+
+    // Outputs of the mesh and of the reference mesh (only with check)
+    vector<unique_ptr<spx::oa_port_in_type>> OUT, OUT_REF;
+
+    size_t m_N;
+    size_t m_n_vectors;
+    bool m_check;
+
+    void run();
+    void compare();
+
+    clements_bench_tb(sc_module_name name, size_t N, size_t n_vectors, bool check = false)
+        : sc_module(name)
+        , m_N(N)
+        , m_n_vectors(n_vectors)
+        , m_check(check)
+    {
+        SC_HAS_PROCESS(clements_bench_tb);
+
+        for (size_t i = 0; i < m_N; ++i)
+            IN.push_back(make_unique<spx::oa_port_out_type>(("IN_" + to_string(i)).c_str()));
+        for (size_t i = 0; i < m_N * (m_N - 1) / 2; ++i)
+        {
+            VPHI.push_back(make_unique<sc_out<double>>(("VPHI_" + to_string(i)).c_str()));
+            VTHETA.push_back(make_unique<sc_out<double>>(("VTHETA_" + to_string(i)).c_str()));
+        }
+
+        SC_THREAD(run);
+
+        if (m_check)
+        {
+            for (size_t i = 0; i < m_N; ++i)
+            {
+                OUT.push_back(make_unique<spx::oa_port_in_type>(("OUT_" + to_string(i)).c_str()));
+                OUT_REF.push_back(make_unique<spx::oa_port_in_type>(("OUT_REF_" + to_string(i)).c_str()));
+            }
+            SC_THREAD(compare);
+        }
+    }
+};
+
+void clements_bench_tb_run();
+void clements_fused_bench_tb_run();
@@ -0,0 +1,42 @@
+#pragma once
+
+#include "optical_signal.h"
+#include <systemc.h>
+#include "specs.h"
+#include "devices/detector.h"
+#include "memory_trace.h"
+
+/* Analytic photodetectors against polling ones.
+ *
+ * Two nets, one with a single wavelength and one with two wavelengths
+ * beating at 100 GHz, are each read by a polling detector and an analytic
+ * one. Both record their samples to a memory trace. Fields change at
+ * irregular times; the samples of each analytic detector must match those of
+ * its polling twin (the readout of the analytic one being held between its
+ * samples), while it only wakes up at input changes.
+ */
+class detector_analytic_tb : public sc_module {
+public:
+    vector<unique_ptr<spx::oa_port_out_type>> IN;
+
+    vector<Detector *> m_detectors;
+    vector<uint32_t> m_wavelength_ids;
+
+    void run();
+
+    detector_analytic_tb(sc_module_name name, const vector<Detector *> &detectors,
+            const vector<uint32_t> &wavelength_ids)
+        : sc_module(name)
+        , m_detectors(detectors)
+        , m_wavelength_ids(wavelength_ids)
+    {
+        SC_HAS_PROCESS(detector_analytic_tb);
+
+        for (size_t i = 0; i < 2; ++i)
+            IN.push_back(make_unique<spx::oa_port_out_type>(("IN_" + to_string(i)).c_str()));
+
+        SC_THREAD(run);
+    }
+};
+
+void detector_analytic_tb_run();
@@ -0,0 +1,116 @@
+#include <chrono>
+#include <random>
+#include "tb/detector_array_bench_tb.h"
+
+using namespace std::chrono;
+
+void detector_array_bench_tb::run()
+{
+    std::mt19937 gen(1234);
+    std::uniform_real_distribution<double> amplitude(0, 1);
+    std::uniform_real_distribution<double> phase(0, 2 * M_PI);
+
+    for (auto pdet : m_detectors)
+        pdet->enable.write(sc_logic(1));
+
+    for (size_t k = 0; k < m_n_steps; ++k)
+    {
+        for (size_t i = 0; i < IN.size(); ++i)
+        {
+            (*IN[i])->write(OpticalSignal(polar(amplitude(gen), phase(gen)), m_wavelength_ids[0]));
+            if (i % 4 == 0)
+            {
+                wait(SC_ZERO_TIME);
+                (*IN[i])->write(OpticalSignal(polar(amplitude(gen), phase(gen)), m_wavelength_ids[1]));
+            }
+        }
+        wait(20, SC_NS);
+    }
+}
+
+static void run_detector_array_bench(bool analytic)
+{
+    const size_t n_detectors = 64;
+    const size_t n_steps = 5;
+
+    // Apply SPECS resolution before creating any device
+    specsGlobalConfig.applyEngineResolution();
+
+    // Two channels, 100 GHz apart
+    vector<uint32_t> wavelength_ids;
+    for (size_t i = 0; i < 2; ++i)
+    {
+        const double freq = 193.1e12 + i * 100e9;
+        wavelength_ids.push_back(OpticalSignal(0, 299792458.0 / freq).m_wavelength_id);
+    }
+
+    vector<unique_ptr<spx::oa_signal_type>> sig_in;
+    vector<unique_ptr<spx::ea_signal_type>> sig_readout;
+    vector<unique_ptr<Detector>> detectors;
+    vector<Detector *> pdets;
+    for (size_t i = 0; i < n_detectors; ++i)
+    {
+        sig_in.push_back(make_unique<spx::oa_signal_type>(("IN_" + to_string(i)).c_str()));
+        sig_readout.push_back(make_unique<spx::ea_signal_type>(("READOUT_" + to_string(i)).c_str()));
+        detectors.push_back(make_unique<Detector>(("pdet_" + to_string(i)).c_str()));
+        detectors[i]->p_in(*sig_in[i]);
+        detectors[i]->p_readout(*sig_readout[i]);
+        detectors[i]->m_analytic = analytic;
+        pdets.push_back(detectors[i].get());
+    }
+
+    detector_array_bench_tb tb("tb", pdets, wavelength_ids, n_steps);
+    for (size_t i = 0; i < n_detectors; ++i)
+        tb.IN[i]->bind(*sig_in[i]);
+
+    // Apply SPECS options specific to the testbench
+    specsGlobalConfig.simulation_mode = OpticalOutputPortMode::EVENT_DRIVEN;
+    specsGlobalConfig.trace_all_optical_nets = 0;
+
+    // Run SPECS pre-simulation code
+    specsGlobalConfig.prepareSimulation();
+
+    // Polling detectors never run out of activity: run for a fixed time
+    sc_start(SC_ZERO_TIME);
+    auto t_sim_start = high_resolution_clock::now();
+    sc_start(n_steps * 20, SC_NS);
+    for (auto pdet : pdets)
+        pdet->flush_readout();
+    auto t_sim_stop = high_resolution_clock::now();
+
+    // Inputs change on the sampling grid, so the last samples are at the end
+    uint64_t n_updates = 0;
+    uint64_t n_wakeups = 0;
+    double max_err = 0;
+    for (auto pdet : pdets)
+    {
+        n_updates += pdet->m_n_updates;
+        n_wakeups += pdet->m_n_wakeups;
+        if (analytic)
+            max_err = max(max_err, abs(pdet->m_cur_readout - pdet->readout_at(sc_time_stamp())));
+    }
+
+    const double t_sim = duration<double>(t_sim_stop - t_sim_start).count();
+
+    cout << endl;
+    cout << n_detectors << (analytic ? " analytic" : " polling") << " photodetectors, ";
+    cout << sc_time_stamp() << " simulated" << endl;
+    cout << "Readout computations: " << n_updates << endl;
+    cout << "Sampling thread wakeups: " << n_wakeups << endl;
+    if (analytic)
+        cout << "Largest error of the rotated phasors: " << max_err << " A" << endl;
+    cout << "Simulation: " << t_sim << " s" << endl;
+    specsGlobalConfig.printEventStats(t_sim);
+
+    sc_close_vcd_trace_file(specsGlobalConfig.default_trace_file);
+}
+
+void detector_array_bench_tb_run()
+{
+    run_detector_array_bench(false);
+}
+
+void detector_array_analytic_bench_tb_run()
+{
+    run_detector_array_bench(true);
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include "optical_signal.h"
+#include <systemc.h>
+#include "specs.h"
+#include "devices/detector.h"
+
+/* Benchmark of a photodetector array (64 detectors by default).
+ *
+ * Every detector reads its own net. New random fields are written every
+ * 20 ns and stay constant in between; one net out of four carries two
+ * wavelengths, which beat at 100 GHz. The run time and the number of
+ * readout computations are reported, so that polling detectors
+ * (detector_array_bench) can be compared with analytic ones
+ * (detector_array_analytic_bench, see Detector).
+ */
+class detector_array_bench_tb : public sc_module {
+public:
+    vector<unique_ptr<spx::oa_port_out_type>> IN;
+
+    vector<Detector *> m_detectors;
+    vector<uint32_t> m_wavelength_ids;
+    size_t m_n_steps;
+
+    void run();
+
+    detector_array_bench_tb(sc_module_name name, const vector<Detector *> &detectors,
+            const vector<uint32_t> &wavelength_ids, size_t n_steps)
+        : sc_module(name)
+        , m_detectors(detectors)
+        , m_wavelength_ids(wavelength_ids)
+        , m_n_steps(n_steps)
+    {
+        SC_HAS_PROCESS(detector_array_bench_tb);
+
+        for (size_t i = 0; i < m_detectors.size(); ++i)
+            IN.push_back(make_unique<spx::oa_port_out_type>(("IN_" + to_string(i)).c_str()));
+
+        SC_THREAD(run);
+    }
+};
+
+void detector_array_bench_tb_run();
+void detector_array_analytic_bench_tb_run();
@@ -0,0 +1,68 @@
+#include <chrono>
+#include <sstream>
+#include "tb/elaboration_bench_tb.h"
+#include "parser/parse_tree.h"
+#include "parser/parser_state.h"
+
+#include "parser.h"
+#include "scanner.h"
+extern int yy_load_next_buf(yyscan_t scanner);
+extern void yy_add_content_from_string(const string &str, const string &desc, yyscan_t &scanner);
+
+using namespace std::chrono;
+
+void elaboration_bench_tb_run()
+{
+    const size_t n_chains = 1000;
+    const size_t chain_length = 1000;
+
+    // Apply SPECS resolution before creating any device
+    specsGlobalConfig.applyEngineResolution();
+    specsGlobalConfig.trace_all_optical_nets = 0;
+
+    stringstream netlist;
+    size_t n_elements = 0;
+    for (size_t c = 0; c < n_chains; ++c)
+    {
+        for (size_t k = 0; k < chain_length; ++k)
+        {
+            netlist << "WG" << c << "_" << k << " C" << c << "_" << k
+                    << " C" << c << "_" << k + 1 << endl;
+            ++n_elements;
+        }
+        if (c % 2 == 0)
+        {
+            netlist << "WG" << c << "_R R" << c << " C" << c << "_" << chain_length << endl;
+            ++n_elements;
+        }
+    }
+
+    ParseTree pt("ROOT");
+    yyscan_t scanner;
+    yylex_init_extra(new ParserState(), &scanner);
+    yy_add_content_from_string(netlist.str(), "elaboration benchmark", scanner);
+    if (yy_load_next_buf(scanner) != 0)
+    {
+        cerr << "Expected yy_load_next_buf to return 0" << endl;
+        exit(1);
+    }
+
+    auto t_parse_start = high_resolution_clock::now();
+    int parsing_result = yyparse(scanner, &pt);
+    auto t_parse_stop = high_resolution_clock::now();
+    yylex_destroy(scanner);
+    if (parsing_result != 0)
+    {
+        cerr << "Parsing failed with code " << parsing_result << endl;
+        exit(1);
+    }
+
+    auto t_build_start = high_resolution_clock::now();
+    pt.build_circuit();
+    auto t_build_stop = high_resolution_clock::now();
+
+    cout << endl;
+    cout << n_elements << " elements, " << pt.nets.size() << " nets" << endl;
+    cout << "Parsing: " << duration<double>(t_parse_stop - t_parse_start).count() << " s" << endl;
+    cout << "Elaboration: " << duration<double>(t_build_stop - t_build_start).count() << " s" << endl;
+}
@@ -0,0 +1,13 @@
+#pragma once
+
+#include <systemc.h>
+#include "specs.h"
+
+/* Benchmark of circuit elaboration (ParseTree::build_circuit).
+ *
+ * A generated netlist of 1000 chains of 1000 waveguides (1M elements) is
+ * parsed and built, without running a simulation. One chain out of two
+ * ends with a second waveguide writing to its last net, which makes the
+ * whole chain bidirectional. Parsing and elaboration times are reported.
+ */
+void elaboration_bench_tb_run();
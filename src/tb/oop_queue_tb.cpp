@@ -0,0 +1,119 @@
+#include <chrono>
+#include <iomanip>
+#include <random>
+#include "tb/oop_queue_tb.h"
+
+#include "utils/pqueue.h"
+#include "specs.h"
+
+using namespace std;
+using namespace std::chrono;
+
+void oop_queue_tb::drop_events()
+{
+    // drop_queue() cannot be used while the simulation is running
+    m_out_writer.m_event_queue.cancel_all();
+    m_out_writer.m_queue.clear();
+    if (m_out_writer.m_scheduler)
+        m_out_writer.m_scheduler->drop(&m_out_writer);
+}
+
+void oop_queue_tb::run()
+{
+    const vector<size_t> depths = { 100, 1000, 10000, 100000 };
+    const size_t n_writes = 10000;
+    const size_t n_writes_legacy = 1000;
+
+    // Wait one tick that all sc_threads are started and on their first `wait` call
+    wait(SC_ZERO_TIME);
+
+    const uint32_t wlid = OpticalSignal(0, 1550e-9).m_wavelength_id;
+    const sc_time::value_type dt = m_out_writer.m_temporal_resolution.value();
+    mt19937 gen(42);
+
+    cout << "----------------------------" << endl;
+    cout << setw(10) << "depth"
+         << setw(18) << "coalesce (ns)"
+         << setw(18) << "schedule (ns)"
+         << setw(18) << "legacy (ns)" << endl;
+
+    for (const auto &depth : depths)
+    {
+        // Start from an empty port (events are never let to fire)
+        drop_events();
+
+        // Fill the pending event store up to the requested depth
+        for (size_t i = 0; i < depth; ++i)
+            m_out_writer.delayedWrite(OpticalSignal(1.0, wlid), sc_time::from_value((i + 1) * dt));
+
+        uniform_int_distribution<size_t> dist(1, depth);
+        vector<size_t> targets(n_writes);
+        for (auto &x : targets)
+            x = dist(gen);
+
+        // Writes landing on already pending events
+        auto start = high_resolution_clock::now();
+        for (const auto &x : targets)
+            m_out_writer.delayedWrite(OpticalSignal(0.5, wlid), sc_time::from_value(x * dt));
+        auto stop = high_resolution_clock::now();
+        double t_coalesce = duration_cast<nanoseconds>(stop - start).count() / (double)n_writes;
+
+        // Writes scheduling new events
+        start = high_resolution_clock::now();
+        for (size_t i = 0; i < n_writes; ++i)
+            m_out_writer.delayedWrite(OpticalSignal(0.5, wlid), sc_time::from_value((depth + i + 1) * dt));
+        stop = high_resolution_clock::now();
+        double t_schedule = duration_cast<nanoseconds>(stop - start).count() / (double)n_writes;
+
+        // Previous implementation: linear scan of a binary heap
+        PQueue<OpticalOutputPort::pair_type> legacy;
+        for (size_t i = 0; i < depth; ++i)
+            legacy.push(make_pair(sc_time::from_value((i + 1) * dt), OpticalSignal(1.0, wlid)));
+        start = high_resolution_clock::now();
+        for (size_t i = 0; i < n_writes_legacy; ++i)
+        {
+            const sc_time t = sc_time::from_value(targets[i] * dt);
+            auto it = std::find_if(legacy.begin(), legacy.end(), [&wlid,&t](const auto &x) {
+                    return t == x.first && wlid == x.second.m_wavelength_id;
+                    });
+            if (it != legacy.end())
+                it->second = OpticalSignal(0.5, wlid);
+        }
+        stop = high_resolution_clock::now();
+        double t_legacy = duration_cast<nanoseconds>(stop - start).count() / (double)n_writes_legacy;
+
+        cout << setw(10) << depth
+             << setw(18) << fixed << setprecision(1) << t_coalesce
+             << setw(18) << t_schedule
+             << setw(18) << t_legacy << endl;
+    }
+    cout << "----------------------------" << endl;
+
+    drop_events();
+    sc_stop();
+
+    while (true) { wait(); }
+}
+
+void oop_queue_tb_run()
+{
+    // Apply SPECS resolution before creating any device
+    specsGlobalConfig.applyEngineResolution();
+
+    spx::oa_signal_type OUT("sig_out");
+
+    oop_queue_tb tb("tb");
+    tb.OUT(OUT);
+
+    // Apply SPECS options specific to the testbench
+    specsGlobalConfig.simulation_mode = OpticalOutputPortMode::EVENT_DRIVEN;
+    specsGlobalConfig.trace_all_optical_nets = 0;
+
+    // Run SPECS pre-simulation code
+    specsGlobalConfig.prepareSimulation();
+
+    // Start simulation
+    sc_start();
+
+    sc_close_vcd_trace_file(specsGlobalConfig.default_trace_file);
+}
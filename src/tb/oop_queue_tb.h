@@ -0,0 +1,35 @@
+#pragma once
+
+#include "optical_signal.h"
+#include "optical_output_port.h"
+#include "specs.h"
+#include <systemc.h>
+
+/* Microbenchmark for the pending-event store of OpticalOutputPort.
+ *
+ * Fills the queue of a single output port up to a given depth, then measures
+ * the average cost of a write which coalesces with an already pending event,
+ * and of a write which schedules a new one. For comparison, the same lookups
+ * are done with the linear scan over a PQueue which was used before.
+ *
+ * With `--scheduler wheel`, writes go to the shared timing wheel instead.
+ */
+class oop_queue_tb : public sc_module {
+public:
+    spx::oa_port_out_type OUT;
+    OpticalOutputPort m_out_writer;
+
+    void run();
+    void drop_events();
+
+    oop_queue_tb(sc_module_name name)
+        : sc_module(name)
+        , m_out_writer("out_delayed_writer", OUT)
+    {
+        SC_HAS_PROCESS(oop_queue_tb);
+
+        SC_THREAD(run);
+    }
+};
+
+void oop_queue_tb_run();
@@ -0,0 +1,193 @@
+#include <chrono>
+#include <random>
+#include <thread>
+#include "tb/parallel_engine_tb.h"
+#include "devices/directional_coupler.h"
+#include "devices/ring.h"
+#include "devices/waveguide.h"
+
+using namespace std::chrono;
+
+void parallel_engine_tb::run()
+{
+    // Wavelengths are written in successive delta cycles
+    sc_time last_t = SC_ZERO_TIME;
+    uint32_t last_wavelength_id = m_changes.empty() ? 0 : m_changes[0].wavelength_id;
+    for (const auto &c : m_changes)
+    {
+        if (c.t > last_t)
+            wait(c.t - sc_time_stamp());
+        else if (c.wavelength_id != last_wavelength_id)
+            wait(SC_ZERO_TIME);
+        last_t = c.t;
+        last_wavelength_id = c.wavelength_id;
+        (*IN[c.lane])->write(OpticalSignal(c.field, c.wavelength_id));
+    }
+}
+
+void parallel_engine_tb::monitor()
+{
+    for (size_t j = 0; j < OUT.size(); ++j)
+    {
+        const auto &s = (*OUT[j])->read();
+        m_out_fields[j][s.m_wavelength_id] = s.m_field;
+    }
+}
+
+void parallel_engine_tb_run()
+{
+    const size_t n_lanes = 32;
+    const size_t n_stages = 12;
+    const size_t n_rings = 4;
+    const size_t n_wavelengths = 4;
+    const size_t n_steps = 20;
+    const size_t n_threads = max(4u, std::thread::hardware_concurrency());
+
+    // Apply SPECS resolution before creating any device
+    specsGlobalConfig.applyEngineResolution();
+
+    const sc_time period(5, SC_PS);
+    const sc_time end(2, SC_NS);
+
+    // Channels 100 GHz apart
+    vector<uint32_t> wavelength_ids;
+    for (size_t i = 0; i < n_wavelengths; ++i)
+    {
+        const double freq = 193.1e12 + i * 100e9;
+        wavelength_ids.push_back(OpticalSignal(0, 299792458.0 / freq).m_wavelength_id);
+    }
+
+    // Couplers of stage s read lanes nets[s], their outputs go through a
+    // waveguide to the shuffled lanes of stage s + 1
+    auto shuffle = [&](size_t j) { return ((j << 1) | (j >> 4)) & (n_lanes - 1); };
+    vector<vector<unique_ptr<spx::oa_signal_type>>> nets(n_stages + 1);
+    vector<vector<unique_ptr<spx::oa_signal_type>>> coupled(n_stages);
+    vector<unique_ptr<DirectionalCouplerUni>> couplers;
+    vector<unique_ptr<WaveguideUni>> waveguides;
+    vector<unique_ptr<Ring>> rings;
+    vector<unique_ptr<spx::oa_signal_type>> outputs;
+    for (size_t s = 0; s <= n_stages; ++s)
+        for (size_t j = 0; j < n_lanes; ++j)
+            nets[s].push_back(make_unique<spx::oa_signal_type>(
+                ("N_" + to_string(s) + "_" + to_string(j)).c_str()));
+    for (size_t s = 0; s < n_stages; ++s)
+    {
+        for (size_t j = 0; j < n_lanes; ++j)
+            coupled[s].push_back(make_unique<spx::oa_signal_type>(
+                ("C_" + to_string(s) + "_" + to_string(j)).c_str()));
+        for (size_t c = 0; c < n_lanes / 2; ++c)
+        {
+            couplers.push_back(make_unique<DirectionalCouplerUni>(
+                ("dc_" + to_string(s) + "_" + to_string(c)).c_str(), 0.5 + 0.02 * (c % 5)));
+            auto &dc = *couplers.back();
+            dc.p_in1(*nets[s][2 * c]);
+            dc.p_in2(*nets[s][2 * c + 1]);
+            dc.p_out1(*coupled[s][2 * c]);
+            dc.p_out2(*coupled[s][2 * c + 1]);
+        }
+        for (size_t j = 0; j < n_lanes; ++j)
+        {
+            const double length_cm = 0.1 + 0.01 * ((s * n_lanes + j) % 7);
+            waveguides.push_back(make_unique<WaveguideUni>(
+                ("wg_" + to_string(s) + "_" + to_string(j)).c_str(), length_cm, 1.0));
+            waveguides.back()->p_in(*coupled[s][j]);
+            waveguides.back()->p_out(*nets[s + 1][shuffle(j)]);
+        }
+    }
+    for (size_t j = 0; j < n_rings; ++j)
+    {
+        outputs.push_back(make_unique<spx::oa_signal_type>(("OUT_" + to_string(j)).c_str()));
+        rings.push_back(make_unique<Ring>(("ring_" + to_string(j)).c_str(), 0.05, 0.5, 0, 100));
+        rings.back()->p_in(*nets[n_stages][j]);
+        rings.back()->p_out(*outputs.back());
+    }
+    auto output = [&](size_t j) -> spx::oa_signal_type & {
+        return j < n_rings ? *outputs[j] : *nets[n_stages][j];
+    };
+
+    // All inputs change at all wavelengths every period
+    std::mt19937 gen(1234);
+    std::uniform_real_distribution<double> amplitude(0, 1);
+    std::uniform_real_distribution<double> phase(0, 2 * M_PI);
+    vector<parallel_engine_tb::Change> changes;
+    for (size_t k = 0; k < n_steps; ++k)
+        for (auto wlid : wavelength_ids)
+            for (size_t j = 0; j < n_lanes; ++j)
+                changes.push_back({period * (double)k, j, wlid, polar(amplitude(gen), phase(gen))});
+
+    parallel_engine_tb tb("tb", n_lanes, changes);
+    for (size_t j = 0; j < n_lanes; ++j)
+    {
+        tb.IN[j]->bind(*nets[0][j]);
+        tb.OUT[j]->bind(output(j));
+    }
+
+    // Apply SPECS options specific to the testbench
+    specsGlobalConfig.simulation_mode = OpticalOutputPortMode::EVENT_DRIVEN;
+    specsGlobalConfig.trace_all_optical_nets = 0;
+
+    // Output ports drop changes within tolerance, which the engine doesn't
+    specsGlobalConfig.default_abstol = 1e-14;
+    specsGlobalConfig.default_reltol = 1e-12;
+
+    // Run SPECS pre-simulation code
+    specsGlobalConfig.prepareSimulation();
+
+    auto t_start = high_resolution_clock::now();
+    sc_start();
+    const double t_systemc = duration<double>(high_resolution_clock::now() - t_start).count();
+    cout << endl << "SystemC: " << t_systemc << " s" << endl;
+
+    // Same inputs in the parallel engine, with one thread and with several
+    vector<unique_ptr<ParallelEngine>> engines;
+    for (size_t threads : {(size_t)1, n_threads})
+    {
+        engines.push_back(make_unique<ParallelEngine>());
+        auto &engine = *engines.back();
+        if (!engine.build(wavelength_ids))
+            exit(1);
+        for (size_t j = 0; j < n_lanes; ++j)
+            engine.observe(&output(j));
+        for (const auto &c : changes)
+            engine.inject(nets[0][c.lane].get(), c.t, c.wavelength_id, c.field);
+
+        t_start = high_resolution_clock::now();
+        engine.run(end, threads);
+        const double t_engine = duration<double>(high_resolution_clock::now() - t_start).count();
+        cout << endl;
+        engine.print(cout);
+        cout << "- run time: " << t_engine << " s" << endl;
+    }
+
+    // Results of the engine don't depend on the number of threads
+    size_t n_samples = 0;
+    for (size_t j = 0; j < n_lanes; ++j)
+    {
+        const auto &a = engines[0]->samples(&output(j));
+        const auto &b = engines[1]->samples(&output(j));
+        bool same = a.size() == b.size();
+        for (size_t k = 0; same && k < a.size(); ++k)
+            same = a[k].t == b[k].t && a[k].wavelength_id == b[k].wavelength_id && a[k].field == b[k].field;
+        if (!same)
+        {
+            cerr << "Output " << j << " differs between 1 and " << n_threads << " threads" << endl;
+            exit(1);
+        }
+        n_samples += a.size();
+    }
+    cout << endl << n_samples << " output samples identical with 1 and " << n_threads << " threads" << endl;
+
+    // Final fields against SystemC
+    double max_err = 0;
+    for (size_t j = 0; j < n_lanes; ++j)
+        for (auto wlid : wavelength_ids)
+            max_err = max(max_err, abs(engines[0]->field(&output(j), wlid) - tb.m_out_fields[j][wlid]));
+    cout << "Largest difference of the final fields with SystemC: " << max_err << endl;
+    if (max_err > 1e-10)
+    {
+        cerr << "Final fields of the parallel engine differ from SystemC" << endl;
+        exit(1);
+    }
+
+    sc_close_vcd_trace_file(specsGlobalConfig.default_trace_file);
+}
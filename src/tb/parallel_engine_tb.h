@@ -0,0 +1,66 @@
+#pragma once
+
+#include "optical_signal.h"
+#include <systemc.h>
+#include <map>
+#include "specs.h"
+#include "parallel_engine.h"
+
+/* Parallel engine on a butterfly network of couplers.
+ *
+ * Stages of 2x2 couplers are connected by waveguides of slightly different
+ * lengths (perfect shuffle between stages), and a few outputs go through a
+ * lossy ring. The inputs change at all wavelengths at regular times.
+ *
+ * The circuit is first simulated by SystemC, then by the parallel engine
+ * with one thread and with several: the samples of the outputs must be
+ * bit-identical between the two runs of the engine, and the final fields
+ * must match those of SystemC.
+ */
+class parallel_engine_tb : public sc_module {
+public:
+    typedef OpticalSignal::field_type field_type;
+
+    // Field of an input from time t on
+    struct Change {
+        sc_time t;
+        size_t lane;
+        uint32_t wavelength_id;
+        field_type field;
+    };
+
+    vector<unique_ptr<spx::oa_port_out_type>> IN;
+    vector<unique_ptr<spx::oa_port_in_type>> OUT;
+
+    // Sorted by time, then wavelength
+    vector<Change> m_changes;
+
+    // Last field of each output, by wavelength
+    vector<std::map<uint32_t, field_type>> m_out_fields;
+
+    void run();
+    void monitor();
+
+    parallel_engine_tb(sc_module_name name, size_t n_lanes, const vector<Change> &changes)
+        : sc_module(name)
+        , m_changes(changes)
+        , m_out_fields(n_lanes)
+    {
+        SC_HAS_PROCESS(parallel_engine_tb);
+
+        for (size_t i = 0; i < n_lanes; ++i)
+        {
+            IN.push_back(make_unique<spx::oa_port_out_type>(("IN_" + to_string(i)).c_str()));
+            OUT.push_back(make_unique<spx::oa_port_in_type>(("OUT_" + to_string(i)).c_str()));
+        }
+
+        SC_THREAD(run);
+
+        SC_METHOD(monitor);
+        for (auto &p : OUT)
+            sensitive << *p;
+        dont_initialize();
+    }
+};
+
+void parallel_engine_tb_run();
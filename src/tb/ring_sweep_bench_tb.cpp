@@ -0,0 +1,66 @@
+#include <chrono>
+#include "tb/ring_sweep_bench_tb.h"
+
+#include "utils/sysc_utils.h"
+
+using namespace std::chrono;
+
+void ring_sweep_bench_tb::run()
+{
+    // Sweep more than one free spectral range (about 8.4 nm)
+    const double lambda_min = 1545e-9;
+    const double lambda_max = 1555e-9;
+
+    for (bool closed_form : { true, false })
+    {
+        m_ring->use_steady_state_model(closed_form);
+
+        double min_power = 1;
+        auto tic = high_resolution_clock::now();
+        for (size_t i = 0; i < m_n_points; ++i)
+        {
+            const double lambda = lambda_min + (lambda_max - lambda_min) * i / (m_n_points - 1);
+            IN->write(OpticalSignal(1, lambda));
+            wait(1, SC_NS);
+            if (OUT->read().getWavelength() == lambda)
+                min_power = std::min(min_power, norm(OUT->read().m_field));
+        }
+        auto toc = high_resolution_clock::now();
+
+        cout << (closed_form ? "Closed-form model: " : "Event-driven loop: ");
+        cout << duration<double>(toc - tic).count() << " s, ";
+        cout << "min through power " << 10 * log10(min_power) << " dB" << endl;
+    }
+}
+
+void ring_sweep_bench_tb_run()
+{
+    const size_t n_points = 1000;
+
+    // Apply SPECS resolution before creating any device
+    specsGlobalConfig.applyEngineResolution();
+
+    spx::oa_signal_type IN("IN"), OUT("OUT");
+
+    // 20 um radius, weak coupling and low loss (linewidth about 30 pm)
+    Ring ring("ring", 2 * M_PI * 20e-4, 0.98, 0, 0.5);
+    ring.p_in(IN);
+    ring.p_out(OUT);
+
+    ring_sweep_bench_tb tb("tb", &ring, n_points);
+    tb.IN(IN);
+    tb.OUT(OUT);
+
+    // Apply SPECS options specific to the testbench
+    specsGlobalConfig.simulation_mode = OpticalOutputPortMode::FREQUENCY_DOMAIN;
+    specsGlobalConfig.trace_all_optical_nets = 0;
+
+    // Run SPECS pre-simulation code
+    specsGlobalConfig.prepareSimulation();
+
+    cout << endl;
+    cout << "Ring sweep: " << n_points << " points" << endl;
+    sc_start();
+
+    sc_close_vcd_trace_file(specsGlobalConfig.default_trace_file);
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include "optical_signal.h"
+#include <systemc.h>
+#include "specs.h"
+#include "devices/ring.h"
+
+/* Benchmark of a wavelength sweep across the resonance of a high-Q ring.
+ *
+ * The sweep is run in FREQUENCY_DOMAIN mode, first with the closed-form
+ * model of the ring, then with the event-driven loop (coupler and
+ * waveguide), where every point takes many round trips to converge. The
+ * wall-clock time and the extinction at resonance are reported for both.
+ */
+class ring_sweep_bench_tb : public sc_module {
+public:
+    spx::oa_port_out_type IN;
+    spx::oa_port_in_type OUT;
+
+    Ring *m_ring;
+    size_t m_n_points;
+
+    void run();
+
+    ring_sweep_bench_tb(sc_module_name name, Ring *ring, size_t n_points)
+        : sc_module(name)
+        , m_ring(ring)
+        , m_n_points(n_points)
+    {
+        SC_HAS_PROCESS(ring_sweep_bench_tb);
+
+        SC_THREAD(run);
+    }
+};
+
+void ring_sweep_bench_tb_run();
@@ -0,0 +1,90 @@
+#include "tb/ring_tran_tb.h"
+
+typedef OpticalSignal::field_type field_type;
+
+namespace {
+void check(const char *what, const sc_time &t, const field_type &actual, const field_type &expected)
+{
+    cout << t << ": " << what << " " << actual << " (expected " << expected << ")" << endl;
+    if (abs(actual - expected) > 1e-9)
+    {
+        cerr << "Ring output differs from the expected transient at " << t << endl;
+        exit(1);
+    }
+}
+} // namespace
+
+void ring_tran_tb::run()
+{
+    const double lambda = 1550e-9;
+    const field_type E = polar(1.0, 0.3);
+
+    // Operating point: closed-form model
+    m_ring->use_steady_state_model(true);
+    IN->write(OpticalSignal(E, lambda));
+    wait(1, SC_NS);
+    const uint32_t wlid = OUT->read().m_wavelength_id;
+    check("OP", sc_time_stamp(), OUT->read().m_field, m_ring->transfer(wlid) * E);
+
+    // Transient: back to the loop, filled with its steady state
+    m_ring->use_steady_state_model(false);
+    const auto &r = m_ring->dc.m_S_through;
+    const auto &k = m_ring->dc.m_S_cross;
+    const auto A = m_ring->wg.transfer(wlid).S;
+    const sc_time tau = m_ring->wg.transfer(wlid).delay;
+
+    // The input changes at half round trips, so the loop field x is
+    // constant over slots of tau/2, with x_j = A (k in_{j-2} + r x_{j-2})
+    const size_t n_off = 11; // input off for 5.5 round trips
+    const size_t n_slots = 40;
+    const field_type x_ss = k * A * E / (1.0 - r * A);
+    vector<field_type> in(n_slots), x(n_slots);
+    for (size_t j = 0; j < n_slots; ++j)
+    {
+        in[j] = j < n_off ? 0.0 : E;
+        x[j] = j < 2 ? x_ss : A * (k * in[j - 2] + r * x[j - 2]);
+    }
+
+    const sc_time t0 = sc_time_stamp();
+    IN->write(OpticalSignal(0, lambda));
+    for (size_t j = 0; j < n_slots; ++j)
+    {
+        if (j == n_off)
+        {
+            wait(t0 + tau * (0.5 * j) - sc_time_stamp());
+            IN->write(OpticalSignal(E, lambda));
+        }
+        wait(t0 + tau * (0.5 * j + 0.25) - sc_time_stamp());
+        check(j < n_off ? "off" : "on ", sc_time_stamp(), OUT->read().m_field, r * in[j] + k * x[j]);
+    }
+
+    cout << endl << "Ring transient matches the loop recurrence" << endl;
+}
+
+void ring_tran_tb_run()
+{
+    // Apply SPECS resolution before creating any device
+    specsGlobalConfig.applyEngineResolution();
+
+    spx::oa_signal_type IN("IN"), OUT("OUT");
+
+    // 10 um radius, round trip of about 0.47 ps
+    Ring ring("ring", 2 * M_PI * 10e-4, 0.85, 0, 2);
+    ring.p_in(IN);
+    ring.p_out(OUT);
+
+    ring_tran_tb tb("tb", &ring);
+    tb.IN(IN);
+    tb.OUT(OUT);
+
+    // Apply SPECS options specific to the testbench
+    specsGlobalConfig.simulation_mode = OpticalOutputPortMode::EVENT_DRIVEN;
+    specsGlobalConfig.trace_all_optical_nets = 0;
+
+    // Run SPECS pre-simulation code
+    specsGlobalConfig.prepareSimulation();
+
+    sc_start();
+
+    sc_close_vcd_trace_file(specsGlobalConfig.default_trace_file);
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include "optical_signal.h"
+#include <systemc.h>
+#include "specs.h"
+#include "devices/ring.h"
+
+/* Transient response of a ring after an operating point.
+ *
+ * The ring is first driven with the closed-form model, as in an OP
+ * analysis, then switched back to its loop, as before a TRAN analysis. The
+ * input is switched off and on again, and the output is checked at every
+ * half round trip against the recurrence of the loop, starting from its
+ * steady state.
+ */
+class ring_tran_tb : public sc_module {
+public:
+    spx::oa_port_out_type IN;
+    spx::oa_port_in_type OUT;
+
+    Ring *m_ring;
+
+    void run();
+
+    ring_tran_tb(sc_module_name name, Ring *ring)
+        : sc_module(name)
+        , m_ring(ring)
+    {
+        SC_HAS_PROCESS(ring_tran_tb);
+
+        SC_THREAD(run);
+    }
+};
+
+void ring_tran_tb_run();
@@ -0,0 +1,147 @@
+#include <chrono>
+#include "tb/steady_state_rerun_tb.h"
+#include "devices/cw_source.h"
+#include "devices/directional_coupler.h"
+#include "devices/phaseshifter.h"
+#include "devices/probe.h"
+#include "devices/waveguide.h"
+#include "memory_trace.h"
+
+using namespace std::chrono;
+
+void steady_state_rerun_tb_run()
+{
+    // Apply SPECS resolution before creating any device
+    specsGlobalConfig.applyEngineResolution();
+
+    spx::oa_signal_type SRC("SRC"), ZERO("ZERO");
+    spx::oa_signal_type A1("A1"), A2("A2"), B1("B1"), B2("B2");
+    spx::oa_signal_type OUT1("OUT1"), OUT2("OUT2");
+    spx::ea_signal_type V_PS("V_PS");
+
+    CWSource cw("CW");
+    cw.setWavelength(1550e-9);
+    cw.setPower(1e-3);
+    cw.p_out(SRC);
+
+    DirectionalCouplerUni dc1("DC1"), dc2("DC2");
+    dc1.p_in1(SRC);
+    dc1.p_in2(ZERO);
+    dc1.p_out1(A1);
+    dc1.p_out2(A2);
+
+    PhaseShifterUni ps("PS");
+    ps.p_in(A1);
+    ps.p_out(B1);
+    ps.p_vin(V_PS);
+
+    WaveguideUni wg("WG", 1e-2, 1.0);
+    wg.p_in(A2);
+    wg.p_out(B2);
+
+    dc2.p_in1(B1);
+    dc2.p_in2(B2);
+    dc2.p_out1(OUT1);
+    dc2.p_out2(OUT2);
+
+    Probe probe1("PROBE1"), probe2("PROBE2");
+    probe1.p_in(OUT1);
+    probe2.p_in(OUT2);
+
+    // Apply SPECS options specific to the testbench
+    specsGlobalConfig.analysis_type = SPECSConfig::OP;
+    specsGlobalConfig.simulation_mode = OpticalOutputPortMode::FREQUENCY_DOMAIN;
+    specsGlobalConfig.trace_all_optical_nets = 0;
+    specsGlobalConfig.trace_filename = "";
+    specsGlobalConfig.default_abstol = 1e-14;
+    specsGlobalConfig.default_reltol = 1e-12;
+    auto mt = make_shared<MemoryTrace>();
+    specsGlobalConfig.memory_trace = mt;
+
+    specsGlobalConfig.runAnalysis();
+
+    // Outputs of the MZI from the current parameters of its devices
+    auto expected = [&](OpticalSignal::field_type out[2]) {
+        const auto E = cw.m_signal_on.m_field;
+        const auto a1 = dc1.m_S_through * E;
+        const auto a2 = dc1.m_S_cross * E;
+        const auto b1 = a1 * polar(ps.m_transmission_field, ps.m_sensitivity * V_PS.read());
+        const auto b2 = a2 * wg.transfer(cw.m_signal_on.m_wavelength_id).S;
+        out[0] = dc2.m_S_through * b1 + dc2.m_S_cross * b2;
+        out[1] = dc2.m_S_cross * b1 + dc2.m_S_through * b2;
+    };
+
+    struct Step {
+        string name;
+        string attribute;
+        double value;
+    };
+    const vector<Step> steps = {
+        {"", "", 0},
+        {"V_PS", "V", 1.2},
+        {"WG", "L", 1.5e-4},
+        {"WG", "ATT", 3.0},
+        {"DC2", "K", 0.3},
+        {"CW", "WL", 1551e-9},
+        {"cw", "P", 2e-3},
+    };
+
+    size_t n_failed = 0;
+    int64_t last_tick = -1;
+    double t_rerun = 0;
+    const MemoryTrace::channel_id channels[2] = {mt->find("PROBE1"), mt->find("PROBE2")};
+    for (const auto &step : steps)
+    {
+        if (step.name.size() && !specsGlobalConfig.setParameter(step.name, step.attribute, step.value))
+            exit(1);
+
+        mt->clear();
+        auto t_start = high_resolution_clock::now();
+        if (!specsGlobalConfig.rerunSteadyState())
+            exit(1);
+        t_rerun += duration<double>(high_resolution_clock::now() - t_start).count();
+
+        OpticalSignal::field_type out[2];
+        expected(out);
+        const uint32_t wlid = cw.m_signal_on.m_wavelength_id;
+        for (size_t j = 0; j < 2; ++j)
+        {
+            // Last sample at the wavelength of the source
+            const auto &ch = mt->channel(channels[j]);
+            size_t k = ch.times.size();
+            while (k > 0 && ch.values[0][k - 1] != wlid)
+                --k;
+            if (k == 0 || (int64_t)ch.times[0] <= last_tick)
+            {
+                cerr << step.name << " " << step.attribute << ": no new sample on " << ch.name << endl;
+                ++n_failed;
+                continue;
+            }
+            const OpticalSignal::field_type got(ch.values[1][k - 1], ch.values[2][k - 1]);
+            if (abs(got - out[j]) > 1e-12)
+            {
+                cerr << step.name << " " << step.attribute << " = " << step.value << ": ";
+                cerr << ch.name << " got " << got << ", expected " << out[j] << endl;
+                ++n_failed;
+            }
+        }
+        last_tick = mt->channel(channels[0]).times.back();
+    }
+
+    // Parameters which can't be set
+    if (specsGlobalConfig.setParameter("NOPE", "L", 1) || specsGlobalConfig.setParameter("WG", "K", 1))
+    {
+        cerr << "Unknown elements or attributes were accepted" << endl;
+        ++n_failed;
+    }
+
+    if (n_failed)
+    {
+        cerr << "Steady state after parameter changes: " << n_failed << " wrong outputs" << endl;
+        exit(1);
+    }
+    cout << "Steady state after parameter changes: all outputs match (" << steps.size();
+    cout << " runs without elaborating again, " << t_rerun / steps.size() << " s per run)" << endl;
+
+    sc_close_vcd_trace_file(specsGlobalConfig.default_trace_file);
+}
@@ -0,0 +1,16 @@
+#pragma once
+
+#include <systemc.h>
+#include "specs.h"
+
+/* Operating point of an elaborated circuit, run again with other parameters.
+ *
+ * A Mach-Zehnder interferometer (a phase shifter driven by an electrical
+ * net in one arm, a waveguide in the other) is built once and its OP
+ * analysis run. Parameters of the phase shifter net, the waveguide, the
+ * second coupler and the CW source are then changed in turn with
+ * SPECSConfig::setParameter() and the analysis run again in the same
+ * process; the fields recorded by the probes at the outputs must match the
+ * transmission computed from the devices.
+ */
+void steady_state_rerun_tb_run();
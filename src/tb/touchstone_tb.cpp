@@ -0,0 +1,108 @@
+#include "tb/touchstone_tb.h"
+
+void touchstone_tb::run()
+{
+    const size_t N = IN.size();
+
+    for (size_t f = 0; f < m_freqs.size(); ++f)
+    {
+        const double lambda = 299792458.0 / m_freqs[f];
+        for (size_t i = 0; i < N; ++i)
+        {
+            (*IN[i])->write(OpticalSignal(1.0, lambda));
+            wait(10, SC_PS);
+
+            for (size_t j = 0; j < N; ++j)
+            {
+                const auto &out = (*OUT[j])->read();
+                const auto &expected = m_expected[f][i * N + j];
+                if (abs(out.m_field - expected) > 1e-9)
+                {
+                    cerr << name() << ": " << m_freqs[f] << " Hz, input " << i;
+                    cerr << " to output " << j << ": got " << out.m_field;
+                    cerr << ", expected " << expected << endl;
+                    ++m_n_failed;
+                }
+            }
+
+            (*IN[i])->write(OpticalSignal(0.0, lambda));
+            wait(10, SC_PS);
+        }
+    }
+}
+
+void touchstone_tb_run()
+{
+    // Apply SPECS resolution before creating any device
+    specsGlobalConfig.applyEngineResolution();
+
+    auto deg = [](double m, double phi) { return polar(m, phi * M_PI / 180); };
+
+    // Two-port at the points of the file and halfway between them. S21
+    // wraps around -180 degrees in the file (-150, 174, 138), so its
+    // unwrapped phase is 150, 186 and 222 degrees once conjugated.
+    const vector<double> freqs_2p = {193.0e12, 193.05e12, 193.1e12, 193.15e12, 193.2e12};
+    vector<touchstone_tb::matrix_type> expected_2p;
+    for (size_t f = 0; f < freqs_2p.size(); ++f)
+    {
+        const double x = f / 2.0; // position in points of the file
+        expected_2p.push_back({
+            deg(0.1, 0), deg(0.9 - 0.1 * x, 150 + 36 * x),
+            deg(0.5, 60), deg(0.2, -90),
+        });
+    }
+
+    // Four-port between its two (identical) points
+    const vector<double> freqs_4p = {193.1e12};
+    touchstone_tb::matrix_type expected_4p;
+    for (size_t i = 0; i < 4; ++i)
+        for (size_t j = 0; j < 4; ++j)
+            expected_4p.push_back(conj(complex<double>(0.1 * (j + 1) + 0.01 * (i + 1), -0.02)));
+
+    // Ordering of the 2-port columns, noise parameters
+    auto data_2p = TouchstoneData::load("circuits/touchstone/two_port.s2p");
+    if (data_2p->nports != 2 || data_2p->freq.size() != 3 || data_2p->z0 != 50)
+    {
+        cerr << "two_port.s2p: wrong number of ports or points, or reference impedance" << endl;
+        exit(1);
+    }
+
+    TouchstoneDevice uut_2p("uut_2p", data_2p);
+    TouchstoneDevice uut_4p("uut_4p", "circuits/touchstone/four_port.s4p");
+    touchstone_tb tb_2p("tb_2p", 2, freqs_2p, expected_2p);
+    touchstone_tb tb_4p("tb_4p", 4, freqs_4p, {expected_4p});
+
+    vector<unique_ptr<spx::oa_signal_type>> sigs;
+    for (auto [uut, tb] : {pair{&uut_2p, &tb_2p}, pair{&uut_4p, &tb_4p}})
+    {
+        for (size_t i = 0; i < uut->nports; ++i)
+        {
+            const string prefix = string(uut->basename()) + "_" + to_string(i);
+            sigs.push_back(make_unique<spx::oa_signal_type>((prefix + "_IN").c_str()));
+            uut->ports_in[i]->bind(*sigs.back());
+            tb->IN[i]->bind(*sigs.back());
+            sigs.push_back(make_unique<spx::oa_signal_type>((prefix + "_OUT").c_str()));
+            uut->ports_out[i]->bind(*sigs.back());
+            tb->OUT[i]->bind(*sigs.back());
+        }
+    }
+
+    // Apply SPECS options specific to the testbench
+    specsGlobalConfig.simulation_mode = OpticalOutputPortMode::EVENT_DRIVEN;
+    specsGlobalConfig.trace_all_optical_nets = 0;
+
+    // Run SPECS pre-simulation code
+    specsGlobalConfig.prepareSimulation();
+
+    sc_start();
+
+    if (tb_2p.m_n_failed + tb_4p.m_n_failed > 0)
+    {
+        cerr << "Touchstone devices: " << tb_2p.m_n_failed + tb_4p.m_n_failed;
+        cerr << " wrong transmissions" << endl;
+        exit(1);
+    }
+    cout << "Touchstone devices: all transmissions match the files" << endl;
+
+    sc_close_vcd_trace_file(specsGlobalConfig.default_trace_file);
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include "optical_signal.h"
+#include <systemc.h>
+#include "specs.h"
+#include "devices/touchstone_device.h"
+
+/* Transmission of Touchstone devices at known frequencies.
+ *
+ * Uses the fixtures of circuits/touchstone (run from the root of the
+ * repository). Each input of the device is excited in turn at each
+ * frequency, and all outputs are compared to the transmission expected
+ * from the file: conjugated S-parameters, with 2-port columns in the order
+ * S11 S21 S12 S22 and others row by row, and magnitude and unwrapped phase
+ * interpolated linearly between points.
+ */
+class touchstone_tb : public sc_module {
+public:
+    // Expected transmission from input i to output j, at index i * N + j
+    typedef vector<complex<double>> matrix_type;
+
+    vector<unique_ptr<spx::oa_port_out_type>> IN;
+    vector<unique_ptr<spx::oa_port_in_type>> OUT;
+
+    vector<double> m_freqs;
+    vector<matrix_type> m_expected;
+    size_t m_n_failed = 0;
+
+    void run();
+
+    touchstone_tb(sc_module_name name, size_t nports, const vector<double> &freqs,
+            const vector<matrix_type> &expected)
+        : sc_module(name)
+        , m_freqs(freqs)
+        , m_expected(expected)
+    {
+        SC_HAS_PROCESS(touchstone_tb);
+
+        for (size_t i = 0; i < nports; ++i)
+        {
+            IN.push_back(make_unique<spx::oa_port_out_type>(("IN_" + to_string(i)).c_str()));
+            OUT.push_back(make_unique<spx::oa_port_in_type>(("OUT_" + to_string(i)).c_str()));
+        }
+
+        SC_THREAD(run);
+    }
+};
+
+void touchstone_tb_run();
@@ -0,0 +1,125 @@
+#include <chrono>
+#include <random>
+#include "tb/wdm_bench_tb.h"
+#include "devices/directional_coupler.h"
+#include "devices/merger.h"
+#include "devices/phaseshifter.h"
+#include "devices/power_meter.h"
+#include "devices/detector.h"
+
+#include "utils/sysc_utils.h"
+
+using namespace std::chrono;
+
+void wdm_bench_tb::run()
+{
+    std::mt19937 gen(1234);
+    std::uniform_real_distribution<double> amplitude(0, 1);
+    std::uniform_real_distribution<double> phase(0, 2 * M_PI);
+
+    for (size_t k = 0; k < m_n_steps; ++k)
+    {
+        // One wavelength per delta cycle on each bus
+        for (const auto &wlid : m_wavelength_ids)
+        {
+            BUS1->write(OpticalSignal(polar(amplitude(gen), phase(gen)), wlid));
+            BUS2->write(OpticalSignal(polar(amplitude(gen), phase(gen)), wlid));
+            wait(SC_ZERO_TIME);
+        }
+        wait(1, SC_NS);
+
+        // Re-emit all channels through the phase shifter
+        VPHI->write(phase(gen));
+        wait(1, SC_NS);
+    }
+}
+
+void wdm_bench_tb_run()
+{
+    const size_t n_channels = 64;
+    const size_t n_stages = 16;
+    const size_t n_steps = 100;
+
+    // Apply SPECS resolution before creating any device
+    specsGlobalConfig.applyEngineResolution();
+
+    // Register the channels (C-band, 100 GHz grid)
+    vector<uint32_t> wavelength_ids;
+    for (size_t i = 0; i < n_channels; ++i)
+    {
+        const double freq = 196.1e12 - i * 100e9;
+        wavelength_ids.push_back(OpticalSignal(0, 299792458.0 / freq).m_wavelength_id);
+    }
+
+    // Optical nets
+    vector<unique_ptr<spx::oa_signal_type>> sig1, sig2;
+    for (size_t i = 0; i <= n_stages; ++i)
+    {
+        sig1.push_back(make_unique<spx::oa_signal_type>(("BUS1_" + to_string(i)).c_str()));
+        sig2.push_back(make_unique<spx::oa_signal_type>(("BUS2_" + to_string(i)).c_str()));
+    }
+    spx::oa_signal_type merged("MERGED"), shifted("SHIFTED");
+    spx::ea_signal_type vphi("VPHI"), readout("READOUT");
+
+    auto t_elab_start = high_resolution_clock::now();
+
+    vector<unique_ptr<DirectionalCouplerUni>> dcs;
+    for (size_t i = 0; i < n_stages; ++i)
+    {
+        dcs.push_back(make_unique<DirectionalCouplerUni>(("dc_" + to_string(i)).c_str(), 0.9));
+        dcs[i]->p_in1(*sig1[i]);
+        dcs[i]->p_in2(*sig2[i]);
+        dcs[i]->p_out1(*sig1[i + 1]);
+        dcs[i]->p_out2(*sig2[i + 1]);
+    }
+
+    Merger merger("merger");
+    merger.p_in1(*sig1[n_stages]);
+    merger.p_in2(*sig2[n_stages]);
+    merger.p_out(merged);
+
+    PhaseShifterUni ps("ps");
+    ps.p_in(merged);
+    ps.p_vin(vphi);
+    ps.p_out(shifted);
+
+    PowerMeter pm("pm");
+    pm.p_in(shifted);
+
+    Detector pdet("pdet");
+    pdet.p_in(shifted);
+    pdet.p_readout(readout);
+
+    wdm_bench_tb tb("tb", wavelength_ids, n_steps);
+    tb.BUS1(*sig1[0]);
+    tb.BUS2(*sig2[0]);
+    tb.VPHI(vphi);
+
+    // Apply SPECS options specific to the testbench
+    specsGlobalConfig.simulation_mode = OpticalOutputPortMode::EVENT_DRIVEN;
+    specsGlobalConfig.trace_all_optical_nets = 0;
+
+    // Run SPECS pre-simulation code
+    specsGlobalConfig.prepareSimulation();
+
+    // Elaborate and run
+    sc_start(SC_ZERO_TIME);
+    auto t_sim_start = high_resolution_clock::now();
+    sc_start();
+    auto t_sim_stop = high_resolution_clock::now();
+
+    const double t_elab = duration<double>(t_sim_start - t_elab_start).count();
+    const double t_sim = duration<double>(t_sim_stop - t_sim_start).count();
+
+    cout << endl;
+    cout << "WDM link: " << n_channels << " channels, " << n_stages;
+    cout << " coupler stages, " << n_steps << " steps" << endl;
+    cout << "Final power: " << pm.m_cur_power << " W" << endl;
+    cout << "Elaboration: " << t_elab << " s" << endl;
+    cout << "Simulation: " << t_sim << " s" << endl;
+    cout << "OpticalSignal: " << sizeof(OpticalSignal) << " bytes";
+    cout << (SPECS_SIGNAL_IDS ? " (with ids)" : "") << endl;
+    specsGlobalConfig.printEventStats(t_sim);
+
+    sc_close_vcd_trace_file(specsGlobalConfig.default_trace_file);
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include "optical_signal.h"
+#include <systemc.h>
+#include "specs.h"
+
+/* Benchmark of a WDM link carrying many channels (64 by default).
+ *
+ * Two buses carrying all channels go through a chain of directional
+ * couplers, are merged and then go through a phase shifter into a power
+ * meter and a photodetector. Each step writes a new random field on every
+ * channel and then changes the phase shift, which makes the phase shifter
+ * re-emit all channels. Every device keeps one field per wavelength, so the
+ * run time mostly measures per-wavelength memory accesses.
+ */
+class wdm_bench_tb : public sc_module {
+public:
+    spx::oa_port_out_type BUS1;
+    spx::oa_port_out_type BUS2;
+    spx::ea_port_out_type VPHI;
+
+    vector<uint32_t> m_wavelength_ids;
+    size_t m_n_steps;
+
+    void run();
+
+    wdm_bench_tb(sc_module_name name, const vector<uint32_t> &wavelength_ids, size_t n_steps)
+        : sc_module(name)
+        , m_wavelength_ids(wavelength_ids)
+        , m_n_steps(n_steps)
+    {
+        SC_HAS_PROCESS(wdm_bench_tb);
+
+        SC_THREAD(run);
+    }
+};
+
+void wdm_bench_tb_run();
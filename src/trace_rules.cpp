@@ -0,0 +1,99 @@
+#include "trace_rules.h"
+
+#include <cmath>
+#include <iostream>
+
+using namespace std;
+
+namespace {
+
+// Equivalent regular expression of a glob
+string glob_to_regex(const string &glob)
+{
+    string re;
+    for (size_t i = 0; i < glob.size(); ++i)
+    {
+        const char c = glob[i];
+        switch (c) {
+            case '*':
+                re += ".*";
+                break;
+            case '?':
+                re += ".";
+                break;
+            case '[':
+            {
+                // Character class, copied as is ([!...] negates, as in sh)
+                const size_t end = glob.find(']', i + 2);
+                if (end == string::npos)
+                {
+                    re += "\\[";
+                    break;
+                }
+                string cls = glob.substr(i + 1, end - i - 1);
+                if (cls[0] == '!')
+                    cls[0] = '^';
+                re += "[" + cls + "]";
+                i = end;
+                break;
+            }
+            default:
+                if (string("\\^$.|+(){}]").find(c) != string::npos)
+                    re += '\\';
+                re += c;
+        }
+    }
+    return re;
+}
+
+} // namespace
+
+bool TraceDeadband::accept(uint32_t wavelength_id, const complex<double> &field)
+{
+    if (!enabled())
+        return true;
+
+    const double p = norm(field);
+    const double ph = arg(field);
+    if (wavelength_id >= m_last.size())
+        m_last.resize(wavelength_id + 1);
+    auto &last = m_last[wavelength_id];
+
+    if (last.valid)
+    {
+        bool inside = true;
+        if (abs_power >= 0 || rel_power >= 0)
+        {
+            const double band = max(abs_power, rel_power * abs(last.power));
+            inside = abs(p - last.power) <= band;
+        }
+        if (inside && phase >= 0)
+            inside = abs(remainder(ph - last.phase, 2 * M_PI)) <= phase;
+        if (inside)
+            return false;
+    }
+    last.power = p;
+    last.phase = ph;
+    last.valid = true;
+    return true;
+}
+
+TraceRule::TraceRule(const string &pattern)
+    : m_pattern(pattern)
+{
+    m_is_regex = pattern.compare(0, 3, "re:") == 0;
+    const string re = m_is_regex ? pattern.substr(3) : glob_to_regex(pattern);
+    try {
+        m_regex = regex(re, regex::ECMAScript | regex::optimize);
+    } catch (const regex_error &e) {
+        cerr << "Invalid .SAVE pattern: " << pattern << " (" << e.what() << ")" << endl;
+        exit(1);
+    }
+}
+
+bool TraceRule::matches(const string &name) const
+{
+    if (m_is_regex)
+        return regex_search(name, m_regex);
+    return regex_match(name, m_regex);
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <complex>
+#include <cstdint>
+#include <regex>
+#include <string>
+#include <vector>
+
+using std::string;
+using std::vector;
+
+/** Deadband of a trace: samples whose power and phase didn't move by more
+ * than the thresholds since the last recorded sample (at the same
+ * wavelength) are not recorded.
+ *
+ * A negative threshold means the quantity is not considered. With all
+ * thresholds negative (the default), every sample is recorded; a
+ * threshold of 0 only drops repeated values.
+ */
+class TraceDeadband {
+public:
+    double abs_power = -1; // W
+    double rel_power = -1; // relative to the last recorded power
+    double phase = -1;     // rad
+
+private:
+    struct Last {
+        double power;
+        double phase;
+        bool valid = false;
+    };
+    vector<Last> m_last; // by wavelength id
+
+public:
+    inline bool enabled() const
+    {
+        return abs_power >= 0 || rel_power >= 0 || phase >= 0;
+    }
+
+    /** Whether a sample should be recorded (and remember it if so) */
+    bool accept(uint32_t wavelength_id, const std::complex<double> &field);
+
+    /** Forget the recorded samples */
+    inline void reset() { m_last.clear(); }
+};
+
+/** A pattern of a .SAVE directive, and the deadband of the traces it saves
+ *
+ * Patterns are globs (`*`, `?`, `[...]`) matched against the whole
+ * hierarchical name, or regular expressions (ECMAScript) when prefixed
+ * with `re:`, which match anywhere in the name unless anchored.
+ */
+class TraceRule {
+private:
+    string m_pattern;
+    std::regex m_regex;
+    bool m_is_regex;
+
+public:
+    TraceDeadband deadband;
+
+    explicit TraceRule(const string &pattern);
+
+    inline const string &pattern() const { return m_pattern; }
+
+    /** Whether name (a net or device name) is selected by the rule */
+    bool matches(const string &name) const;
+};
@@ -0,0 +1,118 @@
+#pragma once
+
+#include <systemc.h>
+
+#include <cstdint>
+#include <functional>
+#include <queue>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+using std::pair;
+using std::vector;
+using std::greater;
+using std::size_t;
+
+/** Ordered store of pending events keyed by (timestamp, channel id).
+ *
+ * Each (timestamp, id) pair can hold at most one pending value. Looking up
+ * an existing entry (to coalesce a new write with it) is O(1) on average
+ * thanks to a hash index, while popping the earliest entry is O(log n) using
+ * a binary heap over the keys. Entries with the same timestamp are popped
+ * in increasing id order.
+ *
+ * This replaces the linear scan of `PQueue` that used to be done on every
+ * write by the optical output ports.
+ */
+template <class T>
+class PendingEventQueue {
+public:
+    typedef sc_time::value_type time_value_type;
+    typedef uint32_t id_type;
+    typedef pair<time_value_type, id_type> key_type;
+
+private:
+    struct key_hash {
+        size_t operator()(const key_type &k) const
+        {
+            // splitmix-style mixing of timestamp and id
+            uint64_t x = k.first ^ (static_cast<uint64_t>(k.second) * 0x9e3779b97f4a7c15ULL);
+            x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+            x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+            return static_cast<size_t>(x ^ (x >> 31));
+        }
+    };
+
+    std::unordered_map<key_type, T, key_hash> m_entries;
+    std::priority_queue<key_type, vector<key_type>, greater<key_type>> m_order;
+
+public:
+    PendingEventQueue() {}
+
+    /** Insert value at (t, id) if no entry exists yet.
+     *
+     * Returns a pointer to the stored value and true if it was inserted, or
+     * a pointer to the already pending value and false otherwise, so that
+     * the caller can coalesce with it.
+     */
+    pair<T *, bool> emplace(const sc_time &t, id_type id, const T &value)
+    {
+        key_type k(t.value(), id);
+        auto res = m_entries.emplace(k, value);
+        if (res.second)
+            m_order.push(k);
+        return make_pair(&res.first->second, res.second);
+    }
+
+    /** Return a pointer to the value pending at (t, id), or nullptr */
+    T *find(const sc_time &t, id_type id)
+    {
+        auto it = m_entries.find(key_type(t.value(), id));
+        return it == m_entries.end() ? nullptr : &it->second;
+    }
+
+    /** Timestamp of the earliest pending entry (queue must not be empty) */
+    sc_time top_time() const
+    {
+        return sc_time::from_value(m_order.top().first);
+    }
+
+    /** Id of the earliest pending entry (queue must not be empty) */
+    id_type top_id() const
+    {
+        return m_order.top().second;
+    }
+
+    /** Remove the earliest pending entry and return its timestamp and value */
+    pair<sc_time, T> pop()
+    {
+        const key_type k = m_order.top();
+        m_order.pop();
+        auto it = m_entries.find(k);
+        pair<sc_time, T> ret(sc_time::from_value(k.first), std::move(it->second));
+        m_entries.erase(it);
+        return ret;
+    }
+
+    void reserve(size_t n)
+    {
+        m_entries.reserve(n);
+    }
+
+    void clear()
+    {
+        m_entries.clear();
+        m_order = decltype(m_order)();
+    }
+
+    size_t size() const
+    {
+        return m_order.size();
+    }
+
+    bool empty() const
+    {
+        return m_order.empty();
+    }
+};
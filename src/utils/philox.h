@@ -0,0 +1,163 @@
+#pragma once
+
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+using std::array;
+using std::vector;
+using std::size_t;
+
+/** Philox4x32-10 counter-based random number generator.
+ *
+ * (Salmon et al., "Parallel random numbers: as easy as 1, 2, 3", SC'11.)
+ *
+ * The output is a pure function of a 128-bit counter and a 64-bit key:
+ * there is no state to advance, so sample `i` of stream `key` can be drawn
+ * from anywhere, in any order, and is the same whatever the number of
+ * threads or the order of the events which requested the samples.
+ */
+namespace philox {
+
+typedef array<uint32_t, 4> counter_type;
+typedef array<uint32_t, 2> key_type;
+
+inline void mulhilo(uint32_t a, uint32_t b, uint32_t &hi, uint32_t &lo)
+{
+    const uint64_t p = static_cast<uint64_t>(a) * b;
+    hi = static_cast<uint32_t>(p >> 32);
+    lo = static_cast<uint32_t>(p);
+}
+
+/** Four random 32-bit words for counter c under key k */
+inline counter_type philox4x32(counter_type c, key_type k)
+{
+    constexpr uint32_t M0 = 0xD2511F53;
+    constexpr uint32_t M1 = 0xCD9E8D57;
+    constexpr uint32_t W0 = 0x9E3779B9;
+    constexpr uint32_t W1 = 0xBB67AE85;
+
+    for (int round = 0; round < 10; ++round)
+    {
+        uint32_t hi0, lo0, hi1, lo1;
+        mulhilo(M0, c[0], hi0, lo0);
+        mulhilo(M1, c[2], hi1, lo1);
+        c = {hi1 ^ c[1] ^ k[0], lo1, hi0 ^ c[3] ^ k[1], lo0};
+        k[0] += W0;
+        k[1] += W1;
+    }
+    return c;
+}
+
+/** Key of a stream, from a 64-bit seed and the name of its owner
+ *
+ * Names are hashed (FNV-1a) so that the key of a device doesn't depend on
+ * the order in which devices are created.
+ */
+inline key_type make_key(uint64_t seed, const std::string &name)
+{
+    uint64_t h = 0xcbf29ce484222325ull;
+    for (unsigned char ch : name)
+    {
+        h ^= ch;
+        h *= 0x100000001b3ull;
+    }
+    // splitmix64 finalizer on the seed, so that nearby seeds give
+    // unrelated keys
+    uint64_t z = seed + 0x9e3779b97f4a7c15ull;
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+    z ^= z >> 31;
+    h ^= z;
+    return {static_cast<uint32_t>(h), static_cast<uint32_t>(h >> 32)};
+}
+
+/** Uniform double in (0, 1) from two 32-bit words (53 bits) */
+inline double to_open_unit(uint32_t a, uint32_t b)
+{
+    const uint64_t x = (static_cast<uint64_t>(a) << 21) ^ (b >> 11);
+    return (static_cast<double>(x) + 0.5) * (1.0 / 9007199254740992.0);
+}
+
+/** Standard normal samples [first, first + n) of stream key
+ *
+ * Sample 2j and 2j+1 are the Box-Muller pair of counter j. The words are
+ * generated for the whole batch first, then transformed in a separate loop
+ * which the compiler can vectorize.
+ */
+inline void fill_normal(const key_type &key, uint64_t first, double *out, size_t n)
+{
+    if (n == 0)
+        return;
+    const uint64_t j0 = first / 2;
+    const uint64_t j1 = (first + n + 1) / 2;
+    const size_t n_pairs = j1 - j0;
+
+    thread_local vector<double> u1, u2;
+    u1.resize(n_pairs);
+    u2.resize(n_pairs);
+    for (size_t p = 0; p < n_pairs; ++p)
+    {
+        const uint64_t j = j0 + p;
+        const auto r = philox4x32({static_cast<uint32_t>(j), static_cast<uint32_t>(j >> 32), 0, 0}, key);
+        u1[p] = to_open_unit(r[0], r[1]);
+        u2[p] = to_open_unit(r[2], r[3]);
+    }
+
+    const size_t skip = first % 2;
+    for (size_t p = 0; p < n_pairs; ++p)
+    {
+        const double radius = std::sqrt(-2.0 * std::log(u1[p]));
+        const double angle = 2.0 * M_PI * u2[p];
+        const size_t i0 = 2 * p;
+        if (i0 >= skip && i0 - skip < n)
+            out[i0 - skip] = radius * std::cos(angle);
+        if (i0 + 1 - skip < n)
+            out[i0 + 1 - skip] = radius * std::sin(angle);
+    }
+}
+
+/** Sequential reader of a normal stream, refilled by batches */
+class NormalStream {
+public:
+    static constexpr size_t batch_size = 256;
+
+private:
+    key_type m_key = {0, 0};
+    uint64_t m_next = 0;        // index of the next sample
+    uint64_t m_batch_start = 0; // index of m_batch[0]
+    bool m_batch_valid = false;
+    array<double, batch_size> m_batch;
+
+public:
+    NormalStream() {}
+
+    /** Restart at sample 0 of the stream of key */
+    void seed(const key_type &key)
+    {
+        m_key = key;
+        m_next = 0;
+        m_batch_valid = false;
+    }
+
+    /** Move to sample index of the stream */
+    inline void seek(uint64_t index) { m_next = index; }
+
+    /** Index of the next sample */
+    inline uint64_t tell() const { return m_next; }
+
+    inline double operator()()
+    {
+        if (!m_batch_valid || m_next < m_batch_start || m_next - m_batch_start >= batch_size)
+        {
+            m_batch_start = m_next;
+            fill_normal(m_key, m_batch_start, m_batch.data(), batch_size);
+            m_batch_valid = true;
+        }
+        return m_batch[m_next++ - m_batch_start];
+    }
+};
+
+} // namespace philox
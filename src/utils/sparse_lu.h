@@ -0,0 +1,262 @@
+#pragma once
+
+#include <cmath>
+#include <complex>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+using std::vector;
+using std::size_t;
+
+/** Sparse LU factorization with partial pivoting.
+ *
+ * Left-looking (Gilbert-Peierls) factorization of a square matrix given in
+ * compressed sparse column (CSC) form: each column k of L and U is obtained
+ * from a sparse triangular solve with the columns of L already computed,
+ * whose nonzero pattern is found by a depth-first search in the graph of L.
+ * The cost is proportional to the number of floating-point operations, which
+ * stays close to linear for the matrices of photonic circuits (mostly
+ * feed-forward, with a few short loops).
+ *
+ * Row pivoting is threshold-based: the diagonal entry is kept as pivot when
+ * its modulus is at least `pivot_tol` times the largest candidate, which
+ * preserves sparsity for diagonally dominant matrices such as (I - S).
+ *
+ * Usage:
+ *     SparseLU<complex<double>> lu;
+ *     lu.set_matrix(n, colptr, rowind, values);
+ *     if (lu.factorize())
+ *         lu.solve(b); // b is overwritten with x such that A x = b
+ */
+template <class T>
+class SparseLU {
+public:
+    typedef T value_type;
+    typedef int64_t index_type;
+
+    double pivot_tol = 0.1;
+
+private:
+    index_type m_n = 0;
+
+    // Matrix to factorize (CSC)
+    vector<index_type> m_Ap;
+    vector<index_type> m_Ai;
+    vector<T> m_Ax;
+
+    // Factors (CSC). L has a unit diagonal stored first in each column,
+    // U has its diagonal stored last in each column.
+    vector<index_type> m_Lp, m_Li, m_Up, m_Ui;
+    vector<T> m_Lx, m_Ux;
+
+    // pinv[i] = k if row i is the k-th pivot
+    vector<index_type> m_pinv;
+
+    // Work arrays
+    vector<T> m_x;
+    vector<index_type> m_xi;
+    vector<index_type> m_stack;
+    vector<index_type> m_pstack;
+    vector<bool> m_marked;
+
+    static inline double modulus(const T &v)
+    {
+        using std::abs;
+        return abs(v);
+    }
+
+    // Depth-first search from row j in the graph of L. Visited rows are
+    // pushed to m_xi[top-1], m_xi[top-2], ... in reverse topological order.
+    index_type dfs(index_type j, index_type top)
+    {
+        index_type head = 0;
+        m_stack[0] = j;
+        while (head >= 0)
+        {
+            j = m_stack[head];
+            const index_type jcol = m_pinv[j];
+            if (!m_marked[j])
+            {
+                m_marked[j] = true;
+                m_pstack[head] = (jcol < 0) ? 0 : m_Lp[jcol] + 1;
+            }
+            bool done = true;
+            const index_type pend = (jcol < 0) ? 0 : m_Lp[jcol + 1];
+            for (index_type p = m_pstack[head]; p < pend; ++p)
+            {
+                const index_type i = m_Li[p];
+                if (m_marked[i])
+                    continue;
+                m_pstack[head] = p + 1;
+                m_stack[++head] = i;
+                done = false;
+                break;
+            }
+            if (done)
+            {
+                --head;
+                m_xi[--top] = j;
+            }
+        }
+        return top;
+    }
+
+public:
+    SparseLU() {}
+
+    /** Set the matrix to factorize (n x n, CSC) */
+    void set_matrix(index_type n, vector<index_type> colptr,
+                    vector<index_type> rowind, vector<T> values)
+    {
+        m_n = n;
+        m_Ap = std::move(colptr);
+        m_Ai = std::move(rowind);
+        m_Ax = std::move(values);
+    }
+
+    inline index_type size() const { return m_n; }
+
+    /** Number of nonzeros in L and U */
+    inline size_t nnz_factors() const { return m_Lx.size() + m_Ux.size(); }
+
+    /** Factorize the matrix. Returns false if it is (numerically) singular. */
+    bool factorize()
+    {
+        const index_type n = m_n;
+
+        m_Lp.assign(n + 1, 0);
+        m_Up.assign(n + 1, 0);
+        m_Li.clear();
+        m_Lx.clear();
+        m_Ui.clear();
+        m_Ux.clear();
+        m_Li.reserve(m_Ai.size() + n);
+        m_Lx.reserve(m_Ai.size() + n);
+        m_Ui.reserve(m_Ai.size() + n);
+        m_Ux.reserve(m_Ai.size() + n);
+
+        m_pinv.assign(n, -1);
+        m_x.assign(n, T(0));
+        m_xi.assign(n, 0);
+        m_stack.assign(n, 0);
+        m_pstack.assign(n, 0);
+        m_marked.assign(n, false);
+
+        for (index_type k = 0; k < n; ++k)
+        {
+            m_Lp[k] = m_Li.size();
+            m_Up[k] = m_Ui.size();
+
+            // Nonzero pattern of x = L \ A(:,k), in topological order
+            index_type top = n;
+            for (index_type p = m_Ap[k]; p < m_Ap[k + 1]; ++p)
+                if (!m_marked[m_Ai[p]])
+                    top = dfs(m_Ai[p], top);
+            for (index_type p = top; p < n; ++p)
+                m_marked[m_xi[p]] = false;
+
+            // Scatter A(:,k) and solve the triangular system
+            for (index_type p = top; p < n; ++p)
+                m_x[m_xi[p]] = T(0);
+            for (index_type p = m_Ap[k]; p < m_Ap[k + 1]; ++p)
+                m_x[m_Ai[p]] += m_Ax[p];
+            for (index_type px = top; px < n; ++px)
+            {
+                const index_type j = m_xi[px];
+                const index_type J = m_pinv[j];
+                if (J < 0)
+                    continue;
+                // L has a unit diagonal
+                const T xj = m_x[j];
+                for (index_type p = m_Lp[J] + 1; p < m_Lp[J + 1]; ++p)
+                    m_x[m_Li[p]] -= m_Lx[p] * xj;
+            }
+
+            // Find the pivot, store U(:,k)
+            index_type ipiv = -1;
+            double amax = -1;
+            for (index_type px = top; px < n; ++px)
+            {
+                const index_type i = m_xi[px];
+                if (m_pinv[i] < 0)
+                {
+                    const double a = modulus(m_x[i]);
+                    if (a > amax)
+                    {
+                        amax = a;
+                        ipiv = i;
+                    }
+                }
+                else
+                {
+                    m_Ui.push_back(m_pinv[i]);
+                    m_Ux.push_back(m_x[i]);
+                }
+            }
+            if (ipiv < 0 || amax <= 0 || !std::isfinite(amax))
+                return false;
+
+            // Prefer the diagonal entry to preserve sparsity
+            if (m_pinv[k] < 0 && modulus(m_x[k]) >= pivot_tol * amax)
+                ipiv = k;
+
+            const T pivot = m_x[ipiv];
+            m_Ui.push_back(k);
+            m_Ux.push_back(pivot);
+            m_pinv[ipiv] = k;
+
+            // Store L(:,k), unit diagonal first
+            m_Li.push_back(ipiv);
+            m_Lx.push_back(T(1));
+            for (index_type px = top; px < n; ++px)
+            {
+                const index_type i = m_xi[px];
+                if (m_pinv[i] < 0)
+                {
+                    m_Li.push_back(i);
+                    m_Lx.push_back(m_x[i] / pivot);
+                }
+                m_x[i] = T(0);
+            }
+        }
+        m_Lp[n] = m_Li.size();
+        m_Up[n] = m_Ui.size();
+
+        // Express row indices of L in pivot order
+        for (auto &i : m_Li)
+            i = m_pinv[i];
+
+        return true;
+    }
+
+    /** Solve A x = b using the factors. b is overwritten with x. */
+    void solve(vector<T> &b) const
+    {
+        const index_type n = m_n;
+        vector<T> x(n);
+
+        // x = P b
+        for (index_type i = 0; i < n; ++i)
+            x[m_pinv[i]] = b[i];
+
+        // x = L \ x
+        for (index_type j = 0; j < n; ++j)
+        {
+            const T xj = x[j];
+            for (index_type p = m_Lp[j] + 1; p < m_Lp[j + 1]; ++p)
+                x[m_Li[p]] -= m_Lx[p] * xj;
+        }
+
+        // x = U \ x
+        for (index_type j = n - 1; j >= 0; --j)
+        {
+            x[j] /= m_Ux[m_Up[j + 1] - 1];
+            const T xj = x[j];
+            for (index_type p = m_Up[j]; p < m_Up[j + 1] - 1; ++p)
+                x[m_Ui[p]] -= m_Ux[p] * xj;
+        }
+
+        b.swap(x);
+    }
+};
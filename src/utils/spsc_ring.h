@@ -0,0 +1,65 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+using std::vector;
+using std::size_t;
+
+/** Bounded lock-free queue between one producer and one consumer thread.
+ *
+ * The capacity is rounded up to a power of two. The producer only writes
+ * `m_tail` and the consumer only writes `m_head`, each with release
+ * semantics, so that an element is fully written before the other side can
+ * see it. The two indices sit on separate cache lines to avoid false
+ * sharing between the threads.
+ */
+template <class T>
+class SpscRing {
+private:
+    vector<T> m_buffer;
+    size_t m_mask;
+    alignas(64) std::atomic<size_t> m_head{0}; // next element to pop
+    alignas(64) std::atomic<size_t> m_tail{0}; // next slot to push
+
+public:
+    explicit SpscRing(size_t capacity)
+    {
+        size_t n = 1;
+        while (n < capacity)
+            n <<= 1;
+        m_buffer.resize(n);
+        m_mask = n - 1;
+    }
+
+    inline size_t capacity() const { return m_buffer.size(); }
+
+    /** Producer side: returns false if the ring is full */
+    inline bool try_push(const T &value)
+    {
+        const size_t tail = m_tail.load(std::memory_order_relaxed);
+        if (tail - m_head.load(std::memory_order_acquire) == m_buffer.size())
+            return false;
+        m_buffer[tail & m_mask] = value;
+        m_tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    /** Consumer side: returns false if the ring is empty */
+    inline bool try_pop(T &value)
+    {
+        const size_t head = m_head.load(std::memory_order_relaxed);
+        if (head == m_tail.load(std::memory_order_acquire))
+            return false;
+        value = m_buffer[head & m_mask];
+        m_head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    /** Number of elements, exact only when called from one of the sides */
+    inline size_t size() const
+    {
+        return m_tail.load(std::memory_order_acquire) - m_head.load(std::memory_order_acquire);
+    }
+};
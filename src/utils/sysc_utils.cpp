@@ -67,4 +67,21 @@ set<sc_object *> sc_get_all_object() {
             all_objects.insert(child);
     }
     return all_objects;
-}
\ No newline at end of file
+}
+
+size_t sc_set_processes_enabled(sc_module *mod, bool enabled)
+{
+    size_t n = 0;
+    for (auto obj : mod->get_child_objects())
+    {
+        sc_process_handle h(obj);
+        if (!h.valid())
+            continue;
+        if (enabled)
+            h.enable();
+        else
+            h.disable();
+        ++n;
+    }
+    return n;
+}
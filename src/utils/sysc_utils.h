@@ -22,6 +22,10 @@ set<sc_module *> sc_get_all_module();
 // Return vector containing all sc_object registered with engine
 set<sc_object *> sc_get_all_object();
 
+// Enable or disable the processes of a module (not those of its children
+// modules), return the number of processes
+size_t sc_set_processes_enabled(sc_module *mod, bool enabled);
+
 // Return vector containing all sc_module of a certain type
 template<typename T>
 set<T *> sc_get_all_module_by_type();
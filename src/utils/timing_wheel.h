@@ -0,0 +1,206 @@
+#pragma once
+
+#include <cassert>
+#include <cstdint>
+#include <limits>
+#include <utility>
+#include <vector>
+
+using std::vector;
+using std::size_t;
+
+/** Hierarchical timing wheel over integer timestamps.
+ *
+ * Timestamps are split in digits of `BITS` bits; level `l` of the wheel holds
+ * the entries whose highest digit differing from the current time is digit
+ * `l`, in the slot given by that digit. Levels cover the full 64-bit range,
+ * so there is no overflow list.
+ *
+ * - `push()` is O(1): it computes the level from the XOR of the timestamp
+ *   with the current time and appends to a slot.
+ * - `next_time()` is O(LEVELS): it looks for the first occupied slot using
+ *   one occupancy bitmap per level.
+ * - `pop_due()` advances the wheel, cascading higher-level slots down as
+ *   they are reached. Each entry is cascaded at most LEVELS times, so the
+ *   advance is O(1) amortised per entry.
+ *
+ * Entries are identified by a handle which stays valid until the entry is
+ * popped, so that callers can update a pending value in place.
+ *
+ * The wheel time never goes backwards: timestamps pushed must not be earlier
+ * than the last timestamp passed to `pop_due()`.
+ */
+template <class T>
+class TimingWheel {
+public:
+    typedef uint64_t time_type;
+    typedef uint32_t handle_type;
+
+    static constexpr unsigned BITS = 6;
+    static constexpr unsigned SLOTS = 1u << BITS;
+    static constexpr unsigned LEVELS = (64 + BITS - 1) / BITS;
+
+private:
+    struct Node {
+        time_type t;
+        T value;
+    };
+
+    vector<Node> m_nodes;
+    vector<handle_type> m_free;
+
+    vector<handle_type> m_slots[LEVELS][SLOTS];
+    time_type m_slot_min[LEVELS][SLOTS];
+    uint64_t m_occupied[LEVELS] = {};
+
+    time_type m_now = 0;
+    size_t m_size = 0;
+
+    static inline unsigned digit(time_type t, unsigned level)
+    {
+        return (t >> (BITS * level)) & (SLOTS - 1);
+    }
+
+    inline unsigned level_of(time_type t) const
+    {
+        time_type x = t ^ m_now;
+        if (x == 0)
+            return 0;
+        return (63 - __builtin_clzll(x)) / BITS;
+    }
+
+    inline void link(handle_type h)
+    {
+        const time_type t = m_nodes[h].t;
+        const unsigned l = level_of(t);
+        const unsigned s = digit(t, l);
+        auto &slot = m_slots[l][s];
+        if (slot.empty() || t < m_slot_min[l][s])
+            m_slot_min[l][s] = t;
+        slot.push_back(h);
+        m_occupied[l] |= (1ULL << s);
+    }
+
+    // Find the first occupied slot (lowest level first).
+    // Entries of lower levels are always earlier than those of higher levels.
+    inline bool first_slot(unsigned &level, unsigned &slot) const
+    {
+        for (unsigned l = 0; l < LEVELS; ++l)
+        {
+            uint64_t occ = m_occupied[l] & (~0ULL << digit(m_now, l));
+            if (occ)
+            {
+                level = l;
+                slot = __builtin_ctzll(occ);
+                return true;
+            }
+        }
+        return false;
+    }
+
+public:
+    TimingWheel() {}
+
+    /** Schedule value at time t and return its handle */
+    handle_type push(time_type t, const T &value)
+    {
+        assert(t >= m_now);
+        handle_type h;
+        if (m_free.empty())
+        {
+            h = m_nodes.size();
+            m_nodes.push_back(Node{t, value});
+        }
+        else
+        {
+            h = m_free.back();
+            m_free.pop_back();
+            m_nodes[h] = Node{t, value};
+        }
+        link(h);
+        ++m_size;
+        return h;
+    }
+
+    /** Access a pending value by its handle */
+    inline T &at(handle_type h)
+    {
+        return m_nodes[h].value;
+    }
+
+    /** Earliest pending timestamp (wheel must not be empty) */
+    time_type next_time() const
+    {
+        unsigned l = 0, s = 0;
+        bool found = first_slot(l, s);
+        (void)found;
+        assert(found);
+        if (l == 0)
+            return (m_now & ~(time_type)(SLOTS - 1)) | s;
+        return m_slot_min[l][s];
+    }
+
+    /** Move all entries due at time t to out (in scheduling order).
+     *
+     * Returns the number of entries moved. Nothing happens if the earliest
+     * pending entry is later than t.
+     */
+    size_t pop_due(time_type t, vector<T> &out)
+    {
+        if (m_size == 0 || next_time() != t)
+            return 0;
+
+        // Cascade higher levels until the earliest slot is at level 0
+        unsigned l = 0, s = 0;
+        while (first_slot(l, s) && l > 0)
+        {
+            // Advance to the beginning of the slot
+            const unsigned shift = BITS * l;
+            time_type prefix = (shift + BITS >= 64) ? 0 : (m_now >> (shift + BITS)) << (shift + BITS);
+            m_now = prefix | ((time_type)s << shift);
+
+            vector<handle_type> nodes;
+            nodes.swap(m_slots[l][s]);
+            m_occupied[l] &= ~(1ULL << s);
+            for (const auto &h : nodes)
+                link(h);
+        }
+
+        assert(l == 0);
+        m_now = t;
+        auto &slot = m_slots[0][s];
+        size_t n = slot.size();
+        for (const auto &h : slot)
+        {
+            out.push_back(std::move(m_nodes[h].value));
+            m_free.push_back(h);
+        }
+        slot.clear();
+        m_occupied[0] &= ~(1ULL << s);
+        m_size -= n;
+        return n;
+    }
+
+    void clear()
+    {
+        for (unsigned l = 0; l < LEVELS; ++l)
+        {
+            for (unsigned s = 0; s < SLOTS; ++s)
+                m_slots[l][s].clear();
+            m_occupied[l] = 0;
+        }
+        m_nodes.clear();
+        m_free.clear();
+        m_size = 0;
+    }
+
+    inline size_t size() const
+    {
+        return m_size;
+    }
+
+    inline bool empty() const
+    {
+        return m_size == 0;
+    }
+};
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+using std::vector;
+using std::size_t;
+
+/** Dense store of one value per wavelength, indexed by wavelength id.
+ *
+ * Wavelength ids are small consecutive integers (indices in
+ * `OpticalSignal::wavelength_registry`), so values are kept in a
+ * contiguous vector instead of a std::map: a lookup is a plain index and
+ * writing to a new wavelength only allocates when the store grows. A
+ * presence flag keeps track of the wavelengths which were actually
+ * written, so that iterating over them visits the same entries as the map
+ * did, in increasing id order.
+ *
+ * Absent entries hold T(0), so sums over all wavelengths can simply run
+ * over values().
+ */
+template <class T>
+class WavelengthFieldStore {
+public:
+    typedef T value_type;
+    typedef uint32_t id_type;
+
+private:
+    vector<T> m_values;
+    vector<uint8_t> m_present;
+
+public:
+    WavelengthFieldStore() {}
+
+    /** Make room for wavelength ids in [0, n) */
+    inline void resize(size_t n)
+    {
+        if (n > m_values.size())
+        {
+            m_values.resize(n, T(0));
+            m_present.resize(n, 0);
+        }
+    }
+
+    inline size_t size() const { return m_values.size(); }
+
+    inline bool contains(id_type id) const
+    {
+        return id < m_present.size() && m_present[id];
+    }
+
+    /** Access the value at id, inserting T(0) if absent */
+    inline T &operator[](id_type id)
+    {
+        if (id >= m_values.size())
+            resize(id + 1);
+        m_present[id] = 1;
+        return m_values[id];
+    }
+
+    /** Value at id, or T(0) if absent (doesn't insert) */
+    inline T get(id_type id) const
+    {
+        return id < m_values.size() ? m_values[id] : T(0);
+    }
+
+    /** Insert value at id if absent */
+    inline void emplace(id_type id, const T &value)
+    {
+        if (!contains(id))
+            (*this)[id] = value;
+    }
+
+    inline void erase(id_type id)
+    {
+        if (id < m_values.size())
+        {
+            m_values[id] = T(0);
+            m_present[id] = 0;
+        }
+    }
+
+    /** Exchange the values (and presence) at ids a and b */
+    inline void swap(id_type a, id_type b)
+    {
+        resize(std::max(a, b) + 1);
+        std::swap(m_values[a], m_values[b]);
+        std::swap(m_present[a], m_present[b]);
+    }
+
+    /** Remove all values, keeping the allocated storage */
+    inline void clear()
+    {
+        std::fill(m_values.begin(), m_values.end(), T(0));
+        std::fill(m_present.begin(), m_present.end(), 0);
+    }
+
+    /** All values by wavelength id (absent entries are T(0)) */
+    inline const vector<T> &values() const { return m_values; }
+
+    /** Call f(id, value) for each present wavelength, in increasing id order */
+    template <class F>
+    inline void for_each(F f) const
+    {
+        const size_t n = m_values.size();
+        for (size_t id = 0; id < n; ++id)
+            if (m_present[id])
+                f(static_cast<id_type>(id), m_values[id]);
+    }
+};
@@ -0,0 +1,136 @@
+#include "wavelength_registry.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <limits>
+
+using std::cerr;
+using std::endl;
+
+WavelengthRegistry::WavelengthRegistry()
+    : m_size(0)
+{
+    for (auto &chunk : m_chunks)
+        chunk.store(nullptr, std::memory_order_relaxed);
+
+    // The first chunk always exists, so that operator[] never dereferences
+    // a null pointer for small ids (unregistered ids read as NaN)
+    double *chunk = new double[chunk_size];
+    std::fill(chunk, chunk + chunk_size, std::numeric_limits<double>::quiet_NaN());
+    m_chunks[0].store(chunk, std::memory_order_release);
+}
+
+WavelengthRegistry::~WavelengthRegistry()
+{
+    for (auto &chunk : m_chunks)
+        delete[] chunk.load(std::memory_order_relaxed);
+}
+
+int64_t WavelengthRegistry::key(const double &wavelength) const
+{
+    if (m_tolerance > 0 && std::isfinite(wavelength))
+        return static_cast<int64_t>(std::floor(wavelength / m_tolerance));
+
+    // Exact match on the bit pattern
+    int64_t k;
+    std::memcpy(&k, &wavelength, sizeof(k));
+    return k;
+}
+
+bool WavelengthRegistry::find_locked(const double &wavelength, id_type &id) const
+{
+    const int64_t k = key(wavelength);
+    if (m_tolerance > 0 && std::isfinite(wavelength))
+    {
+        // A wavelength within tolerance lies in this bucket or a neighbour
+        for (int64_t b = k - 1; b <= k + 1; ++b)
+        {
+            auto it = m_index.find(b);
+            if (it != m_index.end() && std::abs((*this)[it->second] - wavelength) <= m_tolerance)
+            {
+                id = it->second;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    auto it = m_index.find(k);
+    if (it == m_index.end())
+        return false;
+    id = it->second;
+    return true;
+}
+
+bool WavelengthRegistry::find(const double &wavelength, id_type &id) const
+{
+    std::shared_lock<std::shared_mutex> lock(m_mutex);
+    return find_locked(wavelength, id);
+}
+
+WavelengthRegistry::id_type WavelengthRegistry::id(const double &wavelength)
+{
+    id_type ret;
+    if (find(wavelength, ret))
+        return ret;
+
+    std::unique_lock<std::shared_mutex> lock(m_mutex);
+
+    // Another thread may have registered it in the meantime
+    if (find_locked(wavelength, ret))
+        return ret;
+
+    const size_t n = m_size.load(std::memory_order_relaxed);
+    if (n >= max_size)
+    {
+        cerr << "Error: too many wavelengths being used ." << endl;
+        exit(1);
+    }
+
+    double *chunk = m_chunks[n >> chunk_bits].load(std::memory_order_relaxed);
+    if (!chunk)
+    {
+        chunk = new double[chunk_size];
+        std::fill(chunk, chunk + chunk_size, std::numeric_limits<double>::quiet_NaN());
+        m_chunks[n >> chunk_bits].store(chunk, std::memory_order_release);
+    }
+    chunk[n & (chunk_size - 1)] = wavelength;
+
+    ret = static_cast<id_type>(n);
+    m_index.emplace(key(wavelength), ret);
+    m_size.store(n + 1, std::memory_order_release);
+    return ret;
+}
+
+double WavelengthRegistry::at(id_type id) const
+{
+    if (id >= size())
+    {
+        cerr << "Wavelength not found in global vector." << endl;
+        exit(1);
+    }
+    return (*this)[id];
+}
+
+void WavelengthRegistry::set_tolerance(double tolerance)
+{
+    std::unique_lock<std::shared_mutex> lock(m_mutex);
+    if (tolerance == m_tolerance)
+        return;
+    m_tolerance = tolerance;
+
+    // Rebuild the index with the new keys
+    m_index.clear();
+    const size_t n = m_size.load(std::memory_order_relaxed);
+    for (size_t i = 0; i < n; ++i)
+        m_index.emplace(key((*this)[i]), static_cast<id_type>(i));
+}
+
+double WavelengthRegistry::tolerance() const
+{
+    std::shared_lock<std::shared_mutex> lock(m_mutex);
+    return m_tolerance;
+}
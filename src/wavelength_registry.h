@@ -0,0 +1,76 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_map>
+
+/** Registry of the wavelengths used in the simulation.
+ *
+ * Signals only carry a wavelength id, which indexes this registry.
+ *
+ * - Looking up the id of a wavelength is a hash lookup. If it isn't known
+ *   yet, it is appended and gets the next id.
+ * - With a non-zero tolerance, a wavelength within tolerance of an already
+ *   registered one snaps to it, so that values computed in slightly
+ *   different ways (e.g. from a frequency) share the same id.
+ * - Reading a wavelength from its id is a plain array access (operator[])
+ *   or a range-checked one (at()).
+ *
+ * Registration may happen concurrently with reads and other registrations:
+ * values are stored in fixed-size chunks which are never moved, and the
+ * hash index is guarded by a reader/writer lock.
+ */
+class WavelengthRegistry {
+public:
+    typedef uint32_t id_type;
+
+    static constexpr unsigned chunk_bits = 12;
+    static constexpr size_t chunk_size = size_t(1) << chunk_bits;
+    static constexpr size_t max_chunks = 4096;
+    static constexpr size_t max_size = chunk_size * max_chunks;
+
+private:
+    std::atomic<double *> m_chunks[max_chunks];
+    std::atomic<size_t> m_size;
+
+    mutable std::shared_mutex m_mutex;
+    std::unordered_map<int64_t, id_type> m_index;
+    double m_tolerance = 0;
+
+    int64_t key(const double &wavelength) const;
+    bool find_locked(const double &wavelength, id_type &id) const;
+
+public:
+    WavelengthRegistry();
+    ~WavelengthRegistry();
+
+    WavelengthRegistry(const WavelengthRegistry &) = delete;
+    WavelengthRegistry &operator=(const WavelengthRegistry &) = delete;
+
+    /** Id of wavelength, registering it if needed */
+    id_type id(const double &wavelength);
+
+    /** Id of wavelength if it is registered (doesn't register it) */
+    bool find(const double &wavelength, id_type &id) const;
+
+    /** Wavelength for a registered id, without any check */
+    inline double operator[](id_type id) const
+    {
+        return m_chunks[id >> chunk_bits].load(std::memory_order_acquire)[id & (chunk_size - 1)];
+    }
+
+    /** Wavelength for id, exits with an error if it isn't registered */
+    double at(id_type id) const;
+
+    inline size_t size() const { return m_size.load(std::memory_order_acquire); }
+    inline bool empty() const { return size() == 0; }
+
+    /** Snap tolerance in m (0 for exact matching).
+     *
+     * Wavelengths already registered keep their id.
+     */
+    void set_tolerance(double tolerance);
+    double tolerance() const;
+};